@@ -14,11 +14,12 @@
 #define __PROCESS_DISPATCH_HPP__
 
 #include <functional>
-#include <memory> // TODO(benh): Replace shared_ptr with unique_ptr.
+#include <memory>
 #include <string>
 
 #include <process/process.hpp>
 
+#include <stout/lambda.hpp>
 #include <stout/preprocessor.hpp>
 #include <stout/result_of.hpp>
 
@@ -59,11 +60,12 @@ namespace internal {
 // this routine does not expect anything in particular about the
 // specified function (second argument). The semantics are simple: the
 // function gets applied/invoked with the process as its first
-// argument. Currently we wrap the function in a shared_ptr but this
-// will probably change in the future to unique_ptr (or a variant).
+// argument. The function is moved into the dispatch event (small
+// functions are stored inline, see 'lambda::CallableOnce') so that
+// dispatching does not need to allocate in the common case.
 void dispatch(
     const UPID& pid,
-    const std::shared_ptr<std::function<void(ProcessBase*)>>& f,
+    lambda::CallableOnce<void(ProcessBase*)>&& f,
     const Option<const std::type_info*>& functionType = None());
 
 
@@ -83,13 +85,12 @@ struct Dispatch<void>
   template <typename F>
   void operator()(const UPID& pid, F&& f)
   {
-    std::shared_ptr<std::function<void(ProcessBase*)>> f_(
-        new std::function<void(ProcessBase*)>(
-            [=](ProcessBase*) {
-              f();
-            }));
+    lambda::CallableOnce<void(ProcessBase*)> f_(
+        [=](ProcessBase*) {
+          f();
+        });
 
-    internal::dispatch(pid, f_);
+    internal::dispatch(pid, std::move(f_));
   }
 };
 
@@ -106,13 +107,12 @@ struct Dispatch<Future<R>>
   {
     std::shared_ptr<Promise<R>> promise(new Promise<R>());
 
-    std::shared_ptr<std::function<void(ProcessBase*)>> f_(
-        new std::function<void(ProcessBase*)>(
-            [=](ProcessBase*) {
-              promise->associate(f());
-            }));
+    lambda::CallableOnce<void(ProcessBase*)> f_(
+        [=](ProcessBase*) {
+          promise->associate(f());
+        });
 
-    internal::dispatch(pid, f_);
+    internal::dispatch(pid, std::move(f_));
 
     return promise->future();
   }
@@ -130,13 +130,12 @@ struct Dispatch
   {
     std::shared_ptr<Promise<R>> promise(new Promise<R>());
 
-    std::shared_ptr<std::function<void(ProcessBase*)>> f_(
-        new std::function<void(ProcessBase*)>(
-            [=](ProcessBase*) {
-              promise->set(f());
-            }));
+    lambda::CallableOnce<void(ProcessBase*)> f_(
+        [=](ProcessBase*) {
+          promise->set(f());
+        });
 
-    internal::dispatch(pid, f_);
+    internal::dispatch(pid, std::move(f_));
 
     return promise->future();
   }
@@ -156,16 +155,15 @@ struct Dispatch
 template <typename T>
 void dispatch(const PID<T>& pid, void (T::*method)())
 {
-  std::shared_ptr<std::function<void(ProcessBase*)>> f(
-      new std::function<void(ProcessBase*)>(
-          [=](ProcessBase* process) {
-            assert(process != nullptr);
-            T* t = dynamic_cast<T*>(process);
-            assert(t != nullptr);
-            (t->*method)();
-          }));
-
-  internal::dispatch(pid, f, &typeid(method));
+  lambda::CallableOnce<void(ProcessBase*)> f(
+      [=](ProcessBase* process) {
+        assert(process != nullptr);
+        T* t = dynamic_cast<T*>(process);
+        assert(t != nullptr);
+        (t->*method)();
+      });
+
+  internal::dispatch(pid, std::move(f), &typeid(method));
 }
 
 template <typename T>
@@ -192,16 +190,15 @@ void dispatch(const Process<T>* process, void (T::*method)())
       void (T::*method)(ENUM_PARAMS(N, P)),                             \
       ENUM_BINARY_PARAMS(N, A, a))                                      \
   {                                                                     \
-    std::shared_ptr<std::function<void(ProcessBase*)>> f(               \
-        new std::function<void(ProcessBase*)>(                          \
-            [=](ProcessBase* process) {                                 \
-              assert(process != nullptr);                               \
-              T* t = dynamic_cast<T*>(process);                         \
-              assert(t != nullptr);                                     \
-              (t->*method)(ENUM_PARAMS(N, a));                          \
-            }));                                                        \
+    lambda::CallableOnce<void(ProcessBase*)> f(                         \
+        [=](ProcessBase* process) {                                     \
+          assert(process != nullptr);                                   \
+          T* t = dynamic_cast<T*>(process);                             \
+          assert(t != nullptr);                                         \
+          (t->*method)(ENUM_PARAMS(N, a));                              \
+        });                                                             \
                                                                         \
-    internal::dispatch(pid, f, &typeid(method));                        \
+    internal::dispatch(pid, std::move(f), &typeid(method));             \
   }                                                                     \
                                                                         \
   template <typename T,                                                 \
@@ -237,16 +234,15 @@ Future<R> dispatch(const PID<T>& pid, Future<R> (T::*method)())
 {
   std::shared_ptr<Promise<R>> promise(new Promise<R>());
 
-  std::shared_ptr<std::function<void(ProcessBase*)>> f(
-      new std::function<void(ProcessBase*)>(
-          [=](ProcessBase* process) {
-            assert(process != nullptr);
-            T* t = dynamic_cast<T*>(process);
-            assert(t != nullptr);
-            promise->associate((t->*method)());
-          }));
+  lambda::CallableOnce<void(ProcessBase*)> f(
+      [=](ProcessBase* process) {
+        assert(process != nullptr);
+        T* t = dynamic_cast<T*>(process);
+        assert(t != nullptr);
+        promise->associate((t->*method)());
+      });
 
-  internal::dispatch(pid, f, &typeid(method));
+  internal::dispatch(pid, std::move(f), &typeid(method));
 
   return promise->future();
 }
@@ -275,16 +271,15 @@ Future<R> dispatch(const Process<T>* process, Future<R> (T::*method)())
   {                                                                     \
     std::shared_ptr<Promise<R>> promise(new Promise<R>());              \
                                                                         \
-    std::shared_ptr<std::function<void(ProcessBase*)>> f(               \
-        new std::function<void(ProcessBase*)>(                          \
-            [=](ProcessBase* process) {                                 \
-              assert(process != nullptr);                               \
-              T* t = dynamic_cast<T*>(process);                         \
-              assert(t != nullptr);                                     \
-              promise->associate((t->*method)(ENUM_PARAMS(N, a)));      \
-            }));                                                        \
+    lambda::CallableOnce<void(ProcessBase*)> f(                         \
+        [=](ProcessBase* process) {                                     \
+          assert(process != nullptr);                                   \
+          T* t = dynamic_cast<T*>(process);                             \
+          assert(t != nullptr);                                         \
+          promise->associate((t->*method)(ENUM_PARAMS(N, a)));          \
+        });                                                             \
                                                                         \
-    internal::dispatch(pid, f, &typeid(method));                        \
+    internal::dispatch(pid, std::move(f), &typeid(method));             \
                                                                         \
     return promise->future();                                           \
   }                                                                     \
@@ -324,16 +319,15 @@ Future<R> dispatch(const PID<T>& pid, R (T::*method)())
 {
   std::shared_ptr<Promise<R>> promise(new Promise<R>());
 
-  std::shared_ptr<std::function<void(ProcessBase*)>> f(
-      new std::function<void(ProcessBase*)>(
-          [=](ProcessBase* process) {
-            assert(process != nullptr);
-            T* t = dynamic_cast<T*>(process);
-            assert(t != nullptr);
-            promise->set((t->*method)());
-          }));
+  lambda::CallableOnce<void(ProcessBase*)> f(
+      [=](ProcessBase* process) {
+        assert(process != nullptr);
+        T* t = dynamic_cast<T*>(process);
+        assert(t != nullptr);
+        promise->set((t->*method)());
+      });
 
-  internal::dispatch(pid, f, &typeid(method));
+  internal::dispatch(pid, std::move(f), &typeid(method));
 
   return promise->future();
 }
@@ -362,16 +356,15 @@ Future<R> dispatch(const Process<T>* process, R (T::*method)())
   {                                                                     \
     std::shared_ptr<Promise<R>> promise(new Promise<R>());              \
                                                                         \
-    std::shared_ptr<std::function<void(ProcessBase*)>> f(               \
-        new std::function<void(ProcessBase*)>(                          \
-            [=](ProcessBase* process) {                                 \
-              assert(process != nullptr);                               \
-              T* t = dynamic_cast<T*>(process);                         \
-              assert(t != nullptr);                                     \
-              promise->set((t->*method)(ENUM_PARAMS(N, a)));            \
-            }));                                                        \
+    lambda::CallableOnce<void(ProcessBase*)> f(                         \
+        [=](ProcessBase* process) {                                     \
+          assert(process != nullptr);                                   \
+          T* t = dynamic_cast<T*>(process);                             \
+          assert(t != nullptr);                                         \
+          promise->set((t->*method)(ENUM_PARAMS(N, a)));                \
+        });                                                             \
                                                                         \
-    internal::dispatch(pid, f, &typeid(method));                        \
+    internal::dispatch(pid, std::move(f), &typeid(method));             \
                                                                         \
     return promise->future();                                           \
   }                                                                     \
@@ -13,6 +13,7 @@
 #ifndef __PROCESS_EVENT_HPP__
 #define __PROCESS_EVENT_HPP__
 
+#include <atomic>
 #include <memory> // TODO(benh): Replace shared_ptr with unique_ptr.
 
 #include <process/future.hpp>
@@ -26,6 +27,7 @@
 namespace process {
 
 // Forward declarations.
+class EventQueue;
 class ProcessBase;
 struct MessageEvent;
 struct DispatchEvent;
@@ -47,6 +49,12 @@ struct EventVisitor
 
 struct Event
 {
+  Event() : next(nullptr) {}
+
+  // Copies of an event (e.g., made by a filter) are not linked into
+  // any event queue.
+  Event(const Event&) : next(nullptr) {}
+
   virtual ~Event() {}
 
   virtual void visit(EventVisitor* visitor) const = 0;
@@ -81,6 +89,12 @@ struct Event
     }
     return *result;
   }
+
+private:
+  friend class EventQueue;
+
+  // Next event in the event queue of a process (see EventQueue).
+  std::atomic<Event*> next;
 };
 
 
@@ -149,10 +163,10 @@ struct DispatchEvent : Event
 {
   DispatchEvent(
       const UPID& _pid,
-      const std::shared_ptr<lambda::function<void(ProcessBase*)>>& _f,
+      lambda::CallableOnce<void(ProcessBase*)>&& _f,
       const Option<const std::type_info*>& _functionType)
     : pid(_pid),
-      f(_f),
+      f(std::move(_f)),
       functionType(_functionType)
   {}
 
@@ -161,11 +175,18 @@ struct DispatchEvent : Event
     visitor->visit(*this);
   }
 
+  // Dispatch events are allocated from a per thread pool of recycled
+  // events, see process.cpp.
+  static void* operator new(size_t size);
+  static void operator delete(void* event, size_t size);
+
   // PID receiving the dispatch.
   const UPID pid;
 
-  // Function to get invoked as a result of this dispatch event.
-  const std::shared_ptr<lambda::function<void(ProcessBase*)>> f;
+  // Function to get invoked as a result of this dispatch event. It is
+  // mutable because it gets consumed by the (only) invocation while
+  // visitors only ever see a const event.
+  mutable lambda::CallableOnce<void(ProcessBase*)> f;
 
   const Option<const std::type_info*> functionType;
 
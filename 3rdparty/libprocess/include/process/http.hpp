@@ -392,6 +392,12 @@ public:
     // was unable to continue reading!
     Future<Nothing> readerClosed() const;
 
+    // Returns Nothing once the reader has read all the data written
+    // so far and is waiting for more, or once the read-end is closed.
+    // This lets a writer produce data only as fast as the reader
+    // consumes it.
+    Future<Nothing> drained() const;
+
     // Comparison operators useful for checking connection equality.
     bool operator==(const Writer& other) const { return data == other.data; }
     bool operator!=(const Writer& other) const { return !(*this == other); }
@@ -439,6 +445,9 @@ private:
     // empty strings as they serve as a signal for end-of-file.
     std::queue<std::string> writes;
 
+    // Represents writers waiting for the reader to drain the pipe.
+    std::queue<Owned<Promise<Nothing>>> drains;
+
     // Signals when the read-end is closed before the write-end.
     Promise<Nothing> readerClosure;
 
@@ -544,6 +553,12 @@ struct Accepted : Response
 };
 
 
+struct NotModified : Response
+{
+  NotModified() : Response(Status::NOT_MODIFIED) {}
+};
+
+
 struct TemporaryRedirect : Response
 {
   explicit TemporaryRedirect(const std::string& url)
@@ -854,6 +869,11 @@ Request createRequest(
  * Asynchronously sends an HTTP request to the process and
  * returns the HTTP response once the entire response is received.
  *
+ * Unless the response is streamed, the request is sent on a
+ * Keep-Alive connection from a pool that is shared by all the
+ * callers, so that subsequent requests to the same server reuse it
+ * (see LIBPROCESS_HTTP_POOL_CAPACITY).
+ *
  * @param streamedResponse Being true indicates the HTTP response will
  *     be 'PIPE' type, and caller must read the response body from the
  *     Pipe::Reader, otherwise, the HTTP response will be 'BODY' type.
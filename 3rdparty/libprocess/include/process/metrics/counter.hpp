@@ -43,6 +43,11 @@ public:
     return static_cast<double>(data->value.load());
   }
 
+  virtual Option<double> peek() const
+  {
+    return static_cast<double>(data->value.load());
+  }
+
   void reset()
   {
     data->value.store(0);
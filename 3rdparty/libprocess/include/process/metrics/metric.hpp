@@ -36,6 +36,13 @@ public:
 
   virtual Future<double> value() const = 0;
 
+  // Returns the current value if it can be read without waiting on
+  // another process, which lets a snapshot skip waiting for it.
+  virtual Option<double> peek() const
+  {
+    return None();
+  }
+
   const std::string& name() const
   {
     return data->name;
@@ -14,6 +14,7 @@
 #define __PROCESS_METRICS_METRICS_HPP__
 
 #include <string>
+#include <utility>
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -21,8 +22,10 @@
 #include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <process/metrics/counter.hpp>
 #include <process/metrics/metric.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
@@ -58,7 +61,9 @@ private:
       const Option<std::string>& _authenticationRealm)
     : ProcessBase("metrics"),
       limiter(_limiter),
-      authenticationRealm(_authenticationRealm)
+      authenticationRealm(_authenticationRealm),
+      snapshot_cache_hits("metrics/snapshot_cache_hits"),
+      snapshot_cache_misses("metrics/snapshot_cache_misses")
   {}
 
   // Non-copyable, non-assignable.
@@ -74,8 +79,9 @@ private:
 
   static Future<hashmap<std::string, double>> __snapshot(
       const Option<Duration>& timeout,
+      hashmap<std::string, double> snapshot,
       const hashmap<std::string, Future<double>>& metrics,
-      const hashmap<std::string, Option<Statistics<double>>>& statistics);
+      const hashmap<std::string, Statistics<double>>& statistics);
 
   // The Owned<Metric> is an explicit copy of the Metric passed to 'add'.
   hashmap<std::string, Owned<Metric>> metrics;
@@ -89,6 +95,15 @@ private:
 
   // The authentication realm that metrics HTTP endpoints are installed into.
   const Option<std::string> authenticationRealm;
+
+  // The serialized snapshot being taken for the snapshot endpoint,
+  // along with the timeout it was requested with. Requests with the
+  // same timeout that arrive while it is pending share it instead of
+  // taking (and being rate limited for) another one.
+  Option<std::pair<Option<Duration>, Future<std::string>>> pending;
+
+  Counter snapshot_cache_hits;
+  Counter snapshot_cache_misses;
 };
 
 }  // namespace internal {
@@ -356,19 +356,11 @@ protected:
 
   /**
    * Returns the number of events of the given type currently on the event
-   * queue.
+   * queue. Supported for `MessageEvent`, `DispatchEvent`, `HttpEvent`,
+   * `ExitedEvent` and `TerminateEvent`.
    */
   template <typename T>
-  size_t eventCount()
-  {
-    size_t count = 0U;
-
-    synchronized (mutex) {
-      count = std::count_if(events.begin(), events.end(), isEventType<T>);
-    }
-
-    return count;
-  }
+  size_t eventCount();
 
 private:
   friend class SocketManager;
@@ -377,7 +369,7 @@ private:
   friend void* schedule(void*);
 
   // Process states.
-  enum
+  enum ProcessState
   {
     BOTTOM,
     READY,
@@ -385,15 +377,14 @@ private:
     BLOCKED,
     TERMINATING,
     TERMINATED
-  } state;
+  };
 
-  template <typename T>
-  static bool isEventType(const Event* event)
-  {
-    return event->is<T>();
-  }
+  // Updated without holding 'mutex' so that events can be enqueued
+  // (and the process made runnable) without taking a lock.
+  std::atomic<ProcessState> state;
 
-  // Mutex protecting internals.
+  // Mutex serializing the consumer side of the event queue (i.e.,
+  // dequeueing and walking the events).
   // TODO(benh): Consider replacing with a spinlock, on multi-core systems.
   std::recursive_mutex mutex;
 
@@ -446,12 +437,18 @@ private:
   // Static assets(s) to provide.
   std::map<std::string, Asset> assets;
 
-  // Queue of received events, requires lock()ed access!
-  std::deque<Event*> events;
+  // Queue of received events. Enqueueing is lock-free while
+  // dequeueing requires lock()ed access!
+  Owned<EventQueue> events;
 
   // Active references.
   std::atomic_long refs;
 
+  // Index of the worker thread that last resumed this process (or -1
+  // if it has not been resumed by a worker yet). Used by the
+  // ProcessManager to keep a process on the same worker's run queue.
+  std::atomic_long worker;
+
   // Process PID.
   UPID pid;
 };
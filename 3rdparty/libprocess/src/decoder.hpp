@@ -19,16 +19,22 @@
 
 #include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <process/http.hpp>
+#include <process/message.hpp>
+#include <process/pid.hpp>
 #include <process/socket.hpp>
 
 #include <stout/foreach.hpp>
 #include <stout/gzip.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 
+#include "framing.hpp"
+
 
 #if !(HTTP_PARSER_VERSION_MAJOR >= 2)
 #error HTTP Parser version >= 2 required.
@@ -43,7 +49,13 @@ class DataDecoder
 {
 public:
   explicit DataDecoder(const network::Socket& _s)
-    : s(_s), failure(false), request(nullptr)
+    : s(_s),
+      failure(false),
+      offered(false),
+      accepting(false),
+      boundary(false),
+      binary(false),
+      request(nullptr)
   {
     settings.on_message_begin = &DataDecoder::on_message_begin;
     settings.on_url = &DataDecoder::on_url;
@@ -60,13 +72,42 @@ public:
     parser.data = this;
   }
 
+  // Decodes the requests, and the messages sent in the binary framing
+  // (see framing.hpp) which are returned by `messages()`.
   std::deque<http::Request*> decode(const char* data, size_t length)
   {
-    size_t parsed = http_parser_execute(&parser, &settings, data, length);
+    while (length > 0 && !failure) {
+      // Once the sender offered the binary framing, it might switch to
+      // it after any request, which we detect from the next byte.
+      if (boundary) {
+        boundary = false;
+        binary = data[0] == framing::INTERN || data[0] == framing::MESSAGE;
+      }
 
-    if (parsed != length) {
-      // TODO(bmahler): joyent/http-parser exposes error reasons.
-      failure = true;
+      if (binary) {
+        buffer.append(data, length);
+        frames();
+        break;
+      }
+
+      size_t parsed = http_parser_execute(&parser, &settings, data, length);
+
+      // The parser gets paused at the end of each request once the
+      // sender offered the binary framing, see `on_message_complete`.
+      if (HTTP_PARSER_ERRNO(&parser) == HPE_PAUSED) {
+        http_parser_pause(&parser, 0);
+        boundary = true;
+        data += parsed;
+        length -= parsed;
+        continue;
+      }
+
+      if (parsed != length) {
+        // TODO(bmahler): joyent/http-parser exposes error reasons.
+        failure = true;
+      }
+
+      break;
     }
 
     if (!requests.empty()) {
@@ -78,6 +119,24 @@ public:
     return std::deque<http::Request*>();
   }
 
+  // Returns the messages decoded from the binary framing. Note that
+  // the address of their receivers is not set.
+  std::deque<Message*> messages()
+  {
+    std::deque<Message*> result;
+    std::swap(result, decoded);
+    return result;
+  }
+
+  // Returns true (once) after the sender offered the binary framing,
+  // in which case the caller must write back `framing::ACCEPTED`.
+  bool accept()
+  {
+    bool result = accepting;
+    accepting = false;
+    return result;
+  }
+
   bool failed() const
   {
     return failure;
@@ -245,11 +304,105 @@ private:
         static_cast<char>(decoder->request->body.length());
     }
 
+    // Only libprocess messages can offer the binary framing.
+    if (!decoder->offered &&
+        decoder->request->headers.contains("Libprocess-From") &&
+        decoder->request->headers.get(framing::HEADER) ==
+          std::string(framing::BINARY)) {
+      decoder->offered = true;
+      decoder->accepting = true;
+    }
+
+    if (decoder->offered) {
+      http_parser_pause(p, 1);
+    }
+
     decoder->requests.push_back(decoder->request);
     decoder->request = nullptr;
     return 0;
   }
 
+  // Decodes the complete frames in 'buffer'.
+  void frames()
+  {
+    size_t index = 0;
+
+    while (index < buffer.size()) {
+      const char* data = buffer.data() + index;
+      const size_t length = buffer.size() - index;
+
+      if (data[0] == framing::INTERN) {
+        if (length < framing::INTERN_HEADER_SIZE) {
+          break;
+        }
+
+        const uint32_t id = framing::read(data + 1);
+        const uint32_t size = framing::read(data + 5);
+
+        if (length - framing::INTERN_HEADER_SIZE < size) {
+          break;
+        }
+
+        if (id > interned.size() || id >= framing::MAX_INTERNED) {
+          failure = true;
+          break;
+        }
+
+        std::string value(data + framing::INTERN_HEADER_SIZE, size);
+
+        if (id == interned.size()) {
+          interned.push_back(std::move(value));
+        } else {
+          interned[id] = std::move(value);
+          pids.erase(id);
+        }
+
+        index += framing::INTERN_HEADER_SIZE + size;
+      } else if (data[0] == framing::MESSAGE) {
+        if (length < framing::MESSAGE_HEADER_SIZE) {
+          break;
+        }
+
+        const uint32_t from = framing::read(data + 1);
+        const uint32_t to = framing::read(data + 5);
+        const uint32_t name = framing::read(data + 9);
+        const uint32_t size = framing::read(data + 13);
+
+        if (length - framing::MESSAGE_HEADER_SIZE < size) {
+          break;
+        }
+
+        if (from >= interned.size() ||
+            to >= interned.size() ||
+            name >= interned.size()) {
+          failure = true;
+          break;
+        }
+
+        // Parsing a PID is comparatively expensive, hence we only do
+        // it once for each sender.
+        if (!pids.contains(from)) {
+          pids[from] = UPID(interned[from]);
+        }
+
+        Message* message = new Message();
+        message->name = interned[name];
+        message->from = pids.at(from);
+        message->to.id = interned[to];
+        message->body.assign(data + framing::MESSAGE_HEADER_SIZE, size);
+
+        decoded.push_back(message);
+
+        index += framing::MESSAGE_HEADER_SIZE + size;
+      } else {
+        failure = true;
+        break;
+      }
+    }
+
+    buffer.erase(0, index);
+  }
+
   const network::Socket s; // The socket this decoder is associated with.
 
   bool failure;
@@ -268,9 +421,28 @@ private:
   std::string query;
   std::string url;
 
+  // Whether the sender offered the binary framing, and whether the
+  // offer still needs to be accepted.
+  bool offered;
+  bool accepting;
+
+  // Whether the parser is at the end of a request, after which the
+  // sender might have switched to the binary framing.
+  bool boundary;
+
+  // Whether the sender switched to the binary framing.
+  bool binary;
+
+  // The data received in the binary framing that is not decoded yet.
+  std::string buffer;
+
+  std::vector<std::string> interned;
+  hashmap<uint32_t, UPID> pids;
+
   http::Request* request;
 
   std::deque<http::Request*> requests;
+  std::deque<Message*> decoded;
 };
 
 
@@ -18,6 +18,8 @@
 
 #include <map>
 #include <sstream>
+#include <string>
+#include <utility>
 
 #include <process/http.hpp>
 #include <process/process.hpp>
@@ -27,6 +29,9 @@
 #include <stout/hashmap.hpp>
 #include <stout/numify.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
+
+#include "framing.hpp"
 
 
 namespace process {
@@ -68,8 +73,8 @@ private:
 class DataEncoder : public Encoder
 {
 public:
-  DataEncoder(const network::Socket& s, const std::string& _data)
-    : Encoder(s), data(_data), index(0) {}
+  DataEncoder(const network::Socket& s, std::string _data)
+    : Encoder(s), data(std::move(_data)), index(0) {}
 
   virtual ~DataEncoder() {}
 
@@ -107,8 +112,20 @@ private:
 class MessageEncoder : public DataEncoder
 {
 public:
-  MessageEncoder(const network::Socket& s, Message* _message)
-    : DataEncoder(s, encode(_message)), message(_message) {}
+  // If 'connection' is not null, the message is encoded in the framing
+  // negotiated for it (see framing.hpp), otherwise in HTTP.
+  MessageEncoder(
+      const network::Socket& s,
+      Message* _message,
+      framing::Connection* connection = nullptr)
+    : DataEncoder(s, encode(_message, connection)), message(_message) {}
+
+  // Takes the data of the message as already encoded, see `frame()`.
+  MessageEncoder(
+      const network::Socket& s,
+      Message* _message,
+      std::string data)
+    : DataEncoder(s, std::move(data)), message(_message) {}
 
   virtual ~MessageEncoder()
   {
@@ -117,8 +134,23 @@ public:
     }
   }
 
-  static std::string encode(Message* message)
+  // Releases the ownership of the message, e.g., to encode it again
+  // for another connection.
+  Message* release()
   {
+    Message* result = message;
+    message = nullptr;
+    return result;
+  }
+
+  static std::string encode(
+      Message* message,
+      framing::Connection* connection = nullptr)
+  {
+    if (message != nullptr && connection != nullptr && connection->binary) {
+      return binary(*message, connection);
+    }
+
     std::ostringstream out;
 
     if (message != nullptr) {
@@ -138,6 +170,11 @@ public:
           << "Connection: Keep-Alive\r\n"
           << "Host: \r\n";
 
+      if (connection != nullptr && !connection->offered) {
+        out << framing::HEADER << ": " << framing::BINARY << "\r\n";
+        connection->offered = true;
+      }
+
       if (message->body.size() > 0) {
         out << "Transfer-Encoding: chunked\r\n\r\n"
             << std::hex << message->body.size() << "\r\n";
@@ -153,7 +190,69 @@ public:
     return out.str();
   }
 
+  // Encodes the MESSAGE frame of 'message' in the binary framing,
+  // leaving the IDs of its strings to be filled in by `intern()`. This
+  // allows copying the body without holding the lock on the
+  // connection the message is sent on.
+  static std::string frame(const Message& message)
+  {
+    std::string data;
+
+    data.reserve(framing::MESSAGE_HEADER_SIZE + message.body.size());
+
+    data.push_back(static_cast<char>(framing::MESSAGE));
+    framing::append(&data, 0); // From, see `intern()`.
+    framing::append(&data, 0); // To, see `intern()`.
+    framing::append(&data, 0); // Name, see `intern()`.
+    framing::append(&data, static_cast<uint32_t>(message.body.size()));
+    data.append(message.body);
+
+    return data;
+  }
+
+  // Fills in the IDs of the strings of 'message' in its MESSAGE frame
+  // (see `frame()`) as interned on 'connection'. Returns the INTERN
+  // frames that must be sent ahead of it, if any.
+  static std::string intern(
+      const Message& message,
+      framing::Connection* connection,
+      std::string* frame)
+  {
+    CHECK_GE(frame->size(), framing::MESSAGE_HEADER_SIZE);
+
+    // Make sure that the strings of this message do not get their
+    // IDs reassigned while encoding it.
+    if (connection->interned.size() + 3 > framing::MAX_INTERNED) {
+      connection->interned.clear();
+    }
+
+    std::string data;
+
+    const uint32_t from =
+      framing::intern(connection, stringify(message.from), &data);
+    const uint32_t to = framing::intern(connection, message.to.id, &data);
+    const uint32_t name = framing::intern(connection, message.name, &data);
+
+    framing::write(&(*frame)[1], from);
+    framing::write(&(*frame)[5], to);
+    framing::write(&(*frame)[9], name);
+
+    return data;
+  }
+
 private:
+  static std::string binary(
+      const Message& message,
+      framing::Connection* connection)
+  {
+    std::string frame = MessageEncoder::frame(message);
+    std::string data = intern(message, connection, &frame);
+
+    data.append(frame);
+
+    return data;
+  }
+
   Message* message;
 };
 
@@ -251,8 +350,13 @@ public:
 class FileEncoder : public Encoder
 {
 public:
-  FileEncoder(const network::Socket& s, int _fd, size_t _size)
-    : Encoder(s), fd(_fd), size(_size), index(0) {}
+  // Sends 'size' bytes of the file starting at 'offset'.
+  FileEncoder(
+      const network::Socket& s,
+      int _fd,
+      size_t _size,
+      off_t _offset = 0)
+    : Encoder(s), fd(_fd), size(_size), offset(_offset), index(0) {}
 
   virtual ~FileEncoder()
   {
@@ -264,11 +368,11 @@ public:
     return Encoder::FILE;
   }
 
-  virtual int next(off_t* offset, size_t* length)
+  virtual int next(off_t* _offset, size_t* length)
   {
     off_t temp = index;
     index = static_cast<off_t>(size);
-    *offset = temp;
+    *_offset = offset + temp;
     *length = size - temp;
     return fd;
   }
@@ -288,6 +392,7 @@ public:
 private:
   int fd;
   size_t size;
+  off_t offset;
   off_t index;
 };
 
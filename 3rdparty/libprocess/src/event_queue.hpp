@@ -0,0 +1,295 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+#ifndef __PROCESS_EVENT_QUEUE_HPP__
+#define __PROCESS_EVENT_QUEUE_HPP__
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <process/event.hpp>
+
+namespace process {
+
+// The queue of events ("mailbox") of a process.
+//
+// Events can be enqueued concurrently by any number of threads
+// without taking a lock, while dequeueing (and walking the queue for
+// introspection) must be serialized by the caller, which is what
+// 'ProcessBase::mutex' is used for. Events are linked intrusively
+// (see 'Event::next') so enqueueing does not allocate.
+//
+// Injected events are kept on a separate lane that gets drained
+// before the regular events, which gives them the same "jump the
+// queue" semantics as pushing onto the front of a deque.
+//
+// The consumer may dequeue events ahead of serving them (see
+// 'batch' and 'ProcessManager::resume'), in which case the queue
+// keeps them until they are served so that they are still visited.
+class EventQueue
+{
+public:
+  EventQueue() : served(0) {}
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
+  ~EventQueue()
+  {
+    for (Event* event : batched) {
+      delete event;
+    }
+
+    while (Event* event = dequeue()) {
+      delete event;
+    }
+  }
+
+  // Can be called concurrently from any thread.
+  void enqueue(Event* event, bool inject = false)
+  {
+    if (inject) {
+      injected.push(event);
+    } else {
+      events.push(event);
+    }
+  }
+
+  // Returns nullptr if the queue is empty. Callers must serialize.
+  Event* dequeue()
+  {
+    Event* event = injected.pop();
+    if (event == nullptr) {
+      event = events.pop();
+    }
+    return event;
+  }
+
+  // Returns the next injected event, or nullptr if there is none.
+  // Callers must serialize.
+  Event* dequeueInjected()
+  {
+    return injected.pop();
+  }
+
+  // Returns true if there are injected events. Can be called by the
+  // consumer without serializing with the producers.
+  bool hasInjected()
+  {
+    return !injected.empty();
+  }
+
+  // Returns true if there are no events, including events that are
+  // in the middle of being enqueued. Callers must serialize.
+  bool empty()
+  {
+    return injected.empty() && events.empty();
+  }
+
+  // Visits every event currently in the queue, including the batched
+  // events that have not been served yet, in dequeue order. Callers
+  // must serialize.
+  void visit(EventVisitor* visitor)
+  {
+    injected.visit(visitor);
+
+    // The consumer may concurrently take (but not delete) the events
+    // from 'served' on, which both only read.
+    for (size_t i = served.load(std::memory_order_acquire);
+         i < batched.size();
+         i++) {
+      batched[i]->visit(visitor);
+    }
+
+    events.visit(visitor);
+  }
+
+  // Dequeues up to 'max' events that the consumer then serves one
+  // after the other with 'next', which does not need to serialize.
+  // The events stay in the queue until the next batch so that they
+  // can be visited, while the events of the previous batch are
+  // appended to 'retired' for the caller to delete (preferably after
+  // releasing the lock, since deleting an event can run arbitrary
+  // code). Returns the number of batched events. Callers must
+  // serialize.
+  size_t batch(size_t max, std::vector<Event*>* retired)
+  {
+    retired->insert(retired->end(), batched.begin(), batched.end());
+    batched.clear();
+
+    while (batched.size() < max) {
+      Event* event = dequeue();
+      if (event == nullptr) {
+        break;
+      }
+      batched.push_back(event);
+    }
+
+    served.store(0, std::memory_order_release);
+
+    return batched.size();
+  }
+
+  // Returns the next batched event, which is still owned by the
+  // queue, or nullptr if all of them have been served. Only called
+  // by the consumer.
+  Event* next()
+  {
+    size_t index = served.load(std::memory_order_relaxed);
+    if (index == batched.size()) {
+      return nullptr;
+    }
+    served.store(index + 1, std::memory_order_release);
+    return batched[index];
+  }
+
+  // Returns the number of events of type T, including the batched
+  // ones that have not been served yet. Callers must serialize.
+  template <typename T>
+  size_t count()
+  {
+    size_t count = 0U;
+
+    struct CountVisitor : EventVisitor
+    {
+      explicit CountVisitor(size_t* _count) : count(_count) {}
+      virtual void visit(const T&) { (*count)++; }
+      size_t* count;
+    } visitor(&count);
+
+    visit(&visitor);
+
+    return count;
+  }
+
+private:
+  // An intrusive multiple producer, single consumer queue (based on
+  // Dmitry Vyukov's non-blocking MPSC node based queue). Producers
+  // swap themselves in as the 'head' and then link the previous head
+  // to themselves, while the consumer follows 'next' links from the
+  // 'tail'. A stub event is used so the queue is never truly empty
+  // which keeps producers and the consumer from touching the same
+  // event unless there is at most one event in the queue.
+  class Queue
+  {
+  public:
+    Queue() : head(&stub), tail(&stub) {}
+
+    void push(Event* event)
+    {
+      event->next.store(nullptr, std::memory_order_relaxed);
+      Event* previous = head.exchange(event);
+      previous->next.store(event, std::memory_order_release);
+    }
+
+    Event* pop()
+    {
+      Event* event = tail;
+      Event* next = event->next.load(std::memory_order_acquire);
+
+      if (event == &stub) {
+        if (next == nullptr) {
+          if (head.load() == &stub) {
+            return nullptr;
+          }
+
+          // A producer swapped in the head but has not linked the
+          // stub to its event yet.
+          next = link(event);
+        }
+
+        tail = next;
+        event = next;
+        next = event->next.load(std::memory_order_acquire);
+      }
+
+      if (next != nullptr) {
+        tail = next;
+        return event;
+      }
+
+      // This is the last event, unless a producer is in the middle
+      // of enqueueing after it. In order to be able to return it we
+      // push the stub so that 'event' is followed by something.
+      if (head.load() == event) {
+        push(&stub);
+      }
+
+      tail = link(event);
+      return event;
+    }
+
+    bool empty()
+    {
+      return tail == &stub && head.load() == &stub;
+    }
+
+    void visit(EventVisitor* visitor)
+    {
+      Event* event = tail;
+      while (event != nullptr) {
+        if (event != &stub) {
+          event->visit(visitor);
+        }
+        event = event->next.load(std::memory_order_acquire);
+      }
+    }
+
+  private:
+    // Waits for a producer to link 'event' to its successor, which
+    // happens right after the producer swaps in the head. The wait is
+    // normally a few instructions long, hence we spin at first, but
+    // the producer may get preempted in between in which case we
+    // yield so that it can be scheduled (e.g., on the same core).
+    static Event* link(Event* event)
+    {
+      Event* next = event->next.load(std::memory_order_acquire);
+      for (size_t spins = 0; next == nullptr; ++spins) {
+        if (spins < MAX_SPINS) {
+#if defined(__i386__) || defined(__x86_64__)
+          asm ("pause");
+#endif
+        } else {
+          std::this_thread::yield();
+        }
+        next = event->next.load(std::memory_order_acquire);
+      }
+      return next;
+    }
+
+    static constexpr size_t MAX_SPINS = 128;
+
+    struct Stub : Event
+    {
+      virtual void visit(EventVisitor*) const {}
+    } stub;
+
+    // Most recently enqueued event, swapped in by producers.
+    std::atomic<Event*> head;
+
+    // Next event to dequeue (or the stub), only used by the consumer.
+    Event* tail;
+  };
+
+  Queue injected;
+  Queue events;
+
+  // Events dequeued by the last 'batch', of which the first 'served'
+  // have been (or are being) served.
+  std::vector<Event*> batched;
+  std::atomic<size_t> served;
+};
+
+} // namespace process {
+
+#endif // __PROCESS_EVENT_QUEUE_HPP__
@@ -0,0 +1,142 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+#ifndef __FRAMING_HPP__
+#define __FRAMING_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+
+namespace process {
+namespace framing {
+
+// Libprocess messages are sent as HTTP POST requests (see
+// `MessageEncoder`), which any HTTP server can receive. Between two
+// instances of libprocess, they can instead be sent in a compact
+// binary framing, which is negotiated for each connection:
+//
+//   1. The sender offers the binary framing by adding the `HEADER`
+//      header (with the value `BINARY`) to the first message it
+//      sends on the connection.
+//   2. A receiver that supports the binary framing writes back
+//      `ACCEPTED` on the connection. Older receivers ignore the
+//      header, in which case the sender keeps using HTTP.
+//   3. Once the sender has read `ACCEPTED`, it encodes the messages
+//      in the binary framing from then on. The receiver detects the
+//      switch from the first byte following an HTTP message.
+//
+// The binary framing is a sequence of frames, each starting with a
+// one byte tag, with all integers in network byte order:
+//
+//   INTERN:  tag, uint32 id, uint32 length, string.
+//   MESSAGE: tag, uint32 from, uint32 to, uint32 name, uint32 length,
+//            body.
+//
+// The strings of a message (the sender PID, the receiver ID and the
+// message name) are interned by the sender, which sends them once in
+// an INTERN frame and then refers to them by ID. IDs are reassigned
+// (starting from 0 again) once `MAX_INTERNED` strings are interned.
+//
+// NOTE: Neither tag can start an HTTP request.
+
+constexpr char HEADER[] = "Libprocess-Framing";
+constexpr char BINARY[] = "binary";
+constexpr char ACCEPTED[] = "LIBPROCESS/1 binary\r\n";
+
+enum Tag : uint8_t
+{
+  INTERN = 1,
+  MESSAGE = 2,
+};
+
+constexpr size_t INTERN_HEADER_SIZE = 1 + 2 * sizeof(uint32_t);
+constexpr size_t MESSAGE_HEADER_SIZE = 1 + 4 * sizeof(uint32_t);
+
+constexpr uint32_t MAX_INTERNED = 1024;
+
+
+// The framing state of an outbound connection.
+struct Connection
+{
+  Connection() : offered(false), binary(false) {}
+
+  // Whether the binary framing was offered to the receiver.
+  bool offered;
+
+  // Whether the receiver accepted the binary framing.
+  bool binary;
+
+  hashmap<std::string, uint32_t> interned;
+};
+
+
+inline void append(std::string* data, uint32_t value)
+{
+  data->push_back(static_cast<char>((value >> 24) & 0xff));
+  data->push_back(static_cast<char>((value >> 16) & 0xff));
+  data->push_back(static_cast<char>((value >> 8) & 0xff));
+  data->push_back(static_cast<char>(value & 0xff));
+}
+
+
+// Overwrites the four bytes at 'data' with 'value'.
+inline void write(char* data, uint32_t value)
+{
+  data[0] = static_cast<char>((value >> 24) & 0xff);
+  data[1] = static_cast<char>((value >> 16) & 0xff);
+  data[2] = static_cast<char>((value >> 8) & 0xff);
+  data[3] = static_cast<char>(value & 0xff);
+}
+
+
+inline uint32_t read(const char* data)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+  return (static_cast<uint32_t>(bytes[0]) << 24) |
+         (static_cast<uint32_t>(bytes[1]) << 16) |
+         (static_cast<uint32_t>(bytes[2]) << 8) |
+         static_cast<uint32_t>(bytes[3]);
+}
+
+
+// Returns the ID of 'value' on 'connection', first appending an
+// INTERN frame for it to 'data' if it is not yet interned.
+inline uint32_t intern(
+    Connection* connection,
+    const std::string& value,
+    std::string* data)
+{
+  Option<uint32_t> id = connection->interned.get(value);
+  if (id.isSome()) {
+    return id.get();
+  }
+
+  id = static_cast<uint32_t>(connection->interned.size());
+  connection->interned[value] = id.get();
+
+  data->push_back(static_cast<char>(INTERN));
+  append(data, id.get());
+  append(data, static_cast<uint32_t>(value.size()));
+  data->append(value);
+
+  return id.get();
+}
+
+} // namespace framing {
+} // namespace process {
+
+#endif // __FRAMING_HPP__
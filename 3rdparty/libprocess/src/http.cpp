@@ -25,13 +25,16 @@
 #include <ostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <sstream>
 #include <tuple>
 #include <vector>
 
+#include <process/clock.hpp>
 #include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/http.hpp>
@@ -39,14 +42,23 @@
 #include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/socket.hpp>
+#include <process/time.hpp>
+#include <process/timer.hpp>
 
+#include <process/metrics/counter.hpp>
+#include <process/metrics/metrics.hpp>
+#include <process/metrics/push_gauge.hpp>
+
+#include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/ip.hpp>
 #include <stout/lambda.hpp>
 #include <stout/net.hpp>
 #include <stout/nothing.hpp>
 #include <stout/numify.hpp>
 #include <stout/option.hpp>
+#include <stout/os.hpp>
 #include <stout/strings.hpp>
 #include <stout/synchronized.hpp>
 #include <stout/try.hpp>
@@ -55,6 +67,7 @@
 
 using std::deque;
 using std::istringstream;
+using std::list;
 using std::map;
 using std::ostream;
 using std::ostringstream;
@@ -396,6 +409,7 @@ Pipe::Writer Pipe::writer() const
 Future<string> Pipe::Reader::read()
 {
   Future<string> future;
+  queue<Owned<Promise<Nothing>>> drains;
 
   synchronized (data->lock) {
     if (data->readEnd == Reader::CLOSED) {
@@ -411,9 +425,19 @@ Future<string> Pipe::Reader::read()
     } else {
       data->reads.push(Owned<Promise<string>>(new Promise<string>()));
       future = data->reads.back()->future();
+
+      // The pipe is drained, the reader is waiting for more data.
+      std::swap(data->drains, drains);
     }
   }
 
+  // NOTE: We set the promises outside the critical section to avoid
+  // triggering callbacks that try to reacquire the lock.
+  while (!drains.empty()) {
+    drains.front()->set(Nothing());
+    drains.pop();
+  }
+
   return future;
 }
 
@@ -423,6 +447,7 @@ bool Pipe::Reader::close()
   bool closed = false;
   bool notify = false;
   queue<Owned<Promise<string>>> reads;
+  queue<Owned<Promise<Nothing>>> drains;
 
   synchronized (data->lock) {
     if (data->readEnd == Reader::OPEN) {
@@ -434,6 +459,9 @@ bool Pipe::Reader::close()
       // Extract the pending reads so we can fail them.
       std::swap(data->reads, reads);
 
+      // Extract the waiting writers so we can notify them.
+      std::swap(data->drains, drains);
+
       closed = true;
       data->readEnd = Reader::CLOSED;
 
@@ -450,6 +478,11 @@ bool Pipe::Reader::close()
       reads.pop();
     }
 
+    while (!drains.empty()) {
+      drains.front()->set(Nothing());
+      drains.pop();
+    }
+
     if (notify) {
       data->readerClosure.set(Nothing());
     } else {
@@ -554,6 +587,23 @@ Future<Nothing> Pipe::Writer::readerClosed() const
 }
 
 
+Future<Nothing> Pipe::Writer::drained() const
+{
+  Future<Nothing> future;
+
+  synchronized (data->lock) {
+    if (data->readEnd == Reader::CLOSED || !data->reads.empty()) {
+      future = Nothing();
+    } else {
+      data->drains.push(Owned<Promise<Nothing>>(new Promise<Nothing>()));
+      future = data->drains.back()->future();
+    }
+  }
+
+  return future;
+}
+
+
 OK::OK(const JSON::Value& value, const Option<string>& jsonp)
   : Response(Status::OK)
 {
@@ -1284,6 +1334,399 @@ Future<Connection> connect(const URL& url)
 }
 
 
+namespace internal {
+
+Future<Response> request(const Request& request, bool streamedResponse)
+{
+  // We rely on the connection closing after the response.
+  CHECK(!request.keepAlive);
+
+  return http::connect(request.url)
+    .then([=](Connection connection) {
+      Future<Response> response = connection.send(request, streamedResponse);
+
+      // This is a non Keep-Alive request which means the connection
+      // will be closed when the response is received. Since the
+      // 'Connection' is reference-counted, we must maintain a copy
+      // until the disconnection occurs.
+      connection.disconnected()
+        .onAny([connection]() {});
+
+      return response;
+    });
+}
+
+
+// Pools the connections used by `http::request` (and thus by
+// `http::get`, `http::post`, etc.) so that subsequent requests to
+// the same server, from any process, reuse a Keep-Alive connection
+// instead of each setting up a new one.
+//
+// At most `capacity` connections are pooled for each server; the
+// requests made while all of them are in use are sent on a new
+// connection that is closed after the response, as when pooling is
+// disabled. Pooled connections are closed once they have been idle
+// for `idleTimeout`, and as soon as the server closes them.
+class ConnectionPoolProcess : public Process<ConnectionPoolProcess>
+{
+public:
+  ConnectionPoolProcess(size_t _capacity, const Duration& _idleTimeout)
+    : ProcessBase(ID::generate("__http_connection_pool__")),
+      capacity(_capacity),
+      idleTimeout(_idleTimeout) {}
+
+  Future<Response> send(const Request& request)
+  {
+    const string key = authority(request.url);
+
+    Pool& pool = pools[key];
+
+    // Reuse the most recently released connection, which is the
+    // least likely to have been closed by the server meanwhile. The
+    // server may still close it before it receives the request, which
+    // cannot be told apart from a failure after the server processed
+    // it. Hence only the requests that are safe to retry are sent on
+    // an idle connection; the others get a new connection.
+    if (!pool.idle.empty() && idempotent(request.method)) {
+      Connection connection = pool.idle.back().connection;
+      pool.idle.pop_back();
+
+      --metrics.idle_connections;
+      ++metrics.connections_reused;
+
+      return _send(key, connection, request)
+        .repair(defer(self(), [=](const Future<Response>& response) {
+          // The server may have closed the connection before it
+          // received the request, in which case we retry the request
+          // on a new connection.
+          VLOG(1) << "Retrying " << request.method << " request to "
+                  << key << " on a new connection after failing on a"
+                  << " pooled connection: " << response.failure();
+
+          return connect(key, request);
+        }));
+    }
+
+    return connect(key, request);
+  }
+
+protected:
+  virtual void finalize()
+  {
+    // The connections are kept alive by the callbacks on their
+    // disconnection (see `connect()`), hence close them explicitly.
+    foreachvalue (Pool& pool, pools) {
+      foreach (Connection& connection, pool.connections) {
+        connection.disconnect();
+      }
+    }
+  }
+
+private:
+  struct Idle
+  {
+    Idle(const Connection& _connection, const Time& _since)
+      : connection(_connection), since(_since) {}
+
+    Connection connection;
+    Time since;
+  };
+
+  struct Pool
+  {
+    Pool() : connecting(0) {}
+
+    // The connections being established.
+    size_t connecting;
+
+    // The established connections, both in use and idle.
+    list<Connection> connections;
+
+    // The idle connections, in the order in which they were released.
+    list<Idle> idle;
+  };
+
+  struct Metrics
+  {
+    Metrics()
+      : connections_created("http/client/connections_created"),
+        connections_reused("http/client/connections_reused"),
+        idle_connections("http/client/idle_connections")
+    {
+      process::metrics::add(connections_created);
+      process::metrics::add(connections_reused);
+      process::metrics::add(idle_connections);
+    }
+
+    ~Metrics()
+    {
+      process::metrics::remove(connections_created);
+      process::metrics::remove(connections_reused);
+      process::metrics::remove(idle_connections);
+    }
+
+    process::metrics::Counter connections_created;
+    process::metrics::Counter connections_reused;
+    process::metrics::PushGauge idle_connections;
+  } metrics;
+
+  Future<Response> connect(const string& key, const Request& request)
+  {
+    Pool& pool = pools[key];
+
+    // Idle connections are not reused for the requests that are not
+    // safe to retry (see `send()`), hence close the least recently
+    // released one to make room rather than bypassing the pool.
+    if (pool.connecting + pool.connections.size() >= capacity &&
+        !pool.idle.empty()) {
+      Connection connection = pool.idle.front().connection;
+      pool.idle.pop_front();
+      pool.connections.remove(connection);
+
+      --metrics.idle_connections;
+
+      connection.disconnect();
+    }
+
+    if (pool.connecting + pool.connections.size() >= capacity) {
+      return internal::request(request, false);
+    }
+
+    ++pool.connecting;
+
+    return http::connect(request.url)
+      .onAny(defer(self(), [=](const Future<Connection>& connection) {
+        --pools[key].connecting;
+
+        if (connection.isReady()) {
+          Connection _connection = connection.get();
+
+          pools[key].connections.push_back(_connection);
+
+          ++metrics.connections_created;
+
+          _connection.disconnected()
+            .onAny(defer(self(), &Self::disconnected, key, _connection));
+        } else {
+          erase(key);
+        }
+      }))
+      .then(defer(self(), [=](const Connection& connection) {
+        return _send(key, connection, request);
+      }));
+  }
+
+  Future<Response> _send(
+      const string& key,
+      Connection connection,
+      Request request)
+  {
+    request.keepAlive = true;
+
+    Future<Response> response = connection.send(request);
+
+    response
+      .onAny(defer(self(), &Self::release, key, connection, lambda::_1));
+
+    return response;
+  }
+
+  void release(
+      const string& key,
+      Connection connection,
+      const Future<Response>& response)
+  {
+    // The connection closes itself after a response with a
+    // 'Connection: close' header, and is disconnected below after a
+    // failure, hence it must not be reused in either case.
+    if (!response.isReady()) {
+      connection.disconnect();
+      return;
+    }
+
+    if (response->headers.contains("Connection") &&
+        response->headers.at("Connection") == "close") {
+      return;
+    }
+
+    // The connection may have already been closed by the server.
+    if (!pools.contains(key)) {
+      return;
+    }
+
+    Pool& pool = pools[key];
+
+    if (std::find(pool.connections.begin(), pool.connections.end(), connection)
+          == pool.connections.end()) {
+      return;
+    }
+
+    pool.idle.push_back(Idle(connection, Clock::now()));
+
+    ++metrics.idle_connections;
+
+    delay(idleTimeout, self(), &Self::expire, key, connection);
+  }
+
+  void expire(const string& key, Connection connection)
+  {
+    if (!pools.contains(key)) {
+      return;
+    }
+
+    list<Idle>& idle = pools[key].idle;
+
+    for (auto entry = idle.begin(); entry != idle.end(); ++entry) {
+      // The connection may have been reused and released again
+      // since this expiration was scheduled.
+      if (entry->connection == connection &&
+          Clock::now() - entry->since >= idleTimeout) {
+        // Stop handing out the connection right away, rather than
+        // once its disconnection is noticed (see `disconnected()`).
+        idle.erase(entry);
+        --metrics.idle_connections;
+
+        connection.disconnect();
+        return;
+      }
+    }
+  }
+
+  void disconnected(const string& key, const Connection& connection)
+  {
+    Pool& pool = pools[key];
+
+    pool.connections.remove(connection);
+
+    for (auto entry = pool.idle.begin(); entry != pool.idle.end(); ++entry) {
+      if (entry->connection == connection) {
+        pool.idle.erase(entry);
+        --metrics.idle_connections;
+        break;
+      }
+    }
+
+    erase(key);
+  }
+
+  // Removes the pool of the server once it has no connections.
+  void erase(const string& key)
+  {
+    if (pools.contains(key) &&
+        pools[key].connecting == 0 &&
+        pools[key].connections.empty()) {
+      pools.erase(key);
+    }
+  }
+
+  static string authority(const URL& url)
+  {
+    return url.scheme.getOrElse("http") + "://" +
+      (url.ip.isSome() ? stringify(url.ip.get()) : url.domain.getOrElse("")) +
+      ":" + (url.port.isSome() ? stringify(url.port.get()) : "");
+  }
+
+  static bool idempotent(const string& method)
+  {
+    return method == "GET" || method == "HEAD" || method == "PUT" ||
+      method == "DELETE" || method == "OPTIONS";
+  }
+
+  const size_t capacity;
+  const Duration idleTimeout;
+
+  hashmap<string, Pool> pools;
+};
+
+
+// The number of connections pooled for each server, unless
+// overridden by LIBPROCESS_HTTP_POOL_CAPACITY (0 disables pooling).
+constexpr size_t DEFAULT_POOL_CAPACITY = 8;
+
+
+// How long a pooled connection is kept while idle, unless
+// overridden by LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT.
+Duration DEFAULT_POOL_IDLE_TIMEOUT() { return Seconds(5); }
+
+
+// Global connection pool, if pooling is enabled, created on first use.
+static std::mutex* connection_pool_mutex = new std::mutex();
+static ConnectionPoolProcess* connection_pool = nullptr;
+static bool connection_pool_initialized = false;
+
+
+Option<PID<ConnectionPoolProcess>> pool()
+{
+  Option<PID<ConnectionPoolProcess>> pid = None();
+
+  synchronized (connection_pool_mutex) {
+    if (!connection_pool_initialized) {
+      size_t capacity = DEFAULT_POOL_CAPACITY;
+      Duration idleTimeout = DEFAULT_POOL_IDLE_TIMEOUT();
+
+      Option<string> value = os::getenv("LIBPROCESS_HTTP_POOL_CAPACITY");
+      if (value.isSome()) {
+        Try<size_t> result = numify<size_t>(value.get());
+        if (result.isSome()) {
+          capacity = result.get();
+        } else {
+          LOG(WARNING) << "Ignoring invalid LIBPROCESS_HTTP_POOL_CAPACITY="
+                       << value.get() << ": " << result.error();
+        }
+      }
+
+      value = os::getenv("LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT");
+      if (value.isSome()) {
+        Try<Duration> result = Duration::parse(value.get());
+        if (result.isSome()) {
+          idleTimeout = result.get();
+        } else {
+          LOG(WARNING) << "Ignoring invalid LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT="
+                       << value.get() << ": " << result.error();
+        }
+      }
+
+      if (capacity > 0) {
+        connection_pool = new ConnectionPoolProcess(capacity, idleTimeout);
+        spawn(connection_pool);
+      }
+
+      connection_pool_initialized = true;
+    }
+
+    if (connection_pool != nullptr) {
+      pid = connection_pool->self();
+    }
+  }
+
+  return pid;
+}
+
+
+// Replaces the pool with one configured from the environment again
+// once it is next used. Exposed for tests, which might repeatedly
+// change LIBPROCESS_HTTP_POOL_CAPACITY and
+// LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT.
+void reinitializePool()
+{
+  ConnectionPoolProcess* previous = nullptr;
+
+  synchronized (connection_pool_mutex) {
+    previous = connection_pool;
+    connection_pool = nullptr;
+    connection_pool_initialized = false;
+  }
+
+  if (previous != nullptr) {
+    terminate(previous);
+    wait(previous);
+    delete previous;
+  }
+}
+
+} // namespace internal {
+
+
 Request createRequest(
     const URL& url,
     const string& method,
@@ -1334,22 +1777,22 @@ Request createRequest(
 
 Future<Response> request(const Request& request, bool streamedResponse)
 {
-  // We rely on the connection closing after the response.
   CHECK(!request.keepAlive);
 
-  return http::connect(request.url)
-    .then([=](Connection connection) {
-      Future<Response> response = connection.send(request, streamedResponse);
+  // A streamed response is received on a connection of its own, as
+  // the connection cannot be reused until the caller reads the body.
+  if (!streamedResponse) {
+    Option<PID<internal::ConnectionPoolProcess>> pool = internal::pool();
 
-      // This is a non Keep-Alive request which means the connection
-      // will be closed when the response is received. Since the
-      // 'Connection' is reference-counted, we must maintain a copy
-      // until the disconnection occurs.
-      connection.disconnected()
-        .onAny([connection]() {});
+    if (pool.isSome()) {
+      return dispatch(
+          pool.get(),
+          &internal::ConnectionPoolProcess::send,
+          request);
+    }
+  }
 
-      return response;
-    });
+  return internal::request(request, streamedResponse);
 }
 
 
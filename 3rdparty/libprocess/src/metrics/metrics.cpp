@@ -14,6 +14,7 @@
 
 #include <list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <process/collect.hpp>
@@ -29,6 +30,7 @@
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/jsonify.hpp>
 #include <stout/numify.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
@@ -123,6 +125,9 @@ MetricsProcess* MetricsProcess::instance()
 
 void MetricsProcess::initialize()
 {
+  add(Owned<Metric>(new Counter(snapshot_cache_hits)));
+  add(Owned<Metric>(new Counter(snapshot_cache_misses)));
+
   if (authenticationRealm.isSome()) {
     route("/snapshot",
           authenticationRealm.get(),
@@ -150,6 +155,9 @@ string MetricsProcess::help()
           "amount of time the endpoint will take to respond. If the timeout",
           "is exceeded, some metrics may not be included in the response.",
           "",
+          "Requests that arrive while a snapshot with the same timeout is",
+          "being taken share that snapshot.",
+          "",
           "The key is the metric name, and the value is a double-type."),
       AUTHENTICATION(true));
 }
@@ -181,23 +189,41 @@ Future<Nothing> MetricsProcess::remove(const string& name)
 Future<hashmap<string, double>> MetricsProcess::snapshot(
     const Option<Duration>& timeout)
 {
+  // The values of the metrics that can be read without waiting, e.g.,
+  // counters and push gauges, are taken right away, only the values
+  // of (pull) gauges need to be waited for.
+  hashmap<string, double> values;
   hashmap<string, Future<double>> futures;
-  hashmap<string, Option<Statistics<double>>> statistics;
+  hashmap<string, Statistics<double>> statistics;
+
+  foreachpair (const string& name, const Owned<Metric>& metric, metrics) {
+    CHECK_NOTNULL(metric.get());
+
+    Option<double> value = metric->peek();
+    if (value.isSome()) {
+      values[name] = value.get();
+    } else {
+      futures[name] = metric->value();
+    }
 
-  foreachkey (const string& metric, metrics) {
-    CHECK_NOTNULL(metrics[metric].get());
-    futures[metric] = metrics[metric]->value();
     // TODO(dhamon): It would be nice to compute these asynchronously.
-    statistics[metric] = metrics[metric]->statistics();
+    Option<Statistics<double>> statistics_ = metric->statistics();
+    if (statistics_.isSome()) {
+      statistics[name] = statistics_.get();
+    }
+  }
+
+  if (futures.empty()) {
+    return __snapshot(timeout, std::move(values), futures, statistics);
   }
 
   if (timeout.isSome()) {
     return await(futures.values())
       .after(timeout.get(), lambda::bind(_snapshotTimeout, futures.values()))
-      .then(lambda::bind(__snapshot, timeout, futures, statistics));
+      .then(lambda::bind(__snapshot, timeout, values, futures, statistics));
   } else {
     return await(futures.values())
-      .then(lambda::bind(__snapshot, timeout, futures, statistics));
+      .then(lambda::bind(__snapshot, timeout, values, futures, statistics));
   }
 }
 
@@ -222,17 +248,46 @@ Future<http::Response> MetricsProcess::_snapshot(
     timeout = duration.get();
   }
 
-  Future<Nothing> acquire = Nothing();
+  // NOTE: Gauges are evaluated on demand, so there is no way to tell
+  // whether a previous snapshot is still current. Instead, requests
+  // share the snapshot that is being taken when they arrive, which
+  // bounds the load that concurrent scrapers put on the processes
+  // that own the gauges, and the snapshot is only serialized once.
+  Future<string> body;
 
-  if (limiter.isSome()) {
-    acquire = limiter.get()->acquire();
-  }
+  if (pending.isSome() &&
+      pending->first == timeout &&
+      pending->second.isPending()) {
+    ++snapshot_cache_hits;
+
+    body = pending->second;
+  } else {
+    ++snapshot_cache_misses;
+
+    Future<Nothing> acquire = Nothing();
 
-  return acquire.then(defer(self(), &Self::snapshot, timeout))
-      .then([request](const hashmap<string, double>& metrics)
-            -> http::Response {
-        return http::OK(jsonify(metrics), request.url.query.get("jsonp"));
+    if (limiter.isSome()) {
+      acquire = limiter.get()->acquire();
+    }
+
+    body = acquire.then(defer(self(), &Self::snapshot, timeout))
+      .then([](const hashmap<string, double>& metrics) -> string {
+        return jsonify(metrics);
       });
+
+    pending = std::make_pair(timeout, body);
+  }
+
+  const Option<string> jsonp = request.url.query.get("jsonp");
+
+  return body
+    .then([jsonp](const string& json) -> http::Response {
+      if (jsonp.isSome()) {
+        return http::OK(jsonp.get() + "(" + json + ");", "text/javascript");
+      }
+
+      return http::OK(json, "application/json");
+    });
 }
 
 
@@ -247,11 +302,10 @@ list<Future<double>> MetricsProcess::_snapshotTimeout(
 
 Future<hashmap<string, double>> MetricsProcess::__snapshot(
     const Option<Duration>& timeout,
+    hashmap<string, double> snapshot,
     const hashmap<string, Future<double>>& metrics,
-    const hashmap<string, Option<Statistics<double>>>& statistics)
+    const hashmap<string, Statistics<double>>& statistics)
 {
-  hashmap<string, double> snapshot;
-
   foreachpair (const string& key, const Future<double>& value, metrics) {
     // TODO(dhamon): Maybe add the failure message for this metric to the
     // response if value.isFailed().
@@ -262,20 +316,20 @@ Future<hashmap<string, double>> MetricsProcess::__snapshot(
     } else if (value.isReady()) {
       snapshot[key] = value.get();
     }
+  }
 
-    Option<Statistics<double>> statistics_ = statistics.get(key).get();
-
-    if (statistics_.isSome()) {
-      snapshot[key + "/count"] = static_cast<double>(statistics_.get().count);
-      snapshot[key + "/min"] = statistics_.get().min;
-      snapshot[key + "/max"] = statistics_.get().max;
-      snapshot[key + "/p50"] = statistics_.get().p50;
-      snapshot[key + "/p90"] = statistics_.get().p90;
-      snapshot[key + "/p95"] = statistics_.get().p95;
-      snapshot[key + "/p99"] = statistics_.get().p99;
-      snapshot[key + "/p999"] = statistics_.get().p999;
-      snapshot[key + "/p9999"] = statistics_.get().p9999;
-    }
+  foreachpair (const string& key,
+               const Statistics<double>& statistics_,
+               statistics) {
+    snapshot[key + "/count"] = static_cast<double>(statistics_.count);
+    snapshot[key + "/min"] = statistics_.min;
+    snapshot[key + "/max"] = statistics_.max;
+    snapshot[key + "/p50"] = statistics_.p50;
+    snapshot[key + "/p90"] = statistics_.p90;
+    snapshot[key + "/p95"] = statistics_.p95;
+    snapshot[key + "/p99"] = statistics_.p99;
+    snapshot[key + "/p999"] = statistics_.p999;
+    snapshot[key + "/p9999"] = statistics_.p9999;
   }
 
   return snapshot;
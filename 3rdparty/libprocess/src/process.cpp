@@ -98,6 +98,8 @@
 #include <stout/os.hpp>
 #include <stout/os/strerror.hpp>
 #include <stout/path.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/synchronized.hpp>
 #include <stout/thread_local.hpp>
@@ -107,6 +109,8 @@
 #include "decoder.hpp"
 #include "encoder.hpp"
 #include "event_loop.hpp"
+#include "event_queue.hpp"
+#include "framing.hpp"
 #include "gate.hpp"
 #include "process_reference.hpp"
 
@@ -323,6 +327,10 @@ public:
 
   Encoder* next(int s);
 
+  // Switches the outbound socket 's' to the binary framing of
+  // messages, once the receiver accepted it (see framing.hpp).
+  void upgrade(int s);
+
   void close(int s);
 
   void exited(const Address& address);
@@ -341,13 +349,132 @@ private:
     hashmap<UPID, hashset<ProcessBase*>> linkers;
     hashmap<ProcessBase*, hashset<UPID>> linkees;
     hashmap<Address, hashset<UPID>> remotes;
+
+    // Protects the links. This is separate from the locks on the
+    // sockets so that exiting processes do not contend with I/O.
+    std::recursive_mutex mutex;
   } links;
 
+  // The state of the sockets is partitioned into shards, each with
+  // its own lock, so that I/O on different sockets does not contend
+  // on a single lock. The state keyed by socket lives in the shard of
+  // the socket's file descriptor, and the state keyed by socket
+  // address lives in the shard of the address.
+  //
+  // NOTE: To avoid deadlocks, locks must be acquired in the following
+  // order: the lock on an address shard, then the locks on socket
+  // shards (by increasing index), then the lock on 'links'.
+  static constexpr size_t SHARDS = 16;
+
+  struct SocketShard
+  {
+    // Collection of all active sockets (both inbound and outbound).
+    map<int, Socket> sockets;
+
+    // Collection of sockets that should be disposed when they are
+    // finished being used (e.g., when there is no more data to send
+    // on them). Can contain both inbound and outbound sockets.
+    set<int> dispose;
+
+    // Map from socket to socket address for outbound sockets.
+    map<int, Address> addresses;
+
+    // Map from outbound socket to outgoing queue.
+    map<int, queue<Encoder*>> outgoing;
+
+    // HTTP proxies.
+    map<int, HttpProxy*> proxies;
+
+    // Map from outbound socket to the framing of its messages, if the
+    // binary framing is offered on it.
+    map<int, framing::Connection> framings;
+
+    std::recursive_mutex mutex;
+  };
+
+  struct AddressShard
+  {
+    // Map from socket address to temporary sockets (outbound sockets
+    // that will be closed once there is no more data to send on
+    // them).
+    map<Address, int> temps;
+
+    // Map from socket address (ip, port) to persistent sockets
+    // (outbound sockets that will remain open even if there is no
+    // more data to send on them).  We distinguish these from the
+    // 'temps' collection so we can tell when a persistent socket has
+    // been lost (and thus generate ExitedEvents).
+    map<Address, int> persists;
+
+    std::recursive_mutex mutex;
+  };
+
+  SocketShard& socket_shard(int s)
+  {
+    return socket_shards[static_cast<size_t>(s) % SHARDS];
+  }
+
+  AddressShard& address_shard(const Address& address)
+  {
+    return address_shards[std::hash<Address>()(address) % SHARDS];
+  }
+
+  // Returns the framing of the messages on the socket 's' (which must
+  // be in 'shard'), or null if they are always encoded in HTTP. The
+  // caller must hold the lock on 'shard', so that the messages are
+  // encoded in the order in which they are written.
+  framing::Connection* connection(SocketShard* shard, int s)
+  {
+    auto iterator = shard->framings.find(s);
+    return iterator != shard->framings.end() ? &iterator->second : nullptr;
+  }
+
+  // Returns the encoders to send 'message' on the socket 's' (which
+  // must be in 'shard'), in order. The message must already be encoded
+  // into 'data' (see `SocketManager::send()`), so that only the IDs of
+  // its strings are looked up here, unless the socket does not use
+  // the binary framing (yet). The caller must hold the lock on
+  // 'shard', so that the messages are encoded in the order in which
+  // they are written.
+  vector<Encoder*> encode(
+      SocketShard* shard,
+      int s,
+      Message* message,
+      string&& data);
+
+  // Returns true if 's' (which must be in 'shard') still refers to
+  // the outbound socket 'socket' to 'address'. Used to re-validate a
+  // socket once its lock is re-acquired, since it might have been
+  // closed or swapped out, and its file descriptor reused by another
+  // socket, meanwhile. The caller must hold the lock on 'shard'.
+  bool current(
+      SocketShard* shard,
+      int s,
+      const Socket& socket,
+      const Address& address)
+  {
+    auto sockets = shard->sockets.find(s);
+    auto addresses = shard->addresses.find(s);
+
+    return sockets != shard->sockets.end() &&
+      sockets->second == socket &&
+      addresses != shard->addresses.end() &&
+      addresses->second == address;
+  }
+
+  // Removes the socket 's' (which must be in 'shard') along with any
+  // data still queued on it, and shuts it down. Returns the proxy of
+  // the socket, if any, which the caller must terminate once it has
+  // released its locks. The caller must hold the lock on 'shard' and,
+  // for an outbound socket, have already updated its address shard.
+  HttpProxy* remove(SocketShard* shard, int s);
+
   // Switch the underlying socket that a remote end is talking to.
-  // This manipulates the data structures below by swapping all data
+  // This manipulates the data structures above by swapping all data
   // mapped to 'from' to being mapped to 'to'. This is useful for
-  // downgrading a socket from SSL to POLL based.
-  void swap_implementing_socket(const Socket& from, const Socket& to);
+  // downgrading a socket from SSL to POLL based. Returns false if
+  // 'from' is no longer known (e.g., it was closed or swapped out).
+  bool swap_implementing_socket(const Socket& from, const Socket& to);
 
   // Helper function for link().
   void link_connect(
@@ -361,36 +488,8 @@ private:
       Socket socket,
       Message* message);
 
-  // Collection of all active sockets (both inbound and outbound).
-  map<int, Socket> sockets;
-
-  // Collection of sockets that should be disposed when they are
-  // finished being used (e.g., when there is no more data to send on
-  // them). Can contain both inbound and outbound sockets.
-  set<int> dispose;
-
-  // Map from socket to socket address for outbound sockets.
-  map<int, Address> addresses;
-
-  // Map from socket address to temporary sockets (outbound sockets
-  // that will be closed once there is no more data to send on them).
-  map<Address, int> temps;
-
-  // Map from socket address (ip, port) to persistent sockets
-  // (outbound sockets that will remain open even if there is no more
-  // data to send on them).  We distinguish these from the 'temps'
-  // collection so we can tell when a persistent socket has been lost
-  // (and thus generate ExitedEvents).
-  map<Address, int> persists;
-
-  // Map from outbound socket to outgoing queue.
-  map<int, queue<Encoder*>> outgoing;
-
-  // HTTP proxies.
-  map<int, HttpProxy*> proxies;
-
-  // Protects instance variables.
-  std::recursive_mutex mutex;
+  SocketShard socket_shards[SHARDS];
+  AddressShard address_shards[SHARDS];
 };
 
 
@@ -454,12 +553,48 @@ private:
   // Gates for waiting threads (protected by processes_mutex).
   map<ProcessBase*, Gate*> gates;
 
-  // Queue of runnable processes (implemented using list).
+  // Bounded run queue of a single worker thread. A runnable process
+  // is pushed onto the run queue of the worker that last resumed it
+  // (or of the worker that made it runnable) and a worker whose run
+  // queue is empty steals processes from the other run queues.
+  struct RunQueue
+  {
+    std::mutex mutex;
+    deque<ProcessBase*> processes;
+  };
+
+  // Maximum number of events dequeued from a process' event queue
+  // per acquisition of the process mutex in 'resume'. Events that
+  // get injected meanwhile are still serviced before the rest of
+  // the batch.
+  static const size_t EVENT_BATCH_SIZE = 32;
+
+  // Maximum number of processes on a worker's run queue before
+  // processes get pushed onto the shared run queue instead.
+  static const size_t RUNQ_CAPACITY = 1024;
+
+  // Run queues indexed by worker (created in 'init_threads').
+  vector<RunQueue*> runqs;
+
+  // Shared queue of runnable processes that have no worker affinity
+  // or whose worker's run queue is full (implemented using list).
   list<ProcessBase*> runq;
   std::recursive_mutex runq_mutex;
 
-  // Number of running processes, to support Clock::settle operation.
-  std::atomic_long running;
+  // Returns true if the process was found and removed from one of
+  // the run queues (used for donating a thread in 'wait').
+  bool remove(ProcessBase* process);
+
+  // Number of runnable or running processes, to support the
+  // Clock::settle operation. Incremented when a process is enqueued
+  // and decremented when it is done being resumed, so that a process
+  // moving from a run queue to a worker is never missed.
+  std::atomic_long scheduled;
+
+  // Total number of times a process has been enqueued, used by
+  // Clock::settle to detect processes that got enqueued (and maybe
+  // even ran to completion) while it was checking the clock.
+  std::atomic_ulong enqueues;
 
   // Stores the thread handles so that we can join during shutdown.
   vector<std::thread*> threads;
@@ -476,6 +611,14 @@ private:
 // Server socket listen backlog.
 static const int LISTEN_BACKLOG = 500000;
 
+// Maximum number of bytes of queued data that are coalesced into a
+// single write on a socket, see `SocketManager::next()`.
+static const size_t OUTGOING_BATCH_BYTES = 64 * 1024;
+
+// Whether to offer the binary framing of messages (see framing.hpp) on
+// outbound connections, set with 'LIBPROCESS_BINARY_FRAMING'.
+static bool binary_framing = false;
+
 // Local server socket.
 static Socket* __s__ = nullptr;
 
@@ -503,7 +646,9 @@ static Route* processes_route = nullptr;
 // Filter. Synchronized support for using the filterer needs to be
 // recursive in case a filterer wants to do anything fancy (which is
 // possible and likely given that filters will get used for testing).
-static Filter* filterer = nullptr;
+// The filterer is atomic so that the common case of no filter being
+// installed can be checked without taking the lock.
+static std::atomic<Filter*> filterer(nullptr);
 static std::recursive_mutex* filterer_mutex = new std::recursive_mutex();
 
 // Global garbage collector.
@@ -521,6 +666,13 @@ THREAD_LOCAL ProcessBase* __process__ = nullptr;
 // Per thread executor pointer.
 THREAD_LOCAL Executor* _executor_ = nullptr;
 
+// Per thread worker index (-1 for threads that are not workers).
+static THREAD_LOCAL long __worker__ = -1;
+
+// Frees the dispatch events pooled by the calling thread (see
+// 'DispatchEvent::operator new').
+static void drain_dispatch_events();
+
 
 namespace http {
 
@@ -670,6 +822,71 @@ static Message* parse(Request* request)
 }
 
 
+// Parses the value of a 'Range' header (see RFC 7233) for a file of
+// 'size' bytes, returning the offset and the length of the range.
+// Only a single range of bytes is supported: None is returned for
+// anything else (including a malformed header), in which case the
+// whole file is sent as the RFC allows. An error is returned if the
+// range is not satisfiable.
+static Result<pair<size_t, size_t>> range(const string& value, size_t size)
+{
+  const string unit = "bytes=";
+
+  const string spec = strings::trim(value);
+  if (!strings::startsWith(spec, unit) ||
+      spec.find(',') != string::npos) {
+    return None();
+  }
+
+  const string bytes = strings::trim(spec.substr(unit.size()));
+
+  size_t dash = bytes.find('-');
+  if (dash == string::npos) {
+    return None();
+  }
+
+  const string first = strings::trim(bytes.substr(0, dash));
+  const string last = strings::trim(bytes.substr(dash + 1));
+
+  // A suffix range, i.e., the last 'last' bytes of the file.
+  if (first.empty()) {
+    Try<size_t> suffix = numify<size_t>(last);
+    if (suffix.isError()) {
+      return None();
+    }
+
+    if (suffix.get() == 0 || size == 0) {
+      return Error("Range is not satisfiable");
+    }
+
+    size_t length = std::min(suffix.get(), size);
+    return std::make_pair(size - length, length);
+  }
+
+  Try<size_t> start = numify<size_t>(first);
+  if (start.isError()) {
+    return None();
+  }
+
+  size_t end = size - 1;
+
+  if (!last.empty()) {
+    Try<size_t> _end = numify<size_t>(last);
+    if (_end.isError() || _end.get() < start.get()) {
+      return None();
+    }
+
+    end = std::min(_end.get(), end);
+  }
+
+  if (start.get() >= size) {
+    return Error("Range is not satisfiable");
+  }
+
+  return std::make_pair(start.get(), end - start.get() + 1);
+}
+
+
 namespace internal {
 
 void decode_recv(
@@ -697,10 +914,12 @@ void decode_recv(
     return;
   }
 
-  // Decode as much of the data as possible into HTTP requests.
+  // Decode as much of the data as possible into HTTP requests, or
+  // into messages if the sender switched to the binary framing.
   const deque<Request*> requests = decoder->decode(data, length.get());
+  const deque<Message*> messages = decoder->messages();
 
-  if (requests.empty() && decoder->failed()) {
+  if (requests.empty() && messages.empty() && decoder->failed()) {
      VLOG(1) << "Decoder error while receiving";
      socket_manager->close(socket);
      delete[] data;
@@ -727,6 +946,18 @@ void decode_recv(
     }
   }
 
+  if (decoder->accept()) {
+    socket_manager->send(new DataEncoder(socket, framing::ACCEPTED), true);
+  }
+
+  foreach (Message* message, messages) {
+    message->to.address = __address__;
+
+    // TODO(benh): Use the sender PID when delivering in order to
+    // capture happens-before timing relationships for testing.
+    process_manager->deliver(message->to, new MessageEvent(message));
+  }
+
   socket.recv(data, size)
     .onAny(lambda::bind(&decode_recv, lambda::_1, data, size, socket, decoder));
 }
@@ -920,6 +1151,12 @@ bool initialize(
     }
   }
 
+  // Check environment for whether to offer the binary framing.
+  value = os::getenv("LIBPROCESS_BINARY_FRAMING");
+  if (value.isSome()) {
+    binary_framing = value.get() == "true" || value.get() == "1";
+  }
+
   // Create a "server" socket for communicating.
   Try<Socket> create = Socket::create();
   if (create.isError()) {
@@ -1274,18 +1511,62 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
         VLOG(1) << "Returning '404 Not Found' for directory '" << path << "'";
         socket_manager->send(NotFound(), request, socket);
       } else {
+        const size_t size = s.st_size;
+
+        // Serve a single range of the file if one was requested,
+        // e.g., to tail a file without sending all of it.
+        size_t offset = 0;
+        size_t length = size;
+
+        response.headers["Accept-Ranges"] = "bytes";
+
+        Option<string> header = request.method == "GET"
+          ? request.headers.get("Range")
+          : None();
+
+        if (header.isSome() && response.code == http::Status::OK) {
+          Result<pair<size_t, size_t>> bytes = range(header.get(), size);
+
+          if (bytes.isError()) {
+            VLOG(1) << "Returning '416 Requested Range Not Satisfiable'"
+                    << " for range '" << header.get() << "' of file at '"
+                    << path << "' with length " << size;
+
+            os::close(fd);
+
+            Response unsatisfiable(
+                http::Status::REQUESTED_RANGE_NOT_SATISFIABLE);
+            unsatisfiable.headers["Content-Range"] =
+              "bytes */" + stringify(size);
+
+            socket_manager->send(unsatisfiable, request, socket);
+            return true; // All done, can process next request.
+          }
+
+          if (bytes.isSome()) {
+            offset = bytes->first;
+            length = bytes->second;
+
+            response.code = http::Status::PARTIAL_CONTENT;
+            response.status = http::Status::string(response.code);
+            response.headers["Content-Range"] =
+              "bytes " + stringify(offset) + "-" +
+              stringify(offset + length - 1) + "/" + stringify(size);
+          }
+        }
+
         // While the user is expected to properly set a 'Content-Type'
         // header, we fill in (or overwrite) 'Content-Length' header.
-        stringstream out;
-        out << s.st_size;
-        response.headers["Content-Length"] = out.str();
+        response.headers["Content-Length"] = stringify(length);
 
-        if (s.st_size == 0) {
+        if (length == 0) {
+          os::close(fd);
           socket_manager->send(response, request, socket);
           return true; // All done, can process next request.
         }
 
-        VLOG(1) << "Sending file at '" << path << "' with length " << s.st_size;
+        VLOG(1) << "Sending file at '" << path << "' with length " << length
+                << " from offset " << offset;
 
         // TODO(benh): Consider a way to have the socket manager turn
         // on TCP_CORK for both sends and then turn it off.
@@ -1295,7 +1576,7 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
 
         // Note the file descriptor gets closed by FileEncoder.
         socket_manager->send(
-            new FileEncoder(socket, fd, s.st_size),
+            new FileEncoder(socket, fd, length, offset),
             request.keepAlive);
       }
     }
@@ -1397,20 +1678,28 @@ SocketManager::~SocketManager() {}
 
 void SocketManager::accepted(const Socket& socket)
 {
-  synchronized (mutex) {
-    CHECK(sockets.count(socket) == 0);
-    sockets.emplace(socket, socket);
+  SocketShard& shard = socket_shard(socket);
+
+  synchronized (shard.mutex) {
+    CHECK(shard.sockets.count(socket) == 0);
+    shard.sockets.emplace(socket, socket);
   }
 }
 
 
 namespace internal {
 
+// Receives and ignores the data on an outbound socket, except for the
+// acceptance of the binary framing which a receiver writes before
+// anything else (see framing.hpp). 'matched' is the number of bytes
+// of `framing::ACCEPTED` received so far, or none once we know whether
+// the receiver accepted the binary framing.
 void ignore_recv_data(
     const Future<size_t>& length,
     Socket socket,
     char* data,
-    size_t size)
+    size_t size,
+    Option<size_t> matched)
 {
   if (length.isDiscarded() || length.isFailed()) {
     socket_manager->close(socket);
@@ -1424,8 +1713,28 @@ void ignore_recv_data(
     return;
   }
 
+  if (matched.isSome()) {
+    const size_t accepted = sizeof(framing::ACCEPTED) - 1;
+    const size_t count = std::min(length.get(), accepted - matched.get());
+
+    if (memcmp(data, framing::ACCEPTED + matched.get(), count) != 0) {
+      matched = None();
+    } else if (matched.get() + count == accepted) {
+      socket_manager->upgrade(socket);
+      matched = None();
+    } else {
+      matched = matched.get() + count;
+    }
+  }
+
   socket.recv(data, size)
-    .onAny(lambda::bind(&ignore_recv_data, lambda::_1, socket, data, size));
+    .onAny(lambda::bind(
+        &ignore_recv_data,
+        lambda::_1,
+        socket,
+        data,
+        size,
+        matched));
 }
 
 
@@ -1460,30 +1769,27 @@ void SocketManager::link_connect(
     // If we allow downgrading from SSL to non-SSL, then retry as a
     // POLL socket.
     if (attempt_downgrade) {
-      synchronized (mutex) {
-        // It is possible that a prior call to `link()` with `RECONNECT`
-        // semantics has swapped out this socket before we finished
-        // connecting. In this case, we simply stop here and allow the
-        // latest created socket to complete the link.
-        if (sockets.count(socket) <= 0) {
-          return;
-        }
-
-        Try<Socket> create = Socket::create(Socket::POLL);
-        if (create.isError()) {
-          VLOG(1) << "Failed to link, create socket: " << create.error();
-          socket_manager->close(socket);
-          return;
-        }
-
-        poll_socket = create.get();
+      Try<Socket> create = Socket::create(Socket::POLL);
+      if (create.isError()) {
+        VLOG(1) << "Failed to link, create socket: " << create.error();
+        socket_manager->close(socket);
+        return;
+      }
 
-        // Update all the data structures that are mapped to the socket
-        // that just failed to connect. They will now point to the new
-        // POLL socket we are about to try to connect. Even if the
-        // process has exited, persistent links will stay around, and
-        // temporary links will get cleaned up as they would otherwise.
-        swap_implementing_socket(socket, poll_socket.get());
+      poll_socket = create.get();
+
+      // Update all the data structures that are mapped to the socket
+      // that just failed to connect. They will now point to the new
+      // POLL socket we are about to try to connect. Even if the
+      // process has exited, persistent links will stay around, and
+      // temporary links will get cleaned up as they would otherwise.
+      //
+      // It is possible that a prior call to `link()` with `RECONNECT`
+      // semantics has swapped out this socket before we finished
+      // connecting. In this case, we simply stop here and allow the
+      // latest created socket to complete the link.
+      if (!swap_implementing_socket(socket, poll_socket.get())) {
+        return;
       }
 
       CHECK_SOME(poll_socket);
@@ -1505,12 +1811,14 @@ void SocketManager::link_connect(
     return;
   }
 
-  synchronized (mutex) {
+  SocketShard& shard = socket_shard(socket);
+
+  synchronized (shard.mutex) {
     // It is possible that a prior call to `link()` with `RECONNECT`
     // semantics has swapped out this socket before we finished
     // connecting. In this case, we simply stop here and allow the
     // latest created socket to complete the link.
-    if (sockets.count(socket) <= 0) {
+    if (shard.sockets.count(socket) <= 0) {
       return;
     }
 
@@ -1523,7 +1831,8 @@ void SocketManager::link_connect(
           lambda::_1,
           socket,
           data,
-          size));
+          size,
+          Option<size_t>(0)));
   }
 
   // In order to avoid a race condition where internal::send() is
@@ -1561,89 +1870,120 @@ void SocketManager::link(
 
   CHECK_NOTNULL(process);
 
+  // Links to local processes do not involve any sockets.
+  if (to.address == __address__) {
+    synchronized (links.mutex) {
+      links.linkers[to].insert(process);
+      links.linkees[process].insert(to);
+    }
+
+    return;
+  }
+
   Option<Socket> socket = None();
   bool connect = false;
 
-  synchronized (mutex) {
-    // Check if the socket address is remote.
-    if (to.address != __address__) {
-      // Check if there isn't already a persistent link.
-      if (persists.count(to.address) == 0) {
-        // Okay, no link, let's create a socket.
-        // The kind of socket we create is passed in as an argument.
-        // This allows us to support downgrading the connection type
-        // from SSL to POLL if enabled.
-        Try<Socket> create = Socket::create(kind);
-        if (create.isError()) {
-          LOG(WARNING) << "Failed to link, create socket: " << create.error();
-
-          // Failure to create a new socket should generate an `ExitedEvent`
-          // for the linkee. At this point, we have not passed ownership of
-          // this socket to the `SocketManager`, so there is only one possible
-          // linkee to notify.
-          process->enqueue(new ExitedEvent(to));
-          return;
-        }
-        socket = create.get();
-        int s = socket.get().get();
+  AddressShard& peer = address_shard(to.address);
+
+  synchronized (peer.mutex) {
+    // Check if there isn't already a persistent link.
+    if (peer.persists.count(to.address) == 0) {
+      // Okay, no link, let's create a socket.
+      // The kind of socket we create is passed in as an argument.
+      // This allows us to support downgrading the connection type
+      // from SSL to POLL if enabled.
+      Try<Socket> create = Socket::create(kind);
+      if (create.isError()) {
+        LOG(WARNING) << "Failed to link, create socket: " << create.error();
+
+        // Failure to create a new socket should generate an `ExitedEvent`
+        // for the linkee. At this point, we have not passed ownership of
+        // this socket to the `SocketManager`, so there is only one possible
+        // linkee to notify.
+        process->enqueue(new ExitedEvent(to));
+        return;
+      }
+      socket = create.get();
+      int s = socket.get().get();
 
-        CHECK(sockets.count(s) == 0);
-        sockets.emplace(s, socket.get());
+      SocketShard& shard = socket_shard(s);
 
-        addresses[s] = to.address;
+      synchronized (shard.mutex) {
+        CHECK(shard.sockets.count(s) == 0);
+        shard.sockets.emplace(s, socket.get());
 
-        persists[to.address] = s;
+        shard.addresses[s] = to.address;
 
         // Initialize 'outgoing' to prevent a race with
         // SocketManager::send() while the socket is not yet connected.
         // Initializing the 'outgoing' queue prevents
         // SocketManager::send() from trying to write before it's
         // connected.
-        outgoing[s];
-
-        connect = true;
-      } else if (remote == ProcessBase::RemoteConnection::RECONNECT) {
-        // There is a persistent link already and the linker wants to
-        // create a new socket anyway.
-        Try<Socket> create = Socket::create(kind);
-        if (create.isError()) {
-          LOG(WARNING) << "Failed to link, create socket: " << create.error();
-
-          // Failure to create a new socket should generate an `ExitedEvent`
-          // for the linkee. At this point, we have not passed ownership of
-          // this socket to the `SocketManager`, so there is only one possible
-          // linkee to notify.
-          process->enqueue(new ExitedEvent(to));
-          return;
-        }
+        shard.outgoing[s];
 
-        socket = create.get();
-
-        // Update all the data structures that are mapped to the old
-        // socket. They will now point to the new socket we are about
-        // to try to connect.
-        Socket existing(sockets.at(persists.at(to.address)));
-        swap_implementing_socket(existing, socket.get());
-
-        // The `existing` socket could be a perfectly functional socket.
-        // In this case, the socket may be referenced in the callback
-        // loop of `internal::ignore_recv_data`. We shutdown the socket
-        // in order to interrupt this callback loop and thereby release
-        // the final socket reference. This will not result in an
-        // `ExitedEvent` because we have already removed the `existing`
-        // socket from the mapping of linkees and linkers.
-        Try<Nothing> shutdown = existing.shutdown();
-        if (shutdown.isError()) {
-          VLOG(1) << "Failed to shutdown old link: " << shutdown.error();
+        if (binary_framing) {
+          shard.framings[s];
         }
+      }
+
+      peer.persists[to.address] = s;
+
+      connect = true;
+    } else if (remote == ProcessBase::RemoteConnection::RECONNECT) {
+      // There is a persistent link already and the linker wants to
+      // create a new socket anyway.
+      Try<Socket> create = Socket::create(kind);
+      if (create.isError()) {
+        LOG(WARNING) << "Failed to link, create socket: " << create.error();
 
-        connect = true;
+        // Failure to create a new socket should generate an `ExitedEvent`
+        // for the linkee. At this point, we have not passed ownership of
+        // this socket to the `SocketManager`, so there is only one possible
+        // linkee to notify.
+        process->enqueue(new ExitedEvent(to));
+        return;
+      }
+
+      socket = create.get();
+
+      const int s = peer.persists.at(to.address);
+
+      SocketShard& shard = socket_shard(s);
+
+      Option<Socket> existing = None();
+      synchronized (shard.mutex) {
+        existing = shard.sockets.at(s);
       }
+
+      // Update all the data structures that are mapped to the old
+      // socket. They will now point to the new socket we are about
+      // to try to connect. This cannot fail as we hold the lock on
+      // the address, which is needed to close or swap out the old
+      // socket.
+      CHECK(swap_implementing_socket(existing.get(), socket.get()));
+
+      // The `existing` socket could be a perfectly functional socket.
+      // In this case, the socket may be referenced in the callback
+      // loop of `internal::ignore_recv_data`. We shutdown the socket
+      // in order to interrupt this callback loop and thereby release
+      // the final socket reference. This will not result in an
+      // `ExitedEvent` because we have already removed the `existing`
+      // socket from the mapping of linkees and linkers.
+      Try<Nothing> shutdown = existing->shutdown();
+      if (shutdown.isError()) {
+        VLOG(1) << "Failed to shutdown old link: " << shutdown.error();
+      }
+
+      connect = true;
     }
 
-    links.linkers[to].insert(process);
-    links.linkees[process].insert(to);
-    if (to.address != __address__) {
+    // We add the link while holding the lock on the address so that
+    // a concurrent close of the persistent socket either happens
+    // before (and we created a new socket above), or generates an
+    // `ExitedEvent` for this link.
+    synchronized (links.mutex) {
+      links.linkers[to].insert(process);
+      links.linkees[process].insert(to);
       links.remotes[to.address].insert(to);
     }
   }
@@ -1673,9 +2013,11 @@ Option<int> get_persistent_socket(const UPID& to)
 
 Option<int> SocketManager::get_persistent_socket(const UPID& to)
 {
-  synchronized (mutex) {
-    if (persists.count(to.address) > 0) {
-      return persists.at(to.address);
+  AddressShard& peer = address_shard(to.address);
+
+  synchronized (peer.mutex) {
+    if (peer.persists.count(to.address) > 0) {
+      return peer.persists.at(to.address);
     }
   }
 
@@ -1687,16 +2029,18 @@ PID<HttpProxy> SocketManager::proxy(const Socket& socket)
 {
   HttpProxy* proxy = nullptr;
 
-  synchronized (mutex) {
+  SocketShard& shard = socket_shard(socket);
+
+  synchronized (shard.mutex) {
     // This socket might have been asked to get closed (e.g., remote
     // side hang up) while a process is attempting to handle an HTTP
     // request. Thus, if there is no more socket, return an empty PID.
-    if (sockets.count(socket) > 0) {
-      if (proxies.count(socket) > 0) {
-        return proxies[socket]->self();
+    if (shard.sockets.count(socket) > 0) {
+      if (shard.proxies.count(socket) > 0) {
+        return shard.proxies[socket]->self();
       } else {
-        proxy = new HttpProxy(sockets.at(socket));
-        proxies[socket] = proxy;
+        proxy = new HttpProxy(shard.sockets.at(socket));
+        shard.proxies[socket] = proxy;
       }
     }
   }
@@ -1791,21 +2135,23 @@ void SocketManager::send(Encoder* encoder, bool persist)
 {
   CHECK(encoder != nullptr);
 
-  synchronized (mutex) {
+  SocketShard& shard = socket_shard(encoder->socket());
+
+  synchronized (shard.mutex) {
     Socket socket = encoder->socket();
-    if (sockets.count(socket) > 0) {
+    if (shard.sockets.count(socket) > 0) {
       // Update whether or not this socket should get disposed after
       // there is no more data to send.
       if (!persist) {
-        dispose.insert(socket);
+        shard.dispose.insert(socket);
       }
 
-      if (outgoing.count(socket) > 0) {
-        outgoing[socket].push(encoder);
+      if (shard.outgoing.count(socket) > 0) {
+        shard.outgoing[socket].push(encoder);
         encoder = nullptr;
       } else {
         // Initialize the outgoing queue.
-        outgoing[socket];
+        shard.outgoing[socket];
       }
     } else {
       VLOG(1) << "Attempting to send on a no longer valid socket!";
@@ -1864,23 +2210,24 @@ void SocketManager::send_connect(
     // If we allow downgrading from SSL to non-SSL, then retry as a
     // POLL socket.
     if (attempt_downgrade) {
-      synchronized (mutex) {
-        Try<Socket> create = Socket::create(Socket::POLL);
-        if (create.isError()) {
-          VLOG(1) << "Failed to link, create socket: " << create.error();
-          socket_manager->close(socket);
-          delete message;
-          return;
-        }
+      Try<Socket> create = Socket::create(Socket::POLL);
+      if (create.isError()) {
+        VLOG(1) << "Failed to link, create socket: " << create.error();
+        socket_manager->close(socket);
+        delete message;
+        return;
+      }
 
-        poll_socket = create.get();
+      poll_socket = create.get();
 
-        // Update all the data structures that are mapped to the socket
-        // that just failed to connect. They will now point to the new
-        // POLL socket we are about to try to connect. Even if the
-        // process has exited, persistent links will stay around, and
-        // temporary links will get cleaned up as they would otherwise.
-        swap_implementing_socket(socket, poll_socket.get());
+      // Update all the data structures that are mapped to the socket
+      // that just failed to connect. They will now point to the new
+      // POLL socket we are about to try to connect. Even if the
+      // process has exited, persistent links will stay around, and
+      // temporary links will get cleaned up as they would otherwise.
+      if (!swap_implementing_socket(socket, poll_socket.get())) {
+        delete message;
+        return;
       }
 
       CHECK_SOME(poll_socket);
@@ -1904,7 +2251,13 @@ void SocketManager::send_connect(
     return;
   }
 
-  Encoder* encoder = new MessageEncoder(socket, message);
+  Encoder* encoder = nullptr;
+
+  SocketShard& shard = socket_shard(socket);
+
+  synchronized (shard.mutex) {
+    encoder = new MessageEncoder(socket, message, connection(&shard, socket));
+  }
 
   // Receive and ignore data from this socket. Note that we don't
   // expect to receive anything other than HTTP '202 Accepted'
@@ -1918,7 +2271,8 @@ void SocketManager::send_connect(
         lambda::_1,
         socket,
         data,
-        size));
+        size,
+        Option<size_t>(0)));
 
   internal::send(encoder, socket);
 }
@@ -1931,31 +2285,56 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
   const Address& address = message->to.address;
 
   Option<Socket> socket = None();
+  Encoder* encoder = nullptr;
   bool connect = false;
 
-  synchronized (mutex) {
+  // Encode the message before acquiring any lock, since this copies
+  // its body. In the binary framing, the IDs of its strings depend on
+  // the socket and get filled in under the lock, see `encode()`.
+  string data = binary_framing
+    ? MessageEncoder::frame(*message)
+    : MessageEncoder::encode(message);
+
+  AddressShard& peer = address_shard(address);
+
+  synchronized (peer.mutex) {
     // Check if there is already a socket.
-    bool persist = persists.count(address) > 0;
-    bool temp = temps.count(address) > 0;
+    bool persist = peer.persists.count(address) > 0;
+    bool temp = peer.temps.count(address) > 0;
     if (persist || temp) {
-      int s = persist ? persists[address] : temps[address];
-      CHECK(sockets.count(s) > 0);
-      socket = sockets.at(s);
+      int s = persist ? peer.persists[address] : peer.temps[address];
 
-      // Update whether or not this socket should get disposed after
-      // there is no more data to send.
-      if (!persist) {
-        dispose.insert(socket.get());
-      }
+      SocketShard& shard = socket_shard(s);
 
-      if (outgoing.count(socket.get()) > 0) {
-        outgoing[socket.get()].push(new MessageEncoder(socket.get(), message));
-        return;
-      } else {
-        // Initialize the outgoing queue.
-        outgoing[socket.get()];
-      }
+      synchronized (shard.mutex) {
+        CHECK(shard.sockets.count(s) > 0);
+        socket = shard.sockets.at(s);
+
+        // Update whether or not this socket should get disposed after
+        // there is no more data to send.
+        if (!persist) {
+          shard.dispose.insert(socket.get());
+        }
+
+        vector<Encoder*> encoders =
+          encode(&shard, s, message, std::move(data));
+
+        if (shard.outgoing.count(socket.get()) > 0) {
+          foreach (Encoder* encoder, encoders) {
+            shard.outgoing[socket.get()].push(encoder);
+          }
+          return;
+        } else {
+          // Initialize the outgoing queue with the encoders that
+          // follow the one we send below.
+          encoder = encoders.front();
 
+          queue<Encoder*>& outgoing = shard.outgoing[socket.get()];
+          for (size_t i = 1; i < encoders.size(); i++) {
+            outgoing.push(encoders[i]);
+          }
+        }
+      }
     } else {
       // No persistent or temporary socket to the socket address
       // currently exists, so we create a temporary one.
@@ -1971,16 +2350,25 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
       socket = create.get();
       int s = socket.get();
 
-      CHECK(sockets.count(s) == 0);
-      sockets.emplace(s, socket.get());
+      SocketShard& shard = socket_shard(s);
+
+      synchronized (shard.mutex) {
+        CHECK(shard.sockets.count(s) == 0);
+        shard.sockets.emplace(s, socket.get());
 
-      addresses[s] = address;
-      temps[address] = s;
+        shard.addresses[s] = address;
 
-      dispose.insert(s);
+        shard.dispose.insert(s);
 
-      // Initialize the outgoing queue.
-      outgoing[s];
+        // Initialize the outgoing queue.
+        shard.outgoing[s];
+
+        if (binary_framing) {
+          shard.framings[s];
+        }
+      }
+
+      peer.temps[address] = s;
 
       connect = true;
     }
@@ -1998,18 +2386,100 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
   } else {
     // If we're not connecting and we haven't added the encoder to
     // the 'outgoing' queue then schedule it to be sent.
-    internal::send(
-        new MessageEncoder(socket.get(), message),
-        socket.get());
+    CHECK_NOTNULL(encoder);
+    internal::send(encoder, socket.get());
   }
 }
 
 
+vector<Encoder*> SocketManager::encode(
+    SocketShard* shard,
+    int s,
+    Message* message,
+    string&& data)
+{
+  const Socket& socket = shard->sockets.at(s);
+
+  framing::Connection* connection = this->connection(shard, s);
+
+  if (connection == nullptr) {
+    if (binary_framing) {
+      return {new MessageEncoder(socket, message)};
+    }
+
+    return {new MessageEncoder(socket, message, std::move(data))};
+  }
+
+  if (!connection->binary) {
+    // The message is encoded in HTTP while the binary framing has not
+    // been accepted, which depends on whether it was offered already.
+    return {new MessageEncoder(socket, message, connection)};
+  }
+
+  const string interned = MessageEncoder::intern(*message, connection, &data);
+
+  Encoder* encoder = new MessageEncoder(socket, message, std::move(data));
+
+  if (interned.empty()) {
+    return {encoder};
+  }
+
+  return {new DataEncoder(socket, interned), encoder};
+}
+
+
+// Coalesces the data of 'encoder' and of the data encoders at the
+// front of 'encoders' into a single encoder, as long as the total
+// stays within `OUTGOING_BATCH_BYTES`. This turns a burst of small
+// messages queued on a socket (e.g., status update acknowledgements
+// or offers sent to a framework) into a single write.
+static Encoder* coalesce(Encoder* encoder, queue<Encoder*>* encoders)
+{
+  CHECK_EQ(Encoder::DATA, encoder->kind());
+
+  auto fits = [encoders](size_t size) {
+    return !encoders->empty() &&
+      encoders->front()->kind() == Encoder::DATA &&
+      size + encoders->front()->remaining() <= OUTGOING_BATCH_BYTES;
+  };
+
+  if (!fits(encoder->remaining())) {
+    return encoder;
+  }
+
+  string data;
+
+  auto append = [&data](Encoder* encoder) {
+    size_t length;
+    const char* next = static_cast<DataEncoder*>(encoder)->next(&length);
+    data.append(next, length);
+    delete encoder;
+  };
+
+  Socket socket = encoder->socket();
+
+  append(encoder);
+
+  while (fits(data.size())) {
+    append(encoders->front());
+    encoders->pop();
+  }
+
+  return new DataEncoder(socket, std::move(data));
+}
+
+
 Encoder* SocketManager::next(int s)
 {
   HttpProxy* proxy = nullptr; // Non-null if needs to be terminated.
 
-  synchronized (mutex) {
+  // Set if this is an outbound socket to be disposed, see below.
+  Option<Socket> socket = None();
+  Option<Address> address = None();
+
+  SocketShard& shard = socket_shard(s);
+
+  synchronized (shard.mutex) {
     // We cannot assume 'sockets.count(s) > 0' here because it's
     // possible that 's' has been removed with a call to
     // SocketManager::close. For example, it could be the case that a
@@ -2023,54 +2493,59 @@ Encoder* SocketManager::next(int s)
     // invoked we find out there there is no more data and thus stop
     // sending.
     // TODO(benh): Should we actually finish sending the data!?
-    if (sockets.count(s) > 0) {
-      CHECK(outgoing.count(s) > 0);
+    if (shard.sockets.count(s) > 0) {
+      CHECK(shard.outgoing.count(s) > 0);
 
-      if (!outgoing[s].empty()) {
+      queue<Encoder*>& encoders = shard.outgoing[s];
+
+      if (!encoders.empty()) {
         // More messages!
-        Encoder* encoder = outgoing[s].front();
-        outgoing[s].pop();
+        Encoder* encoder = encoders.front();
+        encoders.pop();
+
+        if (encoder->kind() == Encoder::DATA && !encoders.empty()) {
+          encoder = coalesce(encoder, &encoders);
+        }
+
         return encoder;
       } else {
         // No more messages ... erase the outgoing queue.
-        outgoing.erase(s);
+        shard.outgoing.erase(s);
 
-        if (dispose.count(s) > 0) {
+        if (shard.dispose.count(s) > 0) {
           // This is either a temporary socket we created or it's a
           // socket that we were receiving data from and possibly
           // sending HTTP responses back on. Clean up either way.
-          if (addresses.count(s) > 0) {
-            const Address& address = addresses[s];
-            CHECK(temps.count(address) > 0 && temps[address] == s);
-            temps.erase(address);
-            addresses.erase(s);
-          }
-
-          if (proxies.count(s) > 0) {
-            proxy = proxies[s];
-            proxies.erase(s);
+          if (shard.addresses.count(s) > 0) {
+            // The former is also tracked by its address, whose lock
+            // must be acquired before this one, so it gets cleaned
+            // up below.
+            socket = shard.sockets.at(s);
+            address = shard.addresses[s];
+          } else {
+            proxy = remove(&shard, s);
           }
+        }
+      }
+    }
+  }
 
-          dispose.erase(s);
-
-          auto iterator = sockets.find(s);
-
-          // We don't actually close the socket (we wait for the Socket
-          // abstraction to close it once there are no more references),
-          // but we do shutdown the receiving end so any DataDecoder
-          // will get cleaned up (which might have the last reference).
-
-          // Hold on to the Socket and remove it from the 'sockets'
-          // map so that in the case where 'shutdown()' ends up
-          // calling close the termination logic is not run twice.
-          Socket socket = iterator->second;
-          sockets.erase(iterator);
-
-          Try<Nothing> shutdown = socket.shutdown();
-          if (shutdown.isError()) {
-            LOG(ERROR) << "Failed to shutdown socket with fd " << socket.get()
-                       << ": " << shutdown.error();
-          }
+  if (address.isSome()) {
+    AddressShard& peer = address_shard(address.get());
+
+    synchronized (peer.mutex) {
+      synchronized (shard.mutex) {
+        // Since we released the lock on the socket, it might have
+        // been closed, or more data might have been sent on it (in
+        // which case it will be cleaned up once that data is sent).
+        if (current(&shard, s, socket.get(), address.get()) &&
+            shard.outgoing.count(s) == 0 &&
+            shard.dispose.count(s) > 0) {
+          CHECK(peer.temps.count(address.get()) > 0 &&
+                peer.temps[address.get()] == s);
+          peer.temps.erase(address.get());
+
+          proxy = remove(&shard, s);
         }
       }
     }
@@ -2087,72 +2562,121 @@ Encoder* SocketManager::next(int s)
 }
 
 
+void SocketManager::upgrade(int s)
+{
+  SocketShard& shard = socket_shard(s);
+
+  synchronized (shard.mutex) {
+    framing::Connection* connection = this->connection(&shard, s);
+    if (connection != nullptr) {
+      VLOG(2) << "Switching to the binary framing on socket " << s;
+      connection->binary = true;
+    }
+  }
+}
+
+
+HttpProxy* SocketManager::remove(SocketShard* shard, int s)
+{
+  // Clean up any remaining encoders for this socket.
+  if (shard->outgoing.count(s) > 0) {
+    while (!shard->outgoing[s].empty()) {
+      Encoder* encoder = shard->outgoing[s].front();
+      delete encoder;
+      shard->outgoing[s].pop();
+    }
+
+    shard->outgoing.erase(s);
+  }
+
+  shard->addresses.erase(s);
+  shard->framings.erase(s);
+
+  // Clean up any proxy associated with this socket.
+  HttpProxy* proxy = nullptr;
+  if (shard->proxies.count(s) > 0) {
+    proxy = shard->proxies[s];
+    shard->proxies.erase(s);
+  }
+
+  shard->dispose.erase(s);
+
+  auto iterator = shard->sockets.find(s);
+  CHECK(iterator != shard->sockets.end());
+
+  // We don't actually close the socket (we wait for the Socket
+  // abstraction to close it once there are no more references), but
+  // we do shutdown the receiving end so any DataDecoder or
+  // 'ignore_data' receivers will get cleaned up (which might have the
+  // last reference). Calling 'shutdown' will trigger 'ignore_data'
+  // which will get back a 0 (i.e., EOF) when it tries to 'recv' from
+  // the socket.
+
+  // Hold on to the Socket and remove it from the 'sockets' map so that
+  // in the case where 'shutdown()' ends up calling close the
+  // termination logic is not run twice.
+  Socket socket = iterator->second;
+  shard->sockets.erase(iterator);
+
+  Try<Nothing> shutdown = socket.shutdown();
+  if (shutdown.isError()) {
+    LOG(ERROR) << "Failed to shutdown socket with fd " << socket.get()
+               << ": " << shutdown.error();
+  }
+
+  return proxy;
+}
+
+
 void SocketManager::close(int s)
 {
   HttpProxy* proxy = nullptr; // Non-null if needs to be terminated.
 
-  synchronized (mutex) {
+  // Set if this is an outbound socket, see below.
+  Option<Socket> socket = None();
+  Option<Address> address = None();
+
+  SocketShard& shard = socket_shard(s);
+
+  synchronized (shard.mutex) {
     // This socket might not be active if it was already asked to get
     // closed (e.g., a write on the socket failed so we try and close
     // it and then later the recv side of the socket gets closed so we
     // try and close it again). Thus, ignore the request if we don't
     // know about the socket.
-    if (sockets.count(s) > 0) {
-      // Clean up any remaining encoders for this socket.
-      if (outgoing.count(s) > 0) {
-        while (!outgoing[s].empty()) {
-          Encoder* encoder = outgoing[s].front();
-          delete encoder;
-          outgoing[s].pop();
-        }
-
-        outgoing.erase(s);
+    if (shard.sockets.count(s) > 0) {
+      if (shard.addresses.count(s) > 0) {
+        // Sockets used for remote communication are also tracked by
+        // their address, whose lock must be acquired before this one,
+        // so they get cleaned up below.
+        socket = shard.sockets.at(s);
+        address = shard.addresses[s];
+      } else {
+        proxy = remove(&shard, s);
       }
+    }
+  }
 
-      // Clean up after sockets used for remote communication.
-      if (addresses.count(s) > 0) {
-        const Address& address = addresses[s];
+  if (address.isSome()) {
+    AddressShard& peer = address_shard(address.get());
+
+    synchronized (peer.mutex) {
+      synchronized (shard.mutex) {
+        // The socket might have been closed or swapped out since we
+        // released the lock on it.
+        if (current(&shard, s, socket.get(), address.get())) {
+          // Don't bother invoking `exited` unless socket was persistent.
+          if (peer.persists.count(address.get()) > 0 &&
+              peer.persists[address.get()] == s) {
+            peer.persists.erase(address.get());
+            exited(address.get()); // Generate ExitedEvent(s)!
+          } else if (peer.temps.count(address.get()) > 0 &&
+                     peer.temps[address.get()] == s) {
+            peer.temps.erase(address.get());
+          }
 
-        // Don't bother invoking `exited` unless socket was persistent.
-        if (persists.count(address) > 0 && persists[address] == s) {
-          persists.erase(address);
-          exited(address); // Generate ExitedEvent(s)!
-        } else if (temps.count(address) > 0 && temps[address] == s) {
-          temps.erase(address);
+          proxy = remove(&shard, s);
         }
-
-        addresses.erase(s);
-      }
-
-      // Clean up any proxy associated with this socket.
-      if (proxies.count(s) > 0) {
-        proxy = proxies[s];
-        proxies.erase(s);
-      }
-
-      dispose.erase(s);
-      auto iterator = sockets.find(s);
-
-      // We need to stop any 'ignore_data' receivers as they may have
-      // the last Socket reference so we shutdown recvs but don't do a
-      // full close (since that will be taken care of by ~Socket, see
-      // comment below). Calling 'shutdown' will trigger 'ignore_data'
-      // which will get back a 0 (i.e., EOF) when it tries to 'recv'
-      // from the socket. Note we need to do this before we call
-      // 'sockets.erase(s)' to avoid the potential race with the last
-      // reference being in 'sockets'.
-
-
-      // Hold on to the Socket and remove it from the 'sockets' map so
-      // that in the case where 'shutdown()' ends up calling close the
-      // termination logic is not run twice.
-      Socket socket = iterator->second;
-      sockets.erase(iterator);
-
-      Try<Nothing> shutdown = socket.shutdown();
-      if (shutdown.isError()) {
-        LOG(ERROR) << "Failed to shutdown socket with fd " << socket.get()
-                   << ": " << shutdown.error();
       }
     }
   }
@@ -2189,7 +2713,7 @@ void SocketManager::exited(const Address& address)
   // into ProcessManager ... then we wouldn't have to convince
   // ourselves that the accesses to each Process object will always be
   // valid.
-  synchronized (mutex) {
+  synchronized (links.mutex) {
     if (!links.remotes.contains(address)) {
       return; // No linkees for this socket address!
     }
@@ -2230,7 +2754,7 @@ void SocketManager::exited(ProcessBase* process)
   // can update the clocks of linked processes as appropriate.
   const Time time = Clock::now(process);
 
-  synchronized (mutex) {
+  synchronized (links.mutex) {
     // If this process had linked to anything, we need to clean
     // up any pointers to it. Also, if this process was the last
     // linker to a remote linkee, we must remove linkee from the
@@ -2282,60 +2806,125 @@ void SocketManager::exited(ProcessBase* process)
 }
 
 
-void SocketManager::swap_implementing_socket(
+bool SocketManager::swap_implementing_socket(
     const Socket& from, const Socket& to)
 {
   const int from_fd = from.get();
   const int to_fd = to.get();
 
-  synchronized (mutex) {
-    // Make sure 'from' and 'to' are valid to swap.
-    CHECK(sockets.count(from_fd) > 0);
-    CHECK(sockets.count(to_fd) == 0);
+  SocketShard& from_shard = socket_shard(from_fd);
+  SocketShard& to_shard = socket_shard(to_fd);
 
-    sockets.erase(from_fd);
-    sockets.emplace(to_fd, to);
+  // Only outbound sockets get swapped, which are also tracked by
+  // their address, whose lock must be acquired first.
+  Option<Address> address = None();
 
-    // Update the dispose set if this is a temporary link.
-    if (dispose.count(from_fd) > 0) {
-      dispose.insert(to_fd);
-      dispose.erase(from_fd);
+  synchronized (from_shard.mutex) {
+    if (from_shard.addresses.count(from_fd) > 0) {
+      address = from_shard.addresses[from_fd];
     }
+  }
 
-    // Update the fd that this address is associated with. Once we've
-    // done this we can update the 'temps' and 'persists'
-    // data structures using this updated address.
-    addresses[to_fd] = addresses[from_fd];
-    addresses.erase(from_fd);
+  if (address.isNone()) {
+    return false;
+  }
 
-    // If this address is a temporary link.
-    if (temps.count(addresses[to_fd]) > 0) {
-      temps[addresses[to_fd]] = to_fd;
-      // No need to erase as we're changing the value, not the key.
-    }
+  AddressShard& peer = address_shard(address.get());
 
-    // If this address is a persistent link.
-    if (persists.count(addresses[to_fd]) > 0) {
-      persists[addresses[to_fd]] = to_fd;
-      // No need to erase as we're changing the value, not the key.
-    }
+  // Acquire the locks on the socket shards by increasing index.
+  SocketShard& first = &from_shard < &to_shard ? from_shard : to_shard;
+  SocketShard& second = &from_shard < &to_shard ? to_shard : from_shard;
+
+  synchronized (peer.mutex) {
+    synchronized (first.mutex) {
+      synchronized (second.mutex) {
+        // Make sure 'from' and 'to' are valid to swap.
+        if (!current(&from_shard, from_fd, from, address.get())) {
+          return false;
+        }
+
+        CHECK(to_shard.sockets.count(to_fd) == 0);
+
+        from_shard.sockets.erase(from_fd);
+        to_shard.sockets.emplace(to_fd, to);
+
+        // Update the dispose set if this is a temporary link.
+        if (from_shard.dispose.count(from_fd) > 0) {
+          to_shard.dispose.insert(to_fd);
+          from_shard.dispose.erase(from_fd);
+        }
+
+        // Update the fd that this address is associated with.
+        to_shard.addresses[to_fd] = address.get();
+        from_shard.addresses.erase(from_fd);
+
+        // If this address is a temporary link.
+        if (peer.temps.count(address.get()) > 0) {
+          peer.temps[address.get()] = to_fd;
+          // No need to erase as we're changing the value, not the key.
+        }
+
+        // If this address is a persistent link.
+        if (peer.persists.count(address.get()) > 0) {
+          peer.persists[address.get()] = to_fd;
+          // No need to erase as we're changing the value, not the key.
+        }
+
+        // Move any encoders queued against this link to the new socket.
+        to_shard.outgoing[to_fd] = std::move(from_shard.outgoing[from_fd]);
+        from_shard.outgoing.erase(from_fd);
+
+        // The framing is negotiated again on the new socket. Messages
+        // that are queued in the binary framing refer to the strings
+        // interned on the old socket, so they are encoded again.
+        if (from_shard.framings.count(from_fd) > 0) {
+          const bool binary = from_shard.framings[from_fd].binary;
+
+          from_shard.framings.erase(from_fd);
+          to_shard.framings[to_fd];
+
+          if (binary) {
+            queue<Encoder*> encoders;
+            std::swap(encoders, to_shard.outgoing[to_fd]);
+
+            while (!encoders.empty()) {
+              Encoder* front = encoders.front();
+              encoders.pop();
+
+              // The INTERN frames queued ahead of the messages are
+              // specific to the old socket, see `encode()`.
+              MessageEncoder* encoder = dynamic_cast<MessageEncoder*>(front);
+              if (encoder == nullptr) {
+                delete front;
+                continue;
+              }
 
-    // Move any encoders queued against this link to the new socket.
-    outgoing[to_fd] = std::move(outgoing[from_fd]);
-    outgoing.erase(from_fd);
+              Message* message = encoder->release();
+              delete encoder;
 
-    // Update the fd any proxies are associated with.
-    if (proxies.count(from_fd) > 0) {
-      proxies[to_fd] = proxies[from_fd];
-      proxies.erase(from_fd);
+              to_shard.outgoing[to_fd].push(new MessageEncoder(
+                  to, message, connection(&to_shard, to_fd)));
+            }
+          }
+        }
+
+        // Update the fd any proxies are associated with.
+        if (from_shard.proxies.count(from_fd) > 0) {
+          to_shard.proxies[to_fd] = from_shard.proxies[from_fd];
+          from_shard.proxies.erase(from_fd);
+        }
+      }
     }
   }
+
+  return true;
 }
 
 
 ProcessManager::ProcessManager(const Option<string>& _delegate)
   : delegate(_delegate),
-    running(0),
+    scheduled(0),
+    enqueues(0),
     joining_threads(false) {}
 
 
@@ -2390,6 +2979,10 @@ ProcessManager::~ProcessManager()
     thread->join();
     delete thread;
   }
+
+  foreach (RunQueue* runq, runqs) {
+    delete runq;
+  }
 }
 
 
@@ -2437,10 +3030,18 @@ long ProcessManager::init_threads()
 
   threads.reserve(num_worker_threads + 1);
 
+  // Create the run queues before any worker starts dequeueing.
+  runqs.reserve(num_worker_threads);
+  for (long i = 0; i < num_worker_threads; i++) {
+    runqs.push_back(new RunQueue());
+  }
+
   struct
   {
-    void operator()() const
+    void operator()(long index) const
     {
+      __worker__ = index;
+
       do {
         ProcessBase* process = process_manager->dequeue();
         if (process == nullptr) {
@@ -2458,6 +3059,8 @@ long ProcessManager::init_threads()
         }
         process_manager->resume(process);
       } while (true);
+
+      drain_dispatch_events();
     }
 
     // We hold a constant reference to `joining_threads` to make it clear that
@@ -2468,7 +3071,7 @@ long ProcessManager::init_threads()
   // Create processing threads.
   for (long i = 0; i < num_worker_threads; i++) {
     // Retain the thread handles so that we can join when shutting down.
-    threads.emplace_back(new std::thread(worker));
+    threads.emplace_back(new std::thread(worker, i));
   }
 
   // Create a thread for the event loop.
@@ -2742,6 +3345,12 @@ void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
 
+  // Remember the worker so that the process gets enqueued back onto
+  // its run queue (threads donated in 'wait' are not workers).
+  if (__worker__ >= 0) {
+    process->worker.store(__worker__, std::memory_order_relaxed);
+  }
+
   VLOG(2) << "Resuming " << process->pid << " at " << Clock::now();
 
   bool terminate = false;
@@ -2756,26 +3365,64 @@ void ProcessManager::resume(ProcessBase* process)
     catch (...) { terminate = true; }
   }
 
+  // Events of the previous batch, which have all been serviced, that
+  // get deleted without holding the process mutex (see
+  // 'EventQueue::batch'). The batch itself stays in the event queue
+  // until serviced so that it is still reported by
+  // 'ProcessBase::eventCount' and '/__processes__'.
+  vector<Event*> retired;
+
   while (!terminate && !blocked) {
     Event* event = nullptr;
 
-    synchronized (process->mutex) {
-      if (process->events.size() > 0) {
-        event = process->events.front();
-        process->events.pop_front();
-        process->state = ProcessBase::RUNNING;
-      } else {
-        process->state = ProcessBase::BLOCKED;
-        blocked = true;
+    // Injected events jump the queue, including the events that
+    // were already dequeued as part of the current batch.
+    if (process->events->hasInjected()) {
+      synchronized (process->mutex) {
+        event = process->events->dequeueInjected();
       }
     }
 
-    if (!blocked) {
-      CHECK(event != nullptr);
+    // Batched events are owned (and deleted) by the event queue.
+    const bool batched = event == nullptr;
+
+    if (batched) {
+      event = process->events->next();
+    }
+
+    if (event == nullptr) {
+      synchronized (process->mutex) {
+        if (process->events->batch(EVENT_BATCH_SIZE, &retired) > 0) {
+          process->state = ProcessBase::RUNNING;
+        } else {
+          process->state = ProcessBase::BLOCKED;
+
+          // An event might have been enqueued after we found the
+          // queue empty but before we blocked, in which case the
+          // enqueuer saw us running and did not make us runnable.
+          // Unless an enqueuer has since made us runnable (and
+          // another worker will resume us) we continue running.
+          ProcessBase::ProcessState expected = ProcessBase::BLOCKED;
+          blocked = process->events->empty() ||
+            !process->state.compare_exchange_strong(
+                expected, ProcessBase::RUNNING);
+        }
+      }
+
+      foreach (Event* event, retired) {
+        delete event;
+      }
+      retired.clear();
 
-      // Determine if we should filter this event.
+      continue;
+    }
+
+    // Determine if we should filter this event. Filters are only
+    // installed in tests, so avoid the (global) filterer lock
+    // when there is no filter.
+    if (filterer.load() != nullptr) {
       synchronized (filterer_mutex) {
-        if (filterer != nullptr) {
+        if (filterer.load() != nullptr) {
           bool filter = false;
           struct FilterVisitor : EventVisitor
           {
@@ -2783,22 +3430,22 @@ void ProcessManager::resume(ProcessBase* process)
 
             virtual void visit(const MessageEvent& event)
             {
-              *filter = filterer->filter(event);
+              *filter = filterer.load()->filter(event);
             }
 
             virtual void visit(const DispatchEvent& event)
             {
-              *filter = filterer->filter(event);
+              *filter = filterer.load()->filter(event);
             }
 
             virtual void visit(const HttpEvent& event)
             {
-              *filter = filterer->filter(event);
+              *filter = filterer.load()->filter(event);
             }
 
             virtual void visit(const ExitedEvent& event)
             {
-              *filter = filterer->filter(event);
+              *filter = filterer.load()->filter(event);
             }
 
             bool* filter;
@@ -2807,41 +3454,54 @@ void ProcessManager::resume(ProcessBase* process)
           event->visit(&visitor);
 
           if (filter) {
-            delete event;
+            if (!batched) {
+              delete event;
+            }
             continue; // Try and execute the next event.
           }
         }
       }
+    }
 
-      // Determine if we should terminate.
-      terminate = event->is<TerminateEvent>();
-
-      // Now service the event.
-      try {
-        process->serve(*event);
-      } catch (const std::exception& e) {
-        std::cerr << "libprocess: " << process->pid
-                  << " terminating due to "
-                  << e.what() << std::endl;
-        terminate = true;
-      } catch (...) {
-        std::cerr << "libprocess: " << process->pid
-                  << " terminating due to unknown exception" << std::endl;
-        terminate = true;
-      }
+    // Determine if we should terminate.
+    terminate = event->is<TerminateEvent>();
+
+    // Now service the event.
+    try {
+      process->serve(*event);
+    } catch (const std::exception& e) {
+      std::cerr << "libprocess: " << process->pid
+                << " terminating due to "
+                << e.what() << std::endl;
+      terminate = true;
+    } catch (...) {
+      std::cerr << "libprocess: " << process->pid
+                << " terminating due to unknown exception" << std::endl;
+      terminate = true;
+    }
 
+    if (!batched) {
       delete event;
+    }
+
+    if (terminate) {
+      // Delete the rest of the batch along with the pending events.
+      synchronized (process->mutex) {
+        process->events->batch(0, &retired);
+      }
 
-      if (terminate) {
-        cleanup(process);
+      foreach (Event* event, retired) {
+        delete event;
       }
+
+      cleanup(process);
     }
   }
 
   __process__ = nullptr;
 
-  CHECK_GE(running.load(), 1);
-  running.fetch_sub(1);
+  CHECK_GE(scheduled.load(), 1);
+  scheduled.fetch_sub(1);
 }
 
 
@@ -2863,8 +3523,9 @@ void ProcessManager::cleanup(ProcessBase* process)
 
   synchronized (process->mutex) {
     process->state = ProcessBase::TERMINATING;
-    events = process->events;
-    process->events.clear();
+    while (Event* event = process->events->dequeue()) {
+      events.push_back(event);
+    }
   }
 
   // Delete pending events.
@@ -2890,7 +3551,12 @@ void ProcessManager::cleanup(ProcessBase* process)
     }
 
     synchronized (process->mutex) {
-      CHECK(process->events.empty());
+      // Collect any events that were enqueued concurrently with
+      // setting the terminating state above (the enqueuers held a
+      // reference so they are done by now).
+      while (Event* event = process->events->dequeue()) {
+        events.push_back(event);
+      }
 
       processes.erase(process->pid.id);
 
@@ -2943,6 +3609,14 @@ void ProcessManager::cleanup(ProcessBase* process)
       gate->open();
     }
   }
+
+  // Delete the events that were enqueued concurrently with
+  // terminating (outside of the processes lock, see above).
+  while (!events.empty()) {
+    Event* event = events.front();
+    events.pop_front();
+    delete event;
+  }
 }
 
 
@@ -3021,23 +3695,14 @@ bool ProcessManager::wait(const UPID& pid)
       // Check if it is runnable in order to donate this thread.
       if (process->state == ProcessBase::BOTTOM ||
           process->state == ProcessBase::READY) {
-        synchronized (runq_mutex) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            // Found it! Remove it from the run queue since we'll be
-            // donating our thread and also increment 'running' before
-            // leaving this 'runq' protected critical section so that
-            // everyone that is waiting for the processes to settle
-            // continue to wait (otherwise they could see nothing in
-            // 'runq' and 'running' equal to 0 between when we exit
-            // this critical section and increment 'running').
-            runq.erase(it);
-            running.fetch_add(1);
-          } else {
-            // Another thread has resumed the process ...
-            process = nullptr;
-          }
+        // Remove it from the run queue since we'll be donating our
+        // thread. Note that 'scheduled' already accounts for the
+        // process (it was incremented when the process got enqueued)
+        // so everyone that is waiting for the processes to settle
+        // continues to wait until we are done resuming it.
+        if (!remove(process)) {
+          // Another thread has resumed the process ...
+          process = nullptr;
         }
       } else {
         // Process is not runnable, so no need to donate ...
@@ -3124,14 +3789,40 @@ void ProcessManager::enqueue(ProcessBase* process)
     return;
   }
 
+  // Account for the process before it becomes visible to the workers
+  // so that 'settle' can not observe it neither runnable nor running.
+  scheduled.fetch_add(1);
+  enqueues.fetch_add(1);
+
+  // Prefer the run queue of the worker that last resumed the process
+  // and otherwise the run queue of the calling worker (e.g., for a
+  // newly spawned process). Fall back to the shared run queue if the
+  // caller is not a worker or the worker's run queue is full.
+  //
   // TODO(benh): Check and see if this process has it's own thread. If
   // it does, push it on that threads runq, and wake up that thread if
-  // it's not running. Otherwise, check and see which thread this
-  // process was last running on, and put it on that threads runq.
+  // it's not running.
+  long index = process->worker.load(std::memory_order_relaxed);
+  if (index < 0) {
+    index = __worker__;
+  }
 
-  synchronized (runq_mutex) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  bool enqueued = false;
+
+  if (index >= 0 && static_cast<size_t>(index) < runqs.size()) {
+    RunQueue* local = runqs[index];
+    synchronized (local->mutex) {
+      if (local->processes.size() < RUNQ_CAPACITY) {
+        local->processes.push_back(process);
+        enqueued = true;
+      }
+    }
+  }
+
+  if (!enqueued) {
+    synchronized (runq_mutex) {
+      runq.push_back(process);
+    }
   }
 
   // Wake up the processing thread if necessary.
@@ -3141,20 +3832,43 @@ void ProcessManager::enqueue(ProcessBase* process)
 
 ProcessBase* ProcessManager::dequeue()
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
-
   ProcessBase* process = nullptr;
 
-  synchronized (runq_mutex) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
-      // Increment the running count of processes in order to support
-      // the Clock::settle() operation (this must be done atomically
-      // with removing the process from the runq).
-      running.fetch_add(1);
+  // First try this worker's own run queue.
+  if (__worker__ >= 0 && static_cast<size_t>(__worker__) < runqs.size()) {
+    RunQueue* local = runqs[__worker__];
+    synchronized (local->mutex) {
+      if (!local->processes.empty()) {
+        process = local->processes.front();
+        local->processes.pop_front();
+      }
+    }
+  }
+
+  // Then the shared run queue.
+  if (process == nullptr) {
+    synchronized (runq_mutex) {
+      if (!runq.empty()) {
+        process = runq.front();
+        runq.pop_front();
+      }
+    }
+  }
+
+  // Finally, steal from the back of the other workers' run queues,
+  // starting with the next worker so that stealing is spread out.
+  for (size_t i = 1; process == nullptr && i <= runqs.size(); i++) {
+    const size_t index = (__worker__ + i) % runqs.size();
+    if (static_cast<long>(index) == __worker__) {
+      continue;
+    }
+
+    RunQueue* victim = runqs[index];
+    synchronized (victim->mutex) {
+      if (!victim->processes.empty()) {
+        process = victim->processes.back();
+        victim->processes.pop_back();
+      }
     }
   }
 
@@ -3162,27 +3876,56 @@ ProcessBase* ProcessManager::dequeue()
 }
 
 
+bool ProcessManager::remove(ProcessBase* process)
+{
+  foreach (RunQueue* local, runqs) {
+    synchronized (local->mutex) {
+      deque<ProcessBase*>::iterator it =
+        find(local->processes.begin(), local->processes.end(), process);
+      if (it != local->processes.end()) {
+        local->processes.erase(it);
+        return true;
+      }
+    }
+  }
+
+  synchronized (runq_mutex) {
+    list<ProcessBase*>::iterator it = find(runq.begin(), runq.end(), process);
+    if (it != runq.end()) {
+      runq.erase(it);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
 void ProcessManager::settle()
 {
   bool done = true;
   do {
     done = true; // Assume to start that we are settled.
 
-    synchronized (runq_mutex) {
-      if (!runq.empty()) {
-        done = false;
-        continue;
-      }
+    const unsigned long before = enqueues.load();
 
-      if (running.load() > 0) {
-        done = false;
-        continue;
-      }
+    if (scheduled.load() > 0) {
+      done = false;
+      continue;
+    }
 
-      if (!Clock::settled()) {
-        done = false;
-        continue;
-      }
+    if (!Clock::settled()) {
+      done = false;
+      continue;
+    }
+
+    // Since nothing was runnable or running above, any process that
+    // could have created a timer after we checked the clock (e.g.,
+    // because a timer expired and dispatched to it) must have been
+    // enqueued in the meantime.
+    if (enqueues.load() != before) {
+      done = false;
+      continue;
     }
   } while (!done);
 }
@@ -3256,9 +3999,7 @@ Future<Response> ProcessManager::__processes__(const Request&)
       } visitor(&events);
 
       synchronized (process->mutex) {
-        foreach (Event* event, process->events) {
-          event->visit(&visitor);
-        }
+        process->events->visit(&visitor);
       }
 
       object.values["events"] = events;
@@ -3271,6 +4012,7 @@ Future<Response> ProcessManager::__processes__(const Request&)
 
 
 ProcessBase::ProcessBase(const string& id)
+  : events(new EventQueue())
 {
   process::initialize();
 
@@ -3278,6 +4020,8 @@ ProcessBase::ProcessBase(const string& id)
 
   refs = 0;
 
+  worker = -1;
+
   pid.id = id != "" ? id : ID::generate();
   pid.address = __address__;
 
@@ -3297,29 +4041,49 @@ void ProcessBase::enqueue(Event* event, bool inject)
 {
   CHECK(event != nullptr);
 
-  synchronized (mutex) {
-    if (state != TERMINATING && state != TERMINATED) {
-      if (!inject) {
-        events.push_back(event);
-      } else {
-        events.push_front(event);
-      }
+  // NOTE: The process might start terminating right after this check
+  // in which case the event gets deleted during cleanup instead (see
+  // ProcessManager::cleanup).
+  const ProcessState current = state.load();
+  if (current == TERMINATING || current == TERMINATED) {
+    delete event;
+    return;
+  }
 
-      if (state == BLOCKED) {
-        state = READY;
-        process_manager->enqueue(this);
-      }
+  events->enqueue(event, inject);
 
-      CHECK(state == BOTTOM ||
-            state == READY ||
-            state == RUNNING);
-    } else {
-      delete event;
-    }
+  // Make the process runnable if it is blocked. If the process is
+  // about to block it will notice this event when it re-checks its
+  // event queue (see ProcessManager::resume).
+  ProcessState expected = BLOCKED;
+  if (state.compare_exchange_strong(expected, READY)) {
+    process_manager->enqueue(this);
   }
 }
 
 
+template <typename T>
+size_t ProcessBase::eventCount()
+{
+  size_t count = 0U;
+
+  synchronized (mutex) {
+    count = events->count<T>();
+  }
+
+  return count;
+}
+
+
+// Explicit instantiations of the supported event types, since the
+// event queue is not exposed in the header.
+template size_t ProcessBase::eventCount<MessageEvent>();
+template size_t ProcessBase::eventCount<DispatchEvent>();
+template size_t ProcessBase::eventCount<HttpEvent>();
+template size_t ProcessBase::eventCount<ExitedEvent>();
+template size_t ProcessBase::eventCount<TerminateEvent>();
+
+
 void ProcessBase::inject(
     const UPID& from,
     const string& name,
@@ -3368,7 +4132,7 @@ void ProcessBase::visit(const MessageEvent& event)
 
 void ProcessBase::visit(const DispatchEvent& event)
 {
-  (*event.f)(this);
+  std::move(event.f)(this);
 }
 
 
@@ -3771,16 +4535,86 @@ bool exited(const UPID& from, const UPID& to)
 } // namespace inject {
 
 
+// Dispatch events are recycled through a per thread free list in
+// order to avoid going to the allocator for every dispatch. An event
+// gets returned to the pool of the worker thread that deletes it
+// (typically the worker that ran the dispatch) and since most
+// dispatches are made from within other processes the worker threads
+// end up both allocating and deleting most of the events. The pools
+// are bounded, and only worker threads pool events so that the pools
+// can be drained when the workers exit.
+namespace {
+
+struct PooledDispatchEvent
+{
+  PooledDispatchEvent* next;
+};
+
+
+static const size_t DISPATCH_EVENT_POOL_CAPACITY = 1024;
+
+static THREAD_LOCAL PooledDispatchEvent* __dispatch_events__ = nullptr;
+static THREAD_LOCAL size_t __dispatch_events_size__ = 0;
+
+} // namespace {
+
+
+void* DispatchEvent::operator new(size_t size)
+{
+  // Derived classes (if any) might not fit, see the NOTE in
+  // 'DispatchEvent::operator delete'.
+  if (size == sizeof(DispatchEvent) && __dispatch_events__ != nullptr) {
+    PooledDispatchEvent* event = __dispatch_events__;
+    __dispatch_events__ = event->next;
+    __dispatch_events_size__--;
+    return event;
+  }
+
+  return ::operator new(size);
+}
+
+
+void DispatchEvent::operator delete(void* event, size_t size)
+{
+  // NOTE: Only memory for exactly a 'DispatchEvent' gets pooled so
+  // that everything in the pool can be handed out again by
+  // 'DispatchEvent::operator new'.
+  if (size == sizeof(DispatchEvent) &&
+      __worker__ >= 0 &&
+      __dispatch_events_size__ < DISPATCH_EVENT_POOL_CAPACITY) {
+    PooledDispatchEvent* pooled = static_cast<PooledDispatchEvent*>(event);
+    pooled->next = __dispatch_events__;
+    __dispatch_events__ = pooled;
+    __dispatch_events_size__++;
+    return;
+  }
+
+  ::operator delete(event);
+}
+
+
+static void drain_dispatch_events()
+{
+  while (__dispatch_events__ != nullptr) {
+    PooledDispatchEvent* event = __dispatch_events__;
+    __dispatch_events__ = event->next;
+    ::operator delete(event);
+  }
+
+  __dispatch_events_size__ = 0;
+}
+
+
 namespace internal {
 
 void dispatch(
     const UPID& pid,
-    const std::shared_ptr<lambda::function<void(ProcessBase*)>>& f,
+    lambda::CallableOnce<void(ProcessBase*)>&& f,
     const Option<const std::type_info*>& functionType)
 {
   process::initialize();
 
-  DispatchEvent* event = new DispatchEvent(pid, f, functionType);
+  DispatchEvent* event = new DispatchEvent(pid, std::move(f), functionType);
   process_manager->deliver(pid, event, __process__);
 }
 
@@ -18,32 +18,64 @@
 
 #include <gmock/gmock.h>
 
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/socket.hpp>
+
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/metrics.hpp>
+#include <process/metrics/push_gauge.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/gtest.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
+#include <stout/os.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+#include "decoder.hpp"
+#include "encoder.hpp"
+#include "framing.hpp"
 
+namespace framing = process::framing;
 namespace http = process::http;
+namespace metrics = process::metrics;
 
+using process::DataDecoder;
 using process::Future;
+using process::Message;
+using process::MessageEncoder;
 using process::Owned;
+using process::PID;
 using process::Process;
 using process::ProcessBase;
 using process::Promise;
 using process::UPID;
 
+using process::metrics::Gauge;
+using process::metrics::PushGauge;
+
+using process::network::Address;
+using process::network::Socket;
+
 using std::cout;
 using std::endl;
 using std::list;
@@ -51,6 +83,59 @@ using std::ostringstream;
 using std::string;
 using std::vector;
 
+// Counts the calls to the global 'operator new' made (by any thread)
+// during its lifetime, which is used to measure the number of
+// allocations per dispatch. Outside of such a scope the replacement
+// 'operator new' below only forwards to 'malloc', so that it does
+// not affect the other benchmarks.
+class AllocationCounter
+{
+public:
+  AllocationCounter()
+  {
+    allocations.store(0);
+    counting.store(true);
+  }
+
+  ~AllocationCounter()
+  {
+    counting.store(false);
+  }
+
+  size_t count() const
+  {
+    return allocations.load();
+  }
+
+  static std::atomic<bool> counting;
+  static std::atomic<size_t> allocations;
+};
+
+
+std::atomic<bool> AllocationCounter::counting(false);
+std::atomic<size_t> AllocationCounter::allocations(0);
+
+
+void* operator new(size_t size)
+{
+  if (AllocationCounter::counting.load(std::memory_order_relaxed)) {
+    AllocationCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+
 int main(int argc, char** argv)
 {
   // Initialize Google Mock/Test.
@@ -293,6 +378,139 @@ TEST(ProcessTest, Process_BENCHMARK_ClientServer)
 }
 
 
+// Measures the rate at which messages sent to a remote process are
+// written to the socket, where back-to-back messages queued for the
+// same socket get coalesced into fewer writes.
+TEST(ProcessTest, Process_BENCHMARK_MessageThroughput)
+{
+  const size_t numMessages = 100000;
+  const Bytes messageSize = Bytes(64);
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  ASSERT_SOME(socket.bind(Address()));
+
+  Try<Address> address = socket.address();
+  ASSERT_SOME(address);
+
+  ASSERT_SOME(socket.listen(1));
+
+  const UPID from("sender", process::address());
+  const UPID to("receiver", address.get());
+  const string body(messageSize.bytes(), '.');
+
+  Message message;
+  message.name = "message";
+  message.from = from;
+  message.to = to;
+  message.body = body;
+
+  const size_t total = numMessages * MessageEncoder::encode(&message).size();
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < numMessages; i++) {
+    post(from, to, message.name, body.data(), body.size());
+  }
+
+  Future<Socket> accept = socket.accept();
+  AWAIT_READY(accept);
+
+  Socket receiver = accept.get();
+
+  size_t received = 0;
+  while (received < total) {
+    Future<string> data = receiver.recv(None());
+    AWAIT_READY(data);
+    ASSERT_FALSE(data->empty());
+
+    received += data->size();
+  }
+
+  Duration elapsed = watch.elapsed();
+
+  cout << "Sent " << numMessages << " messages of " << messageSize
+       << " in " << elapsed << ": "
+       << numMessages / elapsed.secs() << " messages / sec" << endl;
+}
+
+
+// Measures the CPU cost of sending messages like the ones agents send
+// to the master, i.e., of encoding and decoding them, in HTTP and in
+// the binary framing (see framing.hpp).
+TEST(ProcessTest, Process_BENCHMARK_MessageFraming)
+{
+  const size_t numMessages = 100000;
+  const Bytes messageSize = Bytes(256);
+
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+
+  Message message;
+  message.name = "mesos.internal.StatusUpdateMessage";
+  message.from = UPID("slave(1)@127.0.0.1:5051");
+  message.to = UPID("master@127.0.0.1:5050");
+  message.body = string(messageSize.bytes(), '.');
+
+  auto measure = [&](bool binary) {
+    DataDecoder decoder(socket.get());
+    framing::Connection connection;
+
+    // Negotiate the binary framing.
+    if (binary) {
+      const string offer = MessageEncoder::encode(&message, &connection);
+      foreach (http::Request* request,
+               decoder.decode(offer.data(), offer.size())) {
+        delete request;
+      }
+
+      ASSERT_TRUE(decoder.accept());
+      connection.binary = true;
+    }
+
+    size_t bytes = 0;
+    size_t decoded = 0;
+
+    Stopwatch watch;
+    watch.start();
+
+    for (size_t i = 0; i < numMessages; i++) {
+      const string data =
+        MessageEncoder::encode(&message, binary ? &connection : nullptr);
+
+      bytes += data.size();
+
+      foreach (http::Request* request,
+               decoder.decode(data.data(), data.size())) {
+        decoded++;
+        delete request;
+      }
+
+      foreach (Message* received, decoder.messages()) {
+        decoded++;
+        delete received;
+      }
+    }
+
+    Duration elapsed = watch.elapsed();
+
+    ASSERT_FALSE(decoder.failed());
+    ASSERT_EQ(numMessages, decoded);
+
+    cout << (binary ? "Binary" : "HTTP") << " framing: "
+         << numMessages / elapsed.secs() << " messages / sec, "
+         << bytes / numMessages << " bytes / message" << endl;
+  };
+
+  measure(false);
+  measure(true);
+}
+
+
 class LinkerProcess : public Process<LinkerProcess>
 {
 public:
@@ -318,14 +536,49 @@ public:
 };
 
 
+// Spawns and terminates the given number of ephemeral processes,
+// which generates a large number of dispatches and process exits,
+// and returns how long it took.
+static Duration churn(int iterations)
+{
+  vector<ProcessBase*> ephemeralProcesses;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (int i = 0; i < iterations ; i++) {
+    EphemeralProcess* process = new EphemeralProcess();
+    ephemeralProcesses.push_back(process);
+
+    spawn(process);
+
+    // NOTE: We let EphemeralProcess terminate itself to make sure all
+    // dispatches are actually executed (otherwise, 'wait' below will
+    // be blocked).
+    dispatch(process->self(), &EphemeralProcess::terminate);
+  }
+
+  foreach (ProcessBase* process, ephemeralProcesses) {
+    wait(process);
+    delete process;
+  }
+
+  return watch.elapsed();
+}
+
+
 // Simulate the scenario discussed in MESOS-2182. We first establish a
 // large number of links by creating many linker-linkee pairs. And
 // then, we introduce a large amount of ephemeral process exits as
-// well as event dispatches.
+// well as event dispatches. We then do it again while other threads
+// send messages to remote peers, to measure the contention between
+// process exits and network I/O in the `SocketManager`.
 TEST(ProcessTest, Process_BENCHMARK_LargeNumberOfLinks)
 {
   int links = 5000;
   int iterations = 10000;
+  const size_t numSenders = 4;
+  const size_t numMessages = 25000;
 
   // Keep track of all the linked processes we created.
   vector<ProcessBase*> processes;
@@ -342,31 +595,71 @@ TEST(ProcessTest, Process_BENCHMARK_LargeNumberOfLinks)
     spawn(linker);
   }
 
-  // Generate large number of dispatches and process exits by spawning
-  // and then terminating EphemeralProcesses.
-  vector<ProcessBase*> ephemeralProcesses;
+  cout << "Elapsed: " << churn(iterations) << endl;
+
+  // Each sender sends to its own peer, i.e., over its own socket.
+  vector<Socket> peers;
+  for (size_t i = 0; i < numSenders; i++) {
+    Try<Socket> create = Socket::create();
+    ASSERT_SOME(create);
+
+    Socket peer = create.get();
+
+    ASSERT_SOME(peer.bind(Address()));
+    ASSERT_SOME(peer.listen(1));
+
+    peers.push_back(peer);
+  }
 
   Stopwatch watch;
   watch.start();
 
-  for (int i = 0; i < iterations ; i++) {
-    EphemeralProcess* process = new EphemeralProcess();
-    ephemeralProcesses.push_back(process);
+  vector<std::thread> senders;
+  foreach (const Socket& peer, peers) {
+    senders.emplace_back([peer, numMessages]() mutable {
+      const UPID from("sender", process::address());
+      const UPID to("receiver", peer.address().get());
+      const string body(64, '.');
 
-    spawn(process);
+      Message message;
+      message.name = "message";
+      message.from = from;
+      message.to = to;
+      message.body = body;
 
-    // NOTE: We let EphemeralProcess terminate itself to make sure all
-    // dispatches are actually executed (otherwise, 'wait' below will
-    // be blocked).
-    dispatch(process->self(), &EphemeralProcess::terminate);
+      const size_t total =
+        numMessages * MessageEncoder::encode(&message).size();
+
+      for (size_t i = 0; i < numMessages; i++) {
+        post(from, to, message.name, body.data(), body.size());
+      }
+
+      // Drain the peer so that all the messages get written.
+      Socket receiver = peer.accept().get();
+
+      size_t received = 0;
+      while (received < total) {
+        const string data = receiver.recv(None()).get();
+        if (data.empty()) {
+          break;
+        }
+
+        received += data.size();
+      }
+    });
   }
 
-  foreach (ProcessBase* process, ephemeralProcesses) {
-    wait(process);
-    delete process;
+  Duration elapsed = churn(iterations);
+
+  foreach (std::thread& sender, senders) {
+    sender.join();
   }
 
-  cout << "Elapsed: " << watch.elapsed() << endl;
+  cout << "Elapsed with " << numSenders << " concurrent senders: "
+       << elapsed << endl;
+
+  cout << "Sent " << numSenders * numMessages << " messages in "
+       << watch.elapsed() << endl;
 
   foreach (ProcessBase* process, processes) {
     terminate(process);
@@ -374,3 +667,338 @@ TEST(ProcessTest, Process_BENCHMARK_LargeNumberOfLinks)
     delete process;
   }
 }
+
+
+// A process that bounces a counter back and forth with its peer
+// (using dispatch) until the counter reaches the number of messages.
+class PingPongProcess : public Process<PingPongProcess>
+{
+public:
+  PingPongProcess(size_t _messages, Promise<Nothing>* _done)
+    : messages(_messages), done(_done) {}
+
+  virtual ~PingPongProcess() {}
+
+  void ping(size_t count)
+  {
+    if (count >= messages) {
+      done->set(Nothing());
+      return;
+    }
+
+    dispatch(peer, &PingPongProcess::ping, count + 1);
+  }
+
+  PID<PingPongProcess> peer;
+
+private:
+  const size_t messages;
+  Promise<Nothing>* done;
+};
+
+
+// Measures the dispatch throughput of an increasing number of
+// concurrently busy pairs of processes, from 1 up to the number of
+// cores, to show how the scheduling of runnable processes across
+// the worker threads scales.
+TEST(ProcessTest, Process_BENCHMARK_WorkerScaling)
+{
+  const size_t messages = 100000;
+  const size_t cores = os::cpus().isSome() ? os::cpus().get() : 1;
+
+  // Double the number of pairs each run, ending with one pair per core.
+  vector<size_t> runs;
+  for (size_t pairs = 1; pairs < cores; pairs *= 2) {
+    runs.push_back(pairs);
+  }
+  runs.push_back(cores);
+
+  foreach (size_t pairs, runs) {
+    vector<Owned<Promise<Nothing>>> promises;
+    vector<Owned<PingPongProcess>> processes;
+
+    for (size_t i = 0; i < pairs; i++) {
+      promises.push_back(Owned<Promise<Nothing>>(new Promise<Nothing>()));
+
+      Owned<PingPongProcess> ping(
+          new PingPongProcess(messages, promises.back().get()));
+      Owned<PingPongProcess> pong(
+          new PingPongProcess(messages, promises.back().get()));
+
+      ping->peer = pong->self();
+      pong->peer = ping->self();
+
+      spawn(ping.get());
+      spawn(pong.get());
+
+      processes.push_back(ping);
+      processes.push_back(pong);
+    }
+
+    list<Future<Nothing>> futures;
+    foreach (const Owned<Promise<Nothing>>& promise, promises) {
+      futures.push_back(promise->future());
+    }
+
+    Stopwatch watch;
+    watch.start();
+
+    for (size_t i = 0; i < processes.size(); i += 2) {
+      dispatch(processes[i]->self(), &PingPongProcess::ping, 0);
+    }
+
+    AWAIT_READY_FOR(collect(futures), Minutes(5));
+
+    Duration elapsed = watch.elapsed();
+
+    cout << pairs << " pair(s): "
+         << (messages * pairs) / elapsed.secs() << " dispatches / sec"
+         << endl;
+
+    foreach (const Owned<PingPongProcess>& process, processes) {
+      terminate(process.get());
+      wait(process.get());
+    }
+  }
+}
+
+
+// A process that counts the dispatches it receives and completes
+// once it has received the expected number of them.
+class CounterProcess : public Process<CounterProcess>
+{
+public:
+  explicit CounterProcess(size_t _expected)
+    : expected(_expected), count(0) {}
+
+  virtual ~CounterProcess() {}
+
+  void increment()
+  {
+    if (++count == expected) {
+      promise.set(Nothing());
+    }
+  }
+
+  Future<Nothing> done()
+  {
+    return promise.future();
+  }
+
+private:
+  const size_t expected;
+  size_t count;
+  Promise<Nothing> promise;
+};
+
+
+// A process that dispatches a number of increments to a counter.
+class ProducerProcess : public Process<ProducerProcess>
+{
+public:
+  virtual ~ProducerProcess() {}
+
+  void produce(const PID<CounterProcess>& counter, size_t dispatches)
+  {
+    for (size_t i = 0; i < dispatches; i++) {
+      dispatch(counter, &CounterProcess::increment);
+    }
+  }
+};
+
+
+// Measures the throughput of dispatches into a single process from
+// an increasing number of concurrent producers, to show the cost of
+// contention on the event queue of a busy process (e.g., the master).
+TEST(ProcessTest, Process_BENCHMARK_DispatchThroughput)
+{
+  const size_t dispatches = 1000000;
+  const size_t cores = os::cpus().isSome() ? os::cpus().get() : 1;
+
+  // Double the number of producers each run, ending with one per core.
+  vector<size_t> runs;
+  for (size_t producers = 1; producers < cores; producers *= 2) {
+    runs.push_back(producers);
+  }
+  runs.push_back(cores);
+
+  foreach (size_t producers, runs) {
+    const size_t perProducer = dispatches / producers;
+
+    CounterProcess counter(perProducer * producers);
+    spawn(counter);
+
+    vector<Owned<ProducerProcess>> processes;
+    for (size_t i = 0; i < producers; i++) {
+      processes.push_back(Owned<ProducerProcess>(new ProducerProcess()));
+      spawn(processes.back().get());
+    }
+
+    Future<Nothing> done = dispatch(counter, &CounterProcess::done);
+
+    Stopwatch watch;
+    watch.start();
+
+    foreach (const Owned<ProducerProcess>& producer, processes) {
+      dispatch(
+          producer->self(),
+          &ProducerProcess::produce,
+          counter.self(),
+          perProducer);
+    }
+
+    AWAIT_READY_FOR(done, Minutes(5));
+
+    Duration elapsed = watch.elapsed();
+
+    cout << producers << " producer(s): "
+         << (perProducer * producers) / elapsed.secs()
+         << " dispatches / sec" << endl;
+
+    foreach (const Owned<ProducerProcess>& producer, processes) {
+      terminate(producer.get());
+      wait(producer.get());
+    }
+
+    terminate(counter);
+    wait(counter);
+  }
+}
+
+
+// Measures the number of heap allocations made per dispatch of a
+// method returning void (i.e., no promise is involved) by playing
+// ping pong between two processes, along with the dispatch rate.
+TEST(ProcessTest, Process_BENCHMARK_DispatchAllocations)
+{
+  const size_t messages = 1000000;
+
+  Promise<Nothing> done;
+
+  PingPongProcess ping(messages, &done);
+  PingPongProcess pong(messages, &done);
+
+  ping.peer = pong.self();
+  pong.peer = ping.self();
+
+  spawn(ping);
+  spawn(pong);
+
+  Stopwatch watch;
+  watch.start();
+
+  size_t allocations = 0;
+
+  {
+    AllocationCounter counter;
+
+    dispatch(ping, &PingPongProcess::ping, 0);
+
+    AWAIT_READY_FOR(done.future(), Minutes(5));
+
+    allocations = counter.count();
+  }
+
+  Duration elapsed = watch.elapsed();
+
+  cout << static_cast<double>(allocations) / messages
+       << " allocations / dispatch, "
+       << messages / elapsed.secs() << " dispatches / sec" << endl;
+
+  terminate(ping);
+  wait(ping);
+
+  terminate(pong);
+  wait(pong);
+}
+
+
+// A process that owns gauges and can be kept busy, to emulate a
+// loaded master or allocator.
+class GaugeOwnerProcess : public Process<GaugeOwnerProcess>
+{
+public:
+  double get()
+  {
+    return 42.0;
+  }
+
+  void block(const Duration& duration)
+  {
+    os::sleep(duration);
+  }
+};
+
+
+// Adds the metrics, takes a snapshot of them while their owner is
+// busy, and removes them. Returns the time taken by the snapshot.
+template <typename T>
+static Duration measureSnapshot(
+    const vector<T>& gauges,
+    const PID<GaugeOwnerProcess>& owner,
+    const Duration& busy)
+{
+  list<Future<Nothing>> futures;
+  foreach (const T& gauge, gauges) {
+    futures.push_back(metrics::add(gauge));
+  }
+
+  AWAIT_READY_FOR(collect(futures), Minutes(5));
+
+  dispatch(owner, &GaugeOwnerProcess::block, busy);
+
+  Stopwatch watch;
+  watch.start();
+
+  Future<hashmap<string, double>> snapshot = metrics::snapshot(None());
+
+  AWAIT_READY_FOR(snapshot, Minutes(5));
+
+  Duration elapsed = watch.elapsed();
+
+  EXPECT_LE(gauges.size(), snapshot->size());
+
+  futures.clear();
+  foreach (const T& gauge, gauges) {
+    futures.push_back(metrics::remove(gauge));
+  }
+
+  AWAIT_READY_FOR(collect(futures), Minutes(5));
+
+  return elapsed;
+}
+
+
+// Measures the time to take a snapshot of a large number of gauges
+// whose owner is busy, when the gauges are evaluated by dispatching
+// into the owner and when the owner pushes them.
+TEST(MetricsTest, Metrics_BENCHMARK_Snapshot)
+{
+  const size_t count = 50000;
+  const Duration busy = Milliseconds(500);
+
+  GaugeOwnerProcess owner;
+  spawn(owner);
+
+  vector<Gauge> gauges;
+  for (size_t i = 0; i < count; i++) {
+    gauges.push_back(Gauge(
+        "benchmark/gauge" + stringify(i),
+        defer(owner.self(), &GaugeOwnerProcess::get)));
+  }
+
+  cout << "Took " << measureSnapshot(gauges, owner.self(), busy)
+       << " to snapshot " << count << " gauges" << endl;
+
+  vector<PushGauge> pushGauges;
+  for (size_t i = 0; i < count; i++) {
+    pushGauges.push_back(PushGauge("benchmark/push_gauge" + stringify(i)));
+    pushGauges.back() = 42.0;
+  }
+
+  cout << "Took " << measureSnapshot(pushGauges, owner.self(), busy)
+       << " to snapshot " << count << " push gauges" << endl;
+
+  terminate(owner);
+  wait(owner);
+}
@@ -17,19 +17,29 @@
 #include <vector>
 
 #include <process/http.hpp>
+#include <process/message.hpp>
 #include <process/owned.hpp>
+#include <process/pid.hpp>
 #include <process/socket.hpp>
 
 #include <stout/gtest.hpp>
 
 #include "encoder.hpp"
 #include "decoder.hpp"
+#include "framing.hpp"
 
+namespace framing = process::framing;
 namespace http = process::http;
 
+using process::DataDecoder;
 using process::HttpResponseEncoder;
+using process::Message;
+using process::MessageEncoder;
 using process::Owned;
 using process::ResponseDecoder;
+using process::UPID;
+
+using process::network::Socket;
 
 using std::deque;
 using std::string;
@@ -115,3 +125,126 @@ TEST(EncoderTest, AcceptableEncodings)
       << gzipRequest.headers.get("Accept-Encoding").get() << "'";
   }
 }
+
+
+// Tests that messages are sent in HTTP until the binary framing is
+// accepted, and in the binary framing from then on.
+TEST(EncoderTest, MessageBinaryFraming)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+
+  DataDecoder decoder(socket.get());
+  framing::Connection connection;
+
+  Message message;
+  message.name = "name";
+  message.from = UPID("sender@127.0.0.1:5051");
+  message.to = UPID("receiver@127.0.0.1:5050");
+  message.body = "body";
+
+  // The first message is sent in HTTP and offers the binary framing.
+  const string offer = MessageEncoder::encode(&message, &connection);
+  EXPECT_TRUE(connection.offered);
+  EXPECT_FALSE(connection.binary);
+
+  deque<http::Request*> requests = decoder.decode(offer.data(), offer.size());
+  ASSERT_FALSE(decoder.failed());
+  ASSERT_EQ(1u, requests.size());
+
+  Owned<http::Request> request(requests[0]);
+  EXPECT_EQ("/receiver/name", request->url.path);
+  EXPECT_EQ("body", request->body);
+
+  EXPECT_TRUE(decoder.accept());
+  EXPECT_FALSE(decoder.accept());
+
+  // Once the receiver accepted the binary framing, the strings of the
+  // message are only sent with the first message.
+  connection.binary = true;
+
+  const string first = MessageEncoder::encode(&message, &connection);
+  const string second = MessageEncoder::encode(&message, &connection);
+
+  EXPECT_EQ(framing::MESSAGE_HEADER_SIZE + message.body.size(), second.size());
+  EXPECT_LT(second.size(), first.size());
+
+  // Decode the frames one byte at a time to exercise partial frames.
+  const string data = first + second;
+  for (size_t i = 0; i < data.size(); i++) {
+    EXPECT_TRUE(decoder.decode(data.data() + i, 1).empty());
+    ASSERT_FALSE(decoder.failed());
+  }
+
+  deque<Message*> messages = decoder.messages();
+  ASSERT_EQ(2u, messages.size());
+
+  foreach (Message* decoded, messages) {
+    EXPECT_EQ(message.name, decoded->name);
+    EXPECT_EQ(message.from, decoded->from);
+    EXPECT_EQ(message.to.id, decoded->to.id);
+    EXPECT_EQ(message.body, decoded->body);
+    delete decoded;
+  }
+}
+
+
+// Tests that a message framed before its strings are interned (i.e.,
+// outside the lock on the connection) is encoded as it would have been
+// all at once.
+TEST(EncoderTest, MessageFrameThenIntern)
+{
+  framing::Connection encoded;
+  encoded.offered = true;
+  encoded.binary = true;
+
+  framing::Connection framed;
+  framed.offered = true;
+  framed.binary = true;
+
+  Message message;
+  message.name = "name";
+  message.from = UPID("sender@127.0.0.1:5051");
+  message.to = UPID("receiver@127.0.0.1:5050");
+  message.body = "body";
+
+  for (int i = 0; i < 2; i++) {
+    string frame = MessageEncoder::frame(message);
+    const string interned = MessageEncoder::intern(message, &framed, &frame);
+
+    EXPECT_EQ(i == 0, !interned.empty());
+    EXPECT_EQ(MessageEncoder::encode(&message, &encoded), interned + frame);
+  }
+}
+
+
+// Tests that a decoder that was not offered the binary framing keeps
+// decoding HTTP, as the messages of older senders.
+TEST(EncoderTest, MessageWithoutBinaryFraming)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+
+  DataDecoder decoder(socket.get());
+
+  Message message;
+  message.name = "name";
+  message.from = UPID("sender@127.0.0.1:5051");
+  message.to = UPID("receiver@127.0.0.1:5050");
+  message.body = "body";
+
+  const string data =
+    MessageEncoder::encode(&message) + MessageEncoder::encode(&message);
+
+  deque<http::Request*> requests = decoder.decode(data.data(), data.size());
+  ASSERT_FALSE(decoder.failed());
+  ASSERT_EQ(2u, requests.size());
+
+  EXPECT_FALSE(decoder.accept());
+  EXPECT_TRUE(decoder.messages().empty());
+
+  foreach (http::Request* request, requests) {
+    EXPECT_EQ("/receiver/name", request->url.path);
+    delete request;
+  }
+}
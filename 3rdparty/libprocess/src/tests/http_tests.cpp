@@ -22,6 +22,7 @@
 
 #include <process/address.hpp>
 #include <process/authenticator.hpp>
+#include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
@@ -31,8 +32,11 @@
 #include <process/owned.hpp>
 #include <process/socket.hpp>
 
+#include <process/metrics/metrics.hpp>
+
 #include <stout/base64.hpp>
 #include <stout/gtest.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
@@ -49,6 +53,7 @@ using authentication::Authenticator;
 using authentication::AuthenticationResult;
 using authentication::BasicAuthenticator;
 
+using process::Clock;
 using process::Future;
 using process::Owned;
 using process::PID;
@@ -57,6 +62,7 @@ using process::Promise;
 
 using process::http::URL;
 
+using process::network::Address;
 using process::network::Socket;
 
 using std::string;
@@ -69,6 +75,19 @@ using testing::EndsWith;
 using testing::Invoke;
 using testing::Return;
 
+namespace process {
+namespace http {
+namespace internal {
+
+// Forward declare the `reinitializePool()` function since we want to
+// programmatically change the connection pool settings during tests.
+void reinitializePool();
+
+} // namespace internal {
+} // namespace http {
+} // namespace process {
+
+
 class HttpProcess : public Process<HttpProcess>
 {
 public:
@@ -419,6 +438,45 @@ TEST(HTTPTest, PipeReaderCloses)
 }
 
 
+TEST(HTTPTest, PipeDrained)
+{
+  http::Pipe pipe;
+  http::Pipe::Reader reader = pipe.reader();
+  http::Pipe::Writer writer = pipe.writer();
+
+  EXPECT_TRUE(writer.write("hello"));
+  EXPECT_TRUE(writer.write("world"));
+
+  // The pipe is drained once the reader has read all the data and
+  // is waiting for more.
+  Future<Nothing> drained = writer.drained();
+
+  AWAIT_EQ("hello", reader.read());
+  EXPECT_TRUE(drained.isPending());
+
+  AWAIT_EQ("world", reader.read());
+  EXPECT_TRUE(drained.isPending());
+
+  Future<string> read = reader.read();
+  EXPECT_TRUE(read.isPending());
+  AWAIT_READY(drained);
+
+  // A reader waiting for data means that the pipe is drained.
+  AWAIT_READY(writer.drained());
+
+  EXPECT_TRUE(writer.write("!"));
+  AWAIT_EQ("!", read);
+
+  // Closing the read end notifies the waiting writers.
+  drained = writer.drained();
+  EXPECT_TRUE(drained.isPending());
+
+  EXPECT_TRUE(reader.close());
+  AWAIT_READY(drained);
+  AWAIT_READY(writer.drained());
+}
+
+
 TEST(HTTPTest, Encode)
 {
   string unencoded = "a$&+,/:;=?@ \"<>#%{}|\\^~[]`\x19\x80\xFF";
@@ -779,6 +837,333 @@ TEST(HTTPTest, Request)
 }
 
 
+// Tests that subsequent requests to the same server reuse a pooled
+// Keep-Alive connection rather than each opening a new one.
+TEST(HTTPTest, ConnectionPool)
+{
+  Http http;
+
+  Future<http::Request> get1;
+  Future<http::Request> get2;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(DoAll(FutureArg<0>(&get1), Return(http::OK())))
+    .WillOnce(DoAll(FutureArg<0>(&get2), Return(http::OK())));
+
+  Future<http::Response> response = http::get(http.process->self(), "get");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  response = http::get(http.process->self(), "get");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  AWAIT_READY(get1);
+  AWAIT_READY(get2);
+
+  EXPECT_TRUE(get1->keepAlive);
+  EXPECT_TRUE(get2->keepAlive);
+
+  // Both requests were received on the same connection.
+  EXPECT_EQ(get1->client, get2->client);
+}
+
+
+class HTTPConnectionPoolTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    // Start from an empty pool, so that its metrics only account for
+    // the connections of the test.
+    http::internal::reinitializePool();
+  }
+
+  virtual void TearDown()
+  {
+    os::unsetenv("LIBPROCESS_HTTP_POOL_CAPACITY");
+    os::unsetenv("LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT");
+
+    http::internal::reinitializePool();
+  }
+
+  // Returns the current value of the metric 'name' of the pool.
+  Option<double> metric(const string& name)
+  {
+    Future<hashmap<string, double>> snapshot =
+      process::metrics::snapshot(None());
+
+    AWAIT_EXPECT_READY(snapshot);
+
+    if (!snapshot.isReady()) {
+      return None();
+    }
+
+    return snapshot->get(name);
+  }
+};
+
+
+// Tests that a pooled connection is reused by the requests that are
+// safe to retry, but not by the others.
+TEST_F(HTTPConnectionPoolTest, Reuse)
+{
+  Http http;
+
+  Future<http::Request> get1;
+  Future<http::Request> get2;
+  Future<http::Request> post;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(DoAll(FutureArg<0>(&get1), Return(http::OK())))
+    .WillOnce(DoAll(FutureArg<0>(&get2), Return(http::OK())));
+
+  EXPECT_CALL(*http.process, post(_))
+    .WillOnce(DoAll(FutureArg<0>(&post), Return(http::OK())));
+
+  Future<http::Response> response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  response = http::post(http.process->self(), "post");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  AWAIT_READY(get1);
+  AWAIT_READY(get2);
+  AWAIT_READY(post);
+
+  EXPECT_EQ(get1->client, get2->client);
+  EXPECT_NE(get1->client, post->client);
+
+  EXPECT_SOME_EQ(2.0, metric("http/client/connections_created"));
+  EXPECT_SOME_EQ(1.0, metric("http/client/connections_reused"));
+}
+
+
+// Tests that a request that is not safe to retry closes an idle
+// connection to make room in a full pool, rather than bypassing it.
+TEST_F(HTTPConnectionPoolTest, EvictIdle)
+{
+  os::setenv("LIBPROCESS_HTTP_POOL_CAPACITY", "1");
+  http::internal::reinitializePool();
+
+  Http http;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(Return(http::OK()));
+
+  EXPECT_CALL(*http.process, post(_))
+    .WillOnce(Return(http::OK()));
+
+  Clock::pause();
+
+  Future<http::Response> response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  // Wait for the connection to be released to the pool.
+  Clock::settle();
+
+  EXPECT_SOME_EQ(1.0, metric("http/client/idle_connections"));
+
+  response = http::post(http.process->self(), "post");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  Clock::settle();
+
+  // The idle connection was closed and the request was sent on a new
+  // pooled connection, which is now the idle one.
+  EXPECT_SOME_EQ(1.0, metric("http/client/idle_connections"));
+  EXPECT_SOME_EQ(2.0, metric("http/client/connections_created"));
+  EXPECT_SOME_EQ(0.0, metric("http/client/connections_reused"));
+
+  Clock::resume();
+}
+
+
+// Tests that a pooled connection is closed once it has been idle for
+// LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT.
+TEST_F(HTTPConnectionPoolTest, IdleTimeout)
+{
+  os::setenv("LIBPROCESS_HTTP_POOL_IDLE_TIMEOUT", "10secs");
+  http::internal::reinitializePool();
+
+  Http http;
+
+  Future<http::Request> get1;
+  Future<http::Request> get2;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(DoAll(FutureArg<0>(&get1), Return(http::OK())))
+    .WillOnce(DoAll(FutureArg<0>(&get2), Return(http::OK())));
+
+  Clock::pause();
+
+  Future<http::Response> response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  // Wait for the connection to be released to the pool.
+  Clock::settle();
+
+  EXPECT_SOME_EQ(1.0, metric("http/client/idle_connections"));
+
+  Clock::advance(Seconds(10));
+  Clock::settle();
+
+  EXPECT_SOME_EQ(0.0, metric("http/client/idle_connections"));
+
+  // The next request gets a new connection.
+  response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  AWAIT_READY(get1);
+  AWAIT_READY(get2);
+
+  EXPECT_NE(get1->client, get2->client);
+
+  EXPECT_SOME_EQ(2.0, metric("http/client/connections_created"));
+  EXPECT_SOME_EQ(0.0, metric("http/client/connections_reused"));
+
+  Clock::resume();
+}
+
+
+// Tests that the requests made while all the connections pooled for
+// a server are in use are sent on a connection of their own.
+TEST_F(HTTPConnectionPoolTest, Overflow)
+{
+  os::setenv("LIBPROCESS_HTTP_POOL_CAPACITY", "1");
+  http::internal::reinitializePool();
+
+  Http http;
+
+  Promise<http::Response> promise;
+
+  Future<http::Request> get1;
+  Future<http::Request> get2;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(DoAll(FutureArg<0>(&get1), Return(promise.future())))
+    .WillOnce(DoAll(FutureArg<0>(&get2), Return(http::OK())));
+
+  Future<http::Response> response1 = http::get(http.process->self(), "get");
+
+  AWAIT_READY(get1);
+
+  Future<http::Response> response2 = http::get(http.process->self(), "get");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response2);
+  EXPECT_TRUE(response1.isPending());
+
+  promise.set(http::OK());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response1);
+
+  AWAIT_READY(get2);
+
+  EXPECT_TRUE(get1->keepAlive);
+  EXPECT_FALSE(get2->keepAlive);
+  EXPECT_NE(get1->client, get2->client);
+
+  EXPECT_SOME_EQ(1.0, metric("http/client/connections_created"));
+}
+
+
+// Tests that no connection is pooled when
+// LIBPROCESS_HTTP_POOL_CAPACITY is 0.
+TEST_F(HTTPConnectionPoolTest, Disabled)
+{
+  os::setenv("LIBPROCESS_HTTP_POOL_CAPACITY", "0");
+  http::internal::reinitializePool();
+
+  Http http;
+
+  Future<http::Request> get1;
+  Future<http::Request> get2;
+
+  EXPECT_CALL(*http.process, get(_))
+    .WillOnce(DoAll(FutureArg<0>(&get1), Return(http::OK())))
+    .WillOnce(DoAll(FutureArg<0>(&get2), Return(http::OK())));
+
+  Future<http::Response> response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  response = http::get(http.process->self(), "get");
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  AWAIT_READY(get1);
+  AWAIT_READY(get2);
+
+  EXPECT_FALSE(get1->keepAlive);
+  EXPECT_FALSE(get2->keepAlive);
+  EXPECT_NE(get1->client, get2->client);
+
+  EXPECT_NONE(metric("http/client/connections_created"));
+}
+
+
+// Tests that a request is retried on a new connection when the
+// server closes the pooled connection it was sent on.
+TEST_F(HTTPConnectionPoolTest, RetryAfterServerClosed)
+{
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket server = create.get();
+
+  ASSERT_SOME(server.bind(Address::LOCALHOST_ANY()));
+  ASSERT_SOME(server.listen(2));
+
+  Try<Address> address = server.address();
+  ASSERT_SOME(address);
+
+  const URL url("http", address->ip, address->port, "get");
+
+  const string ok = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+
+  Clock::pause();
+
+  Future<Socket> accept = server.accept();
+  Future<http::Response> response = http::get(url);
+
+  AWAIT_READY(accept);
+
+  {
+    Socket client = accept.get();
+
+    AWAIT_READY(client.recv());
+    AWAIT_READY(client.send(ok));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+    // Wait for the connection to be released to the pool.
+    Clock::settle();
+
+    accept = server.accept();
+    response = http::get(url);
+
+    // The request is sent on the pooled connection, which we close
+    // without responding by releasing the last reference to it.
+    AWAIT_READY(client.recv());
+  }
+
+  AWAIT_READY(accept);
+
+  Socket client = accept.get();
+
+  AWAIT_READY(client.recv());
+  AWAIT_READY(client.send(ok));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  EXPECT_SOME_EQ(2.0, metric("http/client/connections_created"));
+  EXPECT_SOME_EQ(1.0, metric("http/client/connections_reused"));
+
+  Clock::resume();
+}
+
+
 TEST(HTTPConnectionTest, Serial)
 {
   Http http;
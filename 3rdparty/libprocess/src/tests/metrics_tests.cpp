@@ -31,6 +31,7 @@
 #include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/metrics/push_gauge.hpp>
 #include <process/metrics/timer.hpp>
 
 namespace authentication = process::http::authentication;
@@ -47,6 +48,7 @@ using http::Unauthorized;
 
 using metrics::Counter;
 using metrics::Gauge;
+using metrics::PushGauge;
 using metrics::Timer;
 
 using process::Clock;
@@ -167,6 +169,79 @@ TEST_F(MetricsTest, Gauge)
 }
 
 
+TEST_F(MetricsTest, PushGauge)
+{
+  PushGauge gauge("test/push_gauge");
+
+  AWAIT_READY(metrics::add(gauge));
+
+  AWAIT_EXPECT_EQ(0.0, gauge.value());
+  EXPECT_SOME_EQ(0.0, gauge.peek());
+
+  ++gauge;
+  AWAIT_EXPECT_EQ(1.0, gauge.value());
+
+  gauge += 41.5;
+  AWAIT_EXPECT_EQ(42.5, gauge.value());
+
+  gauge -= 2.5;
+  AWAIT_EXPECT_EQ(40.0, gauge.value());
+
+  --gauge;
+  AWAIT_EXPECT_EQ(39.0, gauge.value());
+
+  gauge = 42;
+  AWAIT_EXPECT_EQ(42.0, gauge.value());
+  EXPECT_SOME_EQ(42.0, gauge.peek());
+
+  EXPECT_NONE(gauge.statistics());
+
+  AWAIT_READY(metrics::remove(gauge));
+}
+
+
+// Ensures that metrics which can be read without waiting are part of
+// the snapshot even when the owners of the other gauges do not
+// respond before the timeout.
+TEST_F(MetricsTest, SnapshotPushGauge)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  GaugeProcess process;
+  PID<GaugeProcess> pid = spawn(&process);
+  ASSERT_TRUE(pid);
+
+  Gauge gaugeTimeout("test/gauge_timeout", defer(pid, &GaugeProcess::pending));
+  PushGauge pushGauge("test/push_gauge");
+
+  AWAIT_READY(metrics::add(gaugeTimeout));
+  AWAIT_READY(metrics::add(pushGauge));
+
+  pushGauge = 42;
+
+  Future<hashmap<string, double>> snapshot = metrics::snapshot(Seconds(2));
+
+  Clock::settle();
+  ASSERT_TRUE(snapshot.isPending());
+
+  // Advance the clock to trigger the timeout.
+  Clock::advance(Seconds(2));
+
+  AWAIT_READY(snapshot);
+
+  EXPECT_FALSE(snapshot->contains("test/gauge_timeout"));
+  EXPECT_SOME_EQ(42.0, snapshot->get("test/push_gauge"));
+
+  AWAIT_READY(metrics::remove(gaugeTimeout));
+  AWAIT_READY(metrics::remove(pushGauge));
+
+  terminate(process);
+  wait(process);
+}
+
+
 TEST_F(MetricsTest, Statistics)
 {
   Counter counter("test/counter", process::TIME_SERIES_WINDOW);
@@ -445,6 +520,85 @@ TEST_F(MetricsTest, SnapshotStatistics)
 }
 
 
+// Ensures that requests which arrive while a snapshot is being taken
+// share that snapshot, and that they are counted as cache hits.
+TEST_F(MetricsTest, SnapshotShared)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  UPID upid("metrics", process::address());
+
+  Clock::pause();
+
+  GaugeProcess process;
+  PID<GaugeProcess> pid = spawn(&process);
+  ASSERT_TRUE(pid);
+
+  // The snapshot stays pending until the timeout, due to this gauge.
+  Gauge gaugeTimeout("test/gauge_timeout", defer(pid, &GaugeProcess::pending));
+
+  AWAIT_READY(metrics::add(gaugeTimeout));
+
+  // Advance the clock to avoid rate limit.
+  Clock::advance(Seconds(1));
+
+  Future<Response> response1 = http::get(upid, "snapshot", "timeout=2secs");
+
+  // TODO(neilc): Replace the `sleep` here with a less flaky
+  // synchronization method.
+  os::sleep(Milliseconds(10));
+  Clock::settle();
+
+  ASSERT_TRUE(response1.isPending());
+
+  Future<Response> response2 = http::get(upid, "snapshot", "timeout=2secs");
+
+  os::sleep(Milliseconds(10));
+  Clock::settle();
+
+  ASSERT_TRUE(response2.isPending());
+
+  // Advance the clock to trigger the timeout.
+  Clock::advance(Seconds(2));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response1);
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response2);
+
+  EXPECT_EQ(response1->body, response2->body);
+
+  // Advance the clock to avoid rate limit.
+  Clock::advance(Seconds(1));
+
+  Future<Response> response3 = http::get(upid, "snapshot");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response3);
+
+  Try<JSON::Object> before = JSON::parse<JSON::Object>(response1->body);
+  ASSERT_SOME(before);
+
+  Try<JSON::Object> after = JSON::parse<JSON::Object>(response3->body);
+  ASSERT_SOME(after);
+
+  // The second request shared the first snapshot, the third one did
+  // not since the first snapshot had been taken when it arrived.
+  for (const string& key : {string("metrics/snapshot_cache_hits"),
+                            string("metrics/snapshot_cache_misses")}) {
+    Result<JSON::Number> previous = before->find<JSON::Number>(key);
+    ASSERT_SOME(previous);
+
+    Result<JSON::Number> current = after->find<JSON::Number>(key);
+    ASSERT_SOME(current);
+
+    EXPECT_FLOAT_EQ(previous->as<double>() + 1, current->as<double>());
+  }
+
+  AWAIT_READY(metrics::remove(gaugeTimeout));
+
+  terminate(process);
+  wait(process);
+}
+
+
 TEST_F(MetricsTest, Timer)
 {
   metrics::Timer<Nanoseconds> timer("test/timer");
@@ -50,6 +50,7 @@
 #include <stout/gtest.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/json.hpp>
 #include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
@@ -68,6 +69,7 @@ using process::async;
 using process::Clock;
 using process::defer;
 using process::Deferred;
+using process::DispatchEvent;
 using process::Event;
 using process::Executor;
 using process::ExitedEvent;
@@ -737,6 +739,160 @@ TEST(ProcessTest, InjectExited)
 }
 
 
+class BatchProcess : public Process<BatchProcess>
+{
+public:
+  BatchProcess() : blocked(false), unblock(false), counted(0) {}
+
+  void block()
+  {
+    blocked.store(true);
+    while (!unblock.load()) {}
+  }
+
+  void count() { counted++; }
+
+  void stop() { terminate(self(), true); }
+
+  std::atomic<bool> blocked;
+  std::atomic<bool> unblock;
+  std::atomic<int> counted;
+};
+
+
+// Tests that an event injected while a batch of events is being
+// serviced is serviced before the rest of the batch.
+TEST(ProcessTest, InjectDuringBatch)
+{
+  BatchProcess process;
+  PID<BatchProcess> pid = spawn(process);
+
+  dispatch(pid, &BatchProcess::block);
+
+  while (!process.blocked.load()) {}
+
+  // These are dequeued as a single batch once 'block' returns.
+  dispatch(pid, &BatchProcess::count);
+  dispatch(pid, &BatchProcess::stop);
+  dispatch(pid, &BatchProcess::count);
+  dispatch(pid, &BatchProcess::count);
+
+  process.unblock.store(true);
+
+  wait(pid);
+
+  EXPECT_EQ(1, process.counted.load());
+}
+
+
+class BlockingProcess : public Process<BlockingProcess>
+{
+public:
+  BlockingProcess() : blocked(0), unblocked(0) {}
+
+  // Blocks until 'unblocked' reaches the number of times that 'block'
+  // was called so far.
+  void block()
+  {
+    int count = ++blocked;
+    while (unblocked.load() < count) {}
+  }
+
+  void noop() {}
+
+  std::atomic<int> blocked;
+  std::atomic<int> unblocked;
+};
+
+
+// Tests that events which were dequeued as part of a batch but not
+// serviced yet are still counted as queued events.
+TEST(ProcessTest, EventCountDuringBatch)
+{
+  BlockingProcess process;
+  PID<BlockingProcess> pid = spawn(process);
+
+  dispatch(pid, &BlockingProcess::block);
+
+  while (process.blocked.load() < 1) {}
+
+  // These are dequeued as a single batch once 'block' returns.
+  dispatch(pid, &BlockingProcess::block);
+  dispatch(pid, &BlockingProcess::noop);
+  dispatch(pid, &BlockingProcess::noop);
+  dispatch(pid, &BlockingProcess::noop);
+
+  EXPECT_EQ(4u, process.eventCount<DispatchEvent>());
+
+  process.unblocked.store(1);
+
+  while (process.blocked.load() < 2) {}
+
+  EXPECT_EQ(3u, process.eventCount<DispatchEvent>());
+
+  process.unblocked.store(2);
+
+  terminate(pid);
+  wait(pid);
+
+  EXPECT_EQ(0u, process.eventCount<DispatchEvent>());
+}
+
+
+// Tests that '/__processes__' lists the events which were dequeued
+// as part of a batch but not serviced yet along with their details.
+TEST(ProcessTest, ProcessesDuringBatch)
+{
+  BlockingProcess process;
+  PID<BlockingProcess> pid = spawn(process);
+
+  dispatch(pid, &BlockingProcess::block);
+
+  while (process.blocked.load() < 1) {}
+
+  // These are dequeued as a single batch once 'block' returns.
+  const string body = "body";
+
+  dispatch(pid, &BlockingProcess::block);
+  post(pid, "message", body.data(), body.size());
+
+  process.unblocked.store(1);
+
+  while (process.blocked.load() < 2) {}
+
+  Future<http::Response> response =
+    http::get(UPID("__processes__", process::address()));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+
+  Try<JSON::Array> processes = JSON::parse<JSON::Array>(response->body);
+  ASSERT_SOME(processes);
+
+  Option<JSON::Array> events = None();
+
+  foreach (const JSON::Value& value, processes->values) {
+    const JSON::Object& object = value.as<JSON::Object>();
+    if (object.values.at("id") == JSON::String(pid.id)) {
+      events = object.values.at("events").as<JSON::Array>();
+    }
+  }
+
+  ASSERT_SOME(events);
+  ASSERT_EQ(1u, events->values.size());
+
+  const JSON::Object& event = events->values.front().as<JSON::Object>();
+
+  EXPECT_EQ(JSON::String("MESSAGE"), event.values.at("type"));
+  EXPECT_EQ(JSON::String("message"), event.values.at("name"));
+  EXPECT_EQ(JSON::String(body), event.values.at("body"));
+
+  process.unblocked.store(2);
+
+  terminate(pid);
+  wait(pid);
+}
+
+
 class MessageEventProcess : public Process<MessageEventProcess>
 {
 public:
@@ -1304,6 +1460,50 @@ TEST(ProcessTest, Remote)
 }
 
 
+// Ensures that a burst of messages to a remote address, which get
+// coalesced into fewer writes, arrive intact and in order.
+TEST(ProcessTest, RemoteBurst)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  ASSERT_SOME(socket.bind(Address()));
+
+  Try<Address> address = socket.address();
+  ASSERT_SOME(address);
+
+  ASSERT_SOME(socket.listen(1));
+
+  const UPID from("sender", process::address());
+  const UPID to("receiver", address.get());
+
+  string expected;
+
+  for (size_t i = 0; i < 1000; i++) {
+    Message message;
+    message.name = "burst";
+    message.from = from;
+    message.to = to;
+    message.body = stringify(i);
+
+    expected += MessageEncoder::encode(&message);
+
+    post(from, to, message.name, message.body.data(), message.body.size());
+  }
+
+  Future<Socket> accept = socket.accept();
+  AWAIT_READY(accept);
+
+  Socket client = accept.get();
+
+  AWAIT_EXPECT_EQ(expected, client.recv(expected.size()));
+}
+
+
 // Like the 'remote' test but uses http::connect.
 TEST(ProcessTest, Http1)
 {
@@ -13,7 +13,11 @@
 #ifndef __STOUT_LAMBDA_HPP__
 #define __STOUT_LAMBDA_HPP__
 
+#include <cstddef>
 #include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace lambda {
 
@@ -24,6 +28,186 @@ using std::ref;
 
 using namespace std::placeholders;
 
+
+// A move-only callable that is meant to be invoked (at most) once.
+//
+// Unlike `std::function`, a `CallableOnce` does not need to be
+// copyable which lets it hold move-only callables, and it stores
+// callables that fit into a small inline buffer without any heap
+// allocation. Larger callables are stored on the heap.
+//
+// Invoking a `CallableOnce` requires an rvalue, i.e.:
+//
+//   lambda::CallableOnce<void(int)> f([](int i) { ... });
+//   std::move(f)(42);
+template <typename F>
+class CallableOnce;
+
+
+template <typename R, typename... Args>
+class CallableOnce<R(Args...)>
+{
+  // Whether an rvalue of 'F' can be invoked with 'Args' and returns
+  // something convertible to 'R' (anything, if 'R' is void).
+  template <typename F, typename = void>
+  struct Invocable : std::false_type {};
+
+  template <typename F>
+  struct Invocable<
+      F,
+      decltype(void(std::declval<F>()(std::declval<Args>()...)))>
+    : std::integral_constant<
+          bool,
+          std::is_void<R>::value ||
+          std::is_convertible<
+              decltype(std::declval<F>()(std::declval<Args>()...)),
+              R>::value> {};
+
+public:
+  // Size of the inline buffer, large enough for a pointer to member
+  // function plus a few arguments.
+  static constexpr size_t INLINE_SIZE = 8 * sizeof(void*);
+
+  // NOTE: This only accepts callables that can be invoked with
+  // 'Args', so that it never takes precedence over the copy and move
+  // constructors, nor over the constructors of other 'CallableOnce's
+  // when overloading on them.
+  template <
+      typename F,
+      typename = typename std::enable_if<
+          !std::is_same<typename std::decay<F>::type, CallableOnce>::value &&
+          Invocable<typename std::decay<F>::type>::value>::type>
+  CallableOnce(F&& f)
+  {
+    typedef typename std::decay<F>::type Callable;
+
+    construct<Callable>(
+        std::forward<F>(f),
+        std::integral_constant<
+            bool,
+            sizeof(Callable) <= sizeof(Storage) &&
+            alignof(Callable) <= alignof(Storage) &&
+            std::is_nothrow_move_constructible<Callable>::value>());
+  }
+
+  CallableOnce(CallableOnce&& that) : operations(that.operations)
+  {
+    if (operations != nullptr) {
+      operations->move(&that.storage, &storage);
+      that.operations = nullptr;
+    }
+  }
+
+  CallableOnce(const CallableOnce&) = delete;
+  CallableOnce& operator=(const CallableOnce&) = delete;
+  CallableOnce& operator=(CallableOnce&&) = delete;
+
+  ~CallableOnce()
+  {
+    if (operations != nullptr) {
+      operations->destroy(&storage);
+    }
+  }
+
+  // NOTE: The behavior is undefined if this has been moved from.
+  R operator()(Args... args) &&
+  {
+    return operations->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+private:
+  typedef typename std::aligned_storage<INLINE_SIZE>::type Storage;
+
+  // Type erased operations on the stored callable.
+  struct Operations
+  {
+    R (*invoke)(void* storage, Args&&... args);
+    void (*move)(void* from, void* to);
+    void (*destroy)(void* storage);
+  };
+
+  // Operations for a callable stored in the inline buffer.
+  template <typename Callable>
+  struct Inline
+  {
+    static Callable* get(void* storage)
+    {
+      return static_cast<Callable*>(storage);
+    }
+
+    static R invoke(void* storage, Args&&... args)
+    {
+      return std::move(*get(storage))(std::forward<Args>(args)...);
+    }
+
+    static void move(void* from, void* to)
+    {
+      new (to) Callable(std::move(*get(from)));
+      get(from)->~Callable();
+    }
+
+    static void destroy(void* storage)
+    {
+      get(storage)->~Callable();
+    }
+
+    static const Operations* operations()
+    {
+      static const Operations operations = {&invoke, &move, &destroy};
+      return &operations;
+    }
+  };
+
+  // Operations for a callable stored on the heap, in which case the
+  // inline buffer holds the pointer to it.
+  template <typename Callable>
+  struct Heap
+  {
+    static Callable*& get(void* storage)
+    {
+      return *static_cast<Callable**>(storage);
+    }
+
+    static R invoke(void* storage, Args&&... args)
+    {
+      return std::move(*get(storage))(std::forward<Args>(args)...);
+    }
+
+    static void move(void* from, void* to)
+    {
+      new (to) Callable*(get(from));
+    }
+
+    static void destroy(void* storage)
+    {
+      delete get(storage);
+    }
+
+    static const Operations* operations()
+    {
+      static const Operations operations = {&invoke, &move, &destroy};
+      return &operations;
+    }
+  };
+
+  template <typename Callable, typename F>
+  void construct(F&& f, std::true_type)
+  {
+    new (&storage) Callable(std::forward<F>(f));
+    operations = Inline<Callable>::operations();
+  }
+
+  template <typename Callable, typename F>
+  void construct(F&& f, std::false_type)
+  {
+    new (&storage) Callable*(new Callable(std::forward<F>(f)));
+    operations = Heap<Callable>::operations();
+  }
+
+  const Operations* operations;
+  Storage storage;
+};
+
 } // namespace lambda {
 
 #endif // __STOUT_LAMBDA_HPP__
@@ -0,0 +1,83 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include <stout/lambda.hpp>
+
+using std::string;
+using std::unique_ptr;
+
+
+// A move-only callable that counts how many times it was destroyed.
+struct Prefix
+{
+  Prefix(const string& prefix, int* _destroyed)
+    : value(new string(prefix)), destroyed(_destroyed) {}
+
+  Prefix(Prefix&& that) noexcept
+    : value(std::move(that.value)), destroyed(that.destroyed) {}
+
+  ~Prefix()
+  {
+    if (value) {
+      (*destroyed)++;
+    }
+  }
+
+  string operator()(const string& s) &&
+  {
+    return *value + s;
+  }
+
+  unique_ptr<string> value;
+  int* destroyed;
+};
+
+
+// A callable that is too large to be stored inline.
+struct Large
+{
+  int operator()(int i) const { return i + padding[0]; }
+
+  char padding[1024] = {1};
+};
+
+
+TEST(LambdaTest, CallableOnce)
+{
+  lambda::CallableOnce<int(int)> f([](int i) { return i + 1; });
+  EXPECT_EQ(42, std::move(f)(41));
+
+  int destroyed = 0;
+
+  {
+    lambda::CallableOnce<string(const string&)> g(Prefix("hello ", &destroyed));
+    EXPECT_EQ(0, destroyed);
+
+    // Moving the callable around must not destroy the state it holds.
+    lambda::CallableOnce<string(const string&)> h(std::move(g));
+    EXPECT_EQ(0, destroyed);
+
+    EXPECT_EQ("hello world", std::move(h)("world"));
+  }
+
+  EXPECT_EQ(1, destroyed);
+
+  lambda::CallableOnce<int(int)> large((Large()));
+  lambda::CallableOnce<int(int)> moved(std::move(large));
+  EXPECT_EQ(42, std::move(moved)(41));
+}
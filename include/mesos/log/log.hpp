@@ -160,7 +160,19 @@ public:
     // time. A writer becomes invalid if either Writer::append or
     // Writer::truncate return None, in which case, the writer (or
     // another writer) must be restarted.
-    explicit Writer(Log* log);
+    //
+    // A writer performs up to 'window' appends and truncates at a
+    // time, i.e., an operation does not wait for the previous ones to
+    // finish. Their results are returned in order. If 'groupCommit'
+    // is true, appends that are invoked while 'window' operations are
+    // in progress are queued and then written together in a single
+    // round, rather than failing. Appends are only grouped once the
+    // replicas have confirmed that they support group commits,
+    // otherwise the queued appends are written one at a time.
+    explicit Writer(
+        Log* log,
+        bool groupCommit = false,
+        size_t window = 1);
     ~Writer();
 
     // Attempts to get a promise (from the log's replicas) for
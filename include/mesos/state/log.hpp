@@ -39,7 +39,14 @@ class LogStorageProcess;
 class LogStorage : public mesos::state::Storage
 {
 public:
-  LogStorage(mesos::log::Log* log, size_t diffsBetweenSnapshots = 0);
+  // If 'batchOperations' is true, the modifications that are written
+  // together are stored as a single (batch) entry of the log rather
+  // than as consecutive entries. NOTE: Only versions 1.1 and later
+  // can read batch entries.
+  LogStorage(
+      mesos::log::Log* log,
+      size_t diffsBetweenSnapshots = 0,
+      bool batchOperations = false);
 
   virtual ~LogStorage();
 
@@ -28,8 +28,13 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
+#include <process/shared.hpp>
 
+#include <stout/cache.hpp>
+#include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
 #include <stout/path.hpp>
@@ -44,6 +49,7 @@ using process::dispatch;
 using process::Failure;
 using process::Future;
 using process::Owned;
+using process::Shared;
 
 using std::string;
 using std::vector;
@@ -51,32 +57,47 @@ using std::vector;
 namespace mesos {
 namespace internal {
 
-struct GenericACL
-{
-  ACL::Entity subjects;
-  ACL::Entity objects;
-};
+// The maximum number of authorization decisions cached by the local
+// authorizer. Note that the ACLs cannot change during the lifetime of
+// the authorizer, hence cached decisions never become stale.
+constexpr size_t DECISIONS_CACHE_CAPACITY = 4096;
 
 
-// TODO(mpark): This class exists to optionally carry `ACL::SetQuota` and
-// `ACL::RemoveQuota` ACLs. This is a hack to support the deprecation cycle for
-// `ACL::SetQuota` and `ACL::RemoveQuota`. This can be removed / replaced with
-// `vector<GenericACL>` at the end of deprecation cycle which started with 1.0.
-struct GenericACLs
+// An `ACL::Entity` with its values hashed for fast lookups.
+struct CompiledEntity
 {
-  GenericACLs(const vector<GenericACL>& acls_) : acls(acls_) {}
+  CompiledEntity() : type(ACL::Entity::SOME) {}
 
-  GenericACLs(
-      const vector<GenericACL>& acls_,
-      const vector<GenericACL>& set_quotas_,
-      const vector<GenericACL>& remove_quotas_)
-    : acls(acls_), set_quotas(set_quotas_), remove_quotas(remove_quotas_) {}
+  // Implicit conversion from the protobuf entity.
+  CompiledEntity(const ACL::Entity& entity) : type(entity.type())
+  {
+    foreach (const string& value, entity.values()) {
+      values.insert(value);
+    }
+  }
 
-  vector<GenericACL> acls;
+  // Returns true if all the values of the specified entity are
+  // values of this entity.
+  bool contains(const ACL::Entity& entity) const
+  {
+    foreach (const string& value, entity.values()) {
+      if (!values.contains(value)) {
+        return false;
+      }
+    }
 
-  // These ACLs are set iff the authorization action is `UPDATE_QUOTA`.
-  Option<vector<GenericACL>> set_quotas;
-  Option<vector<GenericACL>> remove_quotas;
+    return true;
+  }
+
+  ACL::Entity::Type type;
+  hashset<string> values;
+};
+
+
+struct GenericACL
+{
+  CompiledEntity subjects;
+  CompiledEntity objects;
 };
 
 
@@ -92,40 +113,27 @@ struct GenericACLs
 //  |       -------|-------|-------|-------
 //  |        ANY   |  No   |  Yes  |   Yes
 //          -------|-------|-------|-------
-static bool matches(const ACL::Entity& request, const ACL::Entity& acl)
+static bool matches(const ACL::Entity& request, const CompiledEntity& acl)
 {
   // NONE only matches with NONE.
   if (request.type() == ACL::Entity::NONE) {
-    return acl.type() == ACL::Entity::NONE;
+    return acl.type == ACL::Entity::NONE;
   }
 
   // ANY matches with ANY or NONE.
   if (request.type() == ACL::Entity::ANY) {
-    return acl.type() == ACL::Entity::ANY || acl.type() == ACL::Entity::NONE;
+    return acl.type == ACL::Entity::ANY || acl.type == ACL::Entity::NONE;
   }
 
   if (request.type() == ACL::Entity::SOME) {
     // SOME matches with ANY or NONE.
-    if (acl.type() == ACL::Entity::ANY || acl.type() == ACL::Entity::NONE) {
+    if (acl.type == ACL::Entity::ANY || acl.type == ACL::Entity::NONE) {
       return true;
     }
 
     // SOME is allowed if the request values are a subset of ACL
     // values.
-    foreach (const string& value, request.values()) {
-      bool found = false;
-      foreach (const string& value_, acl.values()) {
-        if (value == value_) {
-          found = true;
-          break;
-        }
-      }
-
-      if (!found) {
-        return false;
-      }
-    }
-    return true;
+    return acl.contains(request);
   }
 
   return false;
@@ -143,56 +151,167 @@ static bool matches(const ACL::Entity& request, const ACL::Entity& acl)
 //  |       -------|-------|-------|-------
 //  |        ANY   |  No   |  No   |   Yes
 //          -------|-------|-------|-------
-static bool allows(const ACL::Entity& request, const ACL::Entity& acl)
+static bool allows(const ACL::Entity& request, const CompiledEntity& acl)
 {
   // NONE is only allowed by NONE.
   if (request.type() == ACL::Entity::NONE) {
-    return acl.type() == ACL::Entity::NONE;
+    return acl.type == ACL::Entity::NONE;
   }
 
   // ANY is only allowed by ANY.
   if (request.type() == ACL::Entity::ANY) {
-    return acl.type() == ACL::Entity::ANY;
+    return acl.type == ACL::Entity::ANY;
   }
 
   if (request.type() == ACL::Entity::SOME) {
     // SOME is allowed by ANY.
-    if (acl.type() == ACL::Entity::ANY) {
+    if (acl.type == ACL::Entity::ANY) {
       return true;
     }
 
     // SOME is not allowed by NONE.
-    if (acl.type() == ACL::Entity::NONE) {
+    if (acl.type == ACL::Entity::NONE) {
       return false;
     }
 
     // SOME is allowed if the request values are a subset of ACL
     // values.
-    foreach (const string& value, request.values()) {
-      bool found = false;
-      foreach (const string& value_, acl.values()) {
-        if (value == value_) {
-          found = true;
-          break;
+    return acl.contains(request);
+  }
+
+  return false;
+}
+
+
+// The ACLs of an action, indexed by subject so that deciding on a
+// request only considers the ACLs that can match its subject rather
+// than walking all of them.
+class CompiledACLs
+{
+public:
+  CompiledACLs(const vector<GenericACL>& _acls) : acls(_acls)
+  {
+    for (size_t i = 0; i < acls.size(); i++) {
+      const CompiledEntity& subjects = acls[i].subjects;
+
+      if (subjects.type == ACL::Entity::SOME) {
+        foreach (const string& value, subjects.values) {
+          indexed[value].push_back(i);
         }
+      } else {
+        wildcards.push_back(i);
       }
+    }
+  }
 
-      if (!found) {
-        return false;
+  size_t size() const { return acls.size(); }
+
+  // Returns whether the first ACL matching both the subject and the
+  // object allows the request, or none if no ACL matches.
+  Option<bool> decide(
+      const ACL::Entity& subject,
+      const ACL::Entity& object) const
+  {
+    // A request for SOME subject can only match the ACLs whose
+    // subjects are ANY or NONE, or include its value. A request for
+    // ANY subject can only match the former.
+    if (subject.type() == ACL::Entity::ANY ||
+        (subject.type() == ACL::Entity::SOME && subject.values_size() == 1)) {
+      const vector<size_t>* candidates = nullptr;
+
+      if (subject.type() == ACL::Entity::SOME) {
+        auto iterator = indexed.find(subject.values(0));
+        if (iterator != indexed.end()) {
+          candidates = &iterator->second;
+        }
+      }
+
+      // Walk both sets of ACLs in order, as the first match wins.
+      size_t i = 0;
+      size_t j = 0;
+
+      while (i < wildcards.size() ||
+             (candidates != nullptr && j < candidates->size())) {
+        size_t index;
+
+        if (candidates == nullptr || j == candidates->size() ||
+            (i < wildcards.size() && wildcards[i] < (*candidates)[j])) {
+          index = wildcards[i++];
+        } else {
+          index = (*candidates)[j++];
+        }
+
+        Option<bool> decision = decide(acls[index], subject, object);
+        if (decision.isSome()) {
+          return decision;
+        }
       }
+
+      return None();
     }
-    return true;
+
+    foreach (const GenericACL& acl, acls) {
+      Option<bool> decision = decide(acl, subject, object);
+      if (decision.isSome()) {
+        return decision;
+      }
+    }
+
+    return None();
   }
 
-  return false;
-}
+private:
+  static Option<bool> decide(
+      const GenericACL& acl,
+      const ACL::Entity& subject,
+      const ACL::Entity& object)
+  {
+    if (matches(subject, acl.subjects) && matches(object, acl.objects)) {
+      return allows(subject, acl.subjects) && allows(object, acl.objects);
+    }
+
+    return None();
+  }
+
+  vector<GenericACL> acls;
+
+  // Indices of the ACLs whose subjects are ANY or NONE.
+  vector<size_t> wildcards;
+
+  // Indices of the ACLs whose subjects are SOME, by subject value.
+  hashmap<string, vector<size_t>> indexed;
+};
+
+
+// TODO(mpark): This class exists to optionally carry `ACL::SetQuota` and
+// `ACL::RemoveQuota` ACLs. This is a hack to support the deprecation cycle for
+// `ACL::SetQuota` and `ACL::RemoveQuota`. This can be removed / replaced with
+// `vector<GenericACL>` at the end of deprecation cycle which started with 1.0.
+struct GenericACLs
+{
+  GenericACLs(const vector<GenericACL>& acls_) : acls(acls_) {}
+
+  GenericACLs(
+      const vector<GenericACL>& acls_,
+      const vector<GenericACL>& set_quotas_,
+      const vector<GenericACL>& remove_quotas_)
+    : acls(acls_),
+      set_quotas(CompiledACLs(set_quotas_)),
+      remove_quotas(CompiledACLs(remove_quotas_)) {}
+
+  CompiledACLs acls;
+
+  // These ACLs are set iff the authorization action is `UPDATE_QUOTA`.
+  Option<CompiledACLs> set_quotas;
+  Option<CompiledACLs> remove_quotas;
+};
 
 
 class LocalAuthorizerObjectApprover : public ObjectApprover
 {
 public:
   LocalAuthorizerObjectApprover(
-      const GenericACLs& acls,
+      const Shared<GenericACLs>& acls,
       const Option<authorization::Subject>& subject,
       const authorization::Action& action,
       const bool permissive)
@@ -286,14 +405,15 @@ public:
           // TODO(mpark): This is a hack to support the deprecation cycle for
           // `ACL::SetQuota` and `ACL::RemoveQuota`. This block of code can be
           // removed at the end of deprecation cycle which started with 1.0.
-          if (acls_.set_quotas->size() > 0 || acls_.remove_quotas->size() > 0) {
+          if (acls_->set_quotas->size() > 0 ||
+              acls_->remove_quotas->size() > 0) {
             CHECK_NOTNULL(object->value);
             if (*object->value == "SetQuota") {
               aclObject.add_values(object->quota_info->role());
               aclObject.set_type(mesos::ACL::Entity::SOME);
 
-              CHECK_SOME(acls_.set_quotas);
-              return approved(acls_.set_quotas.get(), aclSubject, aclObject);
+              CHECK_SOME(acls_->set_quotas);
+              return approved(acls_->set_quotas.get(), aclSubject, aclObject);
             } else if (*object->value == "RemoveQuota") {
               if (object->quota_info->has_principal()) {
                 aclObject.add_values(object->quota_info->principal());
@@ -302,8 +422,9 @@ public:
                 aclObject.set_type(mesos::ACL::Entity::ANY);
               }
 
-              CHECK_SOME(acls_.remove_quotas);
-              return approved(acls_.remove_quotas.get(), aclSubject, aclObject);
+              CHECK_SOME(acls_->remove_quotas);
+              return approved(
+                  acls_->remove_quotas.get(), aclSubject, aclObject);
             }
           }
 
@@ -374,26 +495,21 @@ public:
       }
     }
 
-    return approved(acls_.acls, aclSubject, aclObject);
+    return approved(acls_->acls, aclSubject, aclObject);
   }
 
 private:
   bool approved(
-      const vector<GenericACL>& acls,
+      const CompiledACLs& acls,
       const ACL::Entity& subject,
       const ACL::Entity& object) const
   {
-    // Authorize subject/object.
-    foreach (const GenericACL& acl, acls) {
-      if (matches(subject, acl.subjects) && matches(object, acl.objects)) {
-        return allows(subject, acl.subjects) && allows(object, acl.objects);
-      }
-    }
-
-    return permissive_; // None of the ACLs match.
+    // Authorize subject/object, if none of the ACLs match we fall
+    // back on the permissive flag.
+    return acls.decide(subject, object).getOrElse(permissive_);
   }
 
-  const GenericACLs acls_;
+  const Shared<GenericACLs> acls_;
   const Option<authorization::Subject> subject_;
   const authorization::Action action_;
   const bool permissive_;
@@ -404,7 +520,9 @@ class LocalAuthorizerProcess : public ProtobufProcess<LocalAuthorizerProcess>
 {
 public:
   LocalAuthorizerProcess(const ACLs& _acls)
-    : ProcessBase(process::ID::generate("local-authorizer")), acls(_acls) {}
+    : ProcessBase(process::ID::generate("local-authorizer")),
+      acls(_acls),
+      decisions(DECISIONS_CACHE_CAPACITY) {}
 
   virtual void initialize()
   {
@@ -423,12 +541,9 @@ public:
         acls.teardown_frameworks_size() > 0) {
       LOG(WARNING) << "ACLs defined for both ShutdownFramework and "
                    << "TeardownFramework; only the latter will be used";
-      return;
-    }
-
-    // Move contents of `acls.shutdown_frameworks` to
-    // `acls.teardown_frameworks`
-    if (acls.shutdown_frameworks_size() > 0) {
+    } else if (acls.shutdown_frameworks_size() > 0) {
+      // Move contents of `acls.shutdown_frameworks` to
+      // `acls.teardown_frameworks`
       LOG(WARNING) << "ShutdownFramework ACL is deprecated; please use "
                    << "TeardownFramework";
       foreach (const ACL::ShutdownFramework& acl, acls.shutdown_frameworks()) {
@@ -437,30 +552,102 @@ public:
         teardown->mutable_framework_principals()->CopyFrom(
             acl.framework_principals());
       }
+      acls.clear_shutdown_frameworks();
+    }
+
+    // Compile the ACLs of each action upfront rather than on every
+    // authorization request.
+    for (int i = authorization::Action_MIN; i <= authorization::Action_MAX;
+         i++) {
+      if (!authorization::Action_IsValid(i)) {
+        continue;
+      }
+
+      const authorization::Action action = authorization::Action(i);
+
+      Result<GenericACLs> genericACLs = createGenericACLs(action, acls);
+
+      // An error fails the requests for the action (rather than the
+      // authorizer) and actions without ACLs (i.e., unknown actions)
+      // deny all objects.
+      if (genericACLs.isError()) {
+        compiled.put(i, Error(genericACLs.error()));
+      } else if (genericACLs.isSome()) {
+        compiled.put(i, Shared<GenericACLs>(
+            new GenericACLs(genericACLs.get())));
+      }
     }
-    acls.clear_shutdown_frameworks();
   }
 
   Future<bool> authorized(const authorization::Request& request)
   {
-    return getObjectApprover(request.subject(), request.action())
-      .then([=](const Owned<ObjectApprover>& objectApprover) -> Future<bool> {
-        Option<ObjectApprover::Object> object = None();
-        if (request.has_object()) {
-          object = ObjectApprover::Object(request.object());
-        }
+    // Only the decisions for requests whose object (if any) is a
+    // value are cached, as other objects (e.g., tasks) are unlikely to
+    // be authorized repeatedly and would be costly to key on.
+    Option<string> key = None();
+
+    if (!request.has_object() ||
+        (request.object().has_value() &&
+         !request.object().has_framework_info() &&
+         !request.object().has_task() &&
+         !request.object().has_task_info() &&
+         !request.object().has_executor_info() &&
+         !request.object().has_quota_info())) {
+      string serialized;
+      if (request.SerializeToString(&serialized)) {
+        key = serialized;
+      }
+    }
 
-        Try<bool> result = objectApprover->approved(object);
-        if (result.isError()) {
-          return Failure(result.error());
-        }
-        return result.get();
-      });
+    if (key.isSome()) {
+      Option<bool> decision = decisions.get(key.get());
+      if (decision.isSome()) {
+        return decision.get();
+      }
+    }
+
+    Option<ObjectApprover::Object> object = None();
+    if (request.has_object()) {
+      object = ObjectApprover::Object(request.object());
+    }
+
+    Try<Owned<ObjectApprover>> objectApprover =
+      createObjectApprover(request.subject(), request.action());
+
+    if (objectApprover.isError()) {
+      return Failure(objectApprover.error());
+    }
+
+    Try<bool> result = objectApprover.get()->approved(object);
+    if (result.isError()) {
+      return Failure(result.error());
+    }
+
+    if (key.isSome()) {
+      decisions.put(key.get(), result.get());
+    }
+
+    return result.get();
   }
 
   Future<Owned<ObjectApprover>> getObjectApprover(
       const Option<authorization::Subject>& subject,
       const authorization::Action& action)
+  {
+    Try<Owned<ObjectApprover>> objectApprover =
+      createObjectApprover(subject, action);
+
+    if (objectApprover.isError()) {
+      return Failure(objectApprover.error());
+    }
+
+    return objectApprover.get();
+  }
+
+private:
+  Try<Owned<ObjectApprover>> createObjectApprover(
+      const Option<authorization::Subject>& subject,
+      const authorization::Action& action)
   {
     // Implementation of the ObjectApprover interface denying all objects.
     class RejectingObjectApprover : public ObjectApprover
@@ -473,23 +660,22 @@ public:
       }
     };
 
-    // Generate GenericACLs.
-    Result<GenericACLs> genericACLs = createGenericACLs(action, acls);
-    if (genericACLs.isError()) {
-      return Failure(genericACLs.error());
-    }
+    Option<Try<Shared<GenericACLs>>> genericACLs = compiled.get(action);
 
     if (genericACLs.isNone()) {
       // If we could not create acls, we deny all objects.
       return Owned<ObjectApprover>(new RejectingObjectApprover());
     }
 
+    if (genericACLs->isError()) {
+      return Error(genericACLs->error());
+    }
+
     return Owned<ObjectApprover>(
         new LocalAuthorizerObjectApprover(
-            genericACLs.get(), subject, action, acls.permissive()));
+            genericACLs->get(), subject, action, acls.permissive()));
   }
 
-private:
   static Result<GenericACLs> createGenericACLs(
       const authorization::Action& action,
       const ACLs& acls)
@@ -727,6 +913,14 @@ private:
   }
 
   ACLs acls;
+
+  // The ACLs of each action, compiled in 'initialize'. Keyed by the
+  // value of the action since 'std::hash' is not defined for enums
+  // by all the supported standard libraries.
+  hashmap<int, Try<Shared<GenericACLs>>> compiled;
+
+  // Recent authorization decisions, see 'authorized'.
+  Cache<string, bool> decisions;
 };
 
 
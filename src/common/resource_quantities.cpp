@@ -0,0 +1,342 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+#include <stout/synchronized.hpp>
+#include <stout/unreachable.hpp>
+
+#include "common/resource_quantities.hpp"
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+
+// NOTE: These mirror the fixed point conversions used for the
+// `Value::Scalar` arithmetic in 'common/values.cpp'.
+static int64_t convertToFixed(double floatValue)
+{
+  return std::llround(floatValue * 1000);
+}
+
+
+static double convertToFloating(int64_t fixedValue)
+{
+  double quotient = static_cast<double>(fixedValue / 1000);
+  double remainder = static_cast<double>(fixedValue % 1000) / 1000.0;
+
+  return quotient + remainder;
+}
+
+
+// Returns the interned name for the given value, interning it first
+// if necessary, or nullptr if `create` is false and the value has not
+// been interned yet.
+//
+// NOTE: The table is leaked on purpose so that the names remain valid
+// while other threads are still running during program exit.
+static const ResourceQuantities::Name* intern(
+    const string& value,
+    bool create = true)
+{
+  static std::mutex* mutex = new std::mutex();
+  static hashmap<string, const ResourceQuantities::Name*>* names =
+    new hashmap<string, const ResourceQuantities::Name*>();
+
+  synchronized (mutex) {
+    Option<const ResourceQuantities::Name*> name = names->get(value);
+
+    if (name.isSome()) {
+      return name.get();
+    }
+
+    if (!create) {
+      return nullptr;
+    }
+
+    const ResourceQuantities::Name* interned =
+      new ResourceQuantities::Name(value, static_cast<uint32_t>(names->size()));
+
+    names->put(value, interned);
+
+    return interned;
+  }
+
+  UNREACHABLE();
+}
+
+
+Value::Scalar ResourceQuantities::Quantity::scalar() const
+{
+  Value::Scalar scalar;
+  scalar.set_value(convertToFloating(value_));
+  return scalar;
+}
+
+
+ResourceQuantities ResourceQuantities::fromScalarResources(
+    const Resources& resources)
+{
+  ResourceQuantities result;
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() != Value::SCALAR) {
+      continue;
+    }
+
+    const int64_t value = convertToFixed(resource.scalar().value());
+
+    if (value <= 0) {
+      continue;
+    }
+
+    result.quantities.push_back(Quantity(
+        intern(resource.name()),
+        intern(resource.role()),
+        resource.has_revocable(),
+        value));
+  }
+
+  result.normalize();
+
+  return result;
+}
+
+
+Value::Scalar ResourceQuantities::get(const string& name) const
+{
+  int64_t total = 0;
+
+  const Name* interned = intern(name, false);
+
+  if (interned != nullptr) {
+    foreach (const Quantity& quantity, quantities) {
+      if (quantity.name_ == interned) {
+        total += quantity.value_;
+      }
+    }
+  }
+
+  Value::Scalar scalar;
+  scalar.set_value(convertToFloating(total));
+  return scalar;
+}
+
+
+bool ResourceQuantities::contains(const ResourceQuantities& that) const
+{
+  // Both are sorted, so we only need to walk them once.
+  vector<Quantity>::const_iterator it = quantities.begin();
+
+  foreach (const Quantity& quantity, that.quantities) {
+    while (it != quantities.end() && it->key_ < quantity.key_) {
+      ++it;
+    }
+
+    if (it == quantities.end() ||
+        it->key_ != quantity.key_ ||
+        it->value_ < quantity.value_) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+ResourceQuantities ResourceQuantities::flatten() const
+{
+  static const Name* any = intern("*");
+
+  ResourceQuantities result;
+
+  foreach (const Quantity& quantity, quantities) {
+    result.quantities.push_back(Quantity(
+        quantity.name_,
+        any,
+        quantity.revocable(),
+        quantity.value_));
+  }
+
+  result.normalize();
+
+  return result;
+}
+
+
+Resources ResourceQuantities::toResources() const
+{
+  Resources result;
+
+  foreach (const Quantity& quantity, quantities) {
+    Resource resource;
+    resource.set_name(quantity.name());
+    resource.set_type(Value::SCALAR);
+    resource.mutable_scalar()->CopyFrom(quantity.scalar());
+    resource.set_role(quantity.role());
+
+    if (quantity.revocable()) {
+      resource.mutable_revocable();
+    }
+
+    result += resource;
+  }
+
+  return result;
+}
+
+
+bool ResourceQuantities::operator==(const ResourceQuantities& that) const
+{
+  if (quantities.size() != that.quantities.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < quantities.size(); i++) {
+    if (quantities[i].key_ != that.quantities[i].key_ ||
+        quantities[i].value_ != that.quantities[i].value_) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool ResourceQuantities::operator!=(const ResourceQuantities& that) const
+{
+  return !(*this == that);
+}
+
+
+ResourceQuantities ResourceQuantities::operator+(
+    const ResourceQuantities& that) const
+{
+  ResourceQuantities result = *this;
+  result += that;
+  return result;
+}
+
+
+ResourceQuantities& ResourceQuantities::operator+=(
+    const ResourceQuantities& that)
+{
+  // Both are sorted, so we only need to walk them once. In the common
+  // case all the quantities are already present and we add in place.
+  vector<Quantity>::iterator it = quantities.begin();
+
+  foreach (const Quantity& quantity, that.quantities) {
+    while (it != quantities.end() && it->key_ < quantity.key_) {
+      ++it;
+    }
+
+    if (it != quantities.end() && it->key_ == quantity.key_) {
+      it->value_ += quantity.value_;
+    } else {
+      it = quantities.insert(it, quantity);
+    }
+
+    ++it;
+  }
+
+  return *this;
+}
+
+
+ResourceQuantities ResourceQuantities::operator-(
+    const ResourceQuantities& that) const
+{
+  ResourceQuantities result = *this;
+  result -= that;
+  return result;
+}
+
+
+ResourceQuantities& ResourceQuantities::operator-=(
+    const ResourceQuantities& that)
+{
+  // Both are sorted, so we only need to walk them once, moving the
+  // remaining quantities over the ones that are removed as we go.
+  size_t read = 0;
+  size_t write = 0;
+
+  foreach (const Quantity& quantity, that.quantities) {
+    while (read < quantities.size() && quantities[read].key_ < quantity.key_) {
+      quantities[write++] = quantities[read++];
+    }
+
+    if (read < quantities.size() && quantities[read].key_ == quantity.key_) {
+      quantities[read].value_ -= quantity.value_;
+
+      if (quantities[read].value_ > 0) {
+        quantities[write++] = quantities[read];
+      }
+
+      read++;
+    }
+  }
+
+  while (read < quantities.size()) {
+    quantities[write++] = quantities[read++];
+  }
+
+  quantities.erase(quantities.begin() + write, quantities.end());
+
+  return *this;
+}
+
+
+void ResourceQuantities::normalize()
+{
+  std::sort(
+      quantities.begin(),
+      quantities.end(),
+      [](const Quantity& left, const Quantity& right) {
+        return left.key_ < right.key_;
+      });
+
+  // Combine the quantities that only differed in the information
+  // that is stripped, e.g., different reservations of the same role.
+  size_t last = 0;
+  for (size_t i = 1; i < quantities.size(); i++) {
+    if (quantities[i].key_ == quantities[last].key_) {
+      quantities[last].value_ += quantities[i].value_;
+    } else {
+      quantities[++last] = quantities[i];
+    }
+  }
+
+  if (!quantities.empty()) {
+    quantities.erase(quantities.begin() + last + 1, quantities.end());
+  }
+}
+
+
+ostream& operator<<(ostream& stream, const ResourceQuantities& quantities)
+{
+  return stream << quantities.toResources();
+}
+
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,152 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __COMMON_RESOURCE_QUANTITIES_HPP__
+#define __COMMON_RESOURCE_QUANTITIES_HPP__
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+namespace mesos {
+namespace internal {
+
+// An aggregate of scalar resource quantities, i.e., the scalar
+// resources stripped of their reservation, disk and sharedness
+// information as done by `Resources::createStrippedScalarQuantity`.
+//
+// The allocator and the sorters aggregate such quantities across
+// agents and perform a lot of arithmetic on them. With `Resources`
+// every operation has to copy and compare protobufs, so instead
+// the resource names and roles are interned into integer IDs and
+// the quantities are kept as a vector of fixed-width entries, sorted
+// by (name, role, revocable). Arithmetic then boils down to merging
+// two short sorted vectors of integers. The values are kept in the
+// same fixed point representation as used by `Value::Scalar`
+// arithmetic, hence the results are identical to what the same
+// operations on the stripped `Resources` yield.
+//
+// Conversion from and to `Resources` is expected to happen only at
+// the edges, i.e., when resources enter the allocator or when the
+// quantities are exposed (e.g., in metrics or logs).
+class ResourceQuantities
+{
+public:
+  // An interned resource name or role. These are never freed, so
+  // the references handed out remain valid for the lifetime of the
+  // program and can be read without synchronization.
+  struct Name
+  {
+    Name(const std::string& _value, uint32_t _id) : value(_value), id(_id) {}
+
+    const std::string value;
+    const uint32_t id;
+  };
+
+  class Quantity
+  {
+  public:
+    const std::string& name() const { return name_->value; }
+    const std::string& role() const { return role_->value; }
+    bool revocable() const { return (key_ & 1) != 0; }
+    Value::Scalar scalar() const;
+
+  private:
+    friend class ResourceQuantities;
+
+    Quantity(const Name* name, const Name* role, bool revocable, int64_t value)
+      : name_(name),
+        role_(role),
+        key_((static_cast<uint64_t>(name->id) << 33) |
+            (static_cast<uint64_t>(role->id) << 1) |
+            (revocable ? 1 : 0)),
+        value_(value) {}
+
+    const Name* name_;
+    const Name* role_;
+
+    // The (name ID, role ID, revocable) triple packed into a single
+    // integer that determines the order of the quantities.
+    uint64_t key_;
+
+    // The value in thousandths, see `Value::Scalar` arithmetic.
+    int64_t value_;
+  };
+
+  typedef std::vector<Quantity>::const_iterator const_iterator;
+
+  // Returns the quantities of the scalar resources, which is the
+  // equivalent of `resources.createStrippedScalarQuantity()`.
+  static ResourceQuantities fromScalarResources(const Resources& resources);
+
+  ResourceQuantities() {}
+
+  bool empty() const { return quantities.empty(); }
+  size_t size() const { return quantities.size(); }
+
+  // Returns the total quantity of the named resource across all
+  // roles, like `Resources::get<Value::Scalar>(name)` does. Returns
+  // an empty scalar if there is no such resource.
+  Value::Scalar get(const std::string& name) const;
+
+  // Returns true if each of the quantities in `that` is less than or
+  // equal to the corresponding quantity here.
+  bool contains(const ResourceQuantities& that) const;
+
+  // Returns the quantities with all roles set to '*', adding up
+  // the quantities of different roles.
+  ResourceQuantities flatten() const;
+
+  // Returns the quantities as stripped scalar resources.
+  Resources toResources() const;
+
+  const_iterator begin() const { return quantities.begin(); }
+  const_iterator end() const { return quantities.end(); }
+
+  bool operator==(const ResourceQuantities& that) const;
+  bool operator!=(const ResourceQuantities& that) const;
+
+  ResourceQuantities operator+(const ResourceQuantities& that) const;
+  ResourceQuantities& operator+=(const ResourceQuantities& that);
+
+  // Like for `Resources`, quantities that drop to zero or below are
+  // removed, and quantities in `that` with no counterpart here are
+  // ignored.
+  ResourceQuantities operator-(const ResourceQuantities& that) const;
+  ResourceQuantities& operator-=(const ResourceQuantities& that);
+
+private:
+  // Sorts the quantities and combines the ones with the same key.
+  void normalize();
+
+  // Sorted by `Quantity::key_`, with positive values.
+  std::vector<Quantity> quantities;
+};
+
+
+std::ostream& operator<<(
+    std::ostream& stream,
+    const ResourceQuantities& quantities);
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_RESOURCE_QUANTITIES_HPP__
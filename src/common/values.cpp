@@ -158,13 +158,15 @@ void coalesce(Value::Ranges* result, vector<Range> ranges)
     return;
   }
 
-  std::sort(
-      ranges.begin(),
-      ranges.end(),
-      [](const Range& left, const Range& right) {
-        return std::tie(left.start, left.end) <
-               std::tie(right.start, right.end);
-      });
+  auto less = [](const Range& left, const Range& right) {
+    return std::tie(left.start, left.end) < std::tie(right.start, right.end);
+  };
+
+  // The ranges are often already sorted, e.g., when they are merged
+  // from coalesced ranges (see `operator+=`).
+  if (!std::is_sorted(ranges.begin(), ranges.end(), less)) {
+    std::sort(ranges.begin(), ranges.end(), less);
+  }
 
   // We build up initial state of the current range.
   CHECK(!ranges.empty());
@@ -226,6 +228,143 @@ void coalesce(Value::Ranges* result, vector<Range> ranges)
   CHECK_EQ(result->range_size(), count);
 }
 
+
+// Returns true if the ranges are sorted and neither overlap nor are
+// adjacent, i.e., if coalescing them would not change them. This is
+// the case for the results of all the operations below, hence we can
+// use it to operate on the ranges in place.
+static bool isCoalesced(const Value::Ranges& ranges)
+{
+  for (int i = 0; i < ranges.range_size(); i++) {
+    const Value::Range& range = ranges.range(i);
+
+    if (range.begin() > range.end()) {
+      return false;
+    }
+
+    if (i > 0) {
+      const uint64_t previous = ranges.range(i - 1).end();
+
+      if (previous == std::numeric_limits<uint64_t>::max() ||
+          range.begin() <= previous + 1) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+// Returns the index of the first of the coalesced ranges that ends
+// at or after `value`, found by binary search.
+static int lowerBound(const Value::Ranges& ranges, uint64_t value)
+{
+  return std::lower_bound(
+      ranges.range().begin(),
+      ranges.range().end(),
+      value,
+      [](const Value::Range& range, uint64_t value) {
+        return range.end() < value;
+      }) - ranges.range().begin();
+}
+
+
+// Inserts the range [begin, end] at the given index.
+static void insert(
+    Value::Ranges* ranges,
+    int index,
+    uint64_t begin,
+    uint64_t end)
+{
+  Value::Range* range = ranges->add_range();
+  range->set_begin(begin);
+  range->set_end(end);
+
+  // Only the pointers to the following ranges need to be moved.
+  std::rotate(
+      ranges->mutable_range()->pointer_begin() + index,
+      ranges->mutable_range()->pointer_end() - 1,
+      ranges->mutable_range()->pointer_end());
+}
+
+
+// Adds the range [begin, end] to the coalesced ranges, such that
+// they remain coalesced. This takes O(log n) to find the ranges to
+// merge with, plus moving the pointers of the ranges that follow in
+// case ranges need to be inserted or removed.
+static void add(Value::Ranges* ranges, uint64_t begin, uint64_t end)
+{
+  // Find the first range that overlaps or is adjacent to [begin, end].
+  int i = begin > 0 ? lowerBound(*ranges, begin - 1) : 0;
+
+  if (i == ranges->range_size() ||
+      (end < std::numeric_limits<uint64_t>::max() &&
+       ranges->range(i).begin() > end + 1)) {
+    insert(ranges, i, begin, end);
+    return;
+  }
+
+  // Merge all the ranges that overlap or are adjacent into the first.
+  Value::Range* merged = ranges->mutable_range(i);
+  merged->set_begin(min(merged->begin(), begin));
+  end = max(merged->end(), end);
+
+  int j = i + 1;
+  while (j < ranges->range_size() &&
+         (end == std::numeric_limits<uint64_t>::max() ||
+          ranges->range(j).begin() <= end + 1)) {
+    end = max(end, ranges->range(j).end());
+    j++;
+  }
+
+  merged->set_end(end);
+
+  if (j > i + 1) {
+    ranges->mutable_range()->DeleteSubrange(i + 1, j - i - 1);
+  }
+}
+
+
+// Subtracts the range [begin, end] from the coalesced ranges, such
+// that they remain coalesced. Like `add`, this takes O(log n) plus
+// moving the pointers of the ranges that follow, if necessary.
+static void subtract(Value::Ranges* ranges, uint64_t begin, uint64_t end)
+{
+  // Find the first range that overlaps with [begin, end].
+  int i = lowerBound(*ranges, begin);
+
+  if (i < ranges->range_size() && ranges->range(i).begin() < begin) {
+    const uint64_t last = ranges->range(i).end();
+
+    // Keep the part of the range before `begin`.
+    ranges->mutable_range(i)->set_end(begin - 1);
+
+    // Split the range if [begin, end] is strictly within it.
+    if (last > end) {
+      insert(ranges, i + 1, end + 1, last);
+      return;
+    }
+
+    i++;
+  }
+
+  // Remove the ranges that are covered entirely.
+  int j = i;
+  while (j < ranges->range_size() && ranges->range(j).end() <= end) {
+    j++;
+  }
+
+  // Keep the part of the last range after `end`.
+  if (j < ranges->range_size() && ranges->range(j).begin() <= end) {
+    ranges->mutable_range(j)->set_begin(end + 1);
+  }
+
+  if (j > i) {
+    ranges->mutable_range()->DeleteSubrange(i, j - i);
+  }
+}
+
 } // namespace internal {
 
 
@@ -321,55 +460,55 @@ ostream& operator<<(ostream& stream, const Value::Ranges& ranges)
 
 bool operator==(const Value::Ranges& _left, const Value::Ranges& _right)
 {
-  Value::Ranges left;
-  coalesce(&left, {_left});
+  // Coalesced ranges are sorted, so they can be compared one by one.
+  const Value::Ranges* left = &_left;
+  const Value::Ranges* right = &_right;
 
-  Value::Ranges right;
-  coalesce(&right, {_right});
+  Value::Ranges coalescedLeft;
+  if (!internal::isCoalesced(_left)) {
+    coalesce(&coalescedLeft, {_left});
+    left = &coalescedLeft;
+  }
 
-  if (left.range_size() == right.range_size()) {
-    for (int i = 0; i < left.range_size(); i++) {
-      // Make sure this range is equal to a range in the right.
-      bool found = false;
-      for (int j = 0; j < right.range_size(); j++) {
-        if (left.range(i).begin() == right.range(j).begin() &&
-            left.range(i).end() == right.range(j).end()) {
-          found = true;
-          break;
-        }
-      }
+  Value::Ranges coalescedRight;
+  if (!internal::isCoalesced(_right)) {
+    coalesce(&coalescedRight, {_right});
+    right = &coalescedRight;
+  }
 
-      if (!found) {
-        return false;
-      }
-    }
+  if (left->range_size() != right->range_size()) {
+    return false;
+  }
 
-    return true;
+  for (int i = 0; i < left->range_size(); i++) {
+    if (left->range(i).begin() != right->range(i).begin() ||
+        left->range(i).end() != right->range(i).end()) {
+      return false;
+    }
   }
 
-  return false;
+  return true;
 }
 
 
-bool operator<=(const Value::Ranges& _left, const Value::Ranges& _right)
+bool operator<=(const Value::Ranges& left, const Value::Ranges& _right)
 {
-  Value::Ranges left;
-  coalesce(&left, {_left});
+  const Value::Ranges* right = &_right;
 
-  Value::Ranges right;
-  coalesce(&right, {_right});
+  Value::Ranges coalescedRight;
+  if (!internal::isCoalesced(_right)) {
+    coalesce(&coalescedRight, {_right});
+    right = &coalescedRight;
+  }
 
-  for (int i = 0; i < left.range_size(); i++) {
-    // Make sure this range is a subset of a range in right.
-    bool matched = false;
-    for (int j = 0; j < right.range_size(); j++) {
-      if (left.range(i).begin() >= right.range(j).begin() &&
-          left.range(i).end() <= right.range(j).end()) {
-        matched = true;
-        break;
-      }
-    }
-    if (!matched) {
+  // Make sure each range is a subset of a range in right. As the
+  // ranges in right are coalesced we can find the only candidate by
+  // binary search.
+  foreach (const Value::Range& range, left.range()) {
+    int i = internal::lowerBound(*right, range.end());
+
+    if (i == right->range_size() ||
+        right->range(i).begin() > range.begin()) {
       return false;
     }
   }
@@ -380,34 +519,95 @@ bool operator<=(const Value::Ranges& _left, const Value::Ranges& _right)
 
 Value::Ranges operator+(const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges result;
-  coalesce(&result, {left, right});
-  return result;
+  Value::Ranges result = left;
+  return result += right;
 }
 
 
 Value::Ranges operator-(const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges result;
-  coalesce(&result, {left});
+  Value::Ranges result = left;
   return result -= right;
 }
 
 
+// Adding or subtracting ranges one at a time (see `internal::add` and
+// `internal::subtract`) is cheap when only a few ranges are involved,
+// e.g., when a task takes a port out of a fragmented range. Beyond
+// this number of ranges we instead rebuild the ranges in one pass.
+static const int MAX_INCREMENTAL_RANGES = 32;
+
+
 Value::Ranges& operator+=(Value::Ranges& left, const Value::Ranges& right)
 {
-  coalesce(&left, {right});
+  if (!internal::isCoalesced(left)) {
+    coalesce(&left, {right});
+    return left;
+  }
+
+  if (right.range_size() > MAX_INCREMENTAL_RANGES) {
+    if (!internal::isCoalesced(right)) {
+      coalesce(&left, {right});
+      return left;
+    }
+
+    // Both are sorted, so merging them keeps the ranges sorted which
+    // lets `coalesce` skip sorting them.
+    vector<internal::Range> ranges;
+    ranges.reserve(left.range_size() + right.range_size());
+
+    foreach (const Value::Range& range, left.range()) {
+      ranges.push_back({range.begin(), range.end()});
+    }
+
+    foreach (const Value::Range& range, right.range()) {
+      ranges.push_back({range.begin(), range.end()});
+    }
+
+    std::inplace_merge(
+        ranges.begin(),
+        ranges.begin() + left.range_size(),
+        ranges.end(),
+        [](const internal::Range& left, const internal::Range& right) {
+          return std::tie(left.start, left.end) <
+                 std::tie(right.start, right.end);
+        });
+
+    internal::coalesce(&left, std::move(ranges));
+    return left;
+  }
+
+  foreach (const Value::Range& range, right.range()) {
+    if (range.begin() <= range.end()) {
+      internal::add(&left, range.begin(), range.end());
+    }
+  }
+
   return left;
 }
 
 
 Value::Ranges& operator-=(Value::Ranges& _left, const Value::Ranges& _right)
 {
-  IntervalSet<uint64_t> left, right;
+  if (_right.range_size() > MAX_INCREMENTAL_RANGES) {
+    IntervalSet<uint64_t> left, right;
+
+    left = rangesToIntervalSet(_left);
+    right = rangesToIntervalSet(_right);
+    _left = intervalSetToRanges(left - right);
 
-  left = rangesToIntervalSet(_left);
-  right = rangesToIntervalSet(_right);
-  _left = intervalSetToRanges(left - right);
+    return _left;
+  }
+
+  if (!internal::isCoalesced(_left)) {
+    coalesce(&_left);
+  }
+
+  foreach (const Value::Range& range, _right.range()) {
+    if (range.begin() <= range.end()) {
+      internal::subtract(&_left, range.begin(), range.end());
+    }
+  }
 
   return _left;
 }
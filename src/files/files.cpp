@@ -469,7 +469,10 @@ const string FilesProcess::READ_HELP = HELP(
         ">        path=VALUE          The path of directory to browse.",
         ">        offset=VALUE        Value added to base address to obtain "
         "a second address",
-        ">        length=VALUE        Length of file to read."),
+        ">        length=VALUE        Length of file to read.",
+        "",
+        "The data returned is limited to 16 pages; use '/files/download'",
+        "with a 'Range' header to read larger ranges of a file."),
     AUTHENTICATION(true),
     AUTHORIZATION(
         "Reading files requires that the request principal is",
@@ -701,6 +704,11 @@ const string FilesProcess::DOWNLOAD_HELP = HELP(
         "This endpoint will return the raw file contents for the",
         "given path.",
         "",
+        "A single range of bytes can be requested with a 'Range' header,",
+        "e.g., 'Range: bytes=-4096' returns the last 4096 bytes of the",
+        "file, which makes it suitable for tailing large files. The",
+        "contents are sent directly from the file without being copied.",
+        "",
         "Query parameters:",
         "",
         ">        path=VALUE          The path of directory to browse."),
@@ -213,7 +213,8 @@ PID<Master> launch(const Flags& flags, Allocator* _allocator)
           set<UPID>(),
           masterFlags.log_auto_initialize,
           "registrar/");
-      storage = new mesos::state::LogStorage(log);
+      storage = new mesos::state::LogStorage(
+          log, 0, masterFlags.registry_batch_writes);
     } else {
       EXIT(EXIT_FAILURE)
         << "'" << masterFlags.registry << "' is not a supported"
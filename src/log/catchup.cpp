@@ -16,24 +16,31 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <list>
+#include <set>
 
 #include <process/collect.hpp>
+#include <process/defer.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
+#include <process/protobuf.hpp>
 #include <process/timer.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/stringify.hpp>
 
 #include "log/catchup.hpp"
 #include "log/consensus.hpp"
+#include "log/replica.hpp"
 
 #include "messages/log.hpp"
 
 using namespace process;
 
 using std::list;
+using std::set;
 
 namespace mesos {
 namespace internal {
@@ -165,10 +172,22 @@ static Future<uint64_t> catchup(
 }
 
 
-// TODO(jieyu): Our current implementation catches-up each position in
-// the set sequentially. In the future, we may want to parallelize it
-// to improve the performance. Also, we may want to implement rate
-// control here so that we don't saturate the network or disk.
+// The maximum number of positions requested in a single catch-up
+// request. The replicas may reply with fewer positions than that if
+// the response grows too large (see 'ReplicaProcess::catchup').
+static const uint64_t CATCHUP_BATCH_SIZE = 1024;
+
+
+// Catches-up an interval of positions in two phases. First, the
+// actions that have already been learned by other replicas are copied
+// in batches (see 'CatchUpRequest'), which requires a single round
+// trip and a single storage write per batch. Then, the positions that
+// are still missing (i.e., that no other replica has learned) are
+// caught-up sequentially by running Paxos on each of them.
+//
+// TODO(jieyu): In the future, we may want to parallelize the second
+// phase to improve the performance. Also, we may want to implement
+// rate control here so that we don't saturate the network or disk.
 class BulkCatchUpProcess : public Process<BulkCatchUpProcess>
 {
 public:
@@ -198,14 +217,16 @@ protected:
     promise.future().onDiscard(lambda::bind(
         static_cast<void(*)(const UPID&, bool)>(terminate), self(), true));
 
-    // Catch-up sequentially.
     current = positions.lower();
 
-    catchup();
+    fetch();
   }
 
   virtual void finalize()
   {
+    fetching.discard();
+    process::discard(responses);
+    checking.discard();
     catching.discard();
 
     // TODO(benh): Discard our promise only after 'catching' has
@@ -214,21 +235,164 @@ protected:
   }
 
 private:
-  static void timedout(Future<uint64_t> catching)
+  template <typename T>
+  static void timedout(Future<T> future)
   {
-    catching.discard();
+    future.discard();
   }
 
-  void catchup()
+  void fetch()
   {
     if (current >= positions.upper()) {
-      // Stop the process if there is nothing left to catch-up. This
-      // also handles the case where the input interval is empty.
+      // All the learned actions have been fetched (this also handles
+      // the case where the input interval is empty).
+      check();
+      return;
+    }
+
+    CatchUpRequest request;
+    request.set_from(current);
+    request.set_to(
+        std::min(current + CATCHUP_BATCH_SIZE, positions.upper()) - 1);
+
+    // No need to ask the local replica.
+    set<UPID> filter;
+    filter.insert(replica->pid());
+
+    network->broadcast(protocol::catchup, request, filter)
+      .onAny(defer(self(), &Self::broadcasted, request, lambda::_1));
+  }
+
+  void broadcasted(
+      const CatchUpRequest& request,
+      const Future<set<Future<CatchUpResponse>>>& future)
+  {
+    if (!future.isReady() || future.get().empty()) {
+      // Let the second phase catch-up the remaining positions.
+      LOG(INFO) << "Unable to fetch learned positions " << request.from()
+                << " to " << request.to() << ": no replica to fetch from";
+
+      check();
+      return;
+    }
+
+    // Any response will do since the actions are learned. The other
+    // responses are discarded once we got one.
+    responses = future.get();
+    fetching = select(responses);
+    fetching.onAny(defer(self(), &Self::fetched, request));
+
+    Clock::timer(
+        timeout,
+        lambda::bind(&Self::timedout<Future<CatchUpResponse>>, fetching));
+  }
+
+  void fetched(const CatchUpRequest& request)
+  {
+    process::discard(responses);
+    responses.clear();
+
+    // The future 'fetching' is never failed by select, and it can
+    // only be discarded if it timed out (or in 'finalize').
+    CHECK(!fetching.isFailed());
+
+    if (fetching.isDiscarded()) {
+      LOG(INFO) << "Unable to fetch learned positions " << request.from()
+                << " to " << request.to() << " in " << timeout;
+
+      check();
+      return;
+    }
+
+    const CatchUpResponse& response = fetching.get().get();
+
+    if (response.end() <= current) {
+      LOG(WARNING) << "Received an invalid catch-up response for positions "
+                   << request.from() << " to " << request.to();
+
+      check();
+      return;
+    }
+
+    LearnedMessage message;
+
+    foreach (const Action& action, response.actions()) {
+      if (!action.has_learned() || !action.learned() ||
+          action.position() < current ||
+          action.position() >= response.end()) {
+        LOG(WARNING) << "Ignoring unexpected action at position "
+                     << action.position() << " in catch-up response";
+        continue;
+      }
+
+      if (!message.has_action()) {
+        message.mutable_action()->CopyFrom(action);
+      } else {
+        message.add_actions()->CopyFrom(action);
+      }
+    }
+
+    if (message.has_action()) {
+      // Persist the actions in the local replica as a single batch.
+      // NOTE: The message is processed by the replica before any
+      // subsequent dispatch from this process (e.g., in 'check').
+      post(self(), replica->pid(), message);
+    }
+
+    current = response.end();
+
+    fetch();
+  }
+
+  void check()
+  {
+    if (positions.lower() >= positions.upper()) {
+      // Nothing to catch-up, the input interval is empty.
+      promise.set(Nothing());
+      terminate(self());
+      return;
+    }
+
+    // Check which positions are still missing after fetching the
+    // learned ones. Note that this includes any truncated position
+    // whose truncation we have not learned about (e.g., if fetching
+    // stopped early).
+    checking = replica->missing(positions.lower(), positions.upper() - 1);
+    checking.onAny(defer(self(), &Self::checked));
+  }
+
+  void checked()
+  {
+    // The future 'checking' can only be discarded in 'finalize'.
+    CHECK(!checking.isDiscarded());
+
+    if (checking.isFailed()) {
+      promise.fail("Failed to get missing positions: " + checking.failure());
+      terminate(self());
+      return;
+    }
+
+    missing = checking.get();
+
+    if (!missing.empty()) {
+      LOG(INFO) << "Catching-up " << missing.size() << " missing positions "
+                << "in " << positions << " with Paxos";
+    }
+
+    catchup();
+  }
+
+  void catchup()
+  {
+    if (missing.empty()) {
+      // Stop the process if there is nothing left to catch-up.
       promise.set(Nothing());
       terminate(self());
       return;
     }
 
+    current = missing.begin()->lower();
+
     // Store the future so that we can discard it if the user wants to
     // cancel the catch-up operation.
     catching = log::catchup(quorum, replica, network, proposal, current)
@@ -236,10 +400,9 @@ private:
       .onFailed(defer(self(), &Self::failed))
       .onReady(defer(self(), &Self::succeeded));
 
-    Clock::timer(timeout, lambda::bind(&Self::timedout, catching));
+    Clock::timer(timeout, lambda::bind(&Self::timedout<uint64_t>, catching));
   }
 
-
   void discarded()
   {
     LOG(INFO) << "Unable to catch-up position " << current
@@ -259,7 +422,7 @@ private:
 
   void succeeded()
   {
-    ++current;
+    missing -= current;
 
     // The single position catch-up function: 'log::catchup' will
     // return the highest proposal number seen so far. We use this
@@ -280,7 +443,13 @@ private:
   uint64_t proposal;
   uint64_t current;
 
+  // Positions that are left to be caught-up with Paxos.
+  IntervalSet<uint64_t> missing;
+
   process::Promise<Nothing> promise;
+  set<Future<CatchUpResponse>> responses;
+  Future<Future<CatchUpResponse>> fetching;
+  Future<IntervalSet<uint64_t>> checking;
   Future<uint64_t> catching;
 };
 
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include <set>
+#include <vector>
 
 #include <process/defer.hpp>
 #include <process/delay.hpp>
@@ -30,6 +31,7 @@
 #include <stout/os.hpp>
 #include <stout/nothing.hpp>
 #include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
 
 #include "log/consensus.hpp"
 #include "log/replica.hpp"
@@ -37,6 +39,7 @@
 using namespace process;
 
 using std::set;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -122,6 +125,9 @@ private:
     }
 
     CHECK_GE(future.get(), quorum);
+    CHECK(!actions.empty());
+
+    const Action& action = actions.front();
 
     request.set_proposal(proposal);
     request.set_position(position);
@@ -263,6 +269,8 @@ private:
   set<Future<PromiseResponse>> responses;
   size_t responsesReceived;
   size_t ignoresReceived;
+  size_t unsupportedReceived;
+  bool groupSupported; // Whether all acceptances supported groups.
   Option<uint64_t> highestNackProposal;
   Option<Action> highestAckAction;
 
@@ -326,6 +334,9 @@ private:
     }
 
     CHECK_GE(future.get(), quorum);
+    CHECK(!actions.empty());
+
+    const Action& action = actions.front();
 
     request.set_proposal(proposal);
 
@@ -439,14 +450,16 @@ public:
       size_t _quorum,
       const Shared<Network>& _network,
       uint64_t _proposal,
-      const Action& _action)
+      const vector<Action>& _actions)
     : ProcessBase(ID::generate("log-write")),
       quorum(_quorum),
       network(_network),
       proposal(_proposal),
-      action(_action),
+      actions(_actions),
       responsesReceived(0),
-      ignoresReceived(0) {}
+      ignoresReceived(0),
+      unsupportedReceived(0),
+      groupSupported(true) {}
 
   virtual ~WriteProcess() {}
 
@@ -490,6 +503,9 @@ private:
     }
 
     CHECK_GE(future.get(), quorum);
+    CHECK(!actions.empty());
+
+    const Action& action = actions.front();
 
     request.set_proposal(proposal);
     request.set_position(action.position());
@@ -511,6 +527,13 @@ private:
         LOG(FATAL) << "Unknown Action::Type " << action.type();
     }
 
+    // Any further actions are appends at the following positions.
+    for (size_t i = 1; i < actions.size(); i++) {
+      CHECK_EQ(Action::APPEND, actions[i].type());
+      CHECK_EQ(action.position() + i, actions[i].position());
+      request.add_appends()->CopyFrom(actions[i].append());
+    }
+
     network->broadcast(protocol::write, request)
       .onAny(defer(self(), &Self::broadcasted, lambda::_1));
   }
@@ -555,6 +578,29 @@ private:
       return;
     }
 
+    if (!isRejectedWrite(response) && !response.has_appends()) {
+      // The replica does not support group commits. It accepts a group
+      // of appends by writing only the first position, hence it must
+      // not count towards the quorum of a group write.
+      groupSupported = false;
+
+      if (actions.size() > 1) {
+        unsupportedReceived++;
+
+        if (responses.size() - unsupportedReceived < quorum) {
+          promise.fail(
+              "Failed to write " + stringify(actions.size()) +
+              " appends in a single round: " +
+              stringify(unsupportedReceived) +
+              " replicas do not support group commits");
+
+          terminate(self());
+        }
+
+        return;
+      }
+    }
+
     responsesReceived++;
 
     if (isRejectedWrite(response)) {
@@ -580,6 +626,11 @@ private:
       } else {
         result.set_type(WriteResponse::ACCEPT);
         result.set_okay(true);
+
+        // Tells the writer whether it can write groups of appends.
+        if (groupSupported) {
+          result.set_appends(actions.size() - 1);
+        }
       }
 
       promise.set(result);
@@ -590,7 +641,7 @@ private:
   const size_t quorum;
   const Shared<Network> network;
   const uint64_t proposal;
-  const Action action;
+  const vector<Action> actions;
 
   WriteRequest request;
   set<Future<WriteResponse>> responses;
@@ -829,13 +880,23 @@ Future<WriteResponse> write(
     const Shared<Network>& network,
     uint64_t proposal,
     const Action& action)
+{
+  return write(quorum, network, proposal, vector<Action>({action}));
+}
+
+
+Future<WriteResponse> write(
+    size_t quorum,
+    const Shared<Network>& network,
+    uint64_t proposal,
+    const vector<Action>& actions)
 {
   WriteProcess* process =
     new WriteProcess(
         quorum,
         network,
         proposal,
-        action);
+        actions);
 
   Future<WriteResponse> future = process->future();
   spawn(process, true);
@@ -845,11 +906,28 @@ Future<WriteResponse> write(
 
 Future<Nothing> learn(const Shared<Network>& network, const Action& action)
 {
+  return learn(network, vector<Action>({action}));
+}
+
+
+Future<Nothing> learn(
+    const Shared<Network>& network,
+    const vector<Action>& actions)
+{
+  CHECK(!actions.empty());
+
   LearnedMessage message;
-  message.mutable_action()->CopyFrom(action);
 
-  if (!action.has_learned() || !action.learned()) {
-    message.mutable_action()->set_learned(true);
+  foreach (const Action& action, actions) {
+    Action* learned = message.has_action()
+      ? message.add_actions()
+      : message.mutable_action();
+
+    learned->CopyFrom(action);
+
+    if (!action.has_learned() || !action.learned()) {
+      learned->set_learned(true);
+    }
   }
 
   return network->broadcast(message);
@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <process/future.hpp>
 #include <process/shared.hpp>
 
@@ -102,6 +104,22 @@ extern process::Future<WriteResponse> write(
     const Action& action);
 
 
+// Runs the write phase for a group of actions at consecutive log
+// positions in a single round, i.e., the replicas accept or reject
+// the write for all positions at once. All but the first action must
+// be appends.
+//
+// Replicas that do not support group commits do not count towards
+// the quorum of a group write. The write fails if a quorum of replicas
+// that do is no longer possible. The 'appends' field of an accepting
+// response is only set if every accepting replica supports groups.
+extern process::Future<WriteResponse> write(
+    size_t quorum,
+    const process::Shared<Network>& network,
+    uint64_t proposal,
+    const std::vector<Action>& actions);
+
+
 // Runs the learn phase (a.k.a, the commit phase) in Paxos. In fact,
 // this phase is not required, but treated as an optimization. In this
 // phase, a proposer broadcasts a learned message to replicas,
@@ -113,6 +131,13 @@ extern process::Future<Nothing> learn(
     const Action& action);
 
 
+// Runs the learn phase for a group of actions that were written in a
+// single round, broadcasting a single learned message.
+extern process::Future<Nothing> learn(
+    const process::Shared<Network>& network,
+    const std::vector<Action>& actions);
+
+
 // Tries to reach consensus for the given log position by running a
 // full Paxos round (i.e., promise -> write -> learn). If no value has
 // been previously agreed on for the given log position, a NOP will be
@@ -17,6 +17,8 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <deque>
+#include <vector>
 
 #include <mesos/type_utils.hpp>
 
@@ -25,7 +27,9 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
+#include <stout/owned.hpp>
 
 #include "log/catchup.hpp"
 #include "log/consensus.hpp"
@@ -35,7 +39,9 @@
 
 using namespace process;
 
+using std::deque;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -47,14 +53,19 @@ public:
   CoordinatorProcess(
       size_t _quorum,
       const Shared<Replica>& _replica,
-      const Shared<Network>& _network)
+      const Shared<Network>& _network,
+      bool _groupCommit,
+      size_t _window)
     : ProcessBase(ID::generate("log-coordinator")),
       quorum(_quorum),
       replica(_replica),
       network(_network),
+      groupCommit(_groupCommit),
+      window(_window),
       state(INITIAL),
       proposal(0),
-      index(0) {}
+      index(0),
+      groupSupported(false) {}
 
   virtual ~CoordinatorProcess() {}
 
@@ -68,7 +79,17 @@ protected:
   virtual void finalize()
   {
     electing.discard();
-    writing.discard();
+
+    foreach (Write& write, writing) {
+      write.future.discard();
+      write.promise->discard();
+    }
+    writing.clear();
+
+    foreach (const PendingAppend& append, pending) {
+      append.promise->fail("Coordinator is being deleted");
+    }
+    pending.clear();
   }
 
 private:
@@ -92,21 +113,51 @@ private:
   // Writing related functions.  //
   /////////////////////////////////
 
-  Future<Option<uint64_t>> write(const Action& action);
-  Future<WriteResponse> runWritePhase(const Action& action);
+  Future<Option<uint64_t>> write(const vector<Action>& actions);
+  Future<WriteResponse> runWritePhase(const vector<Action>& actions);
   Future<Option<uint64_t>> checkWritePhase(
-      const Action& action,
+      const vector<Action>& actions,
       const WriteResponse& response);
-  Future<Nothing> runLearnPhase(const Action& action);
-  Future<bool> checkLearnPhase(const Action& action);
-  Future<Option<uint64_t>> updateIndexAfterWritten(bool missing);
+  Future<Nothing> runLearnPhase(const vector<Action>& actions);
+  Future<bool> checkLearnPhase(const vector<Action>& actions);
+  Future<Option<uint64_t>> getPositionAfterWritten(
+      const vector<Action>& actions,
+      bool missing);
   void writingFinished();
-  void writingFailed();
-  void writingAborted();
+
+  // A write in progress. Writes may finish out of order, but their
+  // results are set in the order of their positions.
+  struct Write
+  {
+    Future<Option<uint64_t>> future;
+    Owned<process::Promise<Option<uint64_t>>> promise;
+  };
+
+  /////////////////////////////////
+  // Group commit functions.     //
+  /////////////////////////////////
+
+  // An append that arrived while the window of writes was full.
+  struct PendingAppend
+  {
+    string bytes;
+    Owned<process::Promise<Option<uint64_t>>> promise;
+  };
+
+  void commit();
+  void committed(
+      uint64_t first,
+      const vector<PendingAppend>& appends,
+      const Future<Option<uint64_t>>& future);
+  void abandon();
 
   const size_t quorum;
   const Shared<Replica> replica;
   const Shared<Network> network;
+  const bool groupCommit;
+
+  // The maximum number of writes in progress.
+  const size_t window;
 
   // The current state of the coordinator. A coordinator needs to be
   // elected first to perform append and truncate operations. If one
@@ -115,7 +166,9 @@ private:
   // coordinator does not declare itself as elected until it wins the
   // election and has filled all existing positions. A coordinator is
   // put in electing state after it decides to go for an election and
-  // before it is elected.
+  // before it is elected. A coordinator is in writing state while it
+  // has writes in progress, which can be up to 'window' writes to
+  // consecutive positions.
   enum
   {
     INITIAL,
@@ -130,8 +183,20 @@ private:
   // The position to which the next entry will be written.
   uint64_t index;
 
+  // Whether all the replicas that accepted the latest write support
+  // group commits. Until they do, the pending appends are written one
+  // at a time, see 'commit()'.
+  bool groupSupported;
+
   Future<Option<uint64_t>> electing;
-  Future<Option<uint64_t>> writing;
+
+  // The writes in progress, in the order of their positions.
+  deque<Write> writing;
+
+  // The appends that arrived while the window of writes was full,
+  // which get written in a single round once a write is done (if
+  // 'groupCommit').
+  deque<PendingAppend> pending;
 };
 
 
@@ -264,6 +329,9 @@ void CoordinatorProcess::electingFinished(const Option<uint64_t>& position)
   } else {
     state = ELECTED;
   }
+
+  // The replicas may have changed since we last wrote.
+  groupSupported = false;
 }
 
 
@@ -307,8 +375,17 @@ Future<Option<uint64_t>> CoordinatorProcess::append(const string& bytes)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
-    return Failure("Coordinator is currently writing");
+  } else if (state == WRITING && writing.size() >= window) {
+    if (!groupCommit) {
+      return Failure("Coordinator is currently writing");
+    }
+
+    PendingAppend append;
+    append.bytes = bytes;
+    append.promise.reset(new process::Promise<Option<uint64_t>>());
+    pending.push_back(append);
+
+    return append.promise->future();
   }
 
   Action action;
@@ -319,7 +396,7 @@ Future<Option<uint64_t>> CoordinatorProcess::append(const string& bytes)
   Action::Append* append = action.mutable_append();
   append->set_bytes(bytes);
 
-  return write(action);
+  return write({action});
 }
 
 
@@ -327,7 +404,7 @@ Future<Option<uint64_t>> CoordinatorProcess::truncate(uint64_t to)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
+  } else if (state == WRITING && writing.size() >= window) {
     return Failure("Coordinator is currently writing");
   }
 
@@ -339,102 +416,245 @@ Future<Option<uint64_t>> CoordinatorProcess::truncate(uint64_t to)
   Action::Truncate* truncate = action.mutable_truncate();
   truncate->set_to(to);
 
-  return write(action);
+  return write({action});
 }
 
 
-Future<Option<uint64_t>> CoordinatorProcess::write(const Action& action)
+Future<Option<uint64_t>> CoordinatorProcess::write(
+    const vector<Action>& actions)
 {
-  LOG(INFO) << "Coordinator attempting to write " << action.type()
-            << " action at position " << action.position();
+  CHECK(!actions.empty());
 
-  CHECK_EQ(state, ELECTED);
-  CHECK(action.has_performed() && action.has_type());
+  if (actions.size() == 1) {
+    LOG(INFO) << "Coordinator attempting to write " << actions[0].type()
+              << " action at position " << actions[0].position();
+  } else {
+    LOG(INFO) << "Coordinator attempting to write " << actions.size()
+              << " actions at positions " << actions.front().position()
+              << " to " << actions.back().position();
+  }
+
+  CHECK(state == ELECTED || state == WRITING);
+  CHECK_LT(writing.size(), window);
+  CHECK_EQ(index, actions.front().position());
+
+  foreach (const Action& action, actions) {
+    CHECK(action.has_performed() && action.has_type());
+  }
 
   state = WRITING;
 
-  writing = runWritePhase(action)
-    .then(defer(self(), &Self::checkWritePhase, action, lambda::_1))
-    .onReady(defer(self(), &Self::writingFinished))
-    .onFailed(defer(self(), &Self::writingFailed))
-    .onDiscarded(defer(self(), &Self::writingAborted));
+  // The next write goes to the following position without waiting
+  // for this write to finish (as long as the window is not full).
+  index += actions.size();
+
+  Write write;
+  write.promise.reset(new process::Promise<Option<uint64_t>>());
+  write.future = runWritePhase(actions)
+    .then(defer(self(), &Self::checkWritePhase, actions, lambda::_1));
+
+  write.future
+    .onAny(defer(self(), &Self::writingFinished));
+
+  // Discarding the result of the write discards the write.
+  Future<Option<uint64_t>> future = write.future;
+  write.promise->future()
+    .onDiscard([future]() mutable { future.discard(); });
 
-  return writing;
+  writing.push_back(write);
+
+  return write.promise->future();
 }
 
 
-Future<WriteResponse> CoordinatorProcess::runWritePhase(const Action& action)
+Future<WriteResponse> CoordinatorProcess::runWritePhase(
+    const vector<Action>& actions)
 {
-  return log::write(quorum, network, proposal, action);
+  return log::write(quorum, network, proposal, actions);
 }
 
 
 Future<Option<uint64_t>> CoordinatorProcess::checkWritePhase(
-    const Action& action,
+    const vector<Action>& actions,
     const WriteResponse& response)
 {
   if (!response.okay()) {
-    // Received a NACK. Save the proposal number.
-    CHECK_LE(proposal, response.proposal());
-    proposal = response.proposal();
+    // Received a NACK. Save the proposal number. Note that a write
+    // to a later position might have received a NACK already.
+    CHECK_LE(actions.front().performed(), response.proposal());
+    proposal = std::max(proposal, response.proposal());
 
     return None();
   }
 
-  return runLearnPhase(action)
-    .then(defer(self(), &Self::checkLearnPhase, action))
-    .then(defer(self(), &Self::updateIndexAfterWritten, lambda::_1));
+  groupSupported = response.has_appends();
+
+  return runLearnPhase(actions)
+    .then(defer(self(), &Self::checkLearnPhase, actions))
+    .then(defer(self(),
+                &Self::getPositionAfterWritten,
+                actions,
+                lambda::_1));
 }
 
 
-Future<Nothing> CoordinatorProcess::runLearnPhase(const Action& action)
+Future<Nothing> CoordinatorProcess::runLearnPhase(
+    const vector<Action>& actions)
 {
-  return log::learn(network, action);
+  return log::learn(network, actions);
 }
 
 
-Future<bool> CoordinatorProcess::checkLearnPhase(const Action& action)
+Future<bool> CoordinatorProcess::checkLearnPhase(
+    const vector<Action>& actions)
 {
   // Make sure that the local replica has learned the newly written
-  // log entry. Since messages are delivered and dispatched in order
-  // locally, we should always have the new entry learned by now.
-  return replica->missing(action.position());
+  // log entries. Since messages are delivered and dispatched in order
+  // locally, we should always have the new entries learned by now.
+  // The entries are learned at once so checking the last one is
+  // sufficient.
+  return replica->missing(actions.back().position());
 }
 
 
-Future<Option<uint64_t>> CoordinatorProcess::updateIndexAfterWritten(
+Future<Option<uint64_t>> CoordinatorProcess::getPositionAfterWritten(
+    const vector<Action>& actions,
     bool missing)
 {
   CHECK(!missing) << "Not expecting local replica to be missing position "
-                  << index << " after the writing is done";
+                  << actions.back().position() << " after the writing is done";
 
-  return index++;
+  return actions.back().position(); // The last written position.
 }
 
 
 void CoordinatorProcess::writingFinished()
 {
-  CHECK_EQ(state, WRITING);
-  state = ELECTED;
+  // Writes may finish out of order, but we only set the result of a
+  // write once the writes to the preceding positions have succeeded,
+  // so that the results are delivered in order.
+  while (!writing.empty() && !writing.front().future.isPending()) {
+    CHECK_EQ(state, WRITING);
+
+    Write write = writing.front();
+    writing.pop_front();
+
+    if (write.future.isReady() && write.future->isSome()) {
+      write.promise->set(write.future.get());
+      continue;
+    }
+
+    // The write was rejected (i.e., another coordinator has been
+    // elected), failed or was discarded. In all cases we demote the
+    // coordinator. Specifically, if a write is discarded we don't
+    // actually know whether the write was successful or not and we
+    // really need to "catch-up" that position before we try and do
+    // another write (see MESOS-1038 for more details). Likewise, the
+    // following positions might have been written while this one was
+    // not, which leaves holes that get filled by the next election.
+    state = INITIAL;
+
+    if (write.future.isReady()) {
+      write.promise->set(write.future.get());
+    } else if (write.future.isFailed()) {
+      write.promise->fail(write.future.failure());
+    } else {
+      write.promise->discard();
+    }
+
+    abandon();
+    return;
+  }
+
+  if (writing.empty() && state == WRITING) {
+    state = ELECTED;
+  }
+
+  // Write the appends that arrived while the window was full, if any.
+  while (!pending.empty() && writing.size() < window) {
+    commit();
+  }
 }
 
 
-void CoordinatorProcess::writingFailed()
+/////////////////////////////////////////////////
+// Handles group commits in CoordinatorProcess.
+/////////////////////////////////////////////////
+
+
+void CoordinatorProcess::commit()
 {
-  CHECK_EQ(state, WRITING);
-  state = INITIAL;
+  CHECK(state == ELECTED || state == WRITING);
+  CHECK(!pending.empty());
+
+  const uint64_t first = index;
+
+  vector<Action> actions;
+  vector<PendingAppend> appends;
+
+  // Replicas that do not support group commits would only write the
+  // first append of a group, so we only write a single append until
+  // a write tells us that the replicas support groups.
+  const size_t count = groupSupported ? pending.size() : 1;
+
+  while (actions.size() < count) {
+    const PendingAppend& append = pending.front();
+
+    Action action;
+    action.set_position(first + actions.size());
+    action.set_promised(proposal);
+    action.set_performed(proposal);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(append.bytes);
+
+    actions.push_back(action);
+    appends.push_back(append);
+
+    pending.pop_front();
+  }
+
+  write(actions)
+    .onAny(defer(self(), &Self::committed, first, appends, lambda::_1));
+}
+
+
+void CoordinatorProcess::committed(
+    uint64_t first,
+    const vector<PendingAppend>& appends,
+    const Future<Option<uint64_t>>& future)
+{
+  for (size_t i = 0; i < appends.size(); i++) {
+    if (future.isReady()) {
+      if (future->isNone()) {
+        appends[i].promise->set(Option<uint64_t>::none());
+      } else {
+        appends[i].promise->set(Option<uint64_t>(first + i));
+      }
+    } else if (future.isFailed()) {
+      appends[i].promise->fail(future.failure());
+    } else {
+      appends[i].promise->discard();
+    }
+  }
 }
 
 
-void CoordinatorProcess::writingAborted()
+void CoordinatorProcess::abandon()
 {
-  CHECK_EQ(state, WRITING);
+  // The coordinator is no longer elected, hence the writes still in
+  // progress return none (although they might still end up in the
+  // log), as do the appends that have not been written yet, like any
+  // append would now.
+  foreach (Write& write, writing) {
+    write.future.discard();
+    write.promise->set(Option<uint64_t>::none());
+  }
+  writing.clear();
 
-  // Demote the coordinator if a write operation is discarded since we
-  // don't actually know the write was successful or not and we really
-  // need to "catch-up" that position before we try and do another
-  // write (see MESOS-1038 for more details).
-  state = INITIAL;
+  foreach (const PendingAppend& append, pending) {
+    append.promise->set(Option<uint64_t>::none());
+  }
+  pending.clear();
 }
 
 
@@ -446,9 +666,14 @@ void CoordinatorProcess::writingAborted()
 Coordinator::Coordinator(
     size_t quorum,
     const Shared<Replica>& replica,
-    const Shared<Network>& network)
+    const Shared<Network>& network,
+    bool groupCommit,
+    size_t window)
 {
-  process = new CoordinatorProcess(quorum, replica, network);
+  CHECK_GT(window, 0u);
+
+  process = new CoordinatorProcess(
+      quorum, replica, network, groupCommit, window);
   spawn(process);
 }
 
@@ -40,10 +40,18 @@ class CoordinatorProcess;
 class Coordinator
 {
 public:
+  // The coordinator has up to 'window' writes (appends or truncates)
+  // in progress at a time, which go to consecutive positions and
+  // whose results are returned in order. If 'groupCommit' is true,
+  // appends that arrive while the window is full are queued and then
+  // written together in a single round once a write is done.
+  // Otherwise such appends fail.
   Coordinator(
       size_t _quorum,
       const process::Shared<Replica>& _replica,
-      const process::Shared<Network>& _network);
+      const process::Shared<Network>& _network,
+      bool _groupCommit = false,
+      size_t _window = 1);
 
   ~Coordinator();
 
@@ -60,7 +68,8 @@ public:
 
   // Appends the specified bytes to the end of the log. Returns the
   // position of the appended entry if the operation succeeds or none
-  // if the coordinator was demoted.
+  // if the coordinator was demoted (in which case the writes still in
+  // progress return none as well).
   process::Future<Option<uint64_t>> append(const std::string& bytes);
 
   // Removes all log entries preceding the log entry at the given
@@ -23,16 +23,28 @@
 
 #include <stdint.h>
 
+#include <mutex>
+
+#include <process/delay.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
 #include <stout/check.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
 #include <stout/numify.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/unreachable.hpp>
 
 #include "log/leveldb.hpp"
 
+using namespace process;
+
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -126,8 +138,91 @@ static string encode(uint64_t position, bool adjust = true)
 // }
 
 
+// The delay between a truncation and the compaction of the truncated
+// positions. This allows us to compact the positions deleted by many
+// consecutive truncations at once.
+static const Duration COMPACTION_DELAY = Seconds(10);
+
+
+class LevelDBCompactionProcess : public Process<LevelDBCompactionProcess>
+{
+public:
+  explicit LevelDBCompactionProcess(leveldb::DB* _db)
+    : ProcessBase(ID::generate("log-leveldb-compaction")),
+      db(_db),
+      target(0),
+      compacted(0),
+      scheduled(false),
+      compactions(0) {}
+
+  virtual ~LevelDBCompactionProcess() {}
+
+  // Schedules a compaction of all the positions before 'to'.
+  void schedule(uint64_t to)
+  {
+    target = std::max(target, to);
+
+    if (!scheduled && target > compacted) {
+      scheduled = true;
+      delay(COMPACTION_DELAY, self(), &Self::compact);
+    }
+  }
+
+  // Fills in the compaction statistics. NOTE: This is called
+  // directly by the storage (i.e., it is not dispatched) so that it
+  // does not have to wait for a compaction in progress.
+  void statistics(Storage::Statistics* statistics)
+  {
+    synchronized (mutex) {
+      statistics->compactions = compactions;
+      statistics->compaction = compaction;
+    }
+  }
+
+private:
+  void compact()
+  {
+    CHECK(scheduled);
+    scheduled = false;
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    // The deleted keys are all before the (encoded) target position
+    // as we always truncate a prefix of the log.
+    const string limit = encode(target);
+    const leveldb::Slice slice(limit);
+
+    db->CompactRange(nullptr, &slice);
+
+    compacted = target;
+
+    const Duration elapsed = stopwatch.elapsed();
+
+    synchronized (mutex) {
+      compactions++;
+      compaction = elapsed;
+    }
+
+    VLOG(1) << "Compacting positions before " << target
+            << " in leveldb took " << elapsed;
+  }
+
+  leveldb::DB* db;
+
+  uint64_t target; // Positions before this one should be compacted.
+  uint64_t compacted; // Positions before this one have been compacted.
+  bool scheduled;
+
+  // Protects the statistics, see 'statistics()'.
+  std::mutex mutex;
+  uint64_t compactions;
+  Option<Duration> compaction;
+};
+
+
 LevelDBStorage::LevelDBStorage()
-  : db(nullptr), first(None())
+  : db(nullptr), compactor(nullptr), first(None())
 {
   // Nothing to see here.
 }
@@ -135,6 +230,12 @@ LevelDBStorage::LevelDBStorage()
 
 LevelDBStorage::~LevelDBStorage()
 {
+  if (compactor != nullptr) {
+    process::terminate(compactor);
+    process::wait(compactor);
+    delete compactor;
+  }
+
   delete db; // Might be null if open failed in LevelDBStorage::restore.
 }
 
@@ -175,11 +276,29 @@ Try<Storage::State> LevelDBStorage::restore(const string& path)
 
   stopwatch.start(); // Restart the stopwatch.
 
-  // TODO(benh): Conditionally compact to avoid long recovery times?
-  db->CompactRange(nullptr, nullptr);
+  // Only compact the positions that have been deleted by truncations
+  // (i.e., before the first action still in the db), in case we did
+  // not get a chance to compact them in the background. Compacting
+  // the whole db would make the recovery time grow with the log.
+  {
+    leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
+
+    iterator->Seek(encode(0));
+
+    if (iterator->Valid()) {
+      const string limit = iterator->key().ToString();
+      const leveldb::Slice slice(limit);
+      db->CompactRange(nullptr, &slice);
+    }
+
+    delete iterator;
+  }
 
   VLOG(1) << "Compacted db in " << stopwatch.elapsed();
 
+  compactor = new LevelDBCompactionProcess(db);
+  spawn(compactor);
+
   State state;
   state.begin = 0;
   state.end = 0;
@@ -347,58 +466,62 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
   if (action.has_type() && action.type() == Action::TRUNCATE &&
       action.has_learned() && action.learned()) {
     CHECK(action.has_truncate());
+    truncate(action.truncate().to());
+  }
+
+  return Nothing();
+}
+
 
-    stopwatch.start(); // Restart the stopwatch.
-
-    // To actually perform the truncation in leveldb we need to remove
-    // all the keys that represent positions no longer in the log. We
-    // do this by attempting to delete all keys that represent the
-    // first position we know is still in leveldb up to (but
-    // excluding) the truncate position. Note that this works because
-    // the semantics of WriteBatch are such that even if the position
-    // doesn't exist (which is possible because this replica has some
-    // holes), we can attempt to delete the key that represents it and
-    // it will just ignore that key. This is *much* cheaper than
-    // actually iterating through the entire database instead (which
-    // was, for posterity, the original implementation). In addition,
-    // caching the "first" position we know is in the database is
-    // cheaper than using an iterator to determine the first position
-    // (which was, for posterity, the second implementation).
-
-    leveldb::WriteBatch batch;
-
-    CHECK_SOME(first);
-
-    // Add positions up to (but excluding) the truncate position to
-    // the batch starting at the first position still in leveldb. It's
-    // likely that the first position is greater than the truncate
-    // position (e.g., during catch-up). In that case, we do nothing
-    // because there is nothing we can truncate.
-    // TODO(jieyu): We might miss a truncation if we do random (i.e.,
-    // out of order) bulk catch-up and the truncate operation is
-    // caught up first.
-    uint64_t index = 0;
-    while ((first.get() + index) < action.truncate().to()) {
-      batch.Delete(encode(first.get() + index));
-      index++;
+Try<Nothing> LevelDBStorage::persist(const vector<Action>& actions)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // We put all of the actions in a single batch so that they are
+  // written (and synced) at once.
+  leveldb::WriteBatch batch;
+  size_t size = 0;
+
+  foreach (const Action& action, actions) {
+    Record record;
+    record.set_type(Record::ACTION);
+    record.mutable_action()->MergeFrom(action);
+
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Error("Failed to serialize record");
     }
 
-    // If we added any positions, attempt to delete them!
-    if (index > 0) {
-      // We do this write asynchronously (e.g., using default options).
-      leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
-
-      if (!status.ok()) {
-        LOG(WARNING) << "Ignoring leveldb batch delete failure: "
-                     << status.ToString();
-      } else {
-        // Save the new first position!
-        CHECK_LT(first.get(), action.truncate().to());
-        first = action.truncate().to();
-
-        VLOG(1) << "Deleting ~" << index
-                << " keys from leveldb took " << stopwatch.elapsed();
-      }
+    batch.Put(encode(action.position()), value);
+    size += value.size();
+  }
+
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  // Update the first position, see the comment above.
+  foreach (const Action& action, actions) {
+    first = min(first, action.position());
+  }
+
+  VLOG(1) << "Persisting " << actions.size() << " actions (" << size
+          << " bytes) to leveldb took " << stopwatch.elapsed();
+
+  // Delete positions if a truncate action has been *learned*, see the
+  // comment above.
+  foreach (const Action& action, actions) {
+    if (action.has_type() && action.type() == Action::TRUNCATE &&
+        action.has_learned() && action.learned()) {
+      CHECK(action.has_truncate());
+      truncate(action.truncate().to());
     }
   }
 
@@ -406,6 +529,87 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
 }
 
 
+void LevelDBStorage::truncate(uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // To actually perform the truncation in leveldb we need to remove
+  // all the keys that represent positions no longer in the log. We
+  // do this by attempting to delete all keys that represent the
+  // first position we know is still in leveldb up to (but
+  // excluding) the truncate position. Note that this works because
+  // the semantics of WriteBatch are such that even if the position
+  // doesn't exist (which is possible because this replica has some
+  // holes), we can attempt to delete the key that represents it and
+  // it will just ignore that key. This is *much* cheaper than
+  // actually iterating through the entire database instead (which
+  // was, for posterity, the original implementation). In addition,
+  // caching the "first" position we know is in the database is
+  // cheaper than using an iterator to determine the first position
+  // (which was, for posterity, the second implementation).
+
+  leveldb::WriteBatch batch;
+
+  CHECK_SOME(first);
+
+  // Add positions up to (but excluding) the truncate position to
+  // the batch starting at the first position still in leveldb. It's
+  // likely that the first position is greater than the truncate
+  // position (e.g., during catch-up). In that case, we do nothing
+  // because there is nothing we can truncate.
+  // TODO(jieyu): We might miss a truncation if we do random (i.e.,
+  // out of order) bulk catch-up and the truncate operation is
+  // caught up first.
+  uint64_t index = 0;
+  while ((first.get() + index) < to) {
+    batch.Delete(encode(first.get() + index));
+    index++;
+  }
+
+  // If we added any positions, attempt to delete them!
+  if (index > 0) {
+    // We do this write asynchronously (e.g., using default options).
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring leveldb batch delete failure: "
+                   << status.ToString();
+    } else {
+      // Save the new first position!
+      CHECK_LT(first.get(), to);
+      first = to;
+
+      VLOG(1) << "Deleting ~" << index
+              << " keys from leveldb took " << stopwatch.elapsed();
+
+      // Reclaim the space used by the deleted keys.
+      dispatch(compactor, &LevelDBCompactionProcess::schedule, to);
+    }
+  }
+}
+
+
+Future<Storage::Statistics> LevelDBStorage::statistics()
+{
+  CHECK_NOTNULL(compactor);
+
+  // Estimate the size of all the keys, including the metadata. Note
+  // that all the keys are zero padded decimal numbers and ':' comes
+  // right after '9' in ASCII.
+  uint64_t size = 0;
+  leveldb::Range range("0", ":");
+  db->GetApproximateSizes(&range, 1, &size);
+
+  Storage::Statistics statistics;
+  statistics.size = Bytes(size);
+
+  compactor->statistics(&statistics);
+
+  return statistics;
+}
+
+
 Try<Action> LevelDBStorage::read(uint64_t position)
 {
   Stopwatch stopwatch;
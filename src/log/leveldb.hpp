@@ -21,6 +21,10 @@
 
 #include <stdint.h>
 
+#include <vector>
+
+#include <process/future.hpp>
+
 #include <stout/option.hpp>
 
 #include "log/storage.hpp"
@@ -29,6 +33,10 @@ namespace mesos {
 namespace internal {
 namespace log {
 
+// Forward declaration.
+class LevelDBCompactionProcess;
+
+
 // Concrete implementation of the storage interface using leveldb.
 class LevelDBStorage : public Storage
 {
@@ -39,11 +47,21 @@ public:
   virtual Try<State> restore(const std::string& path);
   virtual Try<Nothing> persist(const Metadata& metadata);
   virtual Try<Nothing> persist(const Action& action);
+  virtual Try<Nothing> persist(const std::vector<Action>& actions);
   virtual Try<Action> read(uint64_t position);
+  virtual process::Future<Statistics> statistics();
 
 private:
+  // Deletes the positions preceding a learned truncate action, see
+  // the comments in the implementation.
+  void truncate(uint64_t to);
+
   leveldb::DB* db;
 
+  // Compacts the truncated positions in the background so that the
+  // deleted keys do not slow down reads and future restores.
+  LevelDBCompactionProcess* compactor;
+
   // First position still in leveldb, used during truncation.
   Option<uint64_t> first;
 };
@@ -248,6 +248,49 @@ double LogProcess::_recovered()
 }
 
 
+Future<Storage::Statistics> LogProcess::statistics()
+{
+  // The local replica is owned by the recover process until the log
+  // has finished recovery.
+  if (!recovered.future().isReady()) {
+    return Failure("The log has not finished recovery");
+  }
+
+  return replica->statistics();
+}
+
+
+Future<double> LogProcess::_storageSize()
+{
+  return statistics()
+    .then([](const Storage::Statistics& statistics) -> Future<double> {
+      return static_cast<double>(statistics.size.bytes());
+    });
+}
+
+
+Future<double> LogProcess::_storageCompactions()
+{
+  return statistics()
+    .then([](const Storage::Statistics& statistics) -> Future<double> {
+      return static_cast<double>(statistics.compactions);
+    });
+}
+
+
+Future<double> LogProcess::_storageCompactionTime()
+{
+  return statistics()
+    .then([](const Storage::Statistics& statistics) -> Future<double> {
+      if (statistics.compaction.isNone()) {
+        return Failure("No compaction has been done yet");
+      }
+
+      return statistics.compaction.get().ms();
+    });
+}
+
+
 void LogProcess::watch(
     const UPID& pid,
     const set<zookeeper::Group::Membership>& memberships)
@@ -285,15 +328,30 @@ LogProcess::Metrics::Metrics(
     const Option<string>& prefix)
   : recovered(
         prefix.getOrElse("") + "log/recovered",
-        defer(process, &LogProcess::_recovered))
+        defer(process, &LogProcess::_recovered)),
+    storage_size_bytes(
+        prefix.getOrElse("") + "log/storage/size_bytes",
+        defer(process, &LogProcess::_storageSize)),
+    storage_compactions(
+        prefix.getOrElse("") + "log/storage/compactions",
+        defer(process, &LogProcess::_storageCompactions)),
+    storage_compaction_ms(
+        prefix.getOrElse("") + "log/storage/compaction_ms",
+        defer(process, &LogProcess::_storageCompactionTime))
 {
   process::metrics::add(recovered);
+  process::metrics::add(storage_size_bytes);
+  process::metrics::add(storage_compactions);
+  process::metrics::add(storage_compaction_ms);
 }
 
 
 LogProcess::Metrics::~Metrics()
 {
   process::metrics::remove(recovered);
+  process::metrics::remove(storage_size_bytes);
+  process::metrics::remove(storage_compactions);
+  process::metrics::remove(storage_compaction_ms);
 }
 
 
@@ -459,10 +517,15 @@ Log::Position LogReaderProcess::position(uint64_t value)
 /////////////////////////////////////////////////
 
 
-LogWriterProcess::LogWriterProcess(Log* log)
+LogWriterProcess::LogWriterProcess(
+    Log* log,
+    bool _groupCommit,
+    size_t _window)
   : ProcessBase(ID::generate("log-writer")),
     quorum(log->process->quorum),
     network(log->process->network),
+    groupCommit(_groupCommit),
+    window(_window),
     recovering(dispatch(log->process, &LogProcess::recover)),
     coordinator(nullptr),
     error(None()) {}
@@ -548,7 +611,8 @@ Future<Option<Log::Position>> LogWriterProcess::_start()
 
   CHECK_READY(recovering);
 
-  coordinator = new Coordinator(quorum, recovering.get(), network);
+  coordinator = new Coordinator(
+      quorum, recovering.get(), network, groupCommit, window);
 
   LOG(INFO) << "Attempting to start the writer";
 
@@ -736,9 +800,11 @@ Future<Log::Position> Log::Reader::ending()
 /////////////////////////////////////////////////
 
 
-Log::Writer::Writer(Log* log)
+Log::Writer::Writer(Log* log, bool groupCommit, size_t window)
 {
-  process = new LogWriterProcess(log);
+  CHECK_GT(window, 0u);
+
+  process = new LogWriterProcess(log, groupCommit, window);
   spawn(process);
 }
 
@@ -34,6 +34,7 @@
 #include "log/network.hpp"
 #include "log/recover.hpp"
 #include "log/replica.hpp"
+#include "log/storage.hpp"
 
 namespace mesos {
 namespace internal {
@@ -77,6 +78,14 @@ private:
   // Return true if the log has finished recovery.
   double _recovered();
 
+  // Returns the statistics of the storage of the local replica, once
+  // the log has finished recovery.
+  process::Future<Storage::Statistics> statistics();
+
+  process::Future<double> _storageSize();
+  process::Future<double> _storageCompactions();
+  process::Future<double> _storageCompactionTime();
+
   // TODO(benh): Factor this out into "membership renewer".
   void watch(
       const process::UPID& pid,
@@ -109,6 +118,10 @@ private:
     ~Metrics();
 
     process::metrics::Gauge recovered;
+
+    process::metrics::Gauge storage_size_bytes;
+    process::metrics::Gauge storage_compactions;
+    process::metrics::Gauge storage_compaction_ms;
   } metrics;
 };
 
@@ -160,7 +173,7 @@ private:
 class LogWriterProcess : public process::Process<LogWriterProcess>
 {
 public:
-  explicit LogWriterProcess(mesos::log::Log* log);
+  LogWriterProcess(mesos::log::Log* log, bool groupCommit, size_t window);
 
   process::Future<Option<mesos::log::Log::Position>> start();
   process::Future<Option<mesos::log::Log::Position>> append(
@@ -192,6 +205,8 @@ private:
 
   const size_t quorum;
   const process::Shared<Network> network;
+  const bool groupCommit;
+  const size_t window;
 
   process::Future<process::Shared<Replica>> recovering;
   std::list<process::Promise<Nothing>*> promises;
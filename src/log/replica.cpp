@@ -17,12 +17,14 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <vector>
 
 #include <mesos/type_utils.hpp>
 
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/exit.hpp>
@@ -41,6 +43,7 @@ using namespace process;
 
 using std::list;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -52,10 +55,17 @@ namespace protocol {
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
 Protocol<RecoverRequest, RecoverResponse> recover;
+Protocol<CatchUpRequest, CatchUpResponse> catchup;
 
 } // namespace protocol {
 
 
+// The maximum (approximate) size of the actions included in a single
+// catch-up response, so that a lagging replica catching-up a large
+// range of positions does not cause a huge message to be built.
+static const Bytes MAX_CATCHUP_RESPONSE_SIZE = Megabytes(4);
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
@@ -97,6 +107,9 @@ public:
   // Returns the highest implicit promise this replica has given.
   uint64_t promised();
 
+  // Returns the statistics of the underlying storage.
+  Future<Storage::Statistics> statistics();
+
   // Updates the status of this replica. The update will be persisted
   // to storage. Returns true on success and false otherwise.
   bool update(const Metadata::Status& status);
@@ -112,12 +125,19 @@ private:
   // Handles a request from a recover process.
   void recover(const UPID& from, const RecoverRequest& request);
 
-  // Handles a message notifying of a learned action.
-  void learned(const UPID& from, const Action& action);
+  // Handles a request from a lagging replica to fetch learned actions.
+  void catchup(const UPID& from, const CatchUpRequest& request);
 
-  // Persists the specified action to storage. Returns true on success
-  // and false otherwise.
+  // Handles a message notifying of learned actions.
+  void learned(const UPID& from, const LearnedMessage& message);
+
+  // Persists the specified action(s) to storage. Returns true on
+  // success and false otherwise.
   bool persist(const Action& action);
+  bool persist(const vector<Action>& actions);
+
+  // Updates the positions of the log after persisting an action.
+  void persisted(const Action& action);
 
   // Updates the highest promise this replica has given. The update
   // will be persisted to storage. Returns true on success and false
@@ -168,9 +188,11 @@ ReplicaProcess::ReplicaProcess(const string& path)
   install<RecoverRequest>(
       &ReplicaProcess::recover);
 
+  install<CatchUpRequest>(
+      &ReplicaProcess::catchup);
+
   install<LearnedMessage>(
-      &ReplicaProcess::learned,
-      &LearnedMessage::action);
+      &ReplicaProcess::learned);
 }
 
 
@@ -304,6 +326,12 @@ uint64_t ReplicaProcess::promised()
 }
 
 
+Future<Storage::Statistics> ReplicaProcess::statistics()
+{
+  return storage->statistics();
+}
+
+
 bool ReplicaProcess::update(const Metadata::Status& status)
 {
   Metadata metadata_;
@@ -517,6 +545,41 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
 }
 
 
+// Sets the type (and the corresponding field) of the action that the
+// write request proposes for the position at the given offset from
+// the position of the request, see 'WriteRequest.appends'.
+static void propose(const WriteRequest& request, int offset, Action* action)
+{
+  if (request.has_learned()) action->set_learned(request.learned());
+
+  if (offset > 0) {
+    CHECK_EQ(request.type(), Action::APPEND);
+    action->set_type(Action::APPEND);
+    action->mutable_append()->CopyFrom(request.appends(offset - 1));
+    return;
+  }
+
+  action->set_type(request.type());
+
+  switch (request.type()) {
+    case Action::NOP:
+      CHECK(request.has_nop());
+      action->mutable_nop();
+      break;
+    case Action::APPEND:
+      CHECK(request.has_append());
+      action->mutable_append()->CopyFrom(request.append());
+      break;
+    case Action::TRUNCATE:
+      CHECK(request.has_truncate());
+      action->mutable_truncate()->CopyFrom(request.truncate());
+      break;
+    default:
+      LOG(FATAL) << "Unknown Action::Type!";
+  }
+}
+
+
 void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
 {
   // Ignore write requests if this replica is not in VOTING status; we
@@ -534,68 +597,61 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
     return;
   }
 
-  LOG(INFO) << "Replica received write request for position "
-            << request.position() << " from " << from;
+  if (request.appends_size() == 0) {
+    LOG(INFO) << "Replica received write request for position "
+              << request.position() << " from " << from;
+  } else {
+    LOG(INFO) << "Replica received write request for positions "
+              << request.position() << " to "
+              << request.position() + request.appends_size()
+              << " from " << from;
+  }
 
-  Result<Action> result = read(request.position());
+  // The actions to persist, one for each position of the request. We
+  // only accept the write if we can accept it for all positions.
+  vector<Action> actions;
+
+  for (int offset = 0; offset <= request.appends_size(); offset++) {
+    const uint64_t position = request.position() + offset;
+
+    Result<Action> result = read(position);
+
+    if (result.isError()) {
+      LOG(ERROR) << "Error getting log record at " << position
+                 << ": " << result.error();
+      return;
+    } else if (result.isNone()) {
+      if (request.proposal() < promised()) {
+        WriteResponse response;
+        response.set_type(WriteResponse::REJECT);
+        response.set_okay(false);
+        response.set_proposal(promised());
+        response.set_position(request.position());
+        reply(response);
+        return;
+      }
 
-  if (result.isError()) {
-    LOG(ERROR) << "Error getting log record at " << request.position()
-               << ": " << result.error();
-  } else if (result.isNone()) {
-    if (request.proposal() < promised()) {
-      WriteResponse response;
-      response.set_type(WriteResponse::REJECT);
-      response.set_okay(false);
-      response.set_proposal(promised());
-      response.set_position(request.position());
-      reply(response);
-    } else {
       Action action;
-      action.set_position(request.position());
+      action.set_position(position);
       action.set_promised(promised());
       action.set_performed(request.proposal());
-      if (request.has_learned()) action.set_learned(request.learned());
-      action.set_type(request.type());
-
-      switch (request.type()) {
-        case Action::NOP:
-          CHECK(request.has_nop());
-          action.mutable_nop();
-          break;
-        case Action::APPEND:
-          CHECK(request.has_append());
-          action.mutable_append()->CopyFrom(request.append());
-          break;
-        case Action::TRUNCATE:
-          CHECK(request.has_truncate());
-          action.mutable_truncate()->CopyFrom(request.truncate());
-          break;
-        default:
-          LOG(FATAL) << "Unknown Action::Type!";
-      }
+      propose(request, offset, &action);
 
-      if (persist(action)) {
+      actions.push_back(action);
+    } else {
+      Action action = result.get();
+      CHECK_EQ(action.position(), position);
+
+      if (request.proposal() < action.promised()) {
         WriteResponse response;
-        response.set_type(WriteResponse::ACCEPT);
-        response.set_okay(true);
-        response.set_proposal(request.proposal());
+        response.set_type(WriteResponse::REJECT);
+        response.set_okay(false);
+        response.set_proposal(action.promised());
         response.set_position(request.position());
         reply(response);
+        return;
       }
-    }
-  } else if (result.isSome()) {
-    Action action = result.get();
-    CHECK_EQ(action.position(), request.position());
 
-    if (request.proposal() < action.promised()) {
-      WriteResponse response;
-      response.set_type(WriteResponse::REJECT);
-      response.set_okay(false);
-      response.set_proposal(action.promised());
-      response.set_position(request.position());
-      reply(response);
-    } else {
       if (action.has_learned() && action.learned()) {
         // We ignore the write request if this position has already
         // been learned. Turns out that it is possible a replica
@@ -627,44 +683,32 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
         // R3 and R4 during the explicit promise phase. Therefore, it
         // will try to write an append operation at position 5 to R5
         // while R5 currently have a learned NOP stored at position 5.
-      } else {
-        action.set_performed(request.proposal());
-        action.clear_learned();
-        if (request.has_learned()) action.set_learned(request.learned());
-        action.clear_type();
-        action.clear_nop();
-        action.clear_append();
-        action.clear_truncate();
-        action.set_type(request.type());
-
-        switch (request.type()) {
-          case Action::NOP:
-            CHECK(request.has_nop());
-            action.mutable_nop();
-            break;
-          case Action::APPEND:
-            CHECK(request.has_append());
-            action.mutable_append()->CopyFrom(request.append());
-            break;
-          case Action::TRUNCATE:
-            CHECK(request.has_truncate());
-            action.mutable_truncate()->CopyFrom(request.truncate());
-            break;
-          default:
-            LOG(FATAL) << "Unknown Action::Type!";
-        }
-
-        if (persist(action)) {
-          WriteResponse response;
-          response.set_type(WriteResponse::ACCEPT);
-          response.set_okay(true);
-          response.set_proposal(request.proposal());
-          response.set_position(request.position());
-          reply(response);
-        }
+        //
+        // NOTE: For a group commit we ignore the entire request.
+        return;
       }
+
+      action.set_performed(request.proposal());
+      action.clear_learned();
+      action.clear_type();
+      action.clear_nop();
+      action.clear_append();
+      action.clear_truncate();
+      propose(request, offset, &action);
+
+      actions.push_back(action);
     }
   }
+
+  if (persist(actions)) {
+    WriteResponse response;
+    response.set_type(WriteResponse::ACCEPT);
+    response.set_okay(true);
+    response.set_proposal(request.proposal());
+    response.set_position(request.position());
+    response.set_appends(request.appends_size());
+    reply(response);
+  }
 }
 
 
@@ -686,13 +730,91 @@ void ReplicaProcess::recover(const UPID& from, const RecoverRequest& request)
 }
 
 
-void ReplicaProcess::learned(const UPID& from, const Action& action)
+void ReplicaProcess::catchup(const UPID& from, const CatchUpRequest& request)
 {
-  LOG(INFO) << "Replica received learned notice for position "
-            << action.position() << " from " << from;
+  // Only serve learned actions if this replica is in VOTING status,
+  // otherwise its log might itself be lagging behind. We do not reply
+  // so that the requester picks up the response from another replica.
+  if (status() != Metadata::VOTING) {
+    LOG(INFO) << "Replica ignoring catch-up request from " << from
+              << " as it is in " << status() << " status";
+    return;
+  }
+
+  VLOG(2) << "Replica received catch-up request from " << from
+          << " for positions " << request.from() << " to " << request.to();
+
+  CatchUpResponse response;
+
+  // Truncated positions are skipped as the requester will learn the
+  // truncation from the (learned) truncate action past them.
+  uint64_t position = std::max(request.from(), begin);
+  const uint64_t to = std::min(request.to(), end);
+
+  Bytes size = 0;
+
+  for (; position <= to; position++) {
+    if (size >= MAX_CATCHUP_RESPONSE_SIZE) {
+      break;
+    }
+
+    if (holes.contains(position) || unlearned.contains(position)) {
+      continue;
+    }
 
-  CHECK(action.learned());
-  persist(action);
+    Try<Action> action = storage->read(position);
+
+    if (action.isError()) {
+      LOG(ERROR) << "Failed to read position " << position
+                 << " for catch-up request from " << from
+                 << ": " << action.error();
+      break;
+    }
+
+    CHECK(action.get().learned());
+
+    size += action.get().ByteSize();
+    response.add_actions()->CopyFrom(action.get());
+  }
+
+  // The response covers the positions we looked at. If we did not
+  // stop early, it also covers the positions past our end (which we
+  // know nothing about) as well as the positions before our begin
+  // even if they are past the requested range (they are truncated).
+  response.set_end(
+      position <= to ? position : std::max(position, request.to() + 1));
+
+  reply(response);
+}
+
+
+void ReplicaProcess::learned(const UPID& from, const LearnedMessage& message)
+{
+  if (message.actions_size() == 0) {
+    LOG(INFO) << "Replica received learned notice for position "
+              << message.action().position() << " from " << from;
+
+    CHECK(message.action().learned());
+    persist(message.action());
+    return;
+  }
+
+  LOG(INFO) << "Replica received learned notice for positions "
+            << message.action().position() << " to "
+            << message.actions(message.actions_size() - 1).position()
+            << " from " << from;
+
+  vector<Action> actions = {message.action()};
+  actions.insert(
+      actions.end(),
+      message.actions().begin(),
+      message.actions().end());
+
+  foreach (const Action& action, actions) {
+    CHECK(action.learned());
+  }
+
+  persist(actions);
 }
 
 
@@ -708,6 +830,38 @@ bool ReplicaProcess::persist(const Action& action)
   VLOG(1) << "Persisted action " << action.type()
           << " at position " << action.position();
 
+  this->persisted(action);
+
+  return true;
+}
+
+
+bool ReplicaProcess::persist(const vector<Action>& actions)
+{
+  if (actions.size() == 1) {
+    return persist(actions.front());
+  }
+
+  Try<Nothing> persisted = storage->persist(actions);
+
+  if (persisted.isError()) {
+    LOG(ERROR) << "Error writing to log: " << persisted.error();
+    return false;
+  }
+
+  foreach (const Action& action, actions) {
+    VLOG(1) << "Persisted action " << action.type()
+            << " at position " << action.position();
+
+    this->persisted(action);
+  }
+
+  return true;
+}
+
+
+void ReplicaProcess::persisted(const Action& action)
+{
   // No longer a hole here (if there even was one).
   holes -= action.position();
 
@@ -742,8 +896,6 @@ bool ReplicaProcess::persist(const Action& action)
 
   // And update the end position.
   end = std::max(end, action.position());
-
-  return true;
 }
 
 
@@ -838,6 +990,12 @@ Future<uint64_t> Replica::promised() const
 }
 
 
+Future<Storage::Statistics> Replica::statistics() const
+{
+  return dispatch(process, &ReplicaProcess::statistics);
+}
+
+
 Future<bool> Replica::update(const Metadata::Status& status)
 {
   return dispatch(process, &ReplicaProcess::update, status);
@@ -28,6 +28,8 @@
 
 #include <stout/interval.hpp>
 
+#include "log/storage.hpp"
+
 #include "messages/log.hpp"
 
 namespace mesos {
@@ -40,6 +42,7 @@ namespace protocol {
 extern Protocol<PromiseRequest, PromiseResponse> promise;
 extern Protocol<WriteRequest, WriteResponse> write;
 extern Protocol<RecoverRequest, RecoverResponse> recover;
+extern Protocol<CatchUpRequest, CatchUpResponse> catchup;
 
 } // namespace protocol {
 
@@ -89,6 +92,10 @@ public:
   // Returns the highest implicit promise this replica has given.
   process::Future<uint64_t> promised() const;
 
+  // Returns the statistics of the underlying storage (e.g., its size
+  // on disk and the compactions done in the background).
+  process::Future<Storage::Statistics> statistics() const;
+
   // Updates the status of this replica. Returns true if status was
   // updated successfully, false otherwise. Made "virtual" for
   // mocking in tests.
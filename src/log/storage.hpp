@@ -20,9 +20,15 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
+#include <process/future.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
 #include <stout/interval.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 #include "messages/log.hpp"
@@ -48,12 +54,29 @@ public:
     IntervalSet<uint64_t> unlearned;
   };
 
+  // Statistics about the underlying storage (e.g., for metrics).
+  struct Statistics
+  {
+    Bytes size; // Approximate size of the storage on disk.
+    uint64_t compactions; // Number of compactions since restore.
+    Option<Duration> compaction; // Duration of the last compaction.
+  };
+
   virtual ~Storage() {}
 
   virtual Try<State> restore(const std::string& path) = 0;
   virtual Try<Nothing> persist(const Metadata& metadata) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
+
+  // Persists the specified actions atomically, i.e., either all of
+  // them or none of them are persisted.
+  virtual Try<Nothing> persist(const std::vector<Action>& actions) = 0;
   virtual Try<Action> read(uint64_t position) = 0;
+
+  // Returns the current statistics of the storage. Note that this is
+  // asynchronous as the storage might do some work in the background
+  // (e.g., compactions).
+  virtual process::Future<Statistics> statistics() = 0;
 };
 
 } // namespace log {
@@ -17,9 +17,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <utility>
 
 #include <mesos/log/log.hpp>
 
@@ -44,9 +47,11 @@
 using namespace process;
 
 using std::cout;
+using std::deque;
 using std::endl;
 using std::ifstream;
 using std::ofstream;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -96,6 +101,24 @@ Benchmark::Flags::Flags()
       "initialize",
       "Whether to initialize the log",
       true);
+
+  add(&Flags::group_commit,
+      "group_commit",
+      "Whether to write appends that are issued while another append\n"
+      "is in progress together in a single round",
+      false);
+
+  add(&Flags::window,
+      "window",
+      "Maximum number of appends the writer writes at a time, i.e.,\n"
+      "without waiting for the previous ones to finish",
+      1);
+
+  add(&Flags::concurrency,
+      "concurrency",
+      "Maximum number of appends in progress at any time. Values\n"
+      "greater than --window require --group_commit",
+      1);
 }
 
 
@@ -155,6 +178,19 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     return Error(flags.usage("Missing required option --output"));
   }
 
+  if (flags.window == 0) {
+    return Error(flags.usage("Expecting --window to be positive"));
+  }
+
+  if (flags.concurrency == 0) {
+    return Error(flags.usage("Expecting --concurrency to be positive"));
+  }
+
+  if (flags.concurrency > flags.window && !flags.group_commit) {
+    return Error(flags.usage(
+        "Option --concurrency greater than --window requires --group_commit"));
+  }
+
   // Initialize the log.
   if (flags.initialize) {
     Initialize initialize;
@@ -175,7 +211,7 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
       flags.znode.get());
 
   // Create the log writer.
-  Log::Writer writer(&log);
+  Log::Writer writer(&log, flags.group_commit, flags.window);
 
   Future<Option<Log::Position>> position = writer.start();
 
@@ -223,14 +259,29 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     }
   }
 
+  durations.resize(sizes.size());
+  timestamps.resize(sizes.size());
+
+  // The appends in progress (by index into the trace) and the times
+  // at which the appends were started. Appends complete in order,
+  // hence we always wait for the oldest one.
+  deque<pair<size_t, Future<Option<Log::Position>>>> appending;
+  vector<Time> started(sizes.size());
+
   Stopwatch stopwatch;
   stopwatch.start();
 
-  for (size_t i = 0; i < sizes.size(); i++) {
-    Stopwatch stopwatch;
-    stopwatch.start();
+  for (size_t i = 0; i < sizes.size() || !appending.empty();) {
+    if (i < sizes.size() && appending.size() < flags.concurrency) {
+      started[i] = Clock::now();
+      appending.push_back(std::make_pair(i, writer.append(data[i])));
+      i++;
+      continue;
+    }
 
-    position = writer.append(data[i]);
+    const size_t index = appending.front().first;
+    position = appending.front().second;
+    appending.pop_front();
 
     if (!position.await(Seconds(10))) {
       return Error("Failed to append: timed out");
@@ -243,12 +294,31 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
       return Error("Failed to append: exclusive write promise lost");
     }
 
-    durations.push_back(stopwatch.elapsed());
-    timestamps.push_back(Clock::now());
+    timestamps[index] = Clock::now();
+    durations[index] = timestamps[index] - started[index];
   }
 
+  const Duration elapsed = stopwatch.elapsed();
+
   cout << "Total number of appends: " << sizes.size() << endl;
-  cout << "Total time used: " << stopwatch.elapsed() << endl;
+  cout << "Total time used: " << elapsed << endl;
+
+  if (!sizes.empty()) {
+    vector<Duration> sorted = durations;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Returns the latency below which the given fraction of the
+    // appends completed.
+    auto percentile = [&sorted](double fraction) {
+      size_t rank = static_cast<size_t>(fraction * sorted.size());
+      return sorted[std::min(rank, sorted.size() - 1)];
+    };
+
+    cout << "Appends per second: " << sizes.size() / elapsed.secs() << endl;
+    cout << "Append latency p50: " << percentile(0.5) << endl;
+    cout << "Append latency p99: " << percentile(0.99) << endl;
+    cout << "Append latency max: " << sorted.back() << endl;
+  }
 
   // Ouput statistics.
   ofstream output(flags.output.get().c_str());
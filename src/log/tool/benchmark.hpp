@@ -45,6 +45,9 @@ public:
     Option<std::string> output;
     std::string type;
     bool initialize;
+    bool group_commit;
+    size_t window;
+    size_t concurrency;
     bool help;
   };
 
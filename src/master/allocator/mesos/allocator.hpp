@@ -17,6 +17,8 @@
 #ifndef __MASTER_ALLOCATOR_MESOS_ALLOCATOR_HPP__
 #define __MASTER_ALLOCATOR_MESOS_ALLOCATOR_HPP__
 
+#include <utility>
+
 #include <mesos/allocator/allocator.hpp>
 
 #include <process/dispatch.hpp>
@@ -41,8 +43,10 @@ template <typename AllocatorProcess>
 class MesosAllocator : public mesos::allocator::Allocator
 {
 public:
-  // Factory to allow for typed tests.
-  static Try<mesos::allocator::Allocator*> create();
+  // Factory to allow for typed tests. The arguments are forwarded to
+  // the constructor of `AllocatorProcess`.
+  template <typename... Args>
+  static Try<mesos::allocator::Allocator*> create(Args&&... args);
 
   ~MesosAllocator();
 
@@ -157,7 +161,9 @@ public:
       const std::vector<WeightInfo>& weightInfos);
 
 private:
-  MesosAllocator();
+  template <typename... Args>
+  explicit MesosAllocator(Args&&... args);
+
   MesosAllocator(const MesosAllocator&); // Not copyable.
   MesosAllocator& operator=(const MesosAllocator&); // Not assignable.
 
@@ -290,18 +296,20 @@ public:
 
 
 template <typename AllocatorProcess>
+template <typename... Args>
 Try<mesos::allocator::Allocator*>
-MesosAllocator<AllocatorProcess>::create()
+MesosAllocator<AllocatorProcess>::create(Args&&... args)
 {
   mesos::allocator::Allocator* allocator =
-    new MesosAllocator<AllocatorProcess>();
+    new MesosAllocator<AllocatorProcess>(std::forward<Args>(args)...);
   return CHECK_NOTNULL(allocator);
 }
 
 template <typename AllocatorProcess>
-MesosAllocator<AllocatorProcess>::MesosAllocator()
+template <typename... Args>
+MesosAllocator<AllocatorProcess>::MesosAllocator(Args&&... args)
 {
-  process = new AllocatorProcess();
+  process = new AllocatorProcess(std::forward<Args>(args)...);
   process::spawn(process);
 }
 
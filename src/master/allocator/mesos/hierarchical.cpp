@@ -24,6 +24,8 @@
 #include <mesos/resources.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/async.hpp>
+#include <process/check.hpp>
 #include <process/event.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
@@ -274,6 +276,7 @@ void HierarchicalAllocatorProcess::addFramework(
 
   LOG(INFO) << "Added framework " << frameworkId;
 
+  allocationCandidates = slaves.keys();
   allocate();
 }
 
@@ -306,6 +309,12 @@ void HierarchicalAllocatorProcess::removeFramework(
     }
 
     frameworkSorters[role]->remove(frameworkId.value());
+
+    // The role might not satisfy its quota anymore, in which case it
+    // can be offered resources on any slave.
+    if (quotas.contains(role) && !allocation.empty()) {
+      allocationCandidates = slaves.keys();
+    }
   }
 
   // If this is the last framework that was registered for this role,
@@ -351,6 +360,7 @@ void HierarchicalAllocatorProcess::activateFramework(
 
   LOG(INFO) << "Activated framework " << frameworkId;
 
+  allocationCandidates = slaves.keys();
   allocate();
 }
 
@@ -408,6 +418,9 @@ void HierarchicalAllocatorProcess::updateFramework(
 
   frameworks[frameworkId].shared = protobuf::frameworkHasCapability(
       frameworkInfo, FrameworkInfo::Capability::SHARED_RESOURCES);
+
+  // The framework might be able to accept resources on any slave now.
+  allocationCandidates = slaves.keys();
 }
 
 
@@ -486,6 +499,7 @@ void HierarchicalAllocatorProcess::addSlave(
             << ") with " << slaves[slaveId].total
             << " (allocated: " << slaves[slaveId].allocated << ")";
 
+  allocationCandidates.insert(slaveId);
   allocate(slaveId);
 }
 
@@ -508,6 +522,7 @@ void HierarchicalAllocatorProcess::removeSlave(
   quotaRoleSorter->remove(slaveId, slaves[slaveId].total.nonRevocable());
 
   slaves.erase(slaveId);
+  allocationCandidates.erase(slaveId);
 
   // Note that we DO NOT actually delete any filters associated with
   // this slave, that will occur when the delayed
@@ -557,6 +572,7 @@ void HierarchicalAllocatorProcess::updateSlave(
             << " (total: " << slaves[slaveId].total
             << ", allocated: " << slaves[slaveId].allocated << ")";
 
+  allocationCandidates.insert(slaveId);
   allocate(slaveId);
 }
 
@@ -568,6 +584,7 @@ void HierarchicalAllocatorProcess::activateSlave(
   CHECK(slaves.contains(slaveId));
 
   slaves[slaveId].activated = true;
+  allocationCandidates.insert(slaveId);
 
   LOG(INFO)<< "Agent " << slaveId << " reactivated";
 }
@@ -591,6 +608,7 @@ void HierarchicalAllocatorProcess::updateWhitelist(
   CHECK(initialized);
 
   whitelist = _whitelist;
+  allocationCandidates = slaves.keys();
 
   if (whitelist.isSome()) {
     LOG(INFO) << "Updated agent whitelist: " << stringify(whitelist.get());
@@ -725,6 +743,11 @@ void HierarchicalAllocatorProcess::updateAllocation(
 
     slaves[slaveId].total = updatedTotal.get();
 
+    // Shared resources are offerable even when they are allocated,
+    // hence e.g. creating a shared volume changes what can be offered
+    // on this slave.
+    allocationCandidates.insert(slaveId);
+
     // Update the total and allocated resources in each sorter.
     Resources frameworkAllocation =
       frameworkSorter->allocation(frameworkId.value(), slaveId);
@@ -823,6 +846,8 @@ Future<Nothing> HierarchicalAllocatorProcess::updateAvailable(
   quotaRoleSorter->remove(slaveId, oldTotal.nonRevocable());
   quotaRoleSorter->add(slaveId, updatedTotal.get().nonRevocable());
 
+  allocationCandidates.insert(slaveId);
+
   return Nothing();
 }
 
@@ -855,6 +880,7 @@ void HierarchicalAllocatorProcess::updateUnavailability(
       typename Slave::Maintenance(unavailability.get());
   }
 
+  allocationCandidates.insert(slaveId);
   allocate(slaveId);
 }
 
@@ -1003,6 +1029,10 @@ void HierarchicalAllocatorProcess::recoverResources(
       if (quotas.contains(role)) {
         // See comment at `quotaRoleSorter` declaration regarding non-revocable.
         quotaRoleSorter->unallocated(role, slaveId, resources.nonRevocable());
+
+        // The role might not satisfy its quota anymore, in which case
+        // it can be offered resources on any slave.
+        allocationCandidates = slaves.keys();
       }
     }
   }
@@ -1014,6 +1044,7 @@ void HierarchicalAllocatorProcess::recoverResources(
     CHECK(slaves[slaveId].allocated.contains(resources));
 
     slaves[slaveId].allocated -= resources;
+    allocationCandidates.insert(slaveId);
 
     VLOG(1) << "Recovered " << resources
             << " (total: " << slaves[slaveId].total
@@ -1135,6 +1166,7 @@ void HierarchicalAllocatorProcess::reviveOffers(
 
   LOG(INFO) << "Removed offer filters for framework " << frameworkId;
 
+  allocationCandidates = slaves.keys();
   allocate();
 }
 
@@ -1174,6 +1206,7 @@ void HierarchicalAllocatorProcess::setQuota(
 
   // Trigger the allocation explicitly in order to promptly react to the
   // operator's request.
+  allocationCandidates = slaves.keys();
   allocate();
 }
 
@@ -1199,6 +1232,7 @@ void HierarchicalAllocatorProcess::removeQuota(
 
   // Trigger the allocation explicitly in order to promptly react to the
   // operator's request.
+  allocationCandidates = slaves.keys();
   allocate();
 }
 
@@ -1234,6 +1268,7 @@ void HierarchicalAllocatorProcess::updateWeights(
   // then trigger the allocation explicitly in order to promptly
   // react to the operator's request.
   if (rebalance) {
+    allocationCandidates = slaves.keys();
     allocate();
   }
 }
@@ -1274,16 +1309,27 @@ void HierarchicalAllocatorProcess::allocate()
     return;
   }
 
+  if (allocationCandidates.empty()) {
+    VLOG(1) << "Skipped allocation because no agents changed since the "
+            << "last allocation";
+
+    return;
+  }
+
   Stopwatch stopwatch;
   stopwatch.start();
 
   metrics.allocation_run.start();
 
-  allocate(slaves.keys());
+  // NOTE: We take the candidates since `allocate()` updates them.
+  hashset<SlaveID> candidates;
+  std::swap(candidates, allocationCandidates);
+
+  allocate(candidates);
 
   metrics.allocation_run.stop();
 
-  VLOG(1) << "Performed allocation for " << slaves.size() << " agents in "
+  VLOG(1) << "Performed allocation for " << candidates.size() << " agents in "
             << stopwatch.elapsed();
 }
 
@@ -1311,12 +1357,83 @@ void HierarchicalAllocatorProcess::allocate(
 }
 
 
+HierarchicalAllocatorProcess::Candidate::Candidate(const Slave& slave)
+  : gpus(slave.total.gpus().getOrElse(0) > 0)
+{
+  const Resources available = (slave.total - slave.allocated).nonShared();
+
+  unreserved = available.unreserved();
+  reserved = available.reservations();
+}
+
+
+vector<HierarchicalAllocatorProcess::Candidate>
+HierarchicalAllocatorProcess::computeCandidates(const vector<SlaveID>& slaveIds)
+{
+  vector<Candidate> candidates(slaveIds.size());
+
+  // NOTE: This only reads `slaves`, hence it is safe to compute the
+  // candidates of disjoint ranges of slaves concurrently.
+  auto compute = [this, &slaveIds, &candidates](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      candidates[i] = Candidate(slaves.at(slaveIds[i]));
+    }
+  };
+
+  // Handing a handful of slaves to another thread is not worth it, which
+  // is the common case for the allocations triggered by events.
+  const size_t shards = std::max(
+      std::min(
+          allocationParallelism,
+          slaveIds.size() / minSlavesPerShard),
+      (size_t) 1);
+
+  if (shards == 1) {
+    compute(0, slaveIds.size());
+    return candidates;
+  }
+
+  const size_t shardSize = (slaveIds.size() + shards - 1) / shards;
+
+  // The shards other than the first are computed on libprocess worker
+  // threads (see `process::async`) while the allocator computes the
+  // first one and then waits for the others. The allocator must not
+  // modify any state in the meantime, hence it blocks instead of
+  // deferring the rest of the allocation run.
+  vector<Future<Nothing>> futures;
+  for (size_t shard = 1; shard < shards; shard++) {
+    const size_t begin = std::min(shard * shardSize, slaveIds.size());
+    const size_t end = std::min((shard + 1) * shardSize, slaveIds.size());
+
+    futures.push_back(process::async([&compute, begin, end]() {
+      compute(begin, end);
+    }));
+  }
+
+  compute(0, std::min(shardSize, slaveIds.size()));
+
+  foreach (const Future<Nothing>& future, futures) {
+    future.await();
+    CHECK_READY(future);
+  }
+
+  return candidates;
+}
+
+
 // TODO(alexr): Consider factoring out the quota allocation logic.
 void HierarchicalAllocatorProcess::allocate(
     const hashset<SlaveID>& slaveIds_)
 {
   ++metrics.allocation_runs;
 
+  // The given slaves are considered now; they only remain candidates
+  // for the next allocation run if we cannot allocate all of their
+  // resources for reasons outside of these slaves, see below.
+  foreach (const SlaveID& slaveId, slaveIds_) {
+    allocationCandidates.erase(slaveId);
+  }
+
   // Compute the offerable resources, per framework:
   //   (1) For reserved resources on the slave, allocate these to a
   //       framework having the corresponding role.
@@ -1344,6 +1461,9 @@ void HierarchicalAllocatorProcess::allocate(
   // TODO(vinod): Implement a smarter sorting algorithm.
   std::random_shuffle(slaveIds.begin(), slaveIds.end());
 
+  allocationRunCandidates = slaveIds.size();
+  metrics.allocation_candidates += slaveIds.size();
+
   // Returns the __quantity__ of resources allocated to a quota role. Since we
   // account for reservations and persistent volumes toward quota, we strip
   // reservation and persistent volume related information for comparability.
@@ -1357,20 +1477,17 @@ void HierarchicalAllocatorProcess::allocate(
 
     // NOTE: `allocationScalarQuantities` omits dynamic reservation and
     // persistent volume info, but we additionally strip `role` here.
-    Resources resources;
-
-    foreach (Resource resource,
-             quotaRoleSorter->allocationScalarQuantities(role)) {
-      CHECK(!resource.has_reservation());
-      CHECK(!resource.has_disk());
-
-      resource.set_role("*");
-      resources += resource;
-    }
-
-    return resources;
+    return quotaRoleSorter->allocationScalarQuantities(role).flatten();
   };
 
+  // The quantities of the quota guarantees, so that they can be compared
+  // with the allocated quantities without converting them every time.
+  hashmap<string, ResourceQuantities> quotaGuarantees;
+  foreachpair (const string& role, const Quota& quota, quotas) {
+    quotaGuarantees[role] =
+      ResourceQuantities::fromScalarResources(quota.info.guarantee());
+  }
+
   // Due to the two stages in the allocation algorithm and the nature of
   // shared resources being re-offerable even if already allocated, the
   // same shared resources can appear in two (and not more due to the
@@ -1382,10 +1499,60 @@ void HierarchicalAllocatorProcess::allocate(
   // allocated in the current cycle.
   hashmap<SlaveID, Resources> offeredSharedResources;
 
+  // Calculate the currently available resources on the slaves up front,
+  // which is the difference in non-shared resources between total and
+  // allocated, see `Candidate`. This is the only part of an allocation
+  // run that does not depend on the order in which the slaves are
+  // allocated and hence can be done concurrently.
+  vector<Candidate> candidates = computeCandidates(slaveIds);
+
+  // Returns the resources on the slave that can be offered to the
+  // framework in the given role: the resources reserved for the role
+  // and, if `unreserved` is set, the unreserved resources. This is
+  // necessary to ensure that we don't offer resources that are reserved
+  // for another role.
+  //
+  // Since shared resources are offerable even when they are in use, we
+  // make one copy of the shared resources available regardless of the
+  // past allocations, but only to frameworks that are capable of
+  // receiving them and only if they have not been offered in this
+  // offer cycle to a framework.
+  //
+  // NOTE: Currently, frameworks are allowed to have '*' role. Nothing is
+  // reserved for '*' hence only unreserved resources are offered then.
+  auto available = [this, &offeredSharedResources](
+      const Candidate& candidate,
+      const SlaveID& slaveId,
+      const FrameworkID& frameworkId,
+      const string& role,
+      bool unreserved) {
+    Resources resources = candidate.reserved.get(role).getOrElse(Resources());
+
+    if (unreserved) {
+      resources += candidate.unreserved;
+    }
+
+    if (frameworks[frameworkId].shared) {
+      Resources shared = slaves[slaveId].total.shared();
+      if (offeredSharedResources.contains(slaveId)) {
+        shared -= offeredSharedResources[slaveId];
+      }
+
+      resources += shared.reserved(role);
+      if (unreserved) {
+        resources += shared.unreserved();
+      }
+    }
+
+    return resources;
+  };
+
   // Quota comes first and fair share second. Here we process only those
   // roles, for which quota is set (quota'ed roles). Such roles form a
   // special allocation group with a dedicated sorter.
-  foreach (const SlaveID& slaveId, slaveIds) {
+  for (size_t i = 0; i < slaveIds.size(); i++) {
+    const SlaveID& slaveId = slaveIds[i];
+
     foreach (const string& role, quotaRoleSorter->sort()) {
       CHECK(quotas.contains(role));
 
@@ -1397,7 +1564,8 @@ void HierarchicalAllocatorProcess::allocate(
 
       // Get the total quantity of resources allocated to a quota role. The
       // value omits role, reservation, and persistence info.
-      Resources roleConsumedResources = getQuotaRoleAllocatedResources(role);
+      ResourceQuantities roleConsumedResources =
+        getQuotaRoleAllocatedResources(role);
 
       // If quota for the role is satisfied, we do not need to do any further
       // allocations for this role, at least at this stage.
@@ -1406,7 +1574,7 @@ void HierarchicalAllocatorProcess::allocate(
       // alternatives are:
       //   * A custom sorter that is aware of quotas and sorts accordingly.
       //   * Removing satisfied roles from the sorter.
-      if (roleConsumedResources.contains(quotas[role].info.guarantee())) {
+      if (roleConsumedResources.contains(quotaGuarantees[role])) {
         continue;
       }
 
@@ -1419,36 +1587,12 @@ void HierarchicalAllocatorProcess::allocate(
         // Only offer resources from slaves that have GPUs to
         // frameworks that are capable of receiving GPUs.
         // See MESOS-5634.
-        if (!frameworks[frameworkId].gpuAware &&
-            slaves[slaveId].total.gpus().getOrElse(0) > 0) {
+        if (!frameworks[frameworkId].gpuAware && candidates[i].gpus) {
           continue;
         }
 
-        // Calculate the currently available resources on the slave, which
-        // is the difference in non-shared resources between total and
-        // allocated, plus all shared resources on the agent (if applicable).
-        // Since shared resources are offerable even when they are in use, we
-        // make one copy of the shared resources available regardless of the
-        // past allocations.
-        Resources available =
-          (slaves[slaveId].total - slaves[slaveId].allocated).nonShared();
-
-        // Offer a shared resource only if it has not been offered in
-        // this offer cycle to a framework.
-        if (frameworks[frameworkId].shared) {
-          available += slaves[slaveId].total.shared();
-          if (offeredSharedResources.contains(slaveId)) {
-            available -= offeredSharedResources[slaveId];
-          }
-        }
-
         // The resources we offer are the unreserved resources as well as the
-        // reserved resources for this particular role. This is necessary to
-        // ensure that we don't offer resources that are reserved for another
-        // role.
-        //
-        // NOTE: Currently, frameworks are allowed to have '*' role.
-        // Calling reserved('*') returns an empty Resources object.
+        // reserved resources for this particular role.
         //
         // Quota is satisfied from the available non-revocable resources on the
         // agent. It's important that we include reserved resources here since
@@ -1456,7 +1600,8 @@ void HierarchicalAllocatorProcess::allocate(
         // were to rely on stage 2 to offer them out, they would not be checked
         // against the quota guarantee.
         Resources resources =
-          (available.unreserved() + available.reserved(role)).nonRevocable();
+          available(candidates[i], slaveId, frameworkId, role, true)
+            .nonRevocable();
 
         // It is safe to break here, because all frameworks under a role would
         // consider the same resources, so in case we don't have allocatable
@@ -1488,6 +1633,7 @@ void HierarchicalAllocatorProcess::allocate(
         offeredSharedResources[slaveId] += resources.shared();
 
         slaves[slaveId].allocated += resources;
+        candidates[i] = Candidate(slaves[slaveId]);
 
         // Resources allocated as part of the quota count towards the
         // role's and the framework's fair share.
@@ -1507,27 +1653,29 @@ void HierarchicalAllocatorProcess::allocate(
   // the second stage.
   //
   // For performance reasons (MESOS-4833), this omits information about
-  // dynamic reservations or persistent volumes in the resources.
+  // dynamic reservations or persistent volumes in the resources, see
+  // `ResourceQuantities`.
   //
   // NOTE: We use total cluster resources, and not just those based on the
   // agents participating in the current allocation (i.e. provided as an
   // argument to the `allocate()` call) so that frameworks in roles without
   // quota are not unnecessarily deprived of resources.
-  Resources remainingClusterResources = roleSorter->totalScalarQuantities();
+  ResourceQuantities remainingClusterResources =
+    roleSorter->totalScalarQuantities();
   foreachkey (const string& role, activeRoles) {
     remainingClusterResources -= roleSorter->allocationScalarQuantities(role);
   }
 
   // Frameworks in a quota'ed role may temporarily reject resources by
   // filtering or suppressing offers. Hence quotas may not be fully allocated.
-  Resources unallocatedQuotaResources;
-  foreachpair (const string& name, const Quota& quota, quotas) {
+  ResourceQuantities unallocatedQuotaResources;
+  foreachkey (const string& name, quotas) {
     // Compute the amount of quota that the role does not have allocated.
     //
     // NOTE: Revocable resources are excluded in `quotaRoleSorter`.
     // NOTE: Only scalars are considered for quota.
-    Resources allocated = getQuotaRoleAllocatedResources(name);
-    const Resources required = quota.info.guarantee();
+    ResourceQuantities allocated = getQuotaRoleAllocatedResources(name);
+    const ResourceQuantities& required = quotaGuarantees[name];
     unallocatedQuotaResources += (required - allocated);
   }
 
@@ -1537,9 +1685,10 @@ void HierarchicalAllocatorProcess::allocate(
   // `remainingClusterResources`.
   remainingClusterResources -= unallocatedQuotaResources;
 
-  // Shared resources are excluded in determination of over-allocation of
-  // available resources since shared resources are always allocatable.
-  remainingClusterResources = remainingClusterResources.nonShared();
+  // NOTE: Shared resources are excluded in determination of over-allocation
+  // of available resources since shared resources are always allocatable.
+  // As the quantities do not track sharedness, this is done by only adding
+  // non-shared resources to `allocatedStage2` below.
 
   // To ensure we do not over-allocate resources during the second stage
   // with all frameworks, we use 2 stopping criteria:
@@ -1554,14 +1703,20 @@ void HierarchicalAllocatorProcess::allocate(
   // information about dynamic reservations and persistent volumes for
   // performance reasons. This invariant is preserved because we only add
   // resources to it that have also had this metadata stripped from them
-  // (typically by using `Resources::createStrippedScalarQuantity`).
-  Resources allocatedStage2;
+  // (by using `ResourceQuantities`).
+  ResourceQuantities allocatedStage2;
 
   // At this point resources for quotas are allocated or accounted for.
   // Proceed with allocating the remaining free pool.
-  foreach (const SlaveID& slaveId, slaveIds) {
+  for (size_t i = 0; i < slaveIds.size(); i++) {
+    const SlaveID& slaveId = slaveIds[i];
+
     // If there are no resources available for the second stage, stop.
+    //
+    // NOTE: The remaining slaves have to be considered again once
+    // resources become available for the second stage.
     if (!allocatable(remainingClusterResources - allocatedStage2)) {
+      allocationCandidates.insert(slaveIds.begin() + i, slaveIds.end());
       break;
     }
 
@@ -1575,36 +1730,12 @@ void HierarchicalAllocatorProcess::allocate(
         // Only offer resources from slaves that have GPUs to
         // frameworks that are capable of receiving GPUs.
         // See MESOS-5634.
-        if (!frameworks[frameworkId].gpuAware &&
-            slaves[slaveId].total.gpus().getOrElse(0) > 0) {
+        if (!frameworks[frameworkId].gpuAware && candidates[i].gpus) {
           continue;
         }
 
-        // Calculate the currently available resources on the slave, which
-        // is the difference in non-shared resources between total and
-        // allocated, plus all shared resources on the agent (if applicable).
-        // Since shared resources are offerable even when they are in use, we
-        // make one copy of the shared resources available regardless of the
-        // past allocations.
-        Resources available =
-          (slaves[slaveId].total - slaves[slaveId].allocated).nonShared();
-
-        // Offer a shared resource only if it has not been offered in
-        // this offer cycle to a framework.
-        if (frameworks[frameworkId].shared) {
-          available += slaves[slaveId].total.shared();
-          if (offeredSharedResources.contains(slaveId)) {
-            available -= offeredSharedResources[slaveId];
-          }
-        }
-
         // The resources we offer are the unreserved resources as well as the
-        // reserved resources for this particular role. This is necessary to
-        // ensure that we don't offer resources that are reserved for another
-        // role.
-        //
-        // NOTE: Currently, frameworks are allowed to have '*' role.
-        // Calling reserved('*') returns an empty Resources object.
+        // reserved resources for this particular role.
         //
         // NOTE: We do not offer roles with quota any more non-revocable
         // resources once their quota is satisfied. However, note that this is
@@ -1612,10 +1743,8 @@ void HierarchicalAllocatorProcess::allocate(
         // allocation algorithm in stage 1.
         //
         // TODO(mpark): Offer unreserved resources as revocable beyond quota.
-        Resources resources = available.reserved(role);
-        if (!quotas.contains(role)) {
-          resources += available.unreserved();
-        }
+        Resources resources = available(
+            candidates[i], slaveId, frameworkId, role, !quotas.contains(role));
 
         // It is safe to break here, because all frameworks under a role would
         // consider the same resources, so in case we don't have allocatable
@@ -1655,11 +1784,12 @@ void HierarchicalAllocatorProcess::allocate(
         //
         // We exclude shared resources from over-allocation check because
         // shared resources are always allocatable.
-        const Resources scalarQuantity =
-          resources.nonShared().createStrippedScalarQuantity();
+        const ResourceQuantities scalarQuantity =
+          ResourceQuantities::fromScalarResources(resources.nonShared());
 
         if (!remainingClusterResources.contains(
                 allocatedStage2 + scalarQuantity)) {
+          allocationCandidates.insert(slaveId);
           continue;
         }
 
@@ -1676,6 +1806,7 @@ void HierarchicalAllocatorProcess::allocate(
         allocatedStage2 += scalarQuantity;
 
         slaves[slaveId].allocated += resources;
+        candidates[i] = Candidate(slaves[slaveId]);
 
         frameworkSorters[role]->add(slaveId, resources);
         frameworkSorters[role]->allocated(frameworkId_, slaveId, resources);
@@ -1703,6 +1834,17 @@ void HierarchicalAllocatorProcess::allocate(
   // allocator. We leverage the existing timer/cycle of offers to also do any
   // "deallocation" (inverse offers) necessary to satisfy maintenance needs.
   deallocate(slaveIds_);
+
+  // Slaves scheduled for maintenance are considered in every allocation
+  // run since whether inverse offers are filtered depends on time. The
+  // same goes for slaves with shared resources since these can be
+  // offered again in every allocation run.
+  foreach (const SlaveID& slaveId, slaveIds_) {
+    if (slaves[slaveId].maintenance.isSome() ||
+        !slaves[slaveId].total.shared().empty()) {
+      allocationCandidates.insert(slaveId);
+    }
+  }
 }
 
 
@@ -1813,6 +1955,10 @@ void HierarchicalAllocatorProcess::expire(
     if (frameworks[frameworkId].offerFilters[slaveId].empty()) {
       frameworks[frameworkId].offerFilters.erase(slaveId);
     }
+
+    if (slaves.contains(slaveId)) {
+      allocationCandidates.insert(slaveId);
+    }
   }
 
   delete offerFilter;
@@ -1839,6 +1985,10 @@ void HierarchicalAllocatorProcess::expire(
     if(frameworks[frameworkId].inverseOfferFilters[slaveId].empty()) {
       frameworks[frameworkId].inverseOfferFilters.erase(slaveId);
     }
+
+    if (slaves.contains(slaveId)) {
+      allocationCandidates.insert(slaveId);
+    }
   }
 
   delete inverseOfferFilter;
@@ -1925,6 +2075,16 @@ bool HierarchicalAllocatorProcess::allocatable(
 }
 
 
+bool HierarchicalAllocatorProcess::allocatable(
+    const ResourceQuantities& quantities)
+{
+  double cpus = quantities.get("cpus").value();
+  Bytes mem = Megabytes(static_cast<uint64_t>(quantities.get("mem").value()));
+
+  return cpus >= MIN_CPUS || mem >= MIN_MEM;
+}
+
+
 double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
     const string& resource)
 {
@@ -1946,11 +2106,7 @@ double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
 double HierarchicalAllocatorProcess::_resources_total(
     const string& resource)
 {
-  Option<Value::Scalar> total =
-    roleSorter->totalScalarQuantities()
-      .get<Value::Scalar>(resource);
-
-  return total.isSome() ? total->value() : 0;
+  return roleSorter->totalScalarQuantities().get(resource).value();
 }
 
 
@@ -1958,11 +2114,8 @@ double HierarchicalAllocatorProcess::_quota_allocated(
     const string& role,
     const string& resource)
 {
-  Option<Value::Scalar> used =
-    quotaRoleSorter->allocationScalarQuantities(role)
-      .get<Value::Scalar>(resource);
-
-  return used.isSome() ? used->value() : 0;
+  return quotaRoleSorter->allocationScalarQuantities(role)
+    .get(resource).value();
 }
 
 
@@ -17,8 +17,10 @@
 #ifndef __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 #define __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 
+#include <algorithm>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -32,6 +34,8 @@
 #include <stout/lambda.hpp>
 #include <stout/option.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/allocator/mesos/allocator.hpp"
 #include "master/allocator/mesos/metrics.hpp"
 
@@ -74,10 +78,15 @@ public:
   HierarchicalAllocatorProcess(
       const std::function<Sorter*()>& roleSorterFactory,
       const std::function<Sorter*()>& _frameworkSorterFactory,
-      const std::function<Sorter*()>& quotaRoleSorterFactory)
+      const std::function<Sorter*()>& quotaRoleSorterFactory,
+      size_t _allocationParallelism,
+      size_t _minSlavesPerShard)
     : initialized(false),
       paused(true),
       metrics(*this),
+      allocationRunCandidates(0),
+      allocationParallelism(std::max(_allocationParallelism, (size_t) 1)),
+      minSlavesPerShard(std::max(_minSlavesPerShard, (size_t) 1)),
       roleSorter(roleSorterFactory()),
       quotaRoleSorter(quotaRoleSorterFactory()),
       frameworkSorterFactory(_frameworkSorterFactory) {}
@@ -255,6 +264,7 @@ protected:
       const SlaveID& slaveID);
 
   bool allocatable(const Resources& resources);
+  bool allocatable(const ResourceQuantities& quantities);
 
   bool initialized;
   bool paused;
@@ -315,6 +325,11 @@ protected:
   double _offer_filters_active(
       const std::string& role);
 
+  double _allocation_run_candidates()
+  {
+    return static_cast<double>(allocationRunCandidates);
+  }
+
   hashmap<FrameworkID, Framework> frameworks;
 
   struct Slave
@@ -386,6 +401,46 @@ protected:
 
   hashmap<SlaveID, Slave> slaves;
 
+  // Slaves that need to be considered by the next allocation run since
+  // something that affects what can be offered on them changed after
+  // they were last considered. Batch allocations only consider these
+  // slaves so that an allocation run in an idle cluster is cheap.
+  //
+  // NOTE: Changes that can affect all slaves (e.g., adding a framework
+  // or updating quota) mark all slaves.
+  hashset<SlaveID> allocationCandidates;
+
+  // Number of slaves considered by the latest allocation run.
+  size_t allocationRunCandidates;
+
+  // The resources on a slave that can be allocated during an allocation
+  // run, split up the way the allocation stages consume them. This is
+  // computed for all candidate slaves at the start of `allocate()`, in
+  // parallel if `allocationParallelism` is greater than 1, and then
+  // recomputed for a slave after each allocation on it.
+  //
+  // NOTE: Shared resources are not included since whether they can be
+  // offered depends on the framework, see `allocate()`.
+  struct Candidate
+  {
+    Candidate() : gpus(false) {}
+
+    explicit Candidate(const Slave& slave);
+
+    // The unreserved portion of `(total - allocated).nonShared()`.
+    Resources unreserved;
+
+    // The reserved portion of `(total - allocated).nonShared()`, by role.
+    hashmap<std::string, Resources> reserved;
+
+    // Whether the slave has GPUs, see MESOS-5634.
+    bool gpus;
+  };
+
+  // Computes the candidates for the given slaves, see `Candidate`.
+  std::vector<Candidate> computeCandidates(
+      const std::vector<SlaveID>& slaveIds);
+
   // Number of registered frameworks for each role. When a role's active
   // count drops to zero, it is removed from this map; the role is also
   // removed from `roleSorter` and its `frameworkSorter` is deleted.
@@ -410,6 +465,14 @@ protected:
   // Resources (by name) that will be excluded from a role's fair share.
   Option<std::set<std::string>> fairnessExcludeResourceNames;
 
+  // Number of shards the candidates in `allocate()` are computed in,
+  // each on its own libprocess worker thread.
+  const size_t allocationParallelism;
+
+  // Minimum number of slaves in each of these shards. Fewer shards are
+  // used for allocation runs with fewer candidates.
+  const size_t minSlavesPerShard;
+
   // There are two stages of allocation. During the first stage resources
   // are allocated only to frameworks in roles with quota set. During the
   // second stage remaining resources that would not be required to satisfy
@@ -488,14 +551,21 @@ class HierarchicalAllocatorProcess
   : public internal::HierarchicalAllocatorProcess
 {
 public:
-  HierarchicalAllocatorProcess()
+  // The resources available on the candidate slaves of an allocation
+  // run are computed in `allocationParallelism` shards, but only if
+  // each of them gets at least `minSlavesPerShard` slaves.
+  explicit HierarchicalAllocatorProcess(
+      size_t allocationParallelism = 1,
+      size_t minSlavesPerShard = 256)
     : ProcessBase(process::ID::generate("hierarchical-allocator")),
       internal::HierarchicalAllocatorProcess(
           [this]() -> Sorter* {
             return new RoleSorter(this->self(), "allocator/mesos/roles/");
           },
           []() -> Sorter* { return new FrameworkSorter(); },
-          []() -> Sorter* { return new QuotaRoleSorter(); }) {}
+          []() -> Sorter* { return new QuotaRoleSorter(); },
+          allocationParallelism,
+          minSlavesPerShard) {}
 };
 
 } // namespace allocator {
@@ -45,12 +45,20 @@ Metrics::Metrics(const HierarchicalAllocatorProcess& _allocator)
         process::defer(
             allocator, &HierarchicalAllocatorProcess::_event_queue_dispatches)),
     allocation_runs("allocator/mesos/allocation_runs"),
-    allocation_run("allocator/mesos/allocation_run", Hours(1))
+    allocation_run("allocator/mesos/allocation_run", Hours(1)),
+    allocation_candidates("allocator/mesos/allocation_candidates"),
+    allocation_run_candidates(
+        "allocator/mesos/allocation_run_candidates",
+        process::defer(
+            allocator,
+            &HierarchicalAllocatorProcess::_allocation_run_candidates))
 {
   process::metrics::add(event_queue_dispatches);
   process::metrics::add(event_queue_dispatches_);
   process::metrics::add(allocation_runs);
   process::metrics::add(allocation_run);
+  process::metrics::add(allocation_candidates);
+  process::metrics::add(allocation_run_candidates);
 
   // Create and install gauges for the total and allocated
   // amount of standard scalar resources.
@@ -89,6 +97,8 @@ Metrics::~Metrics()
   process::metrics::remove(event_queue_dispatches_);
   process::metrics::remove(allocation_runs);
   process::metrics::remove(allocation_run);
+  process::metrics::remove(allocation_candidates);
+  process::metrics::remove(allocation_run_candidates);
 
   foreach (const Gauge& gauge, resources_total) {
     process::metrics::remove(gauge);
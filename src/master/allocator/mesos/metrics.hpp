@@ -67,6 +67,11 @@ struct Metrics
   // Latency of the allocation algorithm.
   process::metrics::Timer<Milliseconds> allocation_run;
 
+  // Number of agents considered by the allocation algorithm, in total
+  // and in the latest run.
+  process::metrics::Counter allocation_candidates;
+  process::metrics::Gauge allocation_run_candidates;
+
   // Gauges for the total amount of each resource in the cluster.
   std::vector<process::metrics::Gauge> resources_total;
 
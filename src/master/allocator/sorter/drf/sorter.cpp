@@ -14,9 +14,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <algorithm>
+#include <iterator>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <mesos/mesos.hpp>
@@ -27,12 +28,14 @@
 
 #include <stout/check.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
 #include <stout/option.hpp>
 
 #include "logging/logging.hpp"
 
 #include "master/allocator/sorter/drf/sorter.hpp"
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -73,12 +76,12 @@ void DRFSorter::add(const string& name, double weight)
 {
   CHECK(!contains(name));
 
-  Client client(name, 0, 0);
-  clients.insert(client);
-
   allocations[name] = Allocation();
   weights[name] = weight;
 
+  Client client(name, 0, 0);
+  insert(client);
+
   if (metrics.isSome()) {
     metrics->add(name);
   }
@@ -90,12 +93,7 @@ void DRFSorter::update(const string& name, double weight)
   CHECK(weights.contains(name));
   weights[name] = weight;
 
-  // If the total resources have changed, we're going to
-  // recalculate all the shares, so don't bother just
-  // updating this client.
-  if (!dirty) {
-    update(name);
-  }
+  update(name);
 }
 
 
@@ -104,7 +102,7 @@ void DRFSorter::remove(const string& name)
   set<Client, DRFComparator>::iterator it = find(name);
 
   if (it != clients.end()) {
-    clients.erase(it);
+    erase(it);
   }
 
   allocations.erase(name);
@@ -122,8 +120,10 @@ void DRFSorter::activate(const string& name)
 
   set<Client, DRFComparator>::iterator it = find(name);
   if (it == clients.end()) {
-    Client client(name, calculateShare(name), 0);
-    clients.insert(client);
+    Client client(name, 0, 0);
+    insert(client);
+
+    update(name);
   }
 }
 
@@ -137,7 +137,7 @@ void DRFSorter::deactivate(const string& name)
     // because we lose information such as the number of allocations
     // for this client which means the fairness can be gamed by a
     // framework disconnecting and reconnecting.
-    clients.erase(it);
+    erase(it);
   }
 }
 
@@ -157,8 +157,8 @@ void DRFSorter::allocated(
     client.allocations++;
 
     // Remove and reinsert it to update the ordering appropriately.
-    clients.erase(it);
-    clients.insert(client);
+    erase(it);
+    insert(client);
   }
 
   // Add shared resources to the allocated quantities when the same
@@ -168,22 +168,17 @@ void DRFSorter::allocated(
       return !allocations[name].resources[slaveId].contains(resource);
     });
 
-  const Resources scalarQuantities =
-    (resources.nonShared() + newShared).createStrippedScalarQuantity();
+  const ResourceQuantities scalarQuantities =
+    ResourceQuantities::fromScalarResources(resources.nonShared() + newShared);
 
   allocations[name].resources[slaveId] += resources;
   allocations[name].scalarQuantities += scalarQuantities;
 
-  foreach (const Resource& resource, scalarQuantities) {
-    allocations[name].totals[resource.name()] += resource.scalar();
+  foreach (const ResourceQuantities::Quantity& quantity, scalarQuantities) {
+    allocations[name].totals[quantity.name()] += quantity.scalar();
   }
 
-  // If the total resources have changed, we're going to
-  // recalculate all the shares, so don't bother just
-  // updating this client.
-  if (!dirty) {
-    update(name);
-  }
+  update(name);
 }
 
 
@@ -200,10 +195,10 @@ void DRFSorter::update(
   // Otherwise, we need to ensure we re-calculate the shares, as
   // is being currently done, for safety.
 
-  const Resources oldAllocationQuantity =
-    oldAllocation.createStrippedScalarQuantity();
-  const Resources newAllocationQuantity =
-    newAllocation.createStrippedScalarQuantity();
+  const ResourceQuantities oldAllocationQuantity =
+    ResourceQuantities::fromScalarResources(oldAllocation);
+  const ResourceQuantities newAllocationQuantity =
+    ResourceQuantities::fromScalarResources(newAllocation);
 
   CHECK(allocations[name].resources[slaveId].contains(oldAllocation));
   CHECK(allocations[name].scalarQuantities.contains(oldAllocationQuantity));
@@ -214,16 +209,19 @@ void DRFSorter::update(
   allocations[name].scalarQuantities -= oldAllocationQuantity;
   allocations[name].scalarQuantities += newAllocationQuantity;
 
-  foreach (const Resource& resource, oldAllocationQuantity) {
-    allocations[name].totals[resource.name()] -= resource.scalar();
+  foreach (const ResourceQuantities::Quantity& quantity,
+           oldAllocationQuantity) {
+    allocations[name].totals[quantity.name()] -= quantity.scalar();
   }
 
-  foreach (const Resource& resource, newAllocationQuantity) {
-    allocations[name].totals[resource.name()] += resource.scalar();
+  foreach (const ResourceQuantities::Quantity& quantity,
+           newAllocationQuantity) {
+    allocations[name].totals[quantity.name()] += quantity.scalar();
   }
 
-  // Just assume the total has changed, per the TODO above.
-  dirty = true;
+  // The total resources are not affected by updating an allocation,
+  // so only the share of this client can have changed.
+  update(name);
 }
 
 
@@ -235,7 +233,8 @@ const hashmap<SlaveID, Resources>& DRFSorter::allocation(const string& name)
 }
 
 
-const Resources& DRFSorter::allocationScalarQuantities(const string& name)
+const ResourceQuantities& DRFSorter::allocationScalarQuantities(
+    const string& name)
 {
   CHECK(contains(name));
 
@@ -275,7 +274,7 @@ Resources DRFSorter::allocation(const string& name, const SlaveID& slaveId)
 }
 
 
-const Resources& DRFSorter::totalScalarQuantities() const
+const ResourceQuantities& DRFSorter::totalScalarQuantities() const
 {
   return total_.scalarQuantities;
 }
@@ -298,11 +297,12 @@ void DRFSorter::unallocated(
       return !allocations[name].resources[slaveId].contains(resource);
     });
 
-  const Resources scalarQuantities =
-    (resources.nonShared() + absentShared).createStrippedScalarQuantity();
+  const ResourceQuantities scalarQuantities =
+    ResourceQuantities::fromScalarResources(
+        resources.nonShared() + absentShared);
 
-  foreach (const Resource& resource, scalarQuantities) {
-    allocations[name].totals[resource.name()] -= resource.scalar();
+  foreach (const ResourceQuantities::Quantity& quantity, scalarQuantities) {
+    allocations[name].totals[quantity.name()] -= quantity.scalar();
   }
 
   CHECK(allocations[name].scalarQuantities.contains(scalarQuantities));
@@ -312,9 +312,7 @@ void DRFSorter::unallocated(
     allocations[name].resources.erase(slaveId);
   }
 
-  if (!dirty) {
-    update(name);
-  }
+  update(name);
 }
 
 
@@ -330,20 +328,25 @@ void DRFSorter::add(const SlaveID& slaveId, const Resources& resources)
 
     total_.resources[slaveId] += resources;
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + newShared).createStrippedScalarQuantity();
+    const ResourceQuantities scalarQuantities =
+      ResourceQuantities::fromScalarResources(
+          resources.nonShared() + newShared);
 
     total_.scalarQuantities += scalarQuantities;
 
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] += resource.scalar();
+    foreach (const ResourceQuantities::Quantity& quantity, scalarQuantities) {
+      if (!previousTotals.contains(quantity.name())) {
+        previousTotals[quantity.name()] =
+          total_.totals[quantity.name()].value();
+      }
+
+      total_.totals[quantity.name()] += quantity.scalar();
     }
 
-    // We have to recalculate all shares when the total resources
+    // We have to update the affected shares when the total resources
     // change, but we put it off until sort is called so that if
     // something else changes before the next allocation we don't
-    // recalculate everything twice.
-    dirty = true;
+    // update the same shares twice.
   }
 }
 
@@ -363,11 +366,17 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
         return !total_.resources[slaveId].contains(resource);
       });
 
-    const Resources scalarQuantities =
-      (resources.nonShared() + absentShared).createStrippedScalarQuantity();
+    const ResourceQuantities scalarQuantities =
+      ResourceQuantities::fromScalarResources(
+          resources.nonShared() + absentShared);
+
+    foreach (const ResourceQuantities::Quantity& quantity, scalarQuantities) {
+      if (!previousTotals.contains(quantity.name())) {
+        previousTotals[quantity.name()] =
+          total_.totals[quantity.name()].value();
+      }
 
-    foreach (const Resource& resource, scalarQuantities) {
-      total_.totals[resource.name()] -= resource.scalar();
+      total_.totals[quantity.name()] -= quantity.scalar();
     }
 
     CHECK(total_.scalarQuantities.contains(scalarQuantities));
@@ -376,32 +385,104 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
     if (total_.resources[slaveId].empty()) {
       total_.resources.erase(slaveId);
     }
-
-    dirty = true;
   }
 }
 
 
 vector<string> DRFSorter::sort()
 {
-  if (dirty) {
-    set<Client, DRFComparator> temp;
+  if (!previousTotals.empty()) {
+    // Resources whose total grew (or dropped to zero), which can only
+    // shrink the share of the clients dominated by them.
+    hashset<string> grown;
+
+    // Resources whose total shrunk (or became non-zero), which can
+    // only grow the share of the clients holding them.
+    hashmap<string, double> shrunk;
+
+    foreachpair (const string& resourceName,
+                 double previous,
+                 previousTotals) {
+      if (excluded(resourceName)) {
+        continue;
+      }
+
+      const double current = total_.totals.contains(resourceName)
+        ? total_.totals.at(resourceName).value()
+        : 0.0;
+
+      if (current <= 0.0 || (previous > 0.0 && current > previous)) {
+        grown.insert(resourceName);
+      } else if (current != previous) {
+        shrunk[resourceName] = current;
+      }
+    }
+
+    previousTotals.clear();
+
+    // Clients whose share grew, in ascending order, and clients that
+    // no longer fit in their current position, along with their new
+    // share.
+    vector<pair<set<Client, DRFComparator>::iterator, Client>> grew;
+    vector<pair<set<Client, DRFComparator>::iterator, Client>> moved;
 
     set<Client, DRFComparator>::iterator it;
     for (it = clients.begin(); it != clients.end(); it++) {
-      Client client(*it);
+      Allocation& allocation = allocations.at(it->name);
 
-      // Update the 'share' to get proper sorting.
-      client.share = calculateShare(client.name);
+      Client client(*it);
 
-      temp.insert(client);
+      if (allocation.outdated ||
+          (client.dominant.isSome() &&
+           grown.contains(client.dominant.get()))) {
+        const pair<double, Option<string>> share =
+          calculateDominantShare(client.name);
+
+        client.share = share.first;
+        client.dominant = share.second;
+      } else {
+        // The current share is still valid for all the resources
+        // whose total did not shrink, so the new share is the largest
+        // of the current share and the shares of the shrunk resources.
+        foreachpair (const string& resourceName, double total, shrunk) {
+          if (allocation.totals.contains(resourceName)) {
+            const double share =
+              allocation.totals.at(resourceName).value() / total /
+              weights.at(client.name);
+
+            if (share > client.share) {
+              client.share = share;
+              client.dominant = resourceName;
+            }
+          }
+        }
+      }
+
+      allocation.outdated = false;
+
+      if (client.share > it->share) {
+        grew.push_back(std::make_pair(it, client));
+      } else if (client.share < it->share || client.dominant != it->dominant) {
+        if (!updateInPlace(it, client)) {
+          moved.push_back(std::make_pair(it, client));
+        }
+      }
     }
 
-    clients = temp;
+    // Go through the clients whose share grew in descending order, so
+    // that when the shares of a range of clients all grow by the same
+    // factor (e.g., because they are dominated by the same resource)
+    // they can all be updated in place.
+    for (size_t i = grew.size(); i > 0; i--) {
+      if (!updateInPlace(grew[i - 1].first, grew[i - 1].second)) {
+        moved.push_back(grew[i - 1]);
+      }
+    }
 
-    // Reset dirty to false so as not to re-calculate *all*
-    // shares unless another dirtying operation occurs.
-    dirty = false;
+    for (size_t i = 0; i < moved.size(); i++) {
+      erase(moved[i].first);
+      insert(moved[i].second);
+    }
   }
 
   vector<string> result;
@@ -430,26 +511,53 @@ int DRFSorter::count()
 
 void DRFSorter::update(const string& name)
 {
+  // If the total resources have changed, the share would have to be
+  // calculated relative to totals that sort() has not accounted for
+  // yet, so we leave it to sort() to recalculate it.
+  if (!previousTotals.empty()) {
+    allocations.at(name).outdated = true;
+    return;
+  }
+
   set<Client, DRFComparator>::iterator it = find(name);
 
   if (it != clients.end()) {
     Client client(*it);
 
     // Update the 'share' to get proper sorting.
-    client.share = calculateShare(client.name);
+    const pair<double, Option<string>> share =
+      calculateDominantShare(client.name);
+
+    client.share = share.first;
+    client.dominant = share.second;
 
     // Remove and reinsert it to update the ordering appropriately.
-    clients.erase(it);
-    clients.insert(client);
+    erase(it);
+    insert(client);
   }
 }
 
 
+bool DRFSorter::excluded(const string& resourceName) const
+{
+  return fairnessExcludeResourceNames.isSome() &&
+         fairnessExcludeResourceNames->count(resourceName) > 0;
+}
+
+
 double DRFSorter::calculateShare(const string& name) const
+{
+  return calculateDominantShare(name).first;
+}
+
+
+pair<double, Option<string>> DRFSorter::calculateDominantShare(
+    const string& name) const
 {
   CHECK(contains(name));
 
   double share = 0.0;
+  Option<string> dominant = None();
 
   // TODO(benh): This implementation of "dominant resource fairness"
   // currently does not take into account resources that are not
@@ -459,8 +567,7 @@ double DRFSorter::calculateShare(const string& name) const
                const Value::Scalar& scalar,
                total_.totals) {
     // Filter out the resources excluded from fair sharing.
-    if (fairnessExcludeResourceNames.isSome() &&
-        fairnessExcludeResourceNames->count(resourceName) > 0) {
+    if (excluded(resourceName)) {
       continue;
     }
 
@@ -469,24 +576,66 @@ double DRFSorter::calculateShare(const string& name) const
       const double allocation =
         allocations.at(name).totals.at(resourceName).value();
 
-      share = std::max(share, allocation / scalar.value());
+      if (allocation / scalar.value() > share) {
+        share = allocation / scalar.value();
+        dominant = resourceName;
+      }
     }
   }
 
-  return share / weights.at(name);
+  return std::make_pair(share / weights.at(name), dominant);
 }
 
 
 set<Client, DRFComparator>::iterator DRFSorter::find(const string& name)
 {
-  set<Client, DRFComparator>::iterator it;
-  for (it = clients.begin(); it != clients.end(); it++) {
-    if (name == (*it).name) {
-      break;
-    }
+  if (!allocations.contains(name) ||
+      allocations.at(name).position.isNone()) {
+    return clients.end();
+  }
+
+  return allocations.at(name).position.get();
+}
+
+
+void DRFSorter::insert(const Client& client)
+{
+  CHECK(allocations.contains(client.name));
+
+  allocations.at(client.name).position = clients.insert(client).first;
+}
+
+
+bool DRFSorter::updateInPlace(
+    set<Client, DRFComparator>::iterator it,
+    const Client& client)
+{
+  DRFComparator compare;
+
+  if (it != clients.begin() && !compare(*std::prev(it), client)) {
+    return false;
+  }
+
+  if (std::next(it) != clients.end() && !compare(client, *std::next(it))) {
+    return false;
   }
 
-  return it;
+  // NOTE: It is safe to update the client in place (even though the
+  // elements of a set are const) because it is still ordered with
+  // respect to its neighbours.
+  const_cast<Client&>(*it).share = client.share;
+  const_cast<Client&>(*it).dominant = client.dominant;
+
+  return true;
+}
+
+
+void DRFSorter::erase(set<Client, DRFComparator>::iterator it)
+{
+  CHECK(allocations.contains(it->name));
+
+  allocations.at(it->name).position = None();
+  clients.erase(it);
 }
 
 } // namespace allocator {
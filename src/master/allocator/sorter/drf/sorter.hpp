@@ -19,6 +19,7 @@
 
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <mesos/mesos.hpp>
@@ -28,6 +29,8 @@
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/allocator/sorter/drf/metrics.hpp"
 
 #include "master/allocator/sorter/sorter.hpp"
@@ -46,6 +49,12 @@ struct Client
   std::string name;
   double share;
 
+  // The resource that determines the (dominant) share of this client,
+  // if the client has a non-zero share. This lets the sorter tell
+  // which shares can be affected by a change of the total resources,
+  // see 'DRFSorter::sort()'.
+  Option<std::string> dominant;
+
   // We store the number of times this client has been chosen for
   // allocation so that we can fairly share the resources across
   // clients that have the same share. Note that this information is
@@ -107,13 +116,14 @@ public:
   virtual const hashmap<SlaveID, Resources>& allocation(
       const std::string& name);
 
-  virtual const Resources& allocationScalarQuantities(const std::string& name);
+  virtual const ResourceQuantities& allocationScalarQuantities(
+      const std::string& name);
 
   virtual hashmap<std::string, Resources> allocation(const SlaveID& slaveId);
 
   virtual Resources allocation(const std::string& name, const SlaveID& slaveId);
 
-  virtual const Resources& totalScalarQuantities() const;
+  virtual const ResourceQuantities& totalScalarQuantities() const;
 
   virtual void add(const SlaveID& slaveId, const Resources& resources);
 
@@ -133,6 +143,14 @@ private:
   // Returns the dominant resource share for the client.
   double calculateShare(const std::string& name) const;
 
+  // Returns the dominant resource share for the client along with
+  // the resource that determines it (if the share is non-zero).
+  std::pair<double, Option<std::string>> calculateDominantShare(
+      const std::string& name) const;
+
+  // Returns true if the resource is excluded from fair sharing.
+  bool excluded(const std::string& resourceName) const;
+
   // Resources (by name) that will be excluded from fair sharing.
   Option<std::set<std::string>> fairnessExcludeResourceNames;
 
@@ -140,12 +158,31 @@ private:
   // it exists in this Sorter.
   std::set<Client, DRFComparator>::iterator find(const std::string& name);
 
-  // If true, sort() will recalculate all shares.
-  bool dirty = false;
+  // Inserts the client into 'clients' and records its position.
+  void insert(const Client& client);
+
+  // Removes the client from 'clients'.
+  void erase(std::set<Client, DRFComparator>::iterator it);
+
+  // Updates the share of the client at the specified position in
+  // place, if the updated client would remain in the same position.
+  // Returns false (without updating the client) otherwise.
+  bool updateInPlace(
+      std::set<Client, DRFComparator>::iterator it,
+      const Client& client);
 
   // A set of Clients (names and shares) sorted by share.
   std::set<Client, DRFComparator> clients;
 
+  // The totals (by resource name) as of the last time the shares
+  // were brought up to date, for each resource whose total has
+  // changed since then. If non-empty, sort() will update the
+  // affected shares: when the total of a resource grows only the
+  // clients dominated by that resource can see their share shrink,
+  // and when it shrinks the share of a client can only grow to the
+  // share of that resource.
+  hashmap<std::string, double> previousTotals;
+
   // Maps client names to the weights that should be applied to their shares.
   hashmap<std::string, double> weights;
 
@@ -168,15 +205,11 @@ private:
     // Sharedness info is also stripped out when resource identities are
     // omitted because sharedness inherently refers to the identities of
     // resources and not quantities.
-    Resources scalarQuantities;
+    ResourceQuantities scalarQuantities;
 
     // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
+    // the `Resource::name` to aggregated scalar (across roles). This
+    // improves the performance of calculating shares. See MESOS-4694.
     hashmap<std::string, Value::Scalar> totals;
   } total_;
 
@@ -191,16 +224,18 @@ private:
     // Similarly, we aggregate scalars across slaves and omit information
     // about dynamic reservations, persistent volumes and sharedness of
     // the corresponding resource. See notes above.
-    Resources scalarQuantities;
+    ResourceQuantities scalarQuantities;
 
-    // We also store a map version of `scalarQuantities`, mapping
-    // the `Resource::name` to aggregated scalar. This improves the
-    // performance of calculating shares. See MESOS-4694.
-    //
-    // TODO(bmahler): Ideally we do not store `scalarQuantities`
-    // redundantly here, investigate performance improvements to
-    // `Resources` to make this unnecessary.
+    // See `Total::totals` above.
     hashmap<std::string, Value::Scalar> totals;
+
+    // The position of the client in 'clients', if it is active. This
+    // lets us move a client when its share changes in O(log n).
+    Option<std::set<Client, DRFComparator>::iterator> position;
+
+    // If true, the share of the client changed while the total
+    // resources were being changed and sort() must recalculate it.
+    bool outdated = false;
   };
 
   // Maps client names to the resources they have been allocated.
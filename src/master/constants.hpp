@@ -91,12 +91,34 @@ constexpr Duration WHITELIST_WATCH_INTERVAL = Seconds(5);
 // Default number of tasks (limit) for /master/tasks endpoint.
 constexpr size_t TASK_LIMIT = 100;
 
+// Number of bytes of the /master/state endpoint written at once when
+// the state is streamed, the next chunk is only written once the
+// client consumed the previous one.
+constexpr Bytes STATE_STREAM_CHUNK_SIZE = Kilobytes(64);
+
+// Maximum number of '/state-summary' responses cached by the master,
+// one per principal, the least recently used ones are evicted first.
+constexpr size_t MAX_STATE_SUMMARY_RESPONSES = 100;
+
+// Interval at which the master pushes the values of the gauges that
+// are derived from its state (e.g., the number of running tasks).
+constexpr Duration METRICS_REFRESH_INTERVAL = Seconds(1);
+
+// Number of processes serving the read-only calls of the v1 master
+// API and the JSON state endpoints from snapshots of the master's
+// state.
+constexpr size_t STATE_READER_PROCESSES = 4;
+
 constexpr Duration DEFAULT_REGISTRY_GC_INTERVAL = Minutes(15);
 
 constexpr Duration DEFAULT_REGISTRY_MAX_AGENT_AGE = Weeks(2);
 
 constexpr size_t DEFAULT_REGISTRY_MAX_AGENT_COUNT = 100 * 1024;
 
+// Maximum number of deltas the registrar stores before it stores the
+// entire registry again. This bounds the work during recovery.
+constexpr size_t MAX_REGISTRY_DELTAS = 1000;
+
 /**
  * Label used by the Leader Contender and Detector.
  *
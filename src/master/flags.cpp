@@ -114,6 +114,25 @@ mesos::internal::master::Flags::Flags()
       "after which the operation is considered a failure.",
       Seconds(20));
 
+  add(&Flags::registry_store_deltas,
+      "registry_store_deltas",
+      "Whether to store the agent operations of a registry update as a\n"
+      "delta rather than storing the entire registry. The entire registry\n"
+      "is still stored periodically. Masters older than 1.1 ignore the\n"
+      "deltas, hence before downgrading, restart the master once with\n"
+      "this flag disabled: upon recovery the master replays the deltas\n"
+      "and then stores the entire registry. See the upgrade guide.",
+      false);
+
+  add(&Flags::registry_batch_writes,
+      "registry_batch_writes",
+      "Whether to write the registry operations that are stored together\n"
+      "as a single entry of the replicated log rather than as consecutive\n"
+      "entries. Masters older than 1.1 fail to recover a log that contains\n"
+      "such entries, hence only enable this flag once all masters have\n"
+      "been upgraded. See the upgrade guide.",
+      false);
+
   add(&Flags::log_auto_initialize,
       "log_auto_initialize",
       "Whether to automatically initialize the replicated log used for the\n"
@@ -458,6 +477,16 @@ mesos::internal::master::Flags::Flags()
       "  http://www.mail-archive.com/dev@mesos.apache.org/msg35631.html\n"
       "  https://issues.apache.org/jira/browse/MESOS-5377");
 
+  add(&Flags::allocation_parallelism,
+      "allocation_parallelism",
+      "Number of shards the allocator splits the agents into to compute\n"
+      "the resources available on them during an allocation run. The\n"
+      "shards are processed concurrently on libprocess worker threads\n"
+      "before offers are made in fair sharing order. A value of 1 does\n"
+      "all the work on the allocator's own thread. Only applies to the\n"
+      "built-in allocator.",
+      1);
+
   add(&Flags::hooks,
       "hooks",
       "A comma-separated list of hook modules to be\n"
@@ -52,6 +52,8 @@ public:
   bool registry_strict;
   Duration registry_fetch_timeout;
   Duration registry_store_timeout;
+  bool registry_store_deltas;
+  bool registry_batch_writes;
   bool log_auto_initialize;
   Duration agent_reregister_timeout;
   std::string recovery_agent_removal_limit;
@@ -79,6 +81,7 @@ public:
   std::string authenticators;
   std::string allocator;
   Option<std::set<std::string>> fair_sharing_excluded_resource_names;
+  size_t allocation_parallelism;
   Option<std::string> hooks;
   Duration agent_ping_timeout;
   size_t max_agent_ping_timeouts;
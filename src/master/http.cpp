@@ -40,6 +40,7 @@
 
 #include <process/collect.hpp>
 #include <process/defer.hpp>
+#include <process/dispatch.hpp>
 #include <process/help.hpp>
 #include <process/logging.hpp>
 
@@ -92,6 +93,7 @@ using process::AUTHENTICATION;
 using process::AUTHORIZATION;
 using process::Clock;
 using process::DESCRIPTION;
+using process::dispatch;
 using process::Failure;
 using process::Future;
 using process::HELP;
@@ -106,6 +108,7 @@ using process::http::InternalServerError;
 using process::http::MethodNotAllowed;
 using process::http::NotFound;
 using process::http::NotImplemented;
+using process::http::NotModified;
 using process::http::NotAcceptable;
 using process::http::OK;
 using process::http::Pipe;
@@ -127,22 +130,6 @@ using std::vector;
 
 
 namespace mesos {
-
-static void json(
-    JSON::StringWriter* writer, const FrameworkInfo::Capability& capability)
-{
-  writer->append(FrameworkInfo::Capability::Type_Name(capability.type()));
-}
-
-
-static void json(JSON::ObjectWriter* writer, const Offer& offer)
-{
-  writer->field("id", offer.id().value());
-  writer->field("framework_id", offer.framework_id().value());
-  writer->field("slave_id", offer.slave_id().value());
-  writer->field("resources", Resources(offer.resources()));
-}
-
 namespace internal {
 namespace master {
 
@@ -155,225 +142,6 @@ using process::http::Request;
 using process::Owned;
 
 
-// The summary representation of `T` to support the `/state-summary` endpoint.
-// e.g., `Summary<Slave>`.
-template <typename T>
-struct Summary : Representation<T>
-{
-  using Representation<T>::Representation;
-};
-
-
-// The full representation of `T` to support the `/state` endpoint.
-// e.g., `Full<Slave>`.
-template <typename T>
-struct Full : Representation<T>
-{
-  using Representation<T>::Representation;
-};
-
-
-// Forward declaration for `FullFrameworkWriter`.
-static void json(JSON::ObjectWriter* writer, const Summary<Framework>& summary);
-
-
-// Filtered representation of Full<Framework>.
-// Executors and Tasks are filtered based on whether the
-// user is authorized to view them.
-struct FullFrameworkWriter {
-  FullFrameworkWriter(
-      const Owned<ObjectApprover>& taskApprover,
-      const Owned<ObjectApprover>& executorApprover,
-      const Framework* framework)
-    : taskApprover_(taskApprover),
-      executorApprover_(executorApprover),
-      framework_(framework) {}
-
-  void operator()(JSON::ObjectWriter* writer) const
-  {
-    json(writer, Summary<Framework>(*framework_));
-
-    // Add additional fields to those generated by the
-    // `Summary<Framework>` overload.
-    writer->field("user", framework_->info.user());
-    writer->field("failover_timeout", framework_->info.failover_timeout());
-    writer->field("checkpoint", framework_->info.checkpoint());
-    writer->field("role", framework_->info.role());
-    writer->field("registered_time", framework_->registeredTime.secs());
-    writer->field("unregistered_time", framework_->unregisteredTime.secs());
-
-    if (framework_->info.has_principal()) {
-      writer->field("principal", framework_->info.principal());
-    }
-
-    // TODO(bmahler): Consider deprecating this in favor of the split
-    // used and offered resources added in `Summary<Framework>`.
-    writer->field(
-        "resources",
-        framework_->totalUsedResources + framework_->totalOfferedResources);
-
-    // TODO(benh): Consider making reregisteredTime an Option.
-    if (framework_->registeredTime != framework_->reregisteredTime) {
-      writer->field("reregistered_time", framework_->reregisteredTime.secs());
-    }
-
-    // Model all of the tasks associated with a framework.
-    writer->field("tasks", [this](JSON::ArrayWriter* writer) {
-      foreachvalue (const TaskInfo& taskInfo, framework_->pendingTasks) {
-        // Skip unauthorized tasks.
-        if (!approveViewTaskInfo(taskApprover_, taskInfo, framework_->info)) {
-          continue;
-        }
-
-        writer->element([this, &taskInfo](JSON::ObjectWriter* writer) {
-          writer->field("id", taskInfo.task_id().value());
-          writer->field("name", taskInfo.name());
-          writer->field("framework_id", framework_->id().value());
-
-          writer->field(
-            "executor_id",
-            taskInfo.executor().executor_id().value());
-
-          writer->field("slave_id", taskInfo.slave_id().value());
-          writer->field("state", TaskState_Name(TASK_STAGING));
-          writer->field("resources", Resources(taskInfo.resources()));
-          writer->field("statuses", std::initializer_list<TaskStatus>{});
-
-          if (taskInfo.has_labels()) {
-            writer->field("labels", taskInfo.labels());
-          }
-
-          if (taskInfo.has_discovery()) {
-            writer->field("discovery", JSON::Protobuf(taskInfo.discovery()));
-          }
-
-          if (taskInfo.has_container()) {
-            writer->field("container", JSON::Protobuf(taskInfo.container()));
-          }
-        });
-      }
-
-      foreachvalue (Task* task, framework_->tasks) {
-        // Skip unauthorized tasks.
-        if (!approveViewTask(taskApprover_, *task, framework_->info)) {
-          continue;
-        }
-
-        writer->element(*task);
-      }
-    });
-
-    writer->field("completed_tasks", [this](JSON::ArrayWriter* writer) {
-      foreach (const std::shared_ptr<Task>& task, framework_->completedTasks) {
-        // Skip unauthorized tasks.
-        if (!approveViewTask(taskApprover_, *task.get(), framework_->info)) {
-          continue;
-        }
-
-        writer->element(*task);
-      }
-    });
-
-    // Model all of the offers associated with a framework.
-    writer->field("offers", [this](JSON::ArrayWriter* writer) {
-      foreach (Offer* offer, framework_->offers) {
-        writer->element(*offer);
-      }
-    });
-
-    // Model all of the executors of a framework.
-    writer->field("executors", [this](JSON::ArrayWriter* writer) {
-      foreachpair (
-          const SlaveID& slaveId,
-          const auto& executorsMap,
-          framework_->executors) {
-        foreachvalue (const ExecutorInfo& executor, executorsMap) {
-          writer->element([this,
-                           &executor,
-                           &slaveId](JSON::ObjectWriter* writer) {
-            // Skip unauthorized executors.
-            if (!approveViewExecutorInfo(
-                    executorApprover_,
-                    executor,
-                    framework_->info)) {
-              return;
-            }
-
-            json(writer, executor);
-            writer->field("slave_id", slaveId.value());
-          });
-        }
-      }
-    });
-
-    // Model all of the labels associated with a framework.
-    if (framework_->info.has_labels()) {
-      writer->field("labels", framework_->info.labels());
-    }
-  }
-
-  const Owned<ObjectApprover>& taskApprover_;
-  const Owned<ObjectApprover>& executorApprover_;
-  const Framework* framework_;
-};
-
-
-static void json(JSON::ObjectWriter* writer, const Summary<Slave>& summary)
-{
-  const Slave& slave = summary;
-
-  writer->field("id", slave.id.value());
-  writer->field("pid", string(slave.pid));
-  writer->field("hostname", slave.info.hostname());
-  writer->field("registered_time", slave.registeredTime.secs());
-
-  if (slave.reregisteredTime.isSome()) {
-    writer->field("reregistered_time", slave.reregisteredTime.get().secs());
-  }
-
-  const Resources& totalResources = slave.totalResources;
-  writer->field("resources", totalResources);
-  writer->field("used_resources", Resources::sum(slave.usedResources));
-  writer->field("offered_resources", slave.offeredResources);
-  writer->field("reserved_resources", totalResources.reservations());
-  writer->field("unreserved_resources", totalResources.unreserved());
-
-  writer->field("attributes", Attributes(slave.info.attributes()));
-  writer->field("active", slave.active);
-  writer->field("version", slave.version);
-}
-
-
-static void json(JSON::ObjectWriter* writer, const Full<Slave>& full)
-{
-  const Slave& slave = full;
-
-  json(writer, Summary<Slave>(slave));
-}
-
-
-static void json(JSON::ObjectWriter* writer, const Summary<Framework>& summary)
-{
-  const Framework& framework = summary;
-
-  writer->field("id", framework.id().value());
-  writer->field("name", framework.info.name());
-
-  // Omit pid for http frameworks.
-  if (framework.pid.isSome()) {
-    writer->field("pid", string(framework.pid.get()));
-  }
-
-  // TODO(bmahler): Use these in the webui.
-  writer->field("used_resources", framework.totalUsedResources);
-  writer->field("offered_resources", framework.totalOfferedResources);
-  writer->field("capabilities", framework.info.capabilities());
-  writer->field("hostname", framework.info.hostname());
-  writer->field("webui_url", framework.info.webui_url());
-  writer->field("active", framework.active);
-}
-
-
 void Master::Http::log(const Request& request)
 {
   Option<string> userAgent = request.headers.get("User-Agent");
@@ -1273,81 +1041,25 @@ Future<Response> Master::Http::frameworks(
     executorsApprover = Owned<ObjectApprover>(new AcceptingObjectApprover());
   }
 
+  const Option<string> jsonp = request.url.query.get("jsonp");
+
   return collect(frameworksApprover, tasksApprover, executorsApprover)
     .then(defer(master->self(),
-        [this, request](const tuple<Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>>& approvers)
-          -> Response {
-      // This lambda is consumed before the outer lambda
-      // returns, hence capture by reference is fine here.
-      auto frameworks = [this, &approvers](JSON::ObjectWriter* writer) {
-        // Get approver from tuple.
-        Owned<ObjectApprover> frameworksApprover;
-        Owned<ObjectApprover> tasksApprover;
-        Owned<ObjectApprover> executorsApprover;
-        tie(frameworksApprover, tasksApprover, executorsApprover) = approvers;
-
-        // Model all of the frameworks.
-        writer->field(
-            "frameworks",
-            [this, &frameworksApprover, &executorsApprover, &tasksApprover](
-                JSON::ArrayWriter* writer) {
-              foreachvalue (Framework* framework,
-                            master->frameworks.registered) {
-                // Skip unauthorized frameworks.
-                if (!approveViewFrameworkInfo(
-                        frameworksApprover, framework->info)) {
-                  continue;
-                }
-
-                FullFrameworkWriter frameworkWriter(
-                    tasksApprover,
-                    executorsApprover,
-                    framework);
-
-                writer->element(frameworkWriter);
-              }
-            });
-
-        // Model all of the completed frameworks.
-        writer->field(
-            "completed_frameworks",
-            [this, &frameworksApprover, &executorsApprover, &tasksApprover](
-                JSON::ArrayWriter* writer) {
-              foreach (const std::shared_ptr<Framework>& framework,
-                       master->frameworks.completed) {
-                // Skip unauthorized frameworks.
-                if (!approveViewFrameworkInfo(
-                        frameworksApprover, framework->info)) {
-                  continue;
-                }
-
-                FullFrameworkWriter frameworkWriter(
-                    tasksApprover,
-                    executorsApprover,
-                    framework.get());
-
-                writer->element(frameworkWriter);
-              }
-            });
-
-        // Model all currently unregistered frameworks. This can happen
-        // when a framework has yet to re-register after master failover.
-        writer->field("unregistered_frameworks", [this](
-            JSON::ArrayWriter* writer) {
-          // Find unregistered frameworks.
-          foreachvalue (const Slave* slave, master->slaves.registered) {
-            foreachkey (const FrameworkID& frameworkId, slave->tasks) {
-              if (!master->frameworks.registered.contains(frameworkId)) {
-                writer->element(frameworkId.value());
-              }
-            }
-          }
-        });
-      };
+        [this, jsonp](const tuple<Owned<ObjectApprover>,
+                                  Owned<ObjectApprover>,
+                                  Owned<ObjectApprover>>& approvers)
+          -> Future<Response> {
+      // Get approver from tuple.
+      Owned<ObjectApprover> frameworksApprover;
+      Owned<ObjectApprover> tasksApprover;
+      Owned<ObjectApprover> executorsApprover;
+      tie(frameworksApprover, tasksApprover, executorsApprover) = approvers;
 
-      return OK(jsonify(frameworks), request.url.query.get("jsonp"));
+      return master->stateReader->frameworks(
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          jsonp);
   }));
 }
 
@@ -1424,13 +1136,8 @@ Future<Response> Master::Http::getFrameworks(
     .then(defer(master->self(),
         [=](const Owned<ObjectApprover>& frameworksApprover)
           -> Future<Response> {
-      mesos::master::Response response;
-      response.set_type(mesos::master::Response::GET_FRAMEWORKS);
-      response.mutable_get_frameworks()->CopyFrom(
-          _getFrameworks(frameworksApprover));
-
-      return OK(serialize(contentType, evolve(response)),
-                stringify(contentType));
+      return master->stateReader->getFrameworks(
+          frameworksApprover, contentType);
     }));
 }
 
@@ -1526,14 +1233,8 @@ Future<Response> Master::Http::getExecutors(
       Owned<ObjectApprover> executorsApprover;
       tie(frameworksApprover, executorsApprover) = approvers;
 
-      mesos::master::Response response;
-      response.set_type(mesos::master::Response::GET_EXECUTORS);
-
-      response.mutable_get_executors()->CopyFrom(
-          _getExecutors(frameworksApprover, executorsApprover));
-
-      return OK(serialize(contentType, evolve(response)),
-                stringify(contentType));
+      return master->stateReader->getExecutors(
+          frameworksApprover, executorsApprover, contentType);
     }));
 }
 
@@ -1670,15 +1371,11 @@ Future<Response> Master::Http::getState(
       Owned<ObjectApprover> executorsApprover;
       tie(frameworksApprover, tasksApprover, executorsApprover) = approvers;
 
-      mesos::master::Response response;
-      response.set_type(mesos::master::Response::GET_STATE);
-      response.mutable_get_state()->CopyFrom(
-          _getState(frameworksApprover,
-                    tasksApprover,
-                    executorsApprover));
-
-      return OK(serialize(contentType, evolve(response)),
-                stringify(contentType));
+      return master->stateReader->getState(
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          contentType);
     }));
 }
 
@@ -1710,6 +1407,148 @@ mesos::master::Response::GetState Master::Http::_getState(
 }
 
 
+void Master::Http::snapshot(StateSnapshot* snapshot) const
+{
+  // NOTE: Unlike `_getState()`, nothing is filtered here, this is
+  // done by the `StateReader` for every call.
+  const int parts = snapshot->parts;
+
+  snapshot->generation = master->generation;
+
+  snapshot->info = master->info();
+  snapshot->pid = master->self();
+  snapshot->leader = master->leader;
+  snapshot->startTime = master->startTime;
+  snapshot->electedTime = master->electedTime;
+  snapshot->activatedAgents = master->_slaves_active();
+  snapshot->deactivatedAgents = master->_slaves_inactive();
+  snapshot->cluster = master->flags.cluster;
+  snapshot->logDir = master->flags.log_dir;
+  snapshot->externalLogFile = master->flags.external_log_file;
+
+  if (parts & StateSnapshot::FLAGS) {
+    foreachvalue (const flags::Flag& flag, master->flags) {
+      Option<string> value = flag.stringify(master->flags);
+      if (value.isSome()) {
+        snapshot->flags.emplace_back(flag.effective_name().value, value.get());
+      }
+    }
+  }
+
+  snapshot->authorization = master->authorizer.isSome();
+
+  if (parts & StateSnapshot::AGENTS) {
+    snapshot->agents.CopyFrom(_getAgents());
+  }
+
+  if (!(parts & StateSnapshot::FRAMEWORKS)) {
+    return;
+  }
+
+  auto add = [snapshot, parts](const Framework* framework, bool completed) {
+    snapshot->frameworks.emplace_back();
+
+    StateSnapshot::Framework& _framework = snapshot->frameworks.back();
+    _framework.framework = model(*framework);
+    _framework.completed = completed;
+    _framework.pid = framework->pid;
+
+    if (parts & StateSnapshot::TASKS) {
+      foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
+        _framework.pendingTasks.push_back(taskInfo);
+      }
+
+      foreachvalue (const Task* task, framework->tasks) {
+        _framework.tasks.push_back(*CHECK_NOTNULL(task));
+      }
+
+      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
+        _framework.completedTasks.push_back(*task);
+      }
+    }
+
+    if (parts & StateSnapshot::TASK_STATES) {
+      foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
+        _framework.taskStates.emplace_back(taskInfo.slave_id(), TASK_STAGING);
+      }
+
+      foreachvalue (const Task* task, framework->tasks) {
+        _framework.taskStates.emplace_back(task->slave_id(), task->state());
+      }
+
+      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
+        _framework.taskStates.emplace_back(task->slave_id(), task->state());
+      }
+    }
+
+    if (parts & StateSnapshot::EXECUTORS) {
+      foreachpair (const SlaveID& slaveId,
+                   const auto& executorsMap,
+                   framework->executors) {
+        foreachvalue (const ExecutorInfo& executorInfo, executorsMap) {
+          mesos::master::Response::GetExecutors::Executor executor;
+          executor.mutable_executor_info()->CopyFrom(executorInfo);
+          executor.mutable_slave_id()->CopyFrom(slaveId);
+
+          _framework.executors.push_back(executor);
+        }
+      }
+    }
+  };
+
+  foreachvalue (const Framework* framework, master->frameworks.registered) {
+    add(framework, false);
+  }
+
+  foreach (const std::shared_ptr<Framework>& framework,
+           master->frameworks.completed) {
+    add(framework.get(), true);
+  }
+
+  foreachvalue (const Slave* slave, master->slaves.registered) {
+    typedef hashmap<TaskID, Task*> TaskMap;
+    foreachpair (const FrameworkID& frameworkId,
+                 const TaskMap& tasks,
+                 slave->tasks) {
+      if (master->frameworks.registered.contains(frameworkId)) {
+        continue;
+      }
+
+      snapshot->orphanFrameworks.push_back(frameworkId);
+
+      if (parts & StateSnapshot::TASKS) {
+        foreachvalue (const Task* task, tasks) {
+          snapshot->orphanTasks.push_back(*CHECK_NOTNULL(task));
+        }
+      }
+    }
+
+    if (!(parts & StateSnapshot::EXECUTORS)) {
+      continue;
+    }
+
+    typedef hashmap<ExecutorID, ExecutorInfo> ExecutorMap;
+    foreachpair (const FrameworkID& frameworkId,
+                 const ExecutorMap& executors,
+                 slave->executors) {
+      if (master->frameworks.registered.contains(frameworkId)) {
+        continue;
+      }
+
+      foreachvalue (const ExecutorInfo& executorInfo, executors) {
+        mesos::master::Response::GetExecutors::Executor executor;
+        executor.mutable_executor_info()->CopyFrom(executorInfo);
+        executor.mutable_slave_id()->CopyFrom(slave->id);
+
+        snapshot->orphanExecutors.emplace_back(frameworkId, executor);
+      }
+    }
+  }
+
+  snapshot->recoveredFrameworks = master->frameworks.recovered;
+}
+
+
 class Master::Http::FlagsError : public Error
 {
 public:
@@ -2229,61 +2068,7 @@ Future<Response> Master::Http::slaves(
     return redirect(request);
   }
 
-  auto slaves = [this](JSON::ObjectWriter* writer) {
-    writer->field("slaves", [this](JSON::ArrayWriter* writer) {
-      foreachvalue (const Slave* slave, master->slaves.registered) {
-        writer->element([&slave](JSON::ObjectWriter* writer) {
-          json(writer, Full<Slave>(*slave));
-
-          // Add the complete protobuf->JSON for all used, reserved,
-          // and offered resources. The other endpoints summarize
-          // resource information, which omits the details of
-          // reservations and persistent volumes. Full resource
-          // information is necessary so that operators can use the
-          // `/unreserve` and `/destroy-volumes` endpoints.
-
-          hashmap<string, Resources> reserved =
-            slave->totalResources.reservations();
-
-          writer->field(
-              "reserved_resources_full",
-              [&reserved](JSON::ObjectWriter* writer) {
-                foreachpair (const string& role,
-                             const Resources& resources,
-                             reserved) {
-                  writer->field(role, [&resources](JSON::ArrayWriter* writer) {
-                    foreach (const Resource& resource, resources) {
-                      writer->element(JSON::Protobuf(resource));
-                    }
-                  });
-                }
-              });
-
-          Resources usedResources = Resources::sum(slave->usedResources);
-
-          writer->field(
-              "used_resources_full",
-              [&usedResources](JSON::ArrayWriter* writer) {
-                foreach (const Resource& resource, usedResources) {
-                  writer->element(JSON::Protobuf(resource));
-                }
-              });
-
-          const Resources& offeredResources = slave->offeredResources;
-
-          writer->field(
-              "offered_resources_full",
-              [&offeredResources](JSON::ArrayWriter* writer) {
-                foreach (const Resource& resource, offeredResources) {
-                  writer->element(JSON::Protobuf(resource));
-                }
-              });
-        });
-      };
-    });
-  };
-
-  return OK(jsonify(slaves), request.url.query.get("jsonp"));
+  return master->stateReader->slaves(request.url.query.get("jsonp"));
 }
 
 
@@ -2294,12 +2079,7 @@ Future<process::http::Response> Master::Http::getAgents(
 {
   CHECK_EQ(mesos::master::Call::GET_AGENTS, call.type());
 
-  mesos::master::Response response;
-  response.set_type(mesos::master::Response::GET_AGENTS);
-  response.mutable_get_agents()->CopyFrom(_getAgents());
-
-  return OK(serialize(contentType, evolve(response)),
-            stringify(contentType));
+  return master->stateReader->getAgents(contentType);
 }
 
 
@@ -2435,6 +2215,15 @@ string Master::Http::STATE_HELP()
         "The information shown might be filtered based on the user",
         "accessing the endpoint.",
         "",
+        "Query parameters:",
+        "",
+        ">        stream=(true|false)  Whether to stream the state in chunks "
+        "(default is false).",
+        "",
+        "Whether streamed or not, the state is a consistent snapshot of",
+        "the master taken when the request was received; the master",
+        "keeps processing other events while the chunks are written.",
+        "",
         "Example (**Note**: this is not exhaustive):",
         "",
         "```",
@@ -2552,6 +2341,9 @@ Future<Response> Master::Http::state(
     flagsApprover = Owned<ObjectApprover>(new AcceptingObjectApprover());
   }
 
+  const Option<string> jsonp = request.url.query.get("jsonp");
+  const bool streaming = request.url.query.get("stream") == "true";
+
   return collect(
       frameworksApprover,
       tasksApprover,
@@ -2559,185 +2351,28 @@ Future<Response> Master::Http::state(
       flagsApprover)
     .then(defer(
         master->self(),
-        [this, request](const tuple<Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>,
-                                    Owned<ObjectApprover>>& approvers)
-          -> Response {
-      // This lambda is consumed before the outer lambda
-      // returns, hence capture by reference is fine here.
-      auto state = [this, &approvers](JSON::ObjectWriter* writer) {
-        // Get approver from tuple.
-        Owned<ObjectApprover> frameworksApprover;
-        Owned<ObjectApprover> tasksApprover;
-        Owned<ObjectApprover> executorsApprover;
-        Owned<ObjectApprover> flagsApprover;
-        tie(frameworksApprover,
-            tasksApprover,
-            executorsApprover,
-            flagsApprover) = approvers;
-
-        writer->field("version", MESOS_VERSION);
-
-        if (build::GIT_SHA.isSome()) {
-          writer->field("git_sha", build::GIT_SHA.get());
-        }
-
-        if (build::GIT_BRANCH.isSome()) {
-          writer->field("git_branch", build::GIT_BRANCH.get());
-        }
-
-        if (build::GIT_TAG.isSome()) {
-          writer->field("git_tag", build::GIT_TAG.get());
-        }
-
-        writer->field("build_date", build::DATE);
-        writer->field("build_time", build::TIME);
-        writer->field("build_user", build::USER);
-        writer->field("start_time", master->startTime.secs());
-
-        if (master->electedTime.isSome()) {
-          writer->field("elected_time", master->electedTime.get().secs());
-        }
-
-        writer->field("id", master->info().id());
-        writer->field("pid", string(master->self()));
-        writer->field("hostname", master->info().hostname());
-        writer->field("activated_slaves", master->_slaves_active());
-        writer->field("deactivated_slaves", master->_slaves_inactive());
-
-        if (master->leader.isSome()) {
-          writer->field("leader", master->leader.get().pid());
-        }
-
-        if (approveViewFlags(flagsApprover)) {
-          if (master->flags.cluster.isSome()) {
-            writer->field("cluster", master->flags.cluster.get());
-          }
-
-          if (master->flags.log_dir.isSome()) {
-            writer->field("log_dir", master->flags.log_dir.get());
-          }
-
-          if (master->flags.external_log_file.isSome()) {
-            writer->field("external_log_file",
-                          master->flags.external_log_file.get());
-          }
-
-          writer->field("flags", [this](JSON::ObjectWriter* writer) {
-              foreachvalue (const flags::Flag& flag, master->flags) {
-                Option<string> value = flag.stringify(master->flags);
-                if (value.isSome()) {
-                  writer->field(flag.effective_name().value, value.get());
-                }
-              }
-            });
-        }
-
-        // Model all of the slaves.
-        writer->field("slaves", [this](JSON::ArrayWriter* writer) {
-          foreachvalue (Slave* slave, master->slaves.registered) {
-            writer->element(Full<Slave>(*slave));
-          }
-        });
-
-        // Model all of the frameworks.
-        writer->field(
-            "frameworks",
-            [this, &frameworksApprover, &executorsApprover, &tasksApprover](
-                JSON::ArrayWriter* writer) {
-              foreachvalue (
-                  Framework* framework,
-                  master->frameworks.registered) {
-                // Skip unauthorized frameworks.
-                if (!approveViewFrameworkInfo(
-                        frameworksApprover, framework->info)) {
-                  continue;
-                }
-
-                auto frameworkWriter = FullFrameworkWriter(
-                    tasksApprover, executorsApprover, framework);
-
-                writer->element(frameworkWriter);
-              }
-            });
-
-        // Model all of the completed frameworks.
-        writer->field(
-            "completed_frameworks",
-            [this, &frameworksApprover, &executorsApprover, &tasksApprover](
-                JSON::ArrayWriter* writer) {
-              foreach (
-                  const std::shared_ptr<Framework>& framework,
-                  master->frameworks.completed) {
-                // Skip unauthorized frameworks.
-                if (!approveViewFrameworkInfo(
-                    frameworksApprover, framework->info)) {
-                  continue;
-                }
-
-                auto frameworkWriter = FullFrameworkWriter(
-                    tasksApprover, executorsApprover, framework.get());
-
-                writer->element(frameworkWriter);
-              }
-            });
-
-        // Model all of the orphan tasks.
-        writer->field("orphan_tasks", [this, &tasksApprover](
-            JSON::ArrayWriter* writer) {
-          // Find those orphan tasks.
-          foreachvalue (const Slave* slave, master->slaves.registered) {
-            typedef hashmap<TaskID, Task*> TaskMap;
-            foreachvalue (const TaskMap& tasks, slave->tasks) {
-              foreachvalue (const Task* task, tasks) {
-                CHECK_NOTNULL(task);
-                const FrameworkID& frameworkId = task->framework_id();
-                if (!master->frameworks.registered.contains(frameworkId)) {
-                  // TODO(joerg84): This logic should be simplified after
-                  // a deprecation cycle starting with 1.0 as after that
-                  // we can rely on 'master->frameworks.recovered' containing
-                  // all FrameworkInfos.
-                  // Until then there are 3 cases:
-                  // - No authorization enabled: show all orphaned tasks.
-                  // - Authorization enabled, but no FrameworkInfo present:
-                  //   do not show orphaned tasks.
-                  // - Authorization enabled, FrameworkInfo present: filter
-                  //   based on 'approveViewTask'.
-                  if (master->authorizer.isSome() &&
-                     (!master->frameworks.recovered.contains(frameworkId) ||
-                      !approveViewTask(
-                          tasksApprover,
-                          *task,
-                          master->frameworks.recovered[frameworkId]))) {
-                    continue;
-                  }
-
-                  writer->element(*task);
-                }
-              }
-            }
-          }
-        });
-
-        // Model all currently unregistered frameworks. This can happen
-        // when a framework has yet to re-register after master failover.
-        // TODO(vinod): Need to filter these frameworks based on authorization!
-        // See the TODO above for "orphan_tasks" for further details.
-        writer->field("unregistered_frameworks", [this](
-            JSON::ArrayWriter* writer) {
-          // Find unregistered frameworks.
-          foreachvalue (const Slave* slave, master->slaves.registered) {
-            foreachkey (const FrameworkID& frameworkId, slave->tasks) {
-              if (!master->frameworks.registered.contains(frameworkId)) {
-                writer->element(frameworkId.value());
-              }
-            }
-          }
-        });
-      };
-
-      return OK(jsonify(state), request.url.query.get("jsonp"));
+        [this, jsonp, streaming](const tuple<Owned<ObjectApprover>,
+                                             Owned<ObjectApprover>,
+                                             Owned<ObjectApprover>,
+                                             Owned<ObjectApprover>>& approvers)
+          -> Future<Response> {
+      // Get approver from tuple.
+      Owned<ObjectApprover> frameworksApprover;
+      Owned<ObjectApprover> tasksApprover;
+      Owned<ObjectApprover> executorsApprover;
+      Owned<ObjectApprover> flagsApprover;
+      tie(frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          flagsApprover) = approvers;
+
+      return master->stateReader->state(
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          flagsApprover,
+          jsonp,
+          streaming);
     }));
 }
 
@@ -2792,168 +2427,41 @@ Future<Response> Master::Http::readFile(
 }
 
 
-// This abstraction has no side-effects. It factors out computing the
-// mapping from 'slaves' to 'frameworks' to answer the questions 'what
-// frameworks are running on a given slave?' and 'what slaves are
-// running the given framework?'.
-class SlaveFrameworkMapping
+Response Master::Http::cachedResponse(
+    const Request& request,
+    const CachedResponse& cached)
 {
-public:
-  SlaveFrameworkMapping(const hashmap<FrameworkID, Framework*>& frameworks)
-  {
-    foreachpair (const FrameworkID& frameworkId,
-                 const Framework* framework,
-                 frameworks) {
-      foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
-        frameworksToSlaves[frameworkId].insert(taskInfo.slave_id());
-        slavesToFrameworks[taskInfo.slave_id()].insert(frameworkId);
-      }
-
-      foreachvalue (const Task* task, framework->tasks) {
-        frameworksToSlaves[frameworkId].insert(task->slave_id());
-        slavesToFrameworks[task->slave_id()].insert(frameworkId);
-      }
-
-      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
-        frameworksToSlaves[frameworkId].insert(task->slave_id());
-        slavesToFrameworks[task->slave_id()].insert(frameworkId);
-      }
-    }
-  }
-
-  const hashset<FrameworkID>& frameworks(const SlaveID& slaveId) const
-  {
-    const auto iterator = slavesToFrameworks.find(slaveId);
-    return iterator != slavesToFrameworks.end() ?
-      iterator->second : hashset<FrameworkID>::EMPTY;
-  }
-
-  const hashset<SlaveID>& slaves(const FrameworkID& frameworkId) const
-  {
-    const auto iterator = frameworksToSlaves.find(frameworkId);
-    return iterator != frameworksToSlaves.end() ?
-      iterator->second : hashset<SlaveID>::EMPTY;
-  }
-
-private:
-  hashmap<SlaveID, hashset<FrameworkID>> slavesToFrameworks;
-  hashmap<FrameworkID, hashset<SlaveID>> frameworksToSlaves;
-};
-
+  Option<string> jsonp = request.url.query.get("jsonp");
 
-// This abstraction has no side-effects. It factors out the accounting
-// for a 'TaskState' summary. We use this to summarize 'TaskState's
-// for both frameworks as well as slaves.
-struct TaskStateSummary
-{
-  // TODO(jmlvanre): Possibly clean this up as per MESOS-2694.
-  const static TaskStateSummary EMPTY;
-
-  TaskStateSummary()
-    : staging(0),
-      starting(0),
-      running(0),
-      killing(0),
-      finished(0),
-      killed(0),
-      failed(0),
-      lost(0),
-      error(0),
-      dropped(0),
-      unreachable(0),
-      gone(0),
-      gone_by_operator(0),
-      unknown(0) {}
-
-  // Account for the state of the given task.
-  void count(const Task& task)
-  {
-    switch (task.state()) {
-      case TASK_STAGING: { ++staging; break; }
-      case TASK_STARTING: { ++starting; break; }
-      case TASK_RUNNING: { ++running; break; }
-      case TASK_KILLING: { ++killing; break; }
-      case TASK_FINISHED: { ++finished; break; }
-      case TASK_KILLED: { ++killed; break; }
-      case TASK_FAILED: { ++failed; break; }
-      case TASK_LOST: { ++lost; break; }
-      case TASK_ERROR: { ++error; break; }
-      case TASK_DROPPED: { ++dropped; break; }
-      case TASK_UNREACHABLE: { ++unreachable; break; }
-      case TASK_GONE: { ++gone; break; }
-      case TASK_GONE_BY_OPERATOR: { ++gone_by_operator; break; }
-      case TASK_UNKNOWN: { ++unknown; break; }
-      // No default case allows for a helpful compiler error if we
-      // introduce a new state.
-    }
+  // The entity tag is only valid for the JSON body, hence it is not
+  // used for JSONP responses.
+  if (jsonp.isSome()) {
+    return OK(jsonp.get() + "(" + cached.body + ");", "text/javascript");
   }
 
-  size_t staging;
-  size_t starting;
-  size_t running;
-  size_t killing;
-  size_t finished;
-  size_t killed;
-  size_t failed;
-  size_t lost;
-  size_t error;
-  size_t dropped;
-  size_t unreachable;
-  size_t gone;
-  size_t gone_by_operator;
-  size_t unknown;
-};
-
-
-const TaskStateSummary TaskStateSummary::EMPTY;
-
-
-// This abstraction has no side-effects. It factors out computing the
-// 'TaskState' summaries for frameworks and slaves. This answers the
-// questions 'How many tasks are in each state for a given framework?'
-// and 'How many tasks are in each state for a given slave?'.
-class TaskStateSummaries
-{
-public:
-  TaskStateSummaries(const hashmap<FrameworkID, Framework*>& frameworks)
-  {
-    foreachpair (const FrameworkID& frameworkId,
-                 const Framework* framework,
-                 frameworks) {
-      foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
-        frameworkTaskSummaries[frameworkId].staging++;
-        slaveTaskSummaries[taskInfo.slave_id()].staging++;
-      }
-
-      foreachvalue (const Task* task, framework->tasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
-      }
+  // The summary is filtered for the principal of the request, so the
+  // same entity tag can be sent to different principals.
+  auto tag = [&cached](Response* response) {
+    response->headers["ETag"] = cached.etag;
+    response->headers["Vary"] = "Authorization";
+  };
 
-      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+  Option<string> ifNoneMatch = request.headers.get("If-None-Match");
+  if (ifNoneMatch.isSome()) {
+    foreach (const string& etag, strings::tokenize(ifNoneMatch.get(), ",")) {
+      const string token = strings::trim(etag);
+      if (token == cached.etag || token == "W/" + cached.etag || token == "*") {
+        NotModified response;
+        tag(&response);
+        return response;
       }
     }
   }
 
-  const TaskStateSummary& framework(const FrameworkID& frameworkId) const
-  {
-    const auto iterator = frameworkTaskSummaries.find(frameworkId);
-    return iterator != frameworkTaskSummaries.end() ?
-      iterator->second : TaskStateSummary::EMPTY;
-  }
-
-  const TaskStateSummary& slave(const SlaveID& slaveId) const
-  {
-    const auto iterator = slaveTaskSummaries.find(slaveId);
-    return iterator != slaveTaskSummaries.end() ?
-      iterator->second : TaskStateSummary::EMPTY;
-  }
-private:
-  hashmap<FrameworkID, TaskStateSummary> frameworkTaskSummaries;
-  hashmap<SlaveID, TaskStateSummary> slaveTaskSummaries;
-};
+  OK response(cached.body, "application/json");
+  tag(&response);
+  return response;
+}
 
 
 string Master::Http::STATESUMMARY_HELP()
@@ -2964,6 +2472,8 @@ string Master::Http::STATESUMMARY_HELP()
     DESCRIPTION(
         "Returns 200 OK when a summary of the master's state was queried",
         "successfully.",
+        "Returns 304 NOT_MODIFIED when the 'If-None-Match' header of the",
+        "request contains the entity tag of the current summary.",
         "Returns 307 TEMPORARY_REDIRECT redirect to the leading master when",
         "current master is not the leader.",
         "Returns 503 SERVICE_UNAVAILABLE if the leading master cannot be",
@@ -2971,7 +2481,10 @@ string Master::Http::STATESUMMARY_HELP()
         "This endpoint gives a summary of the state of all tasks and",
         "registered frameworks in the cluster as a JSON object.",
         "The information shown might be filtered based on the user",
-        "accessing the endpoint."),
+        "accessing the endpoint.",
+        "The summary is cached until the state of the master changes, and",
+        "its entity tag is returned in the 'ETag' header unless the",
+        "'jsonp' query parameter is used."),
     AUTHENTICATION(true),
     AUTHORIZATION(
         "This endpoint might be filtered based on the user accessing it.",
@@ -3007,126 +2520,40 @@ Future<Response> Master::Http::stateSummary(
   return frameworksApprover
     .then(defer(
         master->self(),
-        [this, request](const Owned<ObjectApprover>& frameworksApprover)
-          -> Response {
-      auto stateSummary =
-          [this, &frameworksApprover](JSON::ObjectWriter* writer) {
-        writer->field("hostname", master->info().hostname());
+        [this, request, principal](
+            const Owned<ObjectApprover>& frameworksApprover)
+          -> Future<Response> {
+      // The summary only depends on the principal through the
+      // authorizer, hence all the principals share a cache entry
+      // when the master has no authorizer.
+      //
+      // NOTE: A request without a principal shares the entry of the
+      // empty principal, neither of which can be authenticated.
+      const string key =
+        master->authorizer.isSome() ? principal.getOrElse("") : "";
 
-        if (master->flags.cluster.isSome()) {
-          writer->field("cluster", master->flags.cluster.get());
-        }
+      Option<CachedResponse> cached = master->stateSummaries.get(key);
+      if (cached.isSome() && cached->generation == master->generation) {
+        ++master->metrics->state_summary_cache_hits;
 
-        // We use the tasks in the 'Frameworks' struct to compute summaries
-        // for this endpoint. This is done 1) for consistency between the
-        // 'slaves' and 'frameworks' subsections below 2) because we want to
-        // provide summary information for frameworks that are currently
-        // registered 3) the frameworks keep a circular buffer of completed
-        // tasks that we can use to keep a limited view on the history of
-        // recent completed / failed tasks.
-
-        // Generate mappings from 'slave' to 'framework' and reverse.
-        SlaveFrameworkMapping slaveFrameworkMapping(
-            master->frameworks.registered);
-
-        // Generate 'TaskState' summaries for all framework and slave ids.
-        TaskStateSummaries taskStateSummaries(master->frameworks.registered);
-
-        // Model all of the slaves.
-        writer->field(
-            "slaves",
-            [this, &slaveFrameworkMapping, &taskStateSummaries](
-                JSON::ArrayWriter* writer) {
-          foreachvalue (Slave* slave, master->slaves.registered) {
-            writer->element(
-                [&slave, &slaveFrameworkMapping, &taskStateSummaries](
-                    JSON::ObjectWriter* writer) {
-              json(writer, Summary<Slave>(*slave));
-
-              // Add the 'TaskState' summary for this slave.
-              const TaskStateSummary& summary =
-                taskStateSummaries.slave(slave->id);
-
-              // TODO(neilc): Update for new PARTITION_AWARE task statuses.
-              writer->field("TASK_STAGING", summary.staging);
-              writer->field("TASK_STARTING", summary.starting);
-              writer->field("TASK_RUNNING", summary.running);
-              writer->field("TASK_KILLING", summary.killing);
-              writer->field("TASK_FINISHED", summary.finished);
-              writer->field("TASK_KILLED", summary.killed);
-              writer->field("TASK_FAILED", summary.failed);
-              writer->field("TASK_LOST", summary.lost);
-              writer->field("TASK_ERROR", summary.error);
-
-              // Add the ids of all the frameworks running on this slave.
-              const hashset<FrameworkID>& frameworks =
-                slaveFrameworkMapping.frameworks(slave->id);
-
-              writer->field(
-                  "framework_ids",
-                  [&frameworks](JSON::ArrayWriter* writer) {
-                foreach (const FrameworkID& frameworkId, frameworks) {
-                  writer->element(frameworkId.value());
-                }
-              });
-            });
-          }
-        });
-
-        // Model all of the frameworks.
-        writer->field(
-            "frameworks",
-            [this,
-             &slaveFrameworkMapping,
-             &taskStateSummaries,
-             &frameworksApprover](JSON::ArrayWriter* writer) {
-          foreachpair (const FrameworkID& frameworkId,
-                       Framework* framework,
-                       master->frameworks.registered) {
-            // Skip unauthorized frameworks.
-            if (!approveViewFrameworkInfo(
-                    frameworksApprover,
-                    framework->info)) {
-              continue;
-            }
+        return cachedResponse(request, cached.get());
+      }
 
-            writer->element(
-                [&frameworkId,
-                 &framework,
-                 &slaveFrameworkMapping,
-                 &taskStateSummaries](JSON::ObjectWriter* writer) {
-              json(writer, Summary<Framework>(*framework));
-
-              // Add the 'TaskState' summary for this framework.
-              const TaskStateSummary& summary =
-                taskStateSummaries.framework(frameworkId);
-
-              // TODO(neilc): Update for new PARTITION_AWARE task statuses.
-              writer->field("TASK_STAGING", summary.staging);
-              writer->field("TASK_STARTING", summary.starting);
-              writer->field("TASK_RUNNING", summary.running);
-              writer->field("TASK_KILLING", summary.killing);
-              writer->field("TASK_FINISHED", summary.finished);
-              writer->field("TASK_KILLED", summary.killed);
-              writer->field("TASK_FAILED", summary.failed);
-              writer->field("TASK_LOST", summary.lost);
-              writer->field("TASK_ERROR", summary.error);
-
-              // Add the ids of all the slaves running this framework.
-              const hashset<SlaveID>& slaves =
-                slaveFrameworkMapping.slaves(frameworkId);
-
-              writer->field("slave_ids", [&slaves](JSON::ArrayWriter* writer) {
-                foreach (const SlaveID& slaveId, slaves) {
-                  writer->element(slaveId.value());
-                }
-              });
-            });
+      ++master->metrics->state_summary_cache_misses;
+
+      return master->stateReader->stateSummary(frameworksApprover)
+        .then(defer(master->self(), [this, request, key](
+            const CachedResponse& cached) -> Response {
+          // Only cache the summary if it is not older than the one
+          // that is cached already, as the responses of concurrent
+          // requests might complete in any order.
+          Option<CachedResponse> current = master->stateSummaries.get(key);
+          if (current.isNone() || current->generation <= cached.generation) {
+            master->stateSummaries.put(key, cached);
           }
-        });
-      };
 
-      return OK(jsonify(stateSummary), request.url.query.get("jsonp"));
+          return cachedResponse(request, cached);
+        }));
     }));
 }
 
@@ -3496,50 +2923,6 @@ Future<Response> Master::Http::_teardown(const FrameworkID& id) const
 }
 
 
-struct TaskComparator
-{
-  static bool ascending(const Task* lhs, const Task* rhs)
-  {
-    size_t lhsSize = lhs->statuses().size();
-    size_t rhsSize = rhs->statuses().size();
-
-    if ((lhsSize == 0) && (rhsSize == 0)) {
-      return false;
-    }
-
-    if (lhsSize == 0) {
-      return true;
-    }
-
-    if (rhsSize == 0) {
-      return false;
-    }
-
-    return (lhs->statuses(0).timestamp() < rhs->statuses(0).timestamp());
-  }
-
-  static bool descending(const Task* lhs, const Task* rhs)
-  {
-    size_t lhsSize = lhs->statuses().size();
-    size_t rhsSize = rhs->statuses().size();
-
-    if ((lhsSize == 0) && (rhsSize == 0)) {
-      return false;
-    }
-
-    if (rhsSize == 0) {
-      return true;
-    }
-
-    if (lhsSize == 0) {
-      return false;
-    }
-
-    return (lhs->statuses(0).timestamp() > rhs->statuses(0).timestamp());
-  }
-};
-
-
 string Master::Http::TASKS_HELP()
 {
   return HELP(
@@ -3589,7 +2972,9 @@ Future<Response> Master::Http::tasks(
   size_t offset = result.isSome() ? result.get() : 0;
 
   Option<string> order = request.url.query.get("order");
-  string _order = order.isSome() && (order.get() == "asc") ? "asc" : "des";
+  const bool ascending = order.isSome() && (order.get() == "asc");
+
+  const Option<string> jsonp = request.url.query.get("jsonp");
 
   // Retrieve Approvers for authorizing frameworks and tasks.
   Future<Owned<ObjectApprover>> frameworksApprover;
@@ -3620,70 +3005,13 @@ Future<Response> Master::Http::tasks(
       Owned<ObjectApprover> tasksApprover;
       tie(frameworksApprover, tasksApprover) = approvers;
 
-      // Construct framework list with both active and completed frameworks.
-      vector<const Framework*> frameworks;
-      foreachvalue (Framework* framework, master->frameworks.registered) {
-        // Skip unauthorized frameworks.
-        if (!approveViewFrameworkInfo(frameworksApprover, framework->info)) {
-          continue;
-        }
-
-        frameworks.push_back(framework);
-      }
-
-      foreach (const std::shared_ptr<Framework>& framework,
-               master->frameworks.completed) {
-        // Skip unauthorized frameworks.
-        if (!approveViewFrameworkInfo(frameworksApprover, framework->info)) {
-          continue;
-        }
-
-        frameworks.push_back(framework.get());
-      }
-
-      // Construct task list with both running and finished tasks.
-      vector<const Task*> tasks;
-      foreach (const Framework* framework, frameworks) {
-        foreachvalue (Task* task, framework->tasks) {
-          CHECK_NOTNULL(task);
-          // Skip unauthorized tasks.
-          if (!approveViewTask(tasksApprover, *task, framework->info)) {
-            continue;
-          }
-
-          tasks.push_back(task);
-        }
-        foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
-          // Skip unauthorized tasks.
-          if (!approveViewTask(tasksApprover, *task.get(), framework->info)) {
-            continue;
-          }
-
-          tasks.push_back(task.get());
-        }
-      }
-
-      // Sort tasks by task status timestamp. Default order is descending.
-      // The earliest timestamp is chosen for comparison when
-      // multiple are present.
-      if (_order == "asc") {
-        sort(tasks.begin(), tasks.end(), TaskComparator::ascending);
-      } else {
-        sort(tasks.begin(), tasks.end(), TaskComparator::descending);
-      }
-
-      auto tasksWriter = [&tasks, limit, offset](JSON::ObjectWriter* writer) {
-        writer->field("tasks",
-                      [&tasks, limit, offset](JSON::ArrayWriter* writer) {
-          // Collect 'limit' number of tasks starting from 'offset'.
-          size_t end = std::min(offset + limit, tasks.size());
-          for (size_t i = offset; i < end; i++) {
-            writer->element(*tasks[i]);
-          }
-        });
-      };
-
-      return OK(jsonify(tasksWriter), request.url.query.get("jsonp"));
+      return master->stateReader->tasks(
+          frameworksApprover,
+          tasksApprover,
+          limit,
+          offset,
+          ascending,
+          jsonp);
   }));
 }
 
@@ -3725,15 +3053,8 @@ Future<Response> Master::Http::getTasks(
       Owned<ObjectApprover> tasksApprover;
       tie(frameworksApprover, tasksApprover) = approvers;
 
-      mesos::master::Response response;
-      response.set_type(mesos::master::Response::GET_TASKS);
-
-      response.mutable_get_tasks()->CopyFrom(
-          _getTasks(frameworksApprover,
-                    tasksApprover));
-
-      return OK(serialize(contentType, evolve(response)),
-                stringify(contentType));
+      return master->stateReader->getTasks(
+          frameworksApprover, tasksApprover, contentType);
   }));
 }
 
@@ -90,6 +90,8 @@ using mesos::log::Log;
 
 using mesos::allocator::Allocator;
 
+using mesos::internal::master::allocator::HierarchicalDRFAllocator;
+
 using mesos::master::contender::MasterContender;
 
 using mesos::master::detector::MasterDetector;
@@ -357,8 +359,12 @@ int main(int argc, char** argv)
   }
 
   // Create an instance of allocator.
+  // NOTE: The built-in allocator is created directly so that it can be
+  // configured with flags that allocator modules do not know about.
   const string allocatorName = flags.allocator;
-  Try<Allocator*> allocator = Allocator::create(allocatorName);
+  Try<Allocator*> allocator = allocatorName == DEFAULT_ALLOCATOR
+    ? HierarchicalDRFAllocator::create(flags.allocation_parallelism)
+    : Allocator::create(allocatorName);
 
   if (allocator.isError()) {
     EXIT(EXIT_FAILURE)
@@ -421,7 +427,7 @@ int main(int argc, char** argv)
           flags.log_auto_initialize,
           "registrar/");
     }
-    storage = new LogStorage(log);
+    storage = new LogStorage(log, 0, flags.registry_batch_writes);
   } else {
     EXIT(EXIT_FAILURE)
       << "'" << flags.registry << "' is not a supported"
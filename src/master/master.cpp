@@ -119,6 +119,7 @@ using process::UPID;
 using process::http::Pipe;
 
 using process::metrics::Counter;
+using process::metrics::PushGauge;
 
 namespace mesos {
 namespace internal {
@@ -293,6 +294,8 @@ Master::Master(
   : ProcessBase("master"),
     flags(_flags),
     http(this),
+    generation(0),
+    stateSummaries(MAX_STATE_SUMMARY_RESPONSES),
     allocator(_allocator),
     registrar(_registrar),
     files(_files),
@@ -842,6 +845,11 @@ void Master::initialize()
       &Master::authenticate,
       &AuthenticateMessage::pid);
 
+  stateReader.reset(new StateReader(
+      self(),
+      [this](StateSnapshot* snapshot) { http.snapshot(snapshot); },
+      STATE_READER_PROCESSES));
+
   // Setup HTTP routes.
   route("/api/v1",
         // TODO(benh): Is this authentication realm sufficient or do
@@ -1081,6 +1089,9 @@ void Master::initialize()
     }
   }
 
+  // Start pushing the gauges derived from the state.
+  refreshMetrics();
+
   contender->initialize(info_);
 
   // Start contending to be a leading master and detecting the current
@@ -2006,6 +2017,8 @@ void Master::detected(const Future<Option<MasterInfo>>& _leader)
   bool wasElected = elected();
   leader = _leader.get();
 
+  metrics->elected = elected() ? 1 : 0;
+
   if (elected()) {
     electedTime = Clock::now();
 
@@ -2773,6 +2786,8 @@ void Master::_subscribe(
       // TODO(bmahler): Shouldn't this re-link with the scheduler?
       framework->connected = true;
 
+      ++generation;
+
       // Reactivate the framework.
       // NOTE: We do this after recovering resources (above) so that
       // the allocator has the correct view of the framework's share.
@@ -2889,6 +2904,8 @@ void Master::disconnect(Framework* framework)
 
   framework->connected = false;
 
+  ++generation;
+
   if (framework->pid.isSome()) {
     // Remove the framework from authenticated. This is safe because
     // a framework will always reauthenticate before (re-)registering.
@@ -2914,6 +2931,8 @@ void Master::deactivate(Framework* framework)
   // Stop sending offers here for now.
   framework->active = false;
 
+  ++generation;
+
   // Tell the allocator to stop allocating resources to this framework.
   allocator->deactivateFramework(framework->id());
 
@@ -2948,6 +2967,8 @@ void Master::disconnect(Slave* slave)
 
   slave->connected = false;
 
+  ++generation;
+
   // Inform the slave observer.
   dispatch(slave->observer, &SlaveObserver::disconnect);
 
@@ -2967,6 +2988,8 @@ void Master::deactivate(Slave* slave)
 
   slave->active = false;
 
+  ++generation;
+
   allocator->deactivateSlave(slave->id);
 
   // Remove and rescind offers.
@@ -5253,6 +5276,8 @@ void Master::reregisterSlave(
     // Update slave's version after re-registering successfully.
     slave->version = version;
 
+    ++generation;
+
     // Reconcile tasks between master and the slave.
     // NOTE: This sends the re-registered message, including tasks
     // that need to be reconciled by the slave.
@@ -5361,6 +5386,8 @@ void Master::_reregisterSlave(
 
   slave->reregisteredTime = Clock::now();
 
+  ++generation;
+
   ++metrics->slave_reregistrations;
 
   // Check whether this master was the one that removed the
@@ -5551,6 +5578,8 @@ void Master::updateSlave(
   slave->totalResources =
     slave->totalResources.nonRevocable() + oversubscribedResources.revocable();
 
+  ++generation;
+
   // First update the agent's resources in the allocator.
   allocator->updateSlave(slaveId, oversubscribedResources);
 
@@ -6037,6 +6066,8 @@ void Master::_markUnreachable(
   slaves.unreachable[slave->id] = unreachableTime;
   authenticated.erase(slave->pid);
 
+  ++generation;
+
   // Remove the slave from the `machines` mapping.
   CHECK(machines.contains(slave->machineId));
   CHECK(machines[slave->machineId].slaves.contains(slave->id));
@@ -6433,6 +6464,8 @@ void Master::offer(const FrameworkID& frameworkId,
 
     offers[offer->id()] = offer;
 
+    metrics->outstanding_offers = offers.size();
+
     framework->addOffer(offer);
     slave->addOffer(offer);
 
@@ -6853,6 +6886,8 @@ void Master::addFramework(Framework* framework)
 
   frameworks.registered[framework->id()] = framework;
 
+  ++generation;
+
   // Remove from 'frameworks.recovered' if necessary.
   frameworks.recovered.erase(framework->id());
 
@@ -7019,6 +7054,8 @@ void Master::_failoverFramework(Framework* framework)
   // Reconnect and reactivate the framework.
   framework->connected = true;
 
+  ++generation;
+
   // Reactivate the framework.
   // NOTE: We do this after recovering resources (above) so that
   // the allocator has the correct view of the framework's share.
@@ -7192,6 +7229,8 @@ void Master::removeFramework(Framework* framework)
   frameworks.registered.erase(framework->id());
   allocator->removeFramework(framework->id());
 
+  ++generation;
+
   // Remove from 'frameworks.recovered' if necessary.
   frameworks.recovered.erase(framework->id());
 
@@ -7257,6 +7296,8 @@ void Master::addSlave(
 
   slaves.registered.put(slave);
 
+  ++generation;
+
   link(slave->pid);
 
   // Map the slave to the machine it is running on.
@@ -7503,6 +7544,8 @@ void Master::_removeSlave(
   slaves.removed.put(slave->id, Nothing());
   authenticated.erase(slave->pid);
 
+  ++generation;
+
   // Remove the slave from the `machines` mapping.
   CHECK(machines.contains(slave->machineId));
   CHECK(machines[slave->machineId].slaves.contains(slave->id));
@@ -7577,6 +7620,8 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
     }
   }
 
+  ++generation;
+
   // TODO(brenden): Consider wiping the `message` field?
   if (task->statuses_size() > 0 &&
       task->statuses(task->statuses_size() - 1).state() == status.state()) {
@@ -7811,6 +7856,8 @@ void Master::removeOffer(Offer* offer, bool rescind)
   // Delete it.
   offers.erase(offer->id());
   delete offer;
+
+  metrics->outstanding_offers = offers.size();
 }
 
 
@@ -7926,6 +7973,65 @@ SlaveID Master::newSlaveId()
 }
 
 
+void Master::refreshMetrics()
+{
+  // The gauges are recomputed periodically rather than whenever the
+  // state changes, since each refresh walks all agents and tasks.
+  delay(METRICS_REFRESH_INTERVAL, self(), &Master::refreshMetrics);
+
+  metrics->slaves_connected = _slaves_connected();
+  metrics->slaves_disconnected = _slaves_disconnected();
+  metrics->slaves_active = _slaves_active();
+  metrics->slaves_inactive = _slaves_inactive();
+
+  metrics->frameworks_connected = _frameworks_connected();
+  metrics->frameworks_disconnected = _frameworks_disconnected();
+  metrics->frameworks_active = _frameworks_active();
+  metrics->frameworks_inactive = _frameworks_inactive();
+
+  metrics->tasks_staging = _tasks_staging();
+  metrics->tasks_starting = _tasks_starting();
+  metrics->tasks_running = _tasks_running();
+  metrics->tasks_killing = _tasks_killing();
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_total) {
+    gauge = _resources_total(name);
+  }
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_used) {
+    gauge = _resources_used(name);
+  }
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_percent) {
+    gauge = _resources_percent(name);
+  }
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_revocable_total) {
+    gauge = _resources_revocable_total(name);
+  }
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_revocable_used) {
+    gauge = _resources_revocable_used(name);
+  }
+
+  foreachpair (const string& name,
+               PushGauge& gauge,
+               metrics->resources_revocable_percent) {
+    gauge = _resources_revocable_percent(name);
+  }
+}
+
+
 double Master::_slaves_active()
 {
   double count = 0.0;
@@ -8215,6 +8321,8 @@ void Slave::addTask(Task* task)
     usedResources[frameworkId] += task->resources();
   }
 
+  ++master->generation;
+
   if (!master->subscribers.subscribed.empty()) {
     master->subscribers.send(protobuf::master::event::createTaskAdded(*task));
   }
@@ -76,6 +76,8 @@
 #include "master/machine.hpp"
 #include "master/metrics.hpp"
 #include "master/registrar.hpp"
+#include "master/registry_operations.hpp"
+#include "master/state_reader.hpp"
 #include "master/validation.hpp"
 
 #include "messages/messages.hpp"
@@ -182,6 +184,8 @@ struct Slave
     if (!tasks.contains(frameworkId) && !executors.contains(frameworkId)) {
       usedResources.erase(frameworkId);
     }
+
+    ++master->generation;
   }
 
   void removeTask(Task* task)
@@ -205,6 +209,8 @@ struct Slave
     }
 
     killedTasks.remove(frameworkId, taskId);
+
+    ++master->generation;
   }
 
   void addOffer(Offer* offer)
@@ -213,6 +219,8 @@ struct Slave
 
     offers.insert(offer);
     offeredResources += offer->resources();
+
+    ++master->generation;
   }
 
   void removeOffer(Offer* offer)
@@ -221,6 +229,8 @@ struct Slave
 
     offeredResources -= offer->resources();
     offers.erase(offer);
+
+    ++master->generation;
   }
 
   void addInverseOffer(InverseOffer* inverseOffer)
@@ -255,6 +265,8 @@ struct Slave
 
     executors[frameworkId][executorInfo.executor_id()] = executorInfo;
     usedResources[frameworkId] += executorInfo.resources();
+
+    ++master->generation;
   }
 
   void removeExecutor(const FrameworkID& frameworkId,
@@ -270,6 +282,8 @@ struct Slave
     if (executors[frameworkId].empty()) {
       executors.erase(frameworkId);
     }
+
+    ++master->generation;
   }
 
   void apply(const Offer::Operation& operation)
@@ -279,6 +293,8 @@ struct Slave
 
     totalResources = resources.get();
     checkpointedResources = totalResources.filter(needCheckpointing);
+
+    ++master->generation;
   }
 
   Master* const master;
@@ -1188,6 +1204,11 @@ private:
     // desired request handler to get consistent request logging.
     static void log(const process::http::Request& request);
 
+    // Takes a snapshot of the state for the read-only calls of the
+    // v1 API and the JSON endpoints, see `StateReader`. Only copies
+    // the parts of the state requested in `snapshot->parts`.
+    void snapshot(StateSnapshot* snapshot) const;
+
     // /api/v1
     process::Future<process::http::Response> api(
         const process::http::Request& request,
@@ -1542,6 +1563,12 @@ private:
         const Option<std::string>& principal,
         ContentType contentType) const;
 
+    // Returns 304 NOT_MODIFIED if the request already has the cached
+    // response, or the cached response otherwise.
+    static process::http::Response cachedResponse(
+        const process::http::Request& request,
+        const CachedResponse& cached);
+
     Master* master;
 
     // NOTE: The quota specific pieces of the Operator API are factored
@@ -1575,6 +1602,20 @@ private:
 
   Http http;
 
+  // Serves the read-only calls of the v1 API and the JSON endpoints
+  // off the master actor.
+  process::Owned<StateReader> stateReader;
+
+  // Increased whenever the master changes the state that is shown by
+  // the '/state-summary' endpoint, so that its cached responses can
+  // be told apart from current ones.
+  uint64_t generation;
+
+  // The most recently used '/state-summary' responses, keyed by the
+  // principal they were filtered for when the master has an
+  // authorizer.
+  Cache<std::string, CachedResponse> stateSummaries;
+
   Option<MasterInfo> leader; // Current leading master.
 
   mesos::allocator::Allocator* allocator;
@@ -1851,17 +1892,11 @@ private:
   // copyable metric types only.
   std::shared_ptr<Metrics> metrics;
 
-  // Gauge handlers.
-  double _uptime_secs()
-  {
-    return (process::Clock::now() - startTime).secs();
-  }
-
-  double _elected()
-  {
-    return elected() ? 1 : 0;
-  }
+  // Pushes the gauges derived from the state of the master, every
+  // METRICS_REFRESH_INTERVAL.
+  void refreshMetrics();
 
+  // Gauge handlers.
   double _slaves_connected();
   double _slaves_disconnected();
   double _slaves_active();
@@ -1872,11 +1907,6 @@ private:
   double _frameworks_active();
   double _frameworks_inactive();
 
-  double _outstanding_offers()
-  {
-    return offers.size();
-  }
-
   double _event_queue_messages()
   {
     return static_cast<double>(eventCount<process::MessageEvent>());
@@ -1919,217 +1949,6 @@ private:
 };
 
 
-// Add a new slave to the list of admitted slaves.
-class AdmitSlave : public Operation
-{
-public:
-  explicit AdmitSlave(const SlaveInfo& _info) : info(_info)
-  {
-    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
-  }
-
-protected:
-  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
-  {
-    // Check if this slave is currently admitted. This should only
-    // happen if there is a slaveID collision, but that is extremely
-    // unlikely in practice: slaveIDs are prefixed with the master ID,
-    // which is a randomly generated UUID.
-    if (slaveIDs->contains(info.id())) {
-      return Error("Agent already admitted");
-    }
-
-    Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
-    slave->mutable_info()->CopyFrom(info);
-    slaveIDs->insert(info.id());
-    return true; // Mutation.
-  }
-
-private:
-  const SlaveInfo info;
-};
-
-
-// Move a slave from the list of admitted slaves to the list of
-// unreachable slaves.
-class MarkSlaveUnreachable : public Operation
-{
-public:
-  MarkSlaveUnreachable(const SlaveInfo& _info, TimeInfo _unreachableTime)
-    : info(_info), unreachableTime(_unreachableTime) {
-    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
-  }
-
-protected:
-  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
-  {
-    // As currently implemented, this should not be possible: the
-    // master will only mark slaves unreachable that are currently
-    // admitted.
-    if (!slaveIDs->contains(info.id())) {
-      return Error("Agent not yet admitted");
-    }
-
-    for (int i = 0; i < registry->slaves().slaves().size(); i++) {
-      const Registry::Slave& slave = registry->slaves().slaves(i);
-
-      if (slave.info().id() == info.id()) {
-        registry->mutable_slaves()->mutable_slaves()->DeleteSubrange(i, 1);
-        slaveIDs->erase(info.id());
-
-        Registry::UnreachableSlave* unreachable =
-          registry->mutable_unreachable()->add_slaves();
-
-        unreachable->mutable_id()->CopyFrom(info.id());
-        unreachable->mutable_timestamp()->CopyFrom(unreachableTime);
-
-        return true; // Mutation.
-      }
-    }
-
-    // Should not happen.
-    return Error("Failed to find agent " + stringify(info.id()));
-  }
-
-private:
-  const SlaveInfo info;
-  const TimeInfo unreachableTime;
-};
-
-
-// Add a slave back to the list of admitted slaves. The slave will
-// typically be in the "unreachable" list; if so, it is removed from
-// that list. The slave might also be in the "admitted" list already.
-// Finally, the slave might be in neither the "unreachable" or
-// "admitted" lists, if its metadata has been garbage collected from
-// the registry.
-class MarkSlaveReachable : public Operation
-{
-public:
-  explicit MarkSlaveReachable(const SlaveInfo& _info) : info(_info) {
-    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
-  }
-
-protected:
-  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
-  {
-    // A slave might try to reregister that appears in the list of
-    // admitted slaves. This can occur when the master fails over:
-    // agents will usually attempt to reregister with the new master
-    // before they are marked unreachable. In this situation, the
-    // registry is already in the correct state, so no changes are
-    // needed.
-    if (slaveIDs->contains(info.id())) {
-      return false; // No mutation.
-    }
-
-    // Check whether the slave is in the unreachable list.
-    // TODO(neilc): Optimize this to avoid linear scan.
-    bool found = false;
-    for (int i = 0; i < registry->unreachable().slaves().size(); i++) {
-      const Registry::UnreachableSlave& slave =
-        registry->unreachable().slaves(i);
-
-      if (slave.id() == info.id()) {
-        registry->mutable_unreachable()->mutable_slaves()->DeleteSubrange(i, 1);
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      LOG(WARNING) << "Allowing UNKNOWN agent to reregister: " << info;
-    }
-
-    // Add the slave to the admitted list, even if we didn't find it
-    // in the unreachable list. This accounts for when the slave was
-    // unreachable for a long time, was GC'd from the unreachable
-    // list, but then eventually reregistered.
-    Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
-    slave->mutable_info()->CopyFrom(info);
-    slaveIDs->insert(info.id());
-
-    return true; // Mutation.
-  }
-
-private:
-  const SlaveInfo info;
-};
-
-
-class PruneUnreachable : public Operation
-{
-public:
-  explicit PruneUnreachable(const hashset<SlaveID>& _toRemove)
-    : toRemove(_toRemove) {}
-
-protected:
-  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* /*slaveIDs*/)
-  {
-    // Attempt to remove the SlaveIDs in `toRemove` from the
-    // unreachable list. Some SlaveIDs in `toRemove` might not appear
-    // in the registry; this is possible if there was a concurrent
-    // registry operation.
-    //
-    // TODO(neilc): This has quadratic worst-case behavior, because
-    // `DeleteSubrange` for a `repeated` object takes linear time.
-    bool mutate = false;
-    int i = 0;
-    while (i < registry->unreachable().slaves().size()) {
-      const Registry::UnreachableSlave& slave =
-        registry->unreachable().slaves(i);
-
-      if (toRemove.contains(slave.id())) {
-        Registry::UnreachableSlaves* unreachable =
-          registry->mutable_unreachable();
-
-        unreachable->mutable_slaves()->DeleteSubrange(i, i+1);
-        mutate = true;
-        continue;
-      }
-
-      i++;
-    }
-
-    return mutate;
-  }
-
-private:
-  const hashset<SlaveID> toRemove;
-};
-
-
-// Implementation of slave removal Registrar operation.
-class RemoveSlave : public Operation
-{
-public:
-  explicit RemoveSlave(const SlaveInfo& _info) : info(_info)
-  {
-    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
-  }
-
-protected:
-  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
-  {
-    for (int i = 0; i < registry->slaves().slaves().size(); i++) {
-      const Registry::Slave& slave = registry->slaves().slaves(i);
-      if (slave.info().id() == info.id()) {
-        registry->mutable_slaves()->mutable_slaves()->DeleteSubrange(i, 1);
-        slaveIDs->erase(info.id());
-        return true; // Mutation.
-      }
-    }
-
-    // Should not happen: the master will only try to remove agents
-    // that are currently admitted.
-    return Error("Agent not yet admitted");
-  }
-
-private:
-  const SlaveInfo info;
-};
-
-
 inline std::ostream& operator<<(
     std::ostream& stream,
     const Framework& framework);
@@ -2237,6 +2056,8 @@ struct Framework
       totalUsedResources += task->resources();
       usedResources[task->slave_id()] += task->resources();
     }
+
+    ++master->generation;
   }
 
   // Notification of task termination, for resource accounting.
@@ -2255,6 +2076,8 @@ struct Framework
     if (usedResources[task->slave_id()].empty()) {
       usedResources.erase(task->slave_id());
     }
+
+    ++master->generation;
   }
 
   // Sends a message to the connected framework.
@@ -2281,6 +2104,8 @@ struct Framework
   {
     // TODO(adam-mesos): Check if completed task already exists.
     completedTasks.push_back(std::shared_ptr<Task>(new Task(task)));
+
+    ++master->generation;
   }
 
   void removeTask(Task* task)
@@ -2300,6 +2125,8 @@ struct Framework
     addCompletedTask(*task);
 
     tasks.erase(task->task_id());
+
+    ++master->generation;
   }
 
   void addOffer(Offer* offer)
@@ -2308,6 +2135,8 @@ struct Framework
     offers.insert(offer);
     totalOfferedResources += offer->resources();
     offeredResources[offer->slave_id()] += offer->resources();
+
+    ++master->generation;
   }
 
   void removeOffer(Offer* offer)
@@ -2322,6 +2151,8 @@ struct Framework
     }
 
     offers.erase(offer);
+
+    ++master->generation;
   }
 
   void addInverseOffer(InverseOffer* inverseOffer)
@@ -2356,6 +2187,8 @@ struct Framework
     executors[slaveId][executorInfo.executor_id()] = executorInfo;
     totalUsedResources += executorInfo.resources();
     usedResources[slaveId] += executorInfo.resources();
+
+    ++master->generation;
   }
 
   void removeExecutor(const SlaveID& slaveId,
@@ -2376,6 +2209,8 @@ struct Framework
     if (executors[slaveId].empty()) {
       executors.erase(slaveId);
     }
+
+    ++master->generation;
   }
 
   const FrameworkID id() const { return info.id(); }
@@ -2445,6 +2280,8 @@ struct Framework
     } else {
       info.clear_labels();
     }
+
+    ++master->generation;
   }
 
   void updateConnection(const process::UPID& newPid)
@@ -2457,6 +2294,8 @@ struct Framework
 
     // TODO(benh): unlink(oldPid);
     pid = newPid;
+
+    ++master->generation;
   }
 
   void updateConnection(const HttpConnection& newHttp)
@@ -2476,6 +2315,8 @@ struct Framework
     CHECK_NONE(http);
 
     http = newHttp;
+
+    ++master->generation;
   }
 
   // Closes the HTTP connection and stops the heartbeat.
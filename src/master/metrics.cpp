@@ -14,19 +14,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
 #include <string>
 
+#include <process/clock.hpp>
+#include <process/defer.hpp>
+#include <process/time.hpp>
+
 #include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/metrics/push_gauge.hpp>
 
 #include <stout/foreach.hpp>
 
 #include "master/master.hpp"
 #include "master/metrics.hpp"
 
+using process::Clock;
+using process::Time;
+
 using process::metrics::Counter;
 using process::metrics::Gauge;
+using process::metrics::PushGauge;
 
 using std::string;
 
@@ -34,55 +44,47 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+static double secondsSince(const Time& time)
+{
+  return (Clock::now() - time).secs();
+}
+
+
 // Message counters are named with "messages_" prefix so they can
 // be grouped together alphabetically in the output.
 // TODO(alexandra.sava): Add metrics for registered and removed slaves.
 Metrics::Metrics(const Master& master)
   : uptime_secs(
         "master/uptime_secs",
-        defer(master, &Master::_uptime_secs)),
+        process::defer(std::bind(&secondsSince, Clock::now()))),
     elected(
-        "master/elected",
-        defer(master, &Master::_elected)),
+        "master/elected"),
     slaves_connected(
-        "master/slaves_connected",
-        defer(master, &Master::_slaves_connected)),
+        "master/slaves_connected"),
     slaves_disconnected(
-        "master/slaves_disconnected",
-        defer(master, &Master::_slaves_disconnected)),
+        "master/slaves_disconnected"),
     slaves_active(
-        "master/slaves_active",
-        defer(master, &Master::_slaves_active)),
+        "master/slaves_active"),
     slaves_inactive(
-        "master/slaves_inactive",
-        defer(master, &Master::_slaves_inactive)),
+        "master/slaves_inactive"),
     frameworks_connected(
-        "master/frameworks_connected",
-        defer(master, &Master::_frameworks_connected)),
+        "master/frameworks_connected"),
     frameworks_disconnected(
-        "master/frameworks_disconnected",
-        defer(master, &Master::_frameworks_disconnected)),
+        "master/frameworks_disconnected"),
     frameworks_active(
-        "master/frameworks_active",
-        defer(master, &Master::_frameworks_active)),
+        "master/frameworks_active"),
     frameworks_inactive(
-        "master/frameworks_inactive",
-        defer(master, &Master::_frameworks_inactive)),
+        "master/frameworks_inactive"),
     outstanding_offers(
-        "master/outstanding_offers",
-        defer(master, &Master::_outstanding_offers)),
+        "master/outstanding_offers"),
     tasks_staging(
-        "master/tasks_staging",
-        defer(master, &Master::_tasks_staging)),
+        "master/tasks_staging"),
     tasks_starting(
-        "master/tasks_starting",
-        defer(master, &Master::_tasks_starting)),
+        "master/tasks_starting"),
     tasks_running(
-        "master/tasks_running",
-        defer(master, &Master::_tasks_running)),
+        "master/tasks_running"),
     tasks_killing(
-        "master/tasks_killing",
-        defer(master, &Master::_tasks_killing)),
+        "master/tasks_killing"),
     tasks_finished(
         "master/tasks_finished"),
     tasks_failed(
@@ -195,7 +197,11 @@ Metrics::Metrics(const Master& master)
     slave_unreachable_completed(
         "master/slave_unreachable_completed"),
     slave_unreachable_canceled(
-        "master/slave_unreachable_canceled")
+        "master/slave_unreachable_canceled"),
+    state_summary_cache_hits(
+        "master/state_summary_cache_hits"),
+    state_summary_cache_misses(
+        "master/state_summary_cache_misses")
 {
   // TODO(dhamon): Check return values of 'add'.
   process::metrics::add(uptime_secs);
@@ -289,27 +295,22 @@ Metrics::Metrics(const Master& master)
   process::metrics::add(slave_unreachable_completed);
   process::metrics::add(slave_unreachable_canceled);
 
+  process::metrics::add(state_summary_cache_hits);
+  process::metrics::add(state_summary_cache_misses);
+
   // Create resource gauges.
   // TODO(dhamon): Set these up dynamically when adding a slave based on the
   // resources the slave exposes.
   const string resources[] = {"cpus", "gpus", "mem", "disk"};
 
   foreach (const string& resource, resources) {
-    Gauge total(
-        "master/" + resource + "_total",
-        defer(master, &Master::_resources_total, resource));
-
-    Gauge used(
-        "master/" + resource + "_used",
-        defer(master, &Master::_resources_used, resource));
-
-    Gauge percent(
-        "master/" + resource + "_percent",
-        defer(master, &Master::_resources_percent, resource));
+    PushGauge total("master/" + resource + "_total");
+    PushGauge used("master/" + resource + "_used");
+    PushGauge percent("master/" + resource + "_percent");
 
-    resources_total.push_back(total);
-    resources_used.push_back(used);
-    resources_percent.push_back(percent);
+    resources_total.put(resource, total);
+    resources_used.put(resource, used);
+    resources_percent.put(resource, percent);
 
     process::metrics::add(total);
     process::metrics::add(used);
@@ -317,21 +318,13 @@ Metrics::Metrics(const Master& master)
   }
 
   foreach (const string& resource, resources) {
-    Gauge total(
-        "master/" + resource + "_revocable_total",
-        defer(master, &Master::_resources_revocable_total, resource));
+    PushGauge total("master/" + resource + "_revocable_total");
+    PushGauge used("master/" + resource + "_revocable_used");
+    PushGauge percent("master/" + resource + "_revocable_percent");
 
-    Gauge used(
-        "master/" + resource + "_revocable_used",
-        defer(master, &Master::_resources_revocable_used, resource));
-
-    Gauge percent(
-        "master/" + resource + "_revocable_percent",
-        defer(master, &Master::_resources_revocable_percent, resource));
-
-    resources_revocable_total.push_back(total);
-    resources_revocable_used.push_back(used);
-    resources_revocable_percent.push_back(percent);
+    resources_revocable_total.put(resource, total);
+    resources_revocable_used.put(resource, used);
+    resources_revocable_percent.put(resource, percent);
 
     process::metrics::add(total);
     process::metrics::add(used);
@@ -434,32 +427,35 @@ Metrics::~Metrics()
   process::metrics::remove(slave_unreachable_completed);
   process::metrics::remove(slave_unreachable_canceled);
 
-  foreach (const Gauge& gauge, resources_total) {
+  process::metrics::remove(state_summary_cache_hits);
+  process::metrics::remove(state_summary_cache_misses);
+
+  foreachvalue (const PushGauge& gauge, resources_total) {
     process::metrics::remove(gauge);
   }
   resources_total.clear();
 
-  foreach (const Gauge& gauge, resources_used) {
+  foreachvalue (const PushGauge& gauge, resources_used) {
     process::metrics::remove(gauge);
   }
   resources_used.clear();
 
-  foreach (const Gauge& gauge, resources_percent) {
+  foreachvalue (const PushGauge& gauge, resources_percent) {
     process::metrics::remove(gauge);
   }
   resources_percent.clear();
 
-  foreach (const Gauge& gauge, resources_revocable_total) {
+  foreachvalue (const PushGauge& gauge, resources_revocable_total) {
     process::metrics::remove(gauge);
   }
   resources_revocable_total.clear();
 
-  foreach (const Gauge& gauge, resources_revocable_used) {
+  foreachvalue (const PushGauge& gauge, resources_revocable_used) {
     process::metrics::remove(gauge);
   }
   resources_revocable_used.clear();
 
-  foreach (const Gauge& gauge, resources_revocable_percent) {
+  foreachvalue (const PushGauge& gauge, resources_revocable_percent) {
     process::metrics::remove(gauge);
   }
   resources_revocable_percent.clear();
@@ -18,11 +18,11 @@
 #define __MASTER_METRICS_HPP__
 
 #include <string>
-#include <vector>
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/metrics/push_gauge.hpp>
 
 #include <stout/hashmap.hpp>
 
@@ -41,26 +41,33 @@ struct Metrics
 
   ~Metrics();
 
+  // Counted from the creation of the master and evaluated by the
+  // metrics process rather than the master.
   process::metrics::Gauge uptime_secs;
-  process::metrics::Gauge elected;
 
-  process::metrics::Gauge slaves_connected;
-  process::metrics::Gauge slaves_disconnected;
-  process::metrics::Gauge slaves_active;
-  process::metrics::Gauge slaves_inactive;
+  // The gauges below are pushed by the master, so that a snapshot
+  // need not wait for it. Those derived from the master's state are
+  // refreshed by `Master::refreshMetrics()` every
+  // METRICS_REFRESH_INTERVAL.
+  process::metrics::PushGauge elected;
 
-  process::metrics::Gauge frameworks_connected;
-  process::metrics::Gauge frameworks_disconnected;
-  process::metrics::Gauge frameworks_active;
-  process::metrics::Gauge frameworks_inactive;
+  process::metrics::PushGauge slaves_connected;
+  process::metrics::PushGauge slaves_disconnected;
+  process::metrics::PushGauge slaves_active;
+  process::metrics::PushGauge slaves_inactive;
 
-  process::metrics::Gauge outstanding_offers;
+  process::metrics::PushGauge frameworks_connected;
+  process::metrics::PushGauge frameworks_disconnected;
+  process::metrics::PushGauge frameworks_active;
+  process::metrics::PushGauge frameworks_inactive;
+
+  process::metrics::PushGauge outstanding_offers;
 
   // Task state metrics.
-  process::metrics::Gauge tasks_staging;
-  process::metrics::Gauge tasks_starting;
-  process::metrics::Gauge tasks_running;
-  process::metrics::Gauge tasks_killing;
+  process::metrics::PushGauge tasks_staging;
+  process::metrics::PushGauge tasks_starting;
+  process::metrics::PushGauge tasks_running;
+  process::metrics::PushGauge tasks_killing;
   process::metrics::Counter tasks_finished;
   process::metrics::Counter tasks_failed;
   process::metrics::Counter tasks_killed;
@@ -165,7 +172,8 @@ struct Metrics
   // Recovery counters.
   process::metrics::Counter recovery_slave_removals;
 
-  // Process metrics.
+  // Process metrics. These are still evaluated on the master since
+  // they describe its event queue.
   process::metrics::Gauge event_queue_messages;
   process::metrics::Gauge event_queue_dispatches;
   process::metrics::Gauge event_queue_http_requests;
@@ -190,15 +198,20 @@ struct Metrics
   process::metrics::Counter slave_unreachable_completed;
   process::metrics::Counter slave_unreachable_canceled;
 
-  // Non-revocable resources.
-  std::vector<process::metrics::Gauge> resources_total;
-  std::vector<process::metrics::Gauge> resources_used;
-  std::vector<process::metrics::Gauge> resources_percent;
+  // Responses of the '/state-summary' endpoint served from, or
+  // rendered into, the cache.
+  process::metrics::Counter state_summary_cache_hits;
+  process::metrics::Counter state_summary_cache_misses;
+
+  // Non-revocable resources, keyed by resource name.
+  hashmap<std::string, process::metrics::PushGauge> resources_total;
+  hashmap<std::string, process::metrics::PushGauge> resources_used;
+  hashmap<std::string, process::metrics::PushGauge> resources_percent;
 
-  // Revocable resources.
-  std::vector<process::metrics::Gauge> resources_revocable_total;
-  std::vector<process::metrics::Gauge> resources_revocable_used;
-  std::vector<process::metrics::Gauge> resources_revocable_percent;
+  // Revocable resources, keyed by resource name.
+  hashmap<std::string, process::metrics::PushGauge> resources_revocable_total;
+  hashmap<std::string, process::metrics::PushGauge> resources_revocable_used;
+  hashmap<std::string, process::metrics::PushGauge> resources_revocable_percent;
 
   void incrementTasksStates(
       const TaskState& state,
@@ -15,12 +15,14 @@
 // limitations under the License.
 
 #include <deque>
+#include <list>
 #include <string>
 
 #include <mesos/type_utils.hpp>
 
 #include <mesos/state/protobuf.hpp>
 
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -34,6 +36,7 @@
 #include <process/metrics/metrics.hpp>
 #include <process/metrics/timer.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
@@ -41,8 +44,10 @@
 #include <stout/protobuf.hpp>
 #include <stout/stopwatch.hpp>
 
+#include "master/constants.hpp"
 #include "master/registrar.hpp"
 #include "master/registry.hpp"
+#include "master/registry_operations.hpp"
 
 using mesos::state::protobuf::State;
 using mesos::state::protobuf::Variable;
@@ -69,6 +74,7 @@ using process::metrics::Gauge;
 using process::metrics::Timer;
 
 using std::deque;
+using std::list;
 using std::string;
 
 namespace mesos {
@@ -88,6 +94,9 @@ public:
     : ProcessBase(process::ID::generate("registrar")),
       metrics(*this),
       updating(false),
+      deltas(0),
+      deltaBytes(0),
+      snapshotBytes(0),
       flags(_flags),
       state(_state),
       authenticationRealm(_authenticationRealm) {}
@@ -185,7 +194,7 @@ private:
   Future<double> _registry_size_bytes()
   {
     if (variable.isSome()) {
-      return variable.get().get().ByteSize();
+      return current.ByteSize();
     }
 
     return Failure("Not recovered yet");
@@ -194,23 +203,56 @@ private:
   // Continuations.
   void _recover(
       const MasterInfo& info,
-      const Future<Variable<Registry>>& recovery);
+      const Future<Nothing>& recovery);
   void __recover(const Future<bool>& recover);
   Future<bool> _apply(Owned<Operation> operation);
 
+  // Helpers for replaying the deltas stored after the registry.
+  Future<Nothing> replay(const Variable<Registry>& snapshot);
+  Future<Nothing> _replay();
+  Future<Nothing> __replay(const list<Variable<RegistryDelta>>& variables);
+
   // Helper for updating state (performing store).
   void update();
   void _update(
-      const Future<Option<Variable<Registry>>>& store,
+      const Future<bool>& store,
       deque<Owned<Operation>> operations);
 
+  // Continuations for storing either the entire registry or a delta.
+  Future<bool> _snapshot(const Option<Variable<Registry>>& store);
+  Future<bool> _delta(
+      const RegistryDelta& delta,
+      const Variable<RegistryDelta>& existing);
+  Future<bool> __delta(
+      const RegistryDelta& delta,
+      const Option<Variable<RegistryDelta>>& store);
+
   // Fails all pending operations and transitions the Registrar
   // into an error state in which all subsequent operations will fail.
   // This ensures we don't attempt to re-acquire log leadership by
   // performing more State storage operations.
   void abort(const string& message);
 
+  // The registry as last stored in its entirety.
   Option<Variable<Registry>> variable;
+
+  // The current registry, i.e., 'variable' with the deltas stored
+  // since applied, along with the accumulator for the operations.
+  Registry current;
+  hashset<SlaveID> slaveIDs;
+
+  // The number and total size of the deltas stored since 'variable'
+  // and the size of 'variable', which determine when we store the
+  // entire registry again.
+  size_t deltas;
+  size_t deltaBytes;
+  size_t snapshotBytes;
+
+  // The variables that hold the deltas, by name, as last fetched or
+  // stored. This saves fetching a variable before storing a delta
+  // in it, see `update()`.
+  hashmap<string, Variable<RegistryDelta>> deltaVariables;
+
   deque<Owned<Operation>> operations;
   bool updating; // Used to signify fetching (recovering) or storing.
 
@@ -254,6 +296,84 @@ void fail(deque<Owned<Operation>>* operations, const string& message)
 }
 
 
+// Returns the name of the variable that holds the delta with the
+// given version. Versions that are MAX_REGISTRY_DELTAS apart share a
+// variable, which is fine since we store the entire registry at
+// least that often.
+static string deltaName(uint64_t version)
+{
+  return "registry_delta_" + stringify(version % MAX_REGISTRY_DELTAS);
+}
+
+
+// The number of deltas fetched at once during recovery. Fetching stops
+// at the first batch that contains the end of the deltas.
+static const size_t DELTA_FETCH_BATCH_SIZE = 16;
+
+
+// Helper for recreating an operation from its representation in a
+// delta, see `Operation::serialize()`.
+static Try<Owned<Operation>> deserialize(
+    const RegistryDelta::Operation& operation)
+{
+  switch (operation.type()) {
+    case RegistryDelta::Operation::ADMIT_SLAVE:
+      if (!operation.has_admit_slave()) {
+        break;
+      }
+
+      return Owned<Operation>(
+          new AdmitSlave(operation.admit_slave().info()));
+
+    case RegistryDelta::Operation::MARK_SLAVE_UNREACHABLE:
+      if (!operation.has_mark_slave_unreachable()) {
+        break;
+      }
+
+      return Owned<Operation>(
+          new MarkSlaveUnreachable(
+              operation.mark_slave_unreachable().info(),
+              operation.mark_slave_unreachable().timestamp()));
+
+    case RegistryDelta::Operation::MARK_SLAVE_REACHABLE:
+      if (!operation.has_mark_slave_reachable()) {
+        break;
+      }
+
+      return Owned<Operation>(
+          new MarkSlaveReachable(operation.mark_slave_reachable().info()));
+
+    case RegistryDelta::Operation::PRUNE_UNREACHABLE: {
+      if (!operation.has_prune_unreachable()) {
+        break;
+      }
+
+      hashset<SlaveID> toRemove;
+      foreach (const SlaveID& slaveId, operation.prune_unreachable().ids()) {
+        toRemove.insert(slaveId);
+      }
+
+      return Owned<Operation>(new PruneUnreachable(toRemove));
+    }
+
+    case RegistryDelta::Operation::REMOVE_SLAVE:
+      if (!operation.has_remove_slave()) {
+        break;
+      }
+
+      return Owned<Operation>(
+          new RemoveSlave(operation.remove_slave().info()));
+
+    case RegistryDelta::Operation::UNKNOWN:
+      break;
+  }
+
+  return Error(
+      "Invalid operation of type " +
+      RegistryDelta::Operation::Type_Name(operation.type()));
+}
+
+
 Future<Response> RegistrarProcess::registry(
     const Request& request,
     const Option<string>& /* principal */)
@@ -261,7 +381,7 @@ Future<Response> RegistrarProcess::registry(
   JSON::Object result;
 
   if (variable.isSome()) {
-    result = JSON::protobuf(variable.get().get());
+    result = JSON::protobuf(current);
   }
 
   return OK(result, request.url.query.get("jsonp"));
@@ -330,9 +450,10 @@ Future<Registry> RegistrarProcess::recover(const MasterInfo& info)
 
     metrics.state_fetch.start();
     state->fetch<Registry>("registry")
+      .then(defer(self(), &Self::replay, lambda::_1))
       .after(flags.registry_fetch_timeout,
              lambda::bind(
-                 &timeout<Variable<Registry>>,
+                 &timeout<Nothing>,
                  "fetch",
                  flags.registry_fetch_timeout,
                  lambda::_1))
@@ -345,9 +466,108 @@ Future<Registry> RegistrarProcess::recover(const MasterInfo& info)
 }
 
 
+Future<Nothing> RegistrarProcess::replay(const Variable<Registry>& snapshot)
+{
+  variable = snapshot;
+  current = snapshot.get();
+
+  foreach (const Registry::Slave& slave, current.slaves().slaves()) {
+    slaveIDs.insert(slave.info().id());
+  }
+
+  // A registry that has never been stored has no deltas either.
+  if (!current.has_version()) {
+    return Nothing();
+  }
+
+  // NOTE: We replay the deltas even if `--registry_store_deltas` is
+  // not set, since they may have been stored by a previous master.
+  // The `Recover` operation then stores the entire registry, after
+  // which the deltas are no longer needed.
+  return _replay();
+}
+
+
+Future<Nothing> RegistrarProcess::_replay()
+{
+  // We don't know how many deltas follow the registry, hence we fetch
+  // them in batches until we find the end. This bounds the number of
+  // variables fetched beyond the deltas to a batch.
+  list<Future<Variable<RegistryDelta>>> futures;
+  for (size_t i = 1; i <= DELTA_FETCH_BATCH_SIZE; i++) {
+    futures.push_back(
+        state->fetch<RegistryDelta>(deltaName(current.version() + i)));
+  }
+
+  return collect(futures)
+    .then(defer(self(), &Self::__replay, lambda::_1));
+}
+
+
+Future<Nothing> RegistrarProcess::__replay(
+    const list<Variable<RegistryDelta>>& variables)
+{
+  // The version of the delta each variable was fetched for.
+  uint64_t version = current.version();
+  bool end = false;
+
+  foreach (const Variable<RegistryDelta>& fetched, variables) {
+    const RegistryDelta delta = fetched.get();
+    version++;
+
+    // The deltas end at the first variable that does not hold the
+    // next version, i.e., one that is empty or that holds a delta
+    // which preceded the registry.
+    if (end || delta.version() != current.version() + 1) {
+      end = true;
+
+      // We will store the next deltas in these variables.
+      deltaVariables.put(deltaName(version), fetched);
+      continue;
+    }
+
+    foreach (const RegistryDelta::Operation& operation, delta.operations()) {
+      Try<Owned<Operation>> deserialized = deserialize(operation);
+      if (deserialized.isError()) {
+        return Failure(
+            "Failed to replay delta " + stringify(delta.version()) +
+            ": " + deserialized.error());
+      }
+
+      // The operations in a delta mutated the registry when they
+      // were first applied, so they must do so again.
+      Try<bool> result = (*deserialized.get())(&current, &slaveIDs);
+      if (result.isError()) {
+        return Failure(
+            "Failed to replay delta " + stringify(delta.version()) +
+            ": " + result.error());
+      }
+    }
+
+    current.set_version(delta.version());
+
+    deltas++;
+    deltaBytes += delta.ByteSize();
+  }
+
+  // There are at most MAX_REGISTRY_DELTAS deltas following the
+  // registry, after which the variables hold older deltas again.
+  if (!end && deltas < MAX_REGISTRY_DELTAS) {
+    return _replay();
+  }
+
+  if (deltas > 0) {
+    LOG(INFO) << "Replayed " << deltas << " registry deltas"
+              << " (" << Bytes(deltaBytes) << ")";
+  }
+
+  return Nothing();
+}
+
+
 void RegistrarProcess::_recover(
     const MasterInfo& info,
-    const Future<Variable<Registry>>& recovery)
+    const Future<Nothing>& recovery)
 {
   updating = false;
 
@@ -360,13 +580,11 @@ void RegistrarProcess::_recover(
     Duration elapsed = metrics.state_fetch.stop();
 
     LOG(INFO) << "Successfully fetched the registry"
-              << " (" << Bytes(recovery.get().get().ByteSize()) << ")"
+              << " (" << Bytes(current.ByteSize()) << ")"
               << " in " << elapsed;
 
-    // Save the registry.
-    variable = recovery.get();
-
-    // Perform the Recover operation to add the new MasterInfo.
+    // Perform the Recover operation to add the new MasterInfo. This
+    // also stores the entire registry, see `update()`.
     Owned<Operation> operation(new Recover(info));
     operations.push_back(operation);
     operation->future()
@@ -391,11 +609,11 @@ void RegistrarProcess::__recover(const Future<bool>& recover)
   } else {
     LOG(INFO) << "Successfully recovered registrar";
 
-    // At this point _update() has updated 'variable' to contain
-    // the Registry with the latest MasterInfo.
+    // At this point 'current' contains the Registry with the
+    // latest MasterInfo, which _update() has stored.
     // Set the promise and un-gate any pending operations.
     CHECK_SOME(variable);
-    recovered.get()->set(variable.get().get());
+    recovered.get()->set(current);
   }
 }
 
@@ -444,29 +662,77 @@ void RegistrarProcess::update()
 
   updating = true;
 
-  // Create a snapshot of the current registry.
-  Registry registry = variable.get().get();
+  // Apply the operations to the current registry in place rather
+  // than to a copy of it. If storing fails we abort (see `_update()`)
+  // so there is no need to be able to roll back.
+  //
+  // Instead of storing the entire registry, which grows with the
+  // size of the cluster, we store a delta with just the operations
+  // that mutated the registry. The entire registry is stored when
+  // one of those operations has no representation in a delta, or
+  // once the deltas add up to MAX_REGISTRY_DELTAS or to the size of
+  // the registry, which bounds the cost of the recovery.
+  RegistryDelta delta;
+  delta.set_version(current.version() + 1);
+
+  bool snapshot =
+    !flags.registry_store_deltas || deltas >= MAX_REGISTRY_DELTAS;
 
-  // Create the 'slaveIDs' accumulator.
-  hashset<SlaveID> slaveIDs;
-  foreach (const Registry::Slave& slave, registry.slaves().slaves()) {
-    slaveIDs.insert(slave.info().id());
+  foreach (Owned<Operation> operation, operations) {
+    Try<bool> result = (*operation)(&current, &slaveIDs);
+
+    if (result.isError() || !result.get() || snapshot) {
+      continue; // No need to process the result of the operation.
+    }
+
+    Option<RegistryDelta::Operation> serialized = operation->serialize();
+
+    if (serialized.isNone()) {
+      snapshot = true;
+    } else {
+      delta.add_operations()->CopyFrom(serialized.get());
+    }
   }
 
-  foreach (Owned<Operation> operation, operations) {
-    // No need to process the result of the operation.
-    (*operation)(&registry, &slaveIDs);
+  current.set_version(delta.version());
+
+  // Note that we store a delta even if none of the operations
+  // mutated the registry, like we used to store the entire registry
+  // even if it didn't change.
+  const size_t size = delta.ByteSize();
+
+  if (deltaBytes + size > snapshotBytes) {
+    snapshot = true;
   }
 
   LOG(INFO) << "Applied " << operations.size() << " operations in "
-            << stopwatch.elapsed() << "; attempting to update the registry";
+            << stopwatch.elapsed() << "; attempting to update the registry"
+            << (snapshot ? "" : " (" + stringify(Bytes(size)) + " delta)");
 
   // Perform the store, and time the operation.
   metrics.state_store.start();
-  state->store(variable.get().mutate(registry))
+
+  Future<bool> store;
+  if (snapshot) {
+    store = state->store(variable.get().mutate(current))
+      .then(defer(self(), &Self::_snapshot, lambda::_1));
+  } else {
+    const string name = deltaName(delta.version());
+
+    // We only need to fetch the variable the first time we store a
+    // delta in it since the master started.
+    if (deltaVariables.contains(name)) {
+      store = _delta(delta, deltaVariables.at(name));
+    } else {
+      store = state->fetch<RegistryDelta>(name)
+        .then(defer(self(), &Self::_delta, delta, lambda::_1));
+    }
+  }
+
+  store
     .after(flags.registry_store_timeout,
            lambda::bind(
-               &timeout<Option<Variable<Registry>>>,
+               &timeout<bool>,
                "store",
                flags.registry_store_timeout,
                lambda::_1))
@@ -477,14 +743,64 @@ void RegistrarProcess::update()
 }
 
 
+Future<bool> RegistrarProcess::_snapshot(
+    const Option<Variable<Registry>>& store)
+{
+  if (store.isNone()) {
+    return false; // Version mismatch.
+  }
+
+  variable = store.get();
+
+  deltas = 0;
+  deltaBytes = 0;
+  snapshotBytes = current.ByteSize();
+
+  return true;
+}
+
+
+Future<bool> RegistrarProcess::_delta(
+    const RegistryDelta& delta,
+    const Variable<RegistryDelta>& existing)
+{
+  // The variable may hold an older delta, which we replace. If it
+  // holds this or a later version another registrar has updated the
+  // registry in the meantime.
+  if (existing.get().version() >= delta.version()) {
+    return false; // Version mismatch.
+  }
+
+  return state->store(existing.mutate(delta))
+    .then(defer(self(), &Self::__delta, delta, lambda::_1));
+}
+
+
+Future<bool> RegistrarProcess::__delta(
+    const RegistryDelta& delta,
+    const Option<Variable<RegistryDelta>>& store)
+{
+  if (store.isNone()) {
+    return false; // Version mismatch.
+  }
+
+  deltaVariables.put(deltaName(delta.version()), store.get());
+
+  deltas++;
+  deltaBytes += delta.ByteSize();
+
+  return true;
+}
+
+
 void RegistrarProcess::_update(
-    const Future<Option<Variable<Registry>>>& store,
+    const Future<bool>& store,
     deque<Owned<Operation>> applied)
 {
   updating = false;
 
   // Abort if the storage operation did not succeed.
-  if (!store.isReady() || store.get().isNone()) {
+  if (!store.isReady() || !store.get()) {
     string message = "Failed to update registry: ";
 
     if (store.isFailed()) {
@@ -505,8 +821,6 @@ void RegistrarProcess::_update(
 
   LOG(INFO) << "Successfully updated the registry in " << elapsed;
 
-  variable = store.get().get();
-
   // Remove the operations.
   while (!applied.empty()) {
     Owned<Operation> operation = applied.front();
@@ -26,6 +26,8 @@
 #include <process/pid.hpp>
 
 #include <stout/hashset.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
 
 #include "master/flags.hpp"
 #include "master/registry.hpp"
@@ -66,6 +68,15 @@ public:
   // Sets the promise based on whether the operation was successful.
   bool set() { return process::Promise<bool>::set(success); }
 
+  // Returns a representation of the operation from which it can be
+  // replayed, which lets the Registrar persist the operation instead
+  // of the entire Registry. Returns none if the operation has no such
+  // representation, in which case the entire Registry gets stored.
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    return None();
+  }
+
 protected:
   virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs) = 0;
 
@@ -0,0 +1,301 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_REGISTRY_OPERATIONS_HPP__
+#define __MASTER_REGISTRY_OPERATIONS_HPP__
+
+#include <glog/logging.h>
+
+#include <mesos/mesos.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "master/registrar.hpp"
+#include "master/registry.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Add a new slave to the list of admitted slaves.
+class AdmitSlave : public Operation
+{
+public:
+  explicit AdmitSlave(const SlaveInfo& _info) : info(_info)
+  {
+    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
+  }
+
+protected:
+  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
+  {
+    // Check if this slave is currently admitted. This should only
+    // happen if there is a slaveID collision, but that is extremely
+    // unlikely in practice: slaveIDs are prefixed with the master ID,
+    // which is a randomly generated UUID.
+    if (slaveIDs->contains(info.id())) {
+      return Error("Agent already admitted");
+    }
+
+    Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
+    slave->mutable_info()->CopyFrom(info);
+    slaveIDs->insert(info.id());
+    return true; // Mutation.
+  }
+
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    RegistryDelta::Operation operation;
+    operation.set_type(RegistryDelta::Operation::ADMIT_SLAVE);
+    operation.mutable_admit_slave()->mutable_info()->CopyFrom(info);
+    return operation;
+  }
+
+private:
+  const SlaveInfo info;
+};
+
+
+// Move a slave from the list of admitted slaves to the list of
+// unreachable slaves.
+class MarkSlaveUnreachable : public Operation
+{
+public:
+  MarkSlaveUnreachable(const SlaveInfo& _info, TimeInfo _unreachableTime)
+    : info(_info), unreachableTime(_unreachableTime) {
+    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
+  }
+
+protected:
+  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
+  {
+    // As currently implemented, this should not be possible: the
+    // master will only mark slaves unreachable that are currently
+    // admitted.
+    if (!slaveIDs->contains(info.id())) {
+      return Error("Agent not yet admitted");
+    }
+
+    for (int i = 0; i < registry->slaves().slaves().size(); i++) {
+      const Registry::Slave& slave = registry->slaves().slaves(i);
+
+      if (slave.info().id() == info.id()) {
+        registry->mutable_slaves()->mutable_slaves()->DeleteSubrange(i, 1);
+        slaveIDs->erase(info.id());
+
+        Registry::UnreachableSlave* unreachable =
+          registry->mutable_unreachable()->add_slaves();
+
+        unreachable->mutable_id()->CopyFrom(info.id());
+        unreachable->mutable_timestamp()->CopyFrom(unreachableTime);
+
+        return true; // Mutation.
+      }
+    }
+
+    // Should not happen.
+    return Error("Failed to find agent " + stringify(info.id()));
+  }
+
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    RegistryDelta::Operation operation;
+    operation.set_type(RegistryDelta::Operation::MARK_SLAVE_UNREACHABLE);
+
+    RegistryDelta::Operation::MarkSlaveUnreachable* unreachable =
+      operation.mutable_mark_slave_unreachable();
+
+    unreachable->mutable_info()->CopyFrom(info);
+    unreachable->mutable_timestamp()->CopyFrom(unreachableTime);
+
+    return operation;
+  }
+
+private:
+  const SlaveInfo info;
+  const TimeInfo unreachableTime;
+};
+
+
+// Add a slave back to the list of admitted slaves. The slave will
+// typically be in the "unreachable" list; if so, it is removed from
+// that list. The slave might also be in the "admitted" list already.
+// Finally, the slave might be in neither the "unreachable" or
+// "admitted" lists, if its metadata has been garbage collected from
+// the registry.
+class MarkSlaveReachable : public Operation
+{
+public:
+  explicit MarkSlaveReachable(const SlaveInfo& _info) : info(_info) {
+    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
+  }
+
+protected:
+  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
+  {
+    // A slave might try to reregister that appears in the list of
+    // admitted slaves. This can occur when the master fails over:
+    // agents will usually attempt to reregister with the new master
+    // before they are marked unreachable. In this situation, the
+    // registry is already in the correct state, so no changes are
+    // needed.
+    if (slaveIDs->contains(info.id())) {
+      return false; // No mutation.
+    }
+
+    // Check whether the slave is in the unreachable list.
+    // TODO(neilc): Optimize this to avoid linear scan.
+    bool found = false;
+    for (int i = 0; i < registry->unreachable().slaves().size(); i++) {
+      const Registry::UnreachableSlave& slave =
+        registry->unreachable().slaves(i);
+
+      if (slave.id() == info.id()) {
+        registry->mutable_unreachable()->mutable_slaves()->DeleteSubrange(i, 1);
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      LOG(WARNING) << "Allowing UNKNOWN agent to reregister: " << info;
+    }
+
+    // Add the slave to the admitted list, even if we didn't find it
+    // in the unreachable list. This accounts for when the slave was
+    // unreachable for a long time, was GC'd from the unreachable
+    // list, but then eventually reregistered.
+    Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
+    slave->mutable_info()->CopyFrom(info);
+    slaveIDs->insert(info.id());
+
+    return true; // Mutation.
+  }
+
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    RegistryDelta::Operation operation;
+    operation.set_type(RegistryDelta::Operation::MARK_SLAVE_REACHABLE);
+    operation.mutable_mark_slave_reachable()->mutable_info()->CopyFrom(info);
+    return operation;
+  }
+
+private:
+  const SlaveInfo info;
+};
+
+
+class PruneUnreachable : public Operation
+{
+public:
+  explicit PruneUnreachable(const hashset<SlaveID>& _toRemove)
+    : toRemove(_toRemove) {}
+
+protected:
+  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* /*slaveIDs*/)
+  {
+    // Attempt to remove the SlaveIDs in `toRemove` from the
+    // unreachable list. Some SlaveIDs in `toRemove` might not appear
+    // in the registry; this is possible if there was a concurrent
+    // registry operation.
+    //
+    // TODO(neilc): This has quadratic worst-case behavior, because
+    // `DeleteSubrange` for a `repeated` object takes linear time.
+    bool mutate = false;
+    int i = 0;
+    while (i < registry->unreachable().slaves().size()) {
+      const Registry::UnreachableSlave& slave =
+        registry->unreachable().slaves(i);
+
+      if (toRemove.contains(slave.id())) {
+        Registry::UnreachableSlaves* unreachable =
+          registry->mutable_unreachable();
+
+        unreachable->mutable_slaves()->DeleteSubrange(i, i+1);
+        mutate = true;
+        continue;
+      }
+
+      i++;
+    }
+
+    return mutate;
+  }
+
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    RegistryDelta::Operation operation;
+    operation.set_type(RegistryDelta::Operation::PRUNE_UNREACHABLE);
+
+    foreach (const SlaveID& slaveId, toRemove) {
+      operation.mutable_prune_unreachable()->add_ids()->CopyFrom(slaveId);
+    }
+
+    return operation;
+  }
+
+private:
+  const hashset<SlaveID> toRemove;
+};
+
+
+// Implementation of slave removal Registrar operation.
+class RemoveSlave : public Operation
+{
+public:
+  explicit RemoveSlave(const SlaveInfo& _info) : info(_info)
+  {
+    CHECK(info.has_id()) << "SlaveInfo is missing the 'id' field";
+  }
+
+protected:
+  virtual Try<bool> perform(Registry* registry, hashset<SlaveID>* slaveIDs)
+  {
+    for (int i = 0; i < registry->slaves().slaves().size(); i++) {
+      const Registry::Slave& slave = registry->slaves().slaves(i);
+      if (slave.info().id() == info.id()) {
+        registry->mutable_slaves()->mutable_slaves()->DeleteSubrange(i, 1);
+        slaveIDs->erase(info.id());
+        return true; // Mutation.
+      }
+    }
+
+    // Should not happen: the master will only try to remove agents
+    // that are currently admitted.
+    return Error("Agent not yet admitted");
+  }
+
+  virtual Option<RegistryDelta::Operation> serialize() const
+  {
+    RegistryDelta::Operation operation;
+    operation.set_type(RegistryDelta::Operation::REMOVE_SLAVE);
+    operation.mutable_remove_slave()->mutable_info()->CopyFrom(info);
+    return operation;
+  }
+
+private:
+  const SlaveInfo info;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_REGISTRY_OPERATIONS_HPP__
@@ -0,0 +1,1657 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "master/state_reader.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <mesos/attributes.hpp>
+#include <mesos/resources.hpp>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
+#include <stout/json.hpp>
+#include <stout/jsonify.hpp>
+#include <stout/nothing.hpp>
+#include <stout/representation.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+#include <stout/unreachable.hpp>
+
+#include "common/build.hpp"
+#include "common/protobuf_utils.hpp"
+
+#include "internal/evolve.hpp"
+
+#include "master/constants.hpp"
+
+#include "version/version.hpp"
+
+using process::Future;
+using process::Owned;
+using process::PID;
+using process::Process;
+using process::Promise;
+using process::Shared;
+using process::UPID;
+
+using process::http::OK;
+using process::http::Pipe;
+using process::http::Response;
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace mesos {
+
+static void json(
+    JSON::StringWriter* writer, const FrameworkInfo::Capability& capability)
+{
+  writer->append(FrameworkInfo::Capability::Type_Name(capability.type()));
+}
+
+
+static void json(JSON::ObjectWriter* writer, const Offer& offer)
+{
+  writer->field("id", offer.id().value());
+  writer->field("framework_id", offer.framework_id().value());
+  writer->field("slave_id", offer.slave_id().value());
+  writer->field("resources", Resources(offer.resources()));
+}
+
+namespace internal {
+namespace master {
+
+typedef mesos::master::Response::GetAgents::Agent Agent;
+
+
+// The summary representation of `T` to support the `/state-summary`
+// endpoint, e.g., `Summary<Agent>`.
+template <typename T>
+struct Summary : Representation<T>
+{
+  using Representation<T>::Representation;
+};
+
+
+// The full representation of `T` to support the `/slaves` endpoint.
+// e.g., `Full<Agent>`.
+template <typename T>
+struct Full : Representation<T>
+{
+  using Representation<T>::Representation;
+};
+
+
+static double secs(const TimeInfo& time)
+{
+  return Nanoseconds(time.nanoseconds()).secs();
+}
+
+
+static void json(JSON::ObjectWriter* writer, const Summary<Agent>& summary)
+{
+  const Agent& agent = summary;
+
+  writer->field("id", agent.agent_info().id().value());
+  writer->field("pid", agent.pid());
+  writer->field("hostname", agent.agent_info().hostname());
+  writer->field("registered_time", secs(agent.registered_time()));
+
+  if (agent.has_reregistered_time()) {
+    writer->field("reregistered_time", secs(agent.reregistered_time()));
+  }
+
+  const Resources totalResources = agent.total_resources();
+  writer->field("resources", totalResources);
+  writer->field("used_resources", Resources(agent.allocated_resources()));
+  writer->field("offered_resources", Resources(agent.offered_resources()));
+  writer->field("reserved_resources", totalResources.reservations());
+  writer->field("unreserved_resources", totalResources.unreserved());
+
+  writer->field("attributes", Attributes(agent.agent_info().attributes()));
+  writer->field("active", agent.active());
+  writer->field("version", agent.version());
+}
+
+
+// The `/slaves` representation of an agent, which adds the complete
+// protobuf->JSON for all used, reserved, and offered resources. The
+// other endpoints summarize resource information, which omits the
+// details of reservations and persistent volumes. Full resource
+// information is necessary so that operators can use the
+// `/unreserve` and `/destroy-volumes` endpoints.
+static void json(JSON::ObjectWriter* writer, const Full<Agent>& full)
+{
+  const Agent& agent = full;
+
+  json(writer, Summary<Agent>(agent));
+
+  hashmap<string, Resources> reserved =
+    Resources(agent.total_resources()).reservations();
+
+  writer->field(
+      "reserved_resources_full",
+      [&reserved](JSON::ObjectWriter* writer) {
+        foreachpair (const string& role,
+                     const Resources& resources,
+                     reserved) {
+          writer->field(role, [&resources](JSON::ArrayWriter* writer) {
+            foreach (const Resource& resource, resources) {
+              writer->element(JSON::Protobuf(resource));
+            }
+          });
+        }
+      });
+
+  writer->field(
+      "used_resources_full",
+      [&agent](JSON::ArrayWriter* writer) {
+        foreach (const Resource& resource, agent.allocated_resources()) {
+          writer->element(JSON::Protobuf(resource));
+        }
+      });
+
+  writer->field(
+      "offered_resources_full",
+      [&agent](JSON::ArrayWriter* writer) {
+        foreach (const Resource& resource, agent.offered_resources()) {
+          writer->element(JSON::Protobuf(resource));
+        }
+      });
+}
+
+
+static void json(
+    JSON::ObjectWriter* writer,
+    const Summary<StateSnapshot::Framework>& summary)
+{
+  const StateSnapshot::Framework& framework = summary;
+  const FrameworkInfo& info = framework.framework.framework_info();
+
+  writer->field("id", info.id().value());
+  writer->field("name", info.name());
+
+  // Omit pid for http frameworks.
+  if (framework.pid.isSome()) {
+    writer->field("pid", string(framework.pid.get()));
+  }
+
+  // TODO(bmahler): Use these in the webui.
+  writer->field(
+      "used_resources",
+      Resources(framework.framework.allocated_resources()));
+  writer->field(
+      "offered_resources",
+      Resources(framework.framework.offered_resources()));
+  writer->field("capabilities", info.capabilities());
+  writer->field("hostname", info.hostname());
+  writer->field("webui_url", info.webui_url());
+  writer->field("active", framework.framework.active());
+}
+
+
+// Filtered full representation of a framework, to support the
+// `/state` and `/frameworks` endpoints. Executors and tasks are
+// filtered based on whether the user is authorized to view them.
+struct FullFrameworkWriter {
+  FullFrameworkWriter(
+      const Owned<ObjectApprover>& taskApprover,
+      const Owned<ObjectApprover>& executorApprover,
+      const StateSnapshot::Framework& framework)
+    : taskApprover_(taskApprover),
+      executorApprover_(executorApprover),
+      framework_(framework),
+      info_(framework.framework.framework_info()) {}
+
+  void operator()(JSON::ObjectWriter* writer) const
+  {
+    json(writer, Summary<StateSnapshot::Framework>(framework_));
+
+    const mesos::master::Response::GetFrameworks::Framework& framework =
+      framework_.framework;
+
+    // Add additional fields to those generated by the
+    // `Summary<Framework>` overload.
+    writer->field("user", info_.user());
+    writer->field("failover_timeout", info_.failover_timeout());
+    writer->field("checkpoint", info_.checkpoint());
+    writer->field("role", info_.role());
+    writer->field("registered_time", secs(framework.registered_time()));
+    writer->field("unregistered_time", secs(framework.unregistered_time()));
+
+    if (info_.has_principal()) {
+      writer->field("principal", info_.principal());
+    }
+
+    // TODO(bmahler): Consider deprecating this in favor of the split
+    // used and offered resources added in `Summary<Framework>`.
+    writer->field(
+        "resources",
+        Resources(framework.allocated_resources()) +
+          Resources(framework.offered_resources()));
+
+    // TODO(benh): Consider making reregisteredTime an Option.
+    if (framework.registered_time().nanoseconds() !=
+        framework.reregistered_time().nanoseconds()) {
+      writer->field("reregistered_time", secs(framework.reregistered_time()));
+    }
+
+    // Model all of the tasks associated with a framework.
+    writer->field("tasks", [this](JSON::ArrayWriter* writer) {
+      foreach (const TaskInfo& taskInfo, framework_.pendingTasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTaskInfo(taskApprover_, taskInfo, info_)) {
+          continue;
+        }
+
+        writer->element([this, &taskInfo](JSON::ObjectWriter* writer) {
+          writer->field("id", taskInfo.task_id().value());
+          writer->field("name", taskInfo.name());
+          writer->field("framework_id", info_.id().value());
+
+          writer->field(
+            "executor_id",
+            taskInfo.executor().executor_id().value());
+
+          writer->field("slave_id", taskInfo.slave_id().value());
+          writer->field("state", TaskState_Name(TASK_STAGING));
+          writer->field("resources", Resources(taskInfo.resources()));
+          writer->field("statuses", std::initializer_list<TaskStatus>{});
+
+          if (taskInfo.has_labels()) {
+            writer->field("labels", taskInfo.labels());
+          }
+
+          if (taskInfo.has_discovery()) {
+            writer->field("discovery", JSON::Protobuf(taskInfo.discovery()));
+          }
+
+          if (taskInfo.has_container()) {
+            writer->field("container", JSON::Protobuf(taskInfo.container()));
+          }
+        });
+      }
+
+      foreach (const Task& task, framework_.tasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(taskApprover_, task, info_)) {
+          continue;
+        }
+
+        writer->element(task);
+      }
+    });
+
+    writer->field("completed_tasks", [this](JSON::ArrayWriter* writer) {
+      foreach (const Task& task, framework_.completedTasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(taskApprover_, task, info_)) {
+          continue;
+        }
+
+        writer->element(task);
+      }
+    });
+
+    // Model all of the offers associated with a framework.
+    writer->field("offers", [&framework](JSON::ArrayWriter* writer) {
+      foreach (const Offer& offer, framework.offers()) {
+        writer->element(offer);
+      }
+    });
+
+    // Model all of the executors of a framework.
+    writer->field("executors", [this](JSON::ArrayWriter* writer) {
+      foreach (
+          const mesos::master::Response::GetExecutors::Executor& executor,
+          framework_.executors) {
+        writer->element([this, &executor](JSON::ObjectWriter* writer) {
+          // Skip unauthorized executors.
+          if (!approveViewExecutorInfo(
+                  executorApprover_,
+                  executor.executor_info(),
+                  info_)) {
+            return;
+          }
+
+          json(writer, executor.executor_info());
+          writer->field("slave_id", executor.slave_id().value());
+        });
+      }
+    });
+
+    // Model all of the labels associated with a framework.
+    if (info_.has_labels()) {
+      writer->field("labels", info_.labels());
+    }
+  }
+
+  const Owned<ObjectApprover>& taskApprover_;
+  const Owned<ObjectApprover>& executorApprover_;
+  const StateSnapshot::Framework& framework_;
+  const FrameworkInfo& info_;
+};
+
+
+// This abstraction has no side-effects. It factors out the accounting
+// for a 'TaskState' summary. We use this to summarize 'TaskState's
+// for both frameworks as well as agents.
+struct TaskStateSummary
+{
+  // TODO(jmlvanre): Possibly clean this up as per MESOS-2694.
+  const static TaskStateSummary EMPTY;
+
+  TaskStateSummary()
+    : staging(0),
+      starting(0),
+      running(0),
+      killing(0),
+      finished(0),
+      killed(0),
+      failed(0),
+      lost(0),
+      error(0),
+      dropped(0),
+      unreachable(0),
+      gone(0),
+      gone_by_operator(0),
+      unknown(0) {}
+
+  // Account for the given task state.
+  void count(TaskState state)
+  {
+    switch (state) {
+      case TASK_STAGING: { ++staging; break; }
+      case TASK_STARTING: { ++starting; break; }
+      case TASK_RUNNING: { ++running; break; }
+      case TASK_KILLING: { ++killing; break; }
+      case TASK_FINISHED: { ++finished; break; }
+      case TASK_KILLED: { ++killed; break; }
+      case TASK_FAILED: { ++failed; break; }
+      case TASK_LOST: { ++lost; break; }
+      case TASK_ERROR: { ++error; break; }
+      case TASK_DROPPED: { ++dropped; break; }
+      case TASK_UNREACHABLE: { ++unreachable; break; }
+      case TASK_GONE: { ++gone; break; }
+      case TASK_GONE_BY_OPERATOR: { ++gone_by_operator; break; }
+      case TASK_UNKNOWN: { ++unknown; break; }
+      // No default case allows for a helpful compiler error if we
+      // introduce a new state.
+    }
+  }
+
+  size_t staging;
+  size_t starting;
+  size_t running;
+  size_t killing;
+  size_t finished;
+  size_t killed;
+  size_t failed;
+  size_t lost;
+  size_t error;
+  size_t dropped;
+  size_t unreachable;
+  size_t gone;
+  size_t gone_by_operator;
+  size_t unknown;
+};
+
+
+const TaskStateSummary TaskStateSummary::EMPTY;
+
+
+// This abstraction has no side-effects. It factors out computing the
+// 'TaskState' summaries of the registered frameworks and of the
+// agents, as well as the mappings from agents to frameworks and back.
+// This answers the questions 'How many tasks are in each state for a
+// given framework (or agent)?' and 'Which frameworks have tasks on a
+// given agent (and vice versa)?'.
+class TaskStateSummaries
+{
+public:
+  explicit TaskStateSummaries(const StateSnapshot& snapshot)
+  {
+    foreach (const StateSnapshot::Framework& framework, snapshot.frameworks) {
+      if (framework.completed) {
+        continue;
+      }
+
+      const FrameworkID& frameworkId =
+        framework.framework.framework_info().id();
+
+      typedef pair<SlaveID, TaskState> TaskStatePair;
+      foreach (const TaskStatePair& task, framework.taskStates) {
+        frameworkTaskSummaries[frameworkId].count(task.second);
+        slaveTaskSummaries[task.first].count(task.second);
+
+        frameworksToSlaves[frameworkId].insert(task.first);
+        slavesToFrameworks[task.first].insert(frameworkId);
+      }
+    }
+  }
+
+  const TaskStateSummary& framework(const FrameworkID& frameworkId) const
+  {
+    const auto iterator = frameworkTaskSummaries.find(frameworkId);
+    return iterator != frameworkTaskSummaries.end() ?
+      iterator->second : TaskStateSummary::EMPTY;
+  }
+
+  const TaskStateSummary& slave(const SlaveID& slaveId) const
+  {
+    const auto iterator = slaveTaskSummaries.find(slaveId);
+    return iterator != slaveTaskSummaries.end() ?
+      iterator->second : TaskStateSummary::EMPTY;
+  }
+
+  const hashset<FrameworkID>& frameworks(const SlaveID& slaveId) const
+  {
+    const auto iterator = slavesToFrameworks.find(slaveId);
+    return iterator != slavesToFrameworks.end() ?
+      iterator->second : hashset<FrameworkID>::EMPTY;
+  }
+
+  const hashset<SlaveID>& slaves(const FrameworkID& frameworkId) const
+  {
+    const auto iterator = frameworksToSlaves.find(frameworkId);
+    return iterator != frameworksToSlaves.end() ?
+      iterator->second : hashset<SlaveID>::EMPTY;
+  }
+
+private:
+  hashmap<FrameworkID, TaskStateSummary> frameworkTaskSummaries;
+  hashmap<SlaveID, TaskStateSummary> slaveTaskSummaries;
+  hashmap<SlaveID, hashset<FrameworkID>> slavesToFrameworks;
+  hashmap<FrameworkID, hashset<SlaveID>> frameworksToSlaves;
+};
+
+
+static void json(JSON::ObjectWriter* writer, const TaskStateSummary& summary)
+{
+  // TODO(neilc): Update for new PARTITION_AWARE task statuses.
+  writer->field("TASK_STAGING", summary.staging);
+  writer->field("TASK_STARTING", summary.starting);
+  writer->field("TASK_RUNNING", summary.running);
+  writer->field("TASK_KILLING", summary.killing);
+  writer->field("TASK_FINISHED", summary.finished);
+  writer->field("TASK_KILLED", summary.killed);
+  writer->field("TASK_FAILED", summary.failed);
+  writer->field("TASK_LOST", summary.lost);
+  writer->field("TASK_ERROR", summary.error);
+}
+
+
+struct TaskComparator
+{
+  static bool ascending(const Task* lhs, const Task* rhs)
+  {
+    size_t lhsSize = lhs->statuses().size();
+    size_t rhsSize = rhs->statuses().size();
+
+    if ((lhsSize == 0) && (rhsSize == 0)) {
+      return false;
+    }
+
+    if (lhsSize == 0) {
+      return true;
+    }
+
+    if (rhsSize == 0) {
+      return false;
+    }
+
+    return (lhs->statuses(0).timestamp() < rhs->statuses(0).timestamp());
+  }
+
+  static bool descending(const Task* lhs, const Task* rhs)
+  {
+    size_t lhsSize = lhs->statuses().size();
+    size_t rhsSize = rhs->statuses().size();
+
+    if ((lhsSize == 0) && (rhsSize == 0)) {
+      return false;
+    }
+
+    if (rhsSize == 0) {
+      return true;
+    }
+
+    if (lhsSize == 0) {
+      return false;
+    }
+
+    return (lhs->statuses(0).timestamp() > rhs->statuses(0).timestamp());
+  }
+};
+
+
+// Writes the `/state` endpoint one piece at a time: a piece is either
+// the fields of the master itself, a single agent, framework or orphan
+// task, or the ID of an unregistered framework. This lets the state be
+// streamed without rendering all of it at once, see `stream()`.
+class StateWriter
+{
+public:
+  StateWriter(
+      const Shared<StateSnapshot>& _snapshot,
+      const Owned<ObjectApprover>& _frameworksApprover,
+      const Owned<ObjectApprover>& _tasksApprover,
+      const Owned<ObjectApprover>& _executorsApprover,
+      const Owned<ObjectApprover>& _flagsApprover,
+      const Option<string>& _jsonp)
+    : snapshot(_snapshot),
+      frameworksApprover(_frameworksApprover),
+      tasksApprover(_tasksApprover),
+      executorsApprover(_executorsApprover),
+      flagsApprover(_flagsApprover),
+      jsonp(_jsonp),
+      field(Field::HEADER),
+      index(0),
+      count(0) {}
+
+  // Writes the state into the pipe in chunks of at least
+  // `STATE_STREAM_CHUNK_SIZE` (unless it is the last one). The next
+  // chunk is only written on `pid` once the reader has consumed the
+  // previous one.
+  static void stream(
+      const UPID& pid,
+      const std::shared_ptr<StateWriter>& state,
+      Pipe::Writer writer)
+  {
+    // Stop writing if the client has gone away.
+    if (!writer.readerClosed().isPending()) {
+      return;
+    }
+
+    std::ostringstream chunk;
+
+    bool more = true;
+    while (more &&
+           chunk.tellp() < static_cast<std::streamoff>(
+               STATE_STREAM_CHUNK_SIZE.bytes())) {
+      more = state->next(&chunk);
+    }
+
+    writer.write(chunk.str());
+
+    if (!more) {
+      writer.close();
+      return;
+    }
+
+    // Wait for the reader to consume the chunk before writing the
+    // next one, so that a slow client does not make us buffer the
+    // whole state.
+    writer.drained()
+      .onAny(process::defer(pid, [pid, state, writer](
+          const Future<Nothing>&) {
+        stream(pid, state, writer);
+      }));
+  }
+
+  // Writes the next piece of the state, returns false once the whole
+  // state has been written.
+  bool next(std::ostream* stream)
+  {
+    switch (field) {
+      case Field::HEADER: {
+        if (jsonp.isSome()) {
+          *stream << jsonp.get() << "(";
+        }
+
+        // All the fields other than the arrays are written at once,
+        // the closing brace of the object is written with the footer.
+        string header = jsonify([this](JSON::ObjectWriter* writer) {
+          header_(writer);
+        });
+
+        CHECK(strings::endsWith(header, "}"));
+        header.pop_back();
+
+        *stream << header;
+
+        begin(stream, "slaves", Field::SLAVES);
+        return true;
+      }
+
+      // Model all of the agents.
+      case Field::SLAVES: {
+        if (index == static_cast<size_t>(snapshot->agents.agents_size())) {
+          end(stream, "frameworks", Field::FRAMEWORKS);
+          return true;
+        }
+
+        element(stream, jsonify(
+            Summary<Agent>(snapshot->agents.agents(index++))));
+
+        return true;
+      }
+
+      // Model all of the frameworks, then all of the completed ones.
+      case Field::FRAMEWORKS:
+      case Field::COMPLETED_FRAMEWORKS: {
+        const bool completed = field == Field::COMPLETED_FRAMEWORKS;
+
+        if (index == snapshot->frameworks.size()) {
+          if (completed) {
+            end(stream, "orphan_tasks", Field::ORPHAN_TASKS);
+          } else {
+            end(stream, "completed_frameworks", Field::COMPLETED_FRAMEWORKS);
+          }
+          return true;
+        }
+
+        const StateSnapshot::Framework& framework =
+          snapshot->frameworks[index++];
+
+        // Skip unauthorized frameworks.
+        if (framework.completed == completed &&
+            approveViewFrameworkInfo(
+                frameworksApprover, framework.framework.framework_info())) {
+          element(stream, jsonify(FullFrameworkWriter(
+              tasksApprover, executorsApprover, framework)));
+        }
+
+        return true;
+      }
+
+      // Model all of the orphan tasks.
+      case Field::ORPHAN_TASKS: {
+        if (index == snapshot->orphanTasks.size()) {
+          end(stream,
+              "unregistered_frameworks",
+              Field::UNREGISTERED_FRAMEWORKS);
+          return true;
+        }
+
+        const Task& task = snapshot->orphanTasks[index++];
+
+        // TODO(joerg84): This logic should be simplified after a
+        // deprecation cycle starting with 1.0 as after that we can
+        // rely on the recovered frameworks containing all
+        // FrameworkInfos. Until then there are 3 cases:
+        // - No authorization enabled: show all orphaned tasks.
+        // - Authorization enabled, but no FrameworkInfo present:
+        //   do not show orphaned tasks.
+        // - Authorization enabled, FrameworkInfo present: filter
+        //   based on 'approveViewTask'.
+        if (snapshot->authorization) {
+          Option<FrameworkInfo> frameworkInfo =
+            snapshot->recoveredFrameworks.get(task.framework_id());
+
+          if (frameworkInfo.isNone() ||
+              !approveViewTask(tasksApprover, task, frameworkInfo.get())) {
+            return true;
+          }
+        }
+
+        element(stream, jsonify(task));
+        return true;
+      }
+
+      // Model all currently unregistered frameworks. This can happen
+      // when a framework has yet to re-register after master failover.
+      // TODO(vinod): Need to filter these frameworks based on
+      // authorization! See the TODO above for "orphan_tasks" for
+      // further details.
+      case Field::UNREGISTERED_FRAMEWORKS: {
+        if (index == snapshot->orphanFrameworks.size()) {
+          *stream << "]}";
+
+          if (jsonp.isSome()) {
+            *stream << ");";
+          }
+
+          field = Field::DONE;
+          return false;
+        }
+
+        element(stream, jsonify(snapshot->orphanFrameworks[index++].value()));
+        return true;
+      }
+
+      case Field::DONE:
+        return false;
+    }
+
+    UNREACHABLE();
+  }
+
+private:
+  enum class Field
+  {
+    HEADER,
+    SLAVES,
+    FRAMEWORKS,
+    COMPLETED_FRAMEWORKS,
+    ORPHAN_TASKS,
+    UNREGISTERED_FRAMEWORKS,
+    DONE
+  };
+
+  // Writes the fields of the master itself.
+  void header_(JSON::ObjectWriter* writer) const
+  {
+    writer->field("version", MESOS_VERSION);
+
+    if (build::GIT_SHA.isSome()) {
+      writer->field("git_sha", build::GIT_SHA.get());
+    }
+
+    if (build::GIT_BRANCH.isSome()) {
+      writer->field("git_branch", build::GIT_BRANCH.get());
+    }
+
+    if (build::GIT_TAG.isSome()) {
+      writer->field("git_tag", build::GIT_TAG.get());
+    }
+
+    writer->field("build_date", build::DATE);
+    writer->field("build_time", build::TIME);
+    writer->field("build_user", build::USER);
+    writer->field("start_time", snapshot->startTime.secs());
+
+    if (snapshot->electedTime.isSome()) {
+      writer->field("elected_time", snapshot->electedTime.get().secs());
+    }
+
+    writer->field("id", snapshot->info.id());
+    writer->field("pid", string(snapshot->pid));
+    writer->field("hostname", snapshot->info.hostname());
+    writer->field("activated_slaves", snapshot->activatedAgents);
+    writer->field("deactivated_slaves", snapshot->deactivatedAgents);
+
+    if (snapshot->leader.isSome()) {
+      writer->field("leader", snapshot->leader.get().pid());
+    }
+
+    if (approveViewFlags(flagsApprover)) {
+      if (snapshot->cluster.isSome()) {
+        writer->field("cluster", snapshot->cluster.get());
+      }
+
+      if (snapshot->logDir.isSome()) {
+        writer->field("log_dir", snapshot->logDir.get());
+      }
+
+      if (snapshot->externalLogFile.isSome()) {
+        writer->field("external_log_file", snapshot->externalLogFile.get());
+      }
+
+      writer->field("flags", [this](JSON::ObjectWriter* writer) {
+        typedef pair<string, string> Flag;
+        foreach (const Flag& flag, snapshot->flags) {
+          writer->field(flag.first, flag.second);
+        }
+      });
+    }
+  }
+
+  // Opens the array `name` and moves on to writing its elements.
+  void begin(std::ostream* stream, const string& name, Field following)
+  {
+    *stream << ',' << jsonify(name) << ":[";
+
+    field = following;
+    index = 0;
+    count = 0;
+  }
+
+  // Closes the current array and opens the next one.
+  void end(std::ostream* stream, const string& name, Field following)
+  {
+    *stream << ']';
+
+    begin(stream, name, following);
+  }
+
+  void element(std::ostream* stream, JSON::Proxy&& value)
+  {
+    if (count++ > 0) {
+      *stream << ',';
+    }
+
+    *stream << std::move(value);
+  }
+
+  const Shared<StateSnapshot> snapshot;
+
+  const Owned<ObjectApprover> frameworksApprover;
+  const Owned<ObjectApprover> tasksApprover;
+  const Owned<ObjectApprover> executorsApprover;
+  const Owned<ObjectApprover> flagsApprover;
+
+  const Option<string> jsonp;
+
+  Field field;
+  size_t index; // Into the array of the current field.
+  size_t count; // Elements written in the current array.
+};
+
+
+class StateReaderProcess : public Process<StateReaderProcess>
+{
+public:
+  StateReaderProcess()
+    : ProcessBase(process::ID::generate("state-reader")) {}
+
+  Response getState(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      const Owned<ObjectApprover>& executorsApprover,
+      ContentType contentType)
+  {
+    mesos::master::Response response;
+    response.set_type(mesos::master::Response::GET_STATE);
+
+    mesos::master::Response::GetState* getState =
+      response.mutable_get_state();
+
+    _getTasks(
+        *snapshot,
+        frameworksApprover,
+        tasksApprover,
+        getState->mutable_get_tasks());
+
+    _getExecutors(
+        *snapshot,
+        frameworksApprover,
+        executorsApprover,
+        getState->mutable_get_executors());
+
+    _getFrameworks(
+        *snapshot,
+        frameworksApprover,
+        getState->mutable_get_frameworks());
+
+    getState->mutable_get_agents()->CopyFrom(snapshot->agents);
+
+    return OK(serialize(contentType, evolve(response)),
+              stringify(contentType));
+  }
+
+  Response getAgents(
+      const Shared<StateSnapshot>& snapshot,
+      ContentType contentType)
+  {
+    mesos::master::Response response;
+    response.set_type(mesos::master::Response::GET_AGENTS);
+    response.mutable_get_agents()->CopyFrom(snapshot->agents);
+
+    return OK(serialize(contentType, evolve(response)),
+              stringify(contentType));
+  }
+
+  Response getFrameworks(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      ContentType contentType)
+  {
+    mesos::master::Response response;
+    response.set_type(mesos::master::Response::GET_FRAMEWORKS);
+
+    _getFrameworks(
+        *snapshot,
+        frameworksApprover,
+        response.mutable_get_frameworks());
+
+    return OK(serialize(contentType, evolve(response)),
+              stringify(contentType));
+  }
+
+  Response getExecutors(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& executorsApprover,
+      ContentType contentType)
+  {
+    mesos::master::Response response;
+    response.set_type(mesos::master::Response::GET_EXECUTORS);
+
+    _getExecutors(
+        *snapshot,
+        frameworksApprover,
+        executorsApprover,
+        response.mutable_get_executors());
+
+    return OK(serialize(contentType, evolve(response)),
+              stringify(contentType));
+  }
+
+  Response getTasks(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      ContentType contentType)
+  {
+    mesos::master::Response response;
+    response.set_type(mesos::master::Response::GET_TASKS);
+
+    _getTasks(
+        *snapshot,
+        frameworksApprover,
+        tasksApprover,
+        response.mutable_get_tasks());
+
+    return OK(serialize(contentType, evolve(response)),
+              stringify(contentType));
+  }
+
+  Response state(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      const Owned<ObjectApprover>& executorsApprover,
+      const Owned<ObjectApprover>& flagsApprover,
+      const Option<string>& jsonp,
+      bool streaming)
+  {
+    std::shared_ptr<StateWriter> state(new StateWriter(
+        snapshot,
+        frameworksApprover,
+        tasksApprover,
+        executorsApprover,
+        flagsApprover,
+        jsonp));
+
+    const string contentType =
+      jsonp.isSome() ? "text/javascript" : "application/json";
+
+    if (!streaming) {
+      std::ostringstream out;
+      while (state->next(&out)) {}
+
+      return OK(out.str(), contentType);
+    }
+
+    Pipe pipe;
+    OK ok;
+
+    ok.headers["Content-Type"] = contentType;
+    ok.type = Response::PIPE;
+    ok.reader = pipe.reader();
+
+    StateWriter::stream(self(), state, pipe.writer());
+
+    return ok;
+  }
+
+  Response frameworks(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      const Owned<ObjectApprover>& executorsApprover,
+      const Option<string>& jsonp)
+  {
+    auto frameworks = [&](JSON::ObjectWriter* writer) {
+      // Model all of the frameworks, then all of the completed ones.
+      auto frameworksWriter = [&](bool completed) {
+        return [&, completed](JSON::ArrayWriter* writer) {
+          foreach (const StateSnapshot::Framework& framework,
+                   snapshot->frameworks) {
+            // Skip unauthorized frameworks.
+            if (framework.completed != completed ||
+                !approveViewFrameworkInfo(
+                    frameworksApprover,
+                    framework.framework.framework_info())) {
+              continue;
+            }
+
+            writer->element(FullFrameworkWriter(
+                tasksApprover, executorsApprover, framework));
+          }
+        };
+      };
+
+      writer->field("frameworks", frameworksWriter(false));
+      writer->field("completed_frameworks", frameworksWriter(true));
+
+      // Model all currently unregistered frameworks. This can happen
+      // when a framework has yet to re-register after master failover.
+      writer->field("unregistered_frameworks", [&](JSON::ArrayWriter* writer) {
+        foreach (const FrameworkID& frameworkId, snapshot->orphanFrameworks) {
+          writer->element(frameworkId.value());
+        }
+      });
+    };
+
+    return OK(jsonify(frameworks), jsonp);
+  }
+
+  Response slaves(
+      const Shared<StateSnapshot>& snapshot,
+      const Option<string>& jsonp)
+  {
+    auto slaves = [&snapshot](JSON::ObjectWriter* writer) {
+      writer->field("slaves", [&snapshot](JSON::ArrayWriter* writer) {
+        foreach (const Agent& agent, snapshot->agents.agents()) {
+          writer->element(Full<Agent>(agent));
+        }
+      });
+    };
+
+    return OK(jsonify(slaves), jsonp);
+  }
+
+  Response tasks(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      size_t limit,
+      size_t offset,
+      bool ascending,
+      const Option<string>& jsonp)
+  {
+    // Construct task list with both running and finished tasks of
+    // both active and completed frameworks.
+    vector<const Task*> tasks;
+    foreach (const StateSnapshot::Framework& framework, snapshot->frameworks) {
+      const FrameworkInfo& frameworkInfo = framework.framework.framework_info();
+
+      // Skip unauthorized frameworks.
+      if (!approveViewFrameworkInfo(frameworksApprover, frameworkInfo)) {
+        continue;
+      }
+
+      foreach (const Task& task, framework.tasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(tasksApprover, task, frameworkInfo)) {
+          continue;
+        }
+
+        tasks.push_back(&task);
+      }
+
+      foreach (const Task& task, framework.completedTasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(tasksApprover, task, frameworkInfo)) {
+          continue;
+        }
+
+        tasks.push_back(&task);
+      }
+    }
+
+    // Sort tasks by task status timestamp. Default order is descending.
+    // The earliest timestamp is chosen for comparison when
+    // multiple are present.
+    if (ascending) {
+      std::sort(tasks.begin(), tasks.end(), TaskComparator::ascending);
+    } else {
+      std::sort(tasks.begin(), tasks.end(), TaskComparator::descending);
+    }
+
+    auto tasksWriter = [&tasks, limit, offset](JSON::ObjectWriter* writer) {
+      writer->field("tasks",
+                    [&tasks, limit, offset](JSON::ArrayWriter* writer) {
+        // Collect 'limit' number of tasks starting from 'offset'.
+        size_t end = std::min(offset + limit, tasks.size());
+        for (size_t i = offset; i < end; i++) {
+          writer->element(*tasks[i]);
+        }
+      });
+    };
+
+    return OK(jsonify(tasksWriter), jsonp);
+  }
+
+  CachedResponse stateSummary(
+      const Shared<StateSnapshot>& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover)
+  {
+    auto stateSummary = [&](JSON::ObjectWriter* writer) {
+      writer->field("hostname", snapshot->info.hostname());
+
+      if (snapshot->cluster.isSome()) {
+        writer->field("cluster", snapshot->cluster.get());
+      }
+
+      // We use the tasks of the registered frameworks to compute the
+      // summaries for this endpoint. This is done 1) for consistency
+      // between the 'slaves' and 'frameworks' subsections below 2)
+      // because we want to provide summary information for frameworks
+      // that are currently registered 3) the frameworks keep a
+      // circular buffer of completed tasks that we can use to keep a
+      // limited view on the history of recent completed / failed
+      // tasks.
+      TaskStateSummaries summaries(*snapshot);
+
+      // Model all of the agents.
+      writer->field("slaves", [&](JSON::ArrayWriter* writer) {
+        foreach (const Agent& agent, snapshot->agents.agents()) {
+          writer->element([&](JSON::ObjectWriter* writer) {
+            const SlaveID& slaveId = agent.agent_info().id();
+
+            json(writer, Summary<Agent>(agent));
+
+            // Add the 'TaskState' summary for this agent.
+            json(writer, summaries.slave(slaveId));
+
+            // Add the ids of all the frameworks running on this agent.
+            writer->field("framework_ids", [&](JSON::ArrayWriter* writer) {
+              foreach (const FrameworkID& frameworkId,
+                       summaries.frameworks(slaveId)) {
+                writer->element(frameworkId.value());
+              }
+            });
+          });
+        }
+      });
+
+      // Model all of the frameworks.
+      writer->field("frameworks", [&](JSON::ArrayWriter* writer) {
+        foreach (const StateSnapshot::Framework& framework,
+                 snapshot->frameworks) {
+          const FrameworkInfo& frameworkInfo =
+            framework.framework.framework_info();
+
+          // Skip completed and unauthorized frameworks.
+          if (framework.completed ||
+              !approveViewFrameworkInfo(frameworksApprover, frameworkInfo)) {
+            continue;
+          }
+
+          writer->element([&](JSON::ObjectWriter* writer) {
+            json(writer, Summary<StateSnapshot::Framework>(framework));
+
+            // Add the 'TaskState' summary for this framework.
+            json(writer, summaries.framework(frameworkInfo.id()));
+
+            // Add the ids of all the agents running this framework.
+            writer->field("slave_ids", [&](JSON::ArrayWriter* writer) {
+              foreach (const SlaveID& slaveId,
+                       summaries.slaves(frameworkInfo.id())) {
+                writer->element(slaveId.value());
+              }
+            });
+          });
+        }
+      });
+    };
+
+    CachedResponse cached;
+    cached.generation = snapshot->generation;
+    cached.body = jsonify(stateSummary);
+
+    // The generation is only unique for this master, hence the entity
+    // tag includes the ID of the master as well.
+    cached.etag =
+      "\"" + snapshot->info.id() + "-" + stringify(cached.generation) + "\"";
+
+    return cached;
+  }
+
+private:
+  // The following filter a snapshot the same way as the master does
+  // for the corresponding calls, see `Master::Http::_getFrameworks`,
+  // `Master::Http::_getExecutors` and `Master::Http::_getTasks`.
+
+  static void _getFrameworks(
+      const StateSnapshot& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      mesos::master::Response::GetFrameworks* getFrameworks)
+  {
+    foreach (const StateSnapshot::Framework& framework, snapshot.frameworks) {
+      // Skip unauthorized frameworks.
+      if (!approveViewFrameworkInfo(
+              frameworksApprover, framework.framework.framework_info())) {
+        continue;
+      }
+
+      if (framework.completed) {
+        getFrameworks->add_completed_frameworks()->CopyFrom(
+            framework.framework);
+      } else {
+        getFrameworks->add_frameworks()->CopyFrom(framework.framework);
+      }
+    }
+
+    foreach (const FrameworkID& frameworkId, snapshot.orphanFrameworks) {
+      Option<FrameworkInfo> frameworkInfo =
+        snapshot.recoveredFrameworks.get(frameworkId);
+
+      if (frameworkInfo.isNone() ||
+          (snapshot.authorization &&
+           !approveViewFrameworkInfo(
+               frameworksApprover, frameworkInfo.get()))) {
+        continue;
+      }
+
+      getFrameworks->add_recovered_frameworks()->CopyFrom(frameworkInfo.get());
+    }
+  }
+
+  static void _getExecutors(
+      const StateSnapshot& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& executorsApprover,
+      mesos::master::Response::GetExecutors* getExecutors)
+  {
+    foreach (const StateSnapshot::Framework& framework, snapshot.frameworks) {
+      const FrameworkInfo& frameworkInfo = framework.framework.framework_info();
+
+      // Skip unauthorized frameworks.
+      if (!approveViewFrameworkInfo(frameworksApprover, frameworkInfo)) {
+        continue;
+      }
+
+      foreach (const mesos::master::Response::GetExecutors::Executor& executor,
+               framework.executors) {
+        // Skip unauthorized executors.
+        if (!approveViewExecutorInfo(
+                executorsApprover, executor.executor_info(), frameworkInfo)) {
+          continue;
+        }
+
+        getExecutors->add_executors()->CopyFrom(executor);
+      }
+    }
+
+    typedef pair<FrameworkID, mesos::master::Response::GetExecutors::Executor>
+      OrphanExecutor;
+
+    foreach (const OrphanExecutor& orphan, snapshot.orphanExecutors) {
+      const mesos::master::Response::GetExecutors::Executor& executor =
+        orphan.second;
+
+      if (snapshot.authorization) {
+        Option<FrameworkInfo> frameworkInfo =
+          snapshot.recoveredFrameworks.get(orphan.first);
+
+        if (frameworkInfo.isNone() ||
+            !approveViewExecutorInfo(
+                executorsApprover,
+                executor.executor_info(),
+                frameworkInfo.get())) {
+          continue;
+        }
+      }
+
+      getExecutors->add_orphan_executors()->CopyFrom(executor);
+    }
+  }
+
+  static void _getTasks(
+      const StateSnapshot& snapshot,
+      const Owned<ObjectApprover>& frameworksApprover,
+      const Owned<ObjectApprover>& tasksApprover,
+      mesos::master::Response::GetTasks* getTasks)
+  {
+    foreach (const StateSnapshot::Framework& framework, snapshot.frameworks) {
+      const FrameworkInfo& frameworkInfo = framework.framework.framework_info();
+
+      // Skip unauthorized frameworks.
+      if (!approveViewFrameworkInfo(frameworksApprover, frameworkInfo)) {
+        continue;
+      }
+
+      // Pending tasks.
+      foreach (const TaskInfo& taskInfo, framework.pendingTasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTaskInfo(tasksApprover, taskInfo, frameworkInfo)) {
+          continue;
+        }
+
+        getTasks->add_pending_tasks()->CopyFrom(
+            protobuf::createTask(taskInfo, TASK_STAGING, frameworkInfo.id()));
+      }
+
+      // Active tasks.
+      foreach (const Task& task, framework.tasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(tasksApprover, task, frameworkInfo)) {
+          continue;
+        }
+
+        getTasks->add_tasks()->CopyFrom(task);
+      }
+
+      // Completed tasks.
+      foreach (const Task& task, framework.completedTasks) {
+        // Skip unauthorized tasks.
+        if (!approveViewTask(tasksApprover, task, frameworkInfo)) {
+          continue;
+        }
+
+        getTasks->add_completed_tasks()->CopyFrom(task);
+      }
+    }
+
+    // Orphan tasks.
+    foreach (const Task& task, snapshot.orphanTasks) {
+      if (snapshot.authorization) {
+        Option<FrameworkInfo> frameworkInfo =
+          snapshot.recoveredFrameworks.get(task.framework_id());
+
+        if (frameworkInfo.isNone() ||
+            !approveViewTask(tasksApprover, task, frameworkInfo.get())) {
+          continue;
+        }
+      }
+
+      getTasks->add_orphan_tasks()->CopyFrom(task);
+    }
+  }
+};
+
+
+StateReader::StateReader(
+    const UPID& _master,
+    const lambda::function<void(StateSnapshot*)>& _capture,
+    size_t _processes)
+  : master(_master),
+    capture(_capture),
+    next(0),
+    version(0),
+    parts(0)
+{
+  CHECK_GT(_processes, 0u);
+
+  for (size_t i = 0; i < _processes; i++) {
+    processes.push_back(new StateReaderProcess());
+    process::spawn(processes.back());
+  }
+}
+
+
+StateReader::~StateReader()
+{
+  foreach (StateReaderProcess* process, processes) {
+    process::terminate(process);
+    process::wait(process);
+    delete process;
+  }
+}
+
+
+Future<Response> StateReader::getState(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& tasksApprover,
+    const Owned<ObjectApprover>& executorsApprover,
+    ContentType contentType)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(
+      StateSnapshot::AGENTS |
+      StateSnapshot::FRAMEWORKS |
+      StateSnapshot::TASKS |
+      StateSnapshot::EXECUTORS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::getState,
+          snapshot,
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          contentType);
+    });
+}
+
+
+Future<Response> StateReader::getAgents(ContentType contentType)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::AGENTS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::getAgents,
+          snapshot,
+          contentType);
+    });
+}
+
+
+Future<Response> StateReader::getFrameworks(
+    const Owned<ObjectApprover>& frameworksApprover,
+    ContentType contentType)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::FRAMEWORKS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::getFrameworks,
+          snapshot,
+          frameworksApprover,
+          contentType);
+    });
+}
+
+
+Future<Response> StateReader::getExecutors(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& executorsApprover,
+    ContentType contentType)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::FRAMEWORKS | StateSnapshot::EXECUTORS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::getExecutors,
+          snapshot,
+          frameworksApprover,
+          executorsApprover,
+          contentType);
+    });
+}
+
+
+Future<Response> StateReader::getTasks(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& tasksApprover,
+    ContentType contentType)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::FRAMEWORKS | StateSnapshot::TASKS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::getTasks,
+          snapshot,
+          frameworksApprover,
+          tasksApprover,
+          contentType);
+    });
+}
+
+
+Future<Response> StateReader::state(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& tasksApprover,
+    const Owned<ObjectApprover>& executorsApprover,
+    const Owned<ObjectApprover>& flagsApprover,
+    const Option<string>& jsonp,
+    bool streaming)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(
+      StateSnapshot::AGENTS |
+      StateSnapshot::FRAMEWORKS |
+      StateSnapshot::TASKS |
+      StateSnapshot::EXECUTORS |
+      StateSnapshot::FLAGS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::state,
+          snapshot,
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          flagsApprover,
+          jsonp,
+          streaming);
+    });
+}
+
+
+Future<Response> StateReader::frameworks(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& tasksApprover,
+    const Owned<ObjectApprover>& executorsApprover,
+    const Option<string>& jsonp)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(
+      StateSnapshot::FRAMEWORKS |
+      StateSnapshot::TASKS |
+      StateSnapshot::EXECUTORS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::frameworks,
+          snapshot,
+          frameworksApprover,
+          tasksApprover,
+          executorsApprover,
+          jsonp);
+    });
+}
+
+
+Future<Response> StateReader::slaves(const Option<string>& jsonp)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::AGENTS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::slaves,
+          snapshot,
+          jsonp);
+    });
+}
+
+
+Future<Response> StateReader::tasks(
+    const Owned<ObjectApprover>& frameworksApprover,
+    const Owned<ObjectApprover>& tasksApprover,
+    size_t limit,
+    size_t offset,
+    bool ascending,
+    const Option<string>& jsonp)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(StateSnapshot::FRAMEWORKS | StateSnapshot::TASKS)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::tasks,
+          snapshot,
+          frameworksApprover,
+          tasksApprover,
+          limit,
+          offset,
+          ascending,
+          jsonp);
+    });
+}
+
+
+Future<CachedResponse> StateReader::stateSummary(
+    const Owned<ObjectApprover>& frameworksApprover)
+{
+  const PID<StateReaderProcess> pid = reader();
+
+  return snapshot(
+      StateSnapshot::AGENTS |
+      StateSnapshot::FRAMEWORKS |
+      StateSnapshot::TASK_STATES)
+    .then([=](const Shared<StateSnapshot>& snapshot) {
+      return process::dispatch(
+          pid,
+          &StateReaderProcess::stateSummary,
+          snapshot,
+          frameworksApprover);
+    });
+}
+
+
+Future<Shared<StateSnapshot>> StateReader::snapshot(int _parts)
+{
+  // The snapshot is taken in a subsequent event of the master, so
+  // that all the calls that the master receives in the meantime can
+  // share it. It holds the parts needed by any of these calls.
+  if (pending.isNone()) {
+    pending = Owned<Promise<Shared<StateSnapshot>>>(
+        new Promise<Shared<StateSnapshot>>());
+
+    parts = 0;
+
+    // NOTE: The reader is owned by the master, so it outlives any
+    // event dispatched to the master.
+    process::dispatch(master, [this]() { take(); });
+  }
+
+  parts |= _parts;
+
+  return pending.get()->future();
+}
+
+
+void StateReader::take()
+{
+  CHECK_SOME(pending);
+
+  Owned<Promise<Shared<StateSnapshot>>> promise = pending.get();
+  pending = None();
+
+  StateSnapshot* snapshot = new StateSnapshot();
+  snapshot->version = ++version;
+  snapshot->parts = parts;
+
+  capture(snapshot);
+
+  VLOG(2) << "Took snapshot " << snapshot->version << " of the master state";
+
+  promise->set(Shared<StateSnapshot>(snapshot));
+}
+
+
+PID<StateReaderProcess> StateReader::reader()
+{
+  PID<StateReaderProcess> pid = processes[next]->self();
+  next = (next + 1) % processes.size();
+  return pid;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,270 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MASTER_STATE_READER_HPP__
+#define __MASTER_STATE_READER_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <mesos/authorizer/authorizer.hpp>
+
+#include <mesos/master/master.hpp>
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/owned.hpp>
+#include <process/pid.hpp>
+#include <process/shared.hpp>
+#include <process/time.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
+
+#include "common/http.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Forward declaration.
+class StateReaderProcess;
+
+
+// An immutable snapshot of the state of the master. It is taken
+// without any authorization filtering so that it can be shared by
+// all the callers, and is filtered for each of them when read.
+struct StateSnapshot
+{
+  // The parts of the state that a snapshot can hold. A snapshot only
+  // holds the parts needed by the calls that share it, e.g., the
+  // tasks are not copied for a call that only lists the agents.
+  enum Part
+  {
+    AGENTS = 1 << 0,
+    FRAMEWORKS = 1 << 1,
+    TASKS = 1 << 2,
+    TASK_STATES = 1 << 3,
+    EXECUTORS = 1 << 4,
+    FLAGS = 1 << 5
+  };
+
+  // A registered or completed framework, with its tasks and executors.
+  struct Framework
+  {
+    mesos::master::Response::GetFrameworks::Framework framework;
+    bool completed;
+
+    // Only set for the frameworks that are not using HTTP.
+    Option<process::UPID> pid;
+
+    // Pending tasks are authorized as `TaskInfo`s, hence they are
+    // only converted to `Task`s when read. Only held with `TASKS`.
+    std::vector<TaskInfo> pendingTasks;
+    std::vector<Task> tasks;
+    std::vector<Task> completedTasks;
+
+    // The agent and state of the tasks above (pending tasks are
+    // staging), which is all the summaries need. Only held with
+    // `TASK_STATES`.
+    std::vector<std::pair<SlaveID, TaskState>> taskStates;
+
+    // Only held with `EXECUTORS`.
+    std::vector<mesos::master::Response::GetExecutors::Executor> executors;
+  };
+
+  // Increases with every snapshot taken by the master.
+  uint64_t version;
+
+  // The generation of the master's state, see `Master::generation`.
+  uint64_t generation;
+
+  // The `Part`s held by this snapshot.
+  int parts;
+
+  // The fields of the master itself, they are always held.
+  MasterInfo info;
+  process::UPID pid;
+  Option<MasterInfo> leader;
+  process::Time startTime;
+  Option<process::Time> electedTime;
+  double activatedAgents;
+  double deactivatedAgents;
+  Option<std::string> cluster;
+  Option<std::string> logDir;
+  Option<std::string> externalLogFile;
+
+  // The effective names and values of the master's flags. Only held
+  // with `FLAGS`.
+  std::vector<std::pair<std::string, std::string>> flags;
+
+  // Whether the master has an authorizer, in which case the tasks and
+  // executors of the frameworks that are not registered are only
+  // visible if the framework is known from a re-registered agent.
+  bool authorization;
+
+  // Only held with `FRAMEWORKS`.
+  std::vector<Framework> frameworks;
+
+  // The tasks and executors of the frameworks that are not
+  // registered (held with `TASKS` and `EXECUTORS` respectively), and
+  // the IDs of those frameworks once per agent (held with
+  // `FRAMEWORKS`).
+  std::vector<Task> orphanTasks;
+  std::vector<std::pair<
+      FrameworkID,
+      mesos::master::Response::GetExecutors::Executor>> orphanExecutors;
+  std::vector<FrameworkID> orphanFrameworks;
+
+  // The frameworks that have not re-registered since the master
+  // failed over, as known from their agents. Only held with
+  // `FRAMEWORKS`.
+  hashmap<FrameworkID, FrameworkInfo> recoveredFrameworks;
+
+  // Only held with `AGENTS`.
+  mesos::master::Response::GetAgents agents;
+};
+
+
+// A response body rendered from a snapshot, along with the generation
+// of the master's state that it reflects and its entity tag.
+struct CachedResponse
+{
+  uint64_t generation;
+  std::string etag;
+  std::string body;
+};
+
+
+// Answers the read-only calls of the v1 master API and the read-only
+// JSON endpoints of the master from snapshots of its state. Snapshots
+// are taken on the master, but filtering them for each caller and
+// serializing the responses, which dominate the cost of these calls
+// on large clusters, is done by a pool of reader processes so that
+// it does not delay the master.
+//
+// All the calls received by the master before a snapshot is taken
+// share that snapshot, so a burst of calls costs the master a single
+// snapshot. As the snapshot is taken after the calls are received,
+// it reflects every change that the master made before them.
+//
+// NOTE: All the functions must be called on the master.
+class StateReader
+{
+public:
+  // `capture` is invoked on the master to take a snapshot, it must
+  // fill in (at least) the parts of the snapshot that are set.
+  StateReader(
+      const process::UPID& master,
+      const lambda::function<void(StateSnapshot*)>& capture,
+      size_t processes);
+
+  ~StateReader();
+
+  // The v1 API calls.
+  process::Future<process::http::Response> getState(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& tasksApprover,
+      const process::Owned<ObjectApprover>& executorsApprover,
+      ContentType contentType);
+
+  process::Future<process::http::Response> getAgents(
+      ContentType contentType);
+
+  process::Future<process::http::Response> getFrameworks(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      ContentType contentType);
+
+  process::Future<process::http::Response> getExecutors(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& executorsApprover,
+      ContentType contentType);
+
+  process::Future<process::http::Response> getTasks(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& tasksApprover,
+      ContentType contentType);
+
+  // The JSON endpoints, see the corresponding `Master::Http` handlers.
+  process::Future<process::http::Response> state(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& tasksApprover,
+      const process::Owned<ObjectApprover>& executorsApprover,
+      const process::Owned<ObjectApprover>& flagsApprover,
+      const Option<std::string>& jsonp,
+      bool streaming);
+
+  process::Future<process::http::Response> frameworks(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& tasksApprover,
+      const process::Owned<ObjectApprover>& executorsApprover,
+      const Option<std::string>& jsonp);
+
+  process::Future<process::http::Response> slaves(
+      const Option<std::string>& jsonp);
+
+  process::Future<process::http::Response> tasks(
+      const process::Owned<ObjectApprover>& frameworksApprover,
+      const process::Owned<ObjectApprover>& tasksApprover,
+      size_t limit,
+      size_t offset,
+      bool ascending,
+      const Option<std::string>& jsonp);
+
+  // Returns the JSON body of the '/state-summary' endpoint (without
+  // JSONP padding) so that the master can cache it.
+  process::Future<CachedResponse> stateSummary(
+      const process::Owned<ObjectApprover>& frameworksApprover);
+
+private:
+  StateReader(const StateReader&) = delete;
+  StateReader& operator=(const StateReader&) = delete;
+
+  // Returns a snapshot holding (at least) the specified parts.
+  process::Future<process::Shared<StateSnapshot>> snapshot(int parts);
+
+  // Takes the pending snapshot.
+  void take();
+
+  // Returns the reader processes in a round-robin order.
+  process::PID<StateReaderProcess> reader();
+
+  const process::UPID master;
+  const lambda::function<void(StateSnapshot*)> capture;
+
+  std::vector<StateReaderProcess*> processes;
+  size_t next;
+
+  uint64_t version;
+
+  Option<process::Owned<process::Promise<process::Shared<StateSnapshot>>>>
+    pending;
+
+  // The parts requested for the pending snapshot.
+  int parts;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_STATE_READER_HPP__
@@ -18,14 +18,19 @@
 
 #include <google/protobuf/io/zero_copy_stream_impl.h> // For ArrayInputStream.
 
+#include <algorithm>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/log/log.hpp>
 
 #include <mesos/state/log.hpp>
 
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -41,6 +46,7 @@
 #include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/svn.hpp>
@@ -55,7 +61,10 @@ using namespace process;
 // Note that we don't add 'using std::set' here because we need
 // 'std::' to disambiguate the 'set' member.
 using std::list;
+using std::shared_ptr;
 using std::string;
+using std::vector;
+using std::weak_ptr;
 
 using mesos::log::Log;
 
@@ -72,11 +81,18 @@ namespace state {
 // All operations are gated by 'start()' which makes sure that a
 // Log::Writer has been started and all positions in the log have been
 // read and cached in memory. All reads are performed by this cache
-// (for now). If the Log::Writer gets demoted (i.e., because another
-// writer started) then the current operation will return false
-// implying the operation was not atomic and subsequent operations
-// will re-'start()' which will again read all positions to make sure
-// operations are consistent.
+// (i.e., a materialized view of all the entries kept current as we
+// write to the log). If the Log::Writer gets demoted (i.e., because
+// another writer started) then the current operation will return
+// false implying the operation was not atomic and subsequent
+// operations will re-'start()' which will again read all positions to
+// make sure operations are consistent.
+//
+// Modifications (i.e., 'set' and 'expunge') that are requested while
+// the log is busy (e.g., appending) are batched and written once the
+// log is available again. The writer uses group commits so the
+// operations of a batch are appended in a single round. Optionally,
+// they are written as a single Operation::BATCH entry instead.
 // TODO(benh): Log demotion does not necessarily imply a non-atomic
 // read/modify/write. An alternative strategy might be to retry after
 // restarting via 'start' (and holding on to the mutex so no other
@@ -84,7 +100,10 @@ namespace state {
 class LogStorageProcess : public Process<LogStorageProcess>
 {
 public:
-  LogStorageProcess(Log* log, size_t diffsBetweenSnapshots);
+  LogStorageProcess(
+      Log* log,
+      size_t diffsBetweenSnapshots,
+      bool batchOperations);
 
   virtual ~LogStorageProcess();
 
@@ -104,8 +123,11 @@ private:
       const Log::Position& beginning,
       const Log::Position& position);
 
-  // Helper for applying log entries.
+  // Helpers for applying log entries.
   Future<Nothing> apply(const list<Log::Entry>& entries);
+  Try<Nothing> _apply(
+      const Log::Position& position,
+      const Operation& operation);
 
   // Helper for performing truncation.
   void truncate();
@@ -114,22 +136,45 @@ private:
       const Log::Position& minimum,
       const Option<Log::Position>& position);
 
-  // Continuations.
-  Future<Option<Entry>> _get(const string& name);
+  // A 'set' or an 'expunge' waiting to be written to the log.
+  struct Modification
+  {
+    enum Type
+    {
+      SET,
+      EXPUNGE
+    };
 
-  Future<bool> _set(const Entry& entry, const UUID& uuid);
-  Future<bool> __set(const Entry& entry, const UUID& uuid);
-  Future<bool> ___set(
-      const Entry& entry,
-      size_t diff,
-      Option<Log::Position> position);
-
-  Future<bool> _expunge(const Entry& entry);
-  Future<bool> __expunge(const Entry& entry);
-  Future<bool> ___expunge(
-      const Entry& entry,
-      const Option<Log::Position>& position);
+    Modification(Type _type, const Entry& _entry, const UUID& _uuid)
+      : type(_type), entry(_entry), uuid(_uuid) {}
+
+    const Type type;
+    const Entry entry;
 
+    // The version of the entry expected by the caller.
+    const UUID uuid;
+
+    process::Promise<bool> promise;
+  };
+
+  // Helpers for writing modifications to the log.
+  Future<bool> modify(const shared_ptr<Modification>& modification);
+  Future<Nothing> flush();
+  Future<Nothing> _flush(const list<shared_ptr<Modification>>& modifications);
+  Future<Nothing> __flush(
+      const list<shared_ptr<Modification>>& modifications,
+      const hashmap<string, Option<Entry>>& entries,
+      const hashmap<string, size_t>& diffs,
+      const vector<string>& names,
+      const hashmap<string, size_t>& appends,
+      const list<Option<Log::Position>>& positions);
+
+  static void abandon(
+      const list<shared_ptr<Modification>>& modifications,
+      const Future<Nothing>& future);
+
+  // Continuations.
+  Future<Option<Entry>> _get(const string& name);
   Future<std::set<string>> _names();
 
   Log::Reader reader;
@@ -137,9 +182,15 @@ private:
 
   const size_t diffsBetweenSnapshots;
 
+  // Whether to write the operations of a batch as a single entry.
+  const bool batchOperations;
+
   // Used to serialize Log::Writer::append/truncate operations.
   Mutex mutex;
 
+  // Modifications that have not been written to the log yet.
+  list<shared_ptr<Modification>> pending;
+
   // Whether or not we've started the ability to append to log.
   Option<Future<Nothing>> starting;
 
@@ -222,11 +273,15 @@ private:
 };
 
 
-LogStorageProcess::LogStorageProcess(Log* log, size_t diffsBetweenSnapshots)
+LogStorageProcess::LogStorageProcess(
+    Log* log,
+    size_t diffsBetweenSnapshots,
+    bool batchOperations)
   : ProcessBase(process::ID::generate("log-storage")),
     reader(log),
-    writer(log),
-    diffsBetweenSnapshots(diffsBetweenSnapshots) {}
+    writer(log, true),
+    diffsBetweenSnapshots(diffsBetweenSnapshots),
+    batchOperations(batchOperations) {}
 
 
 LogStorageProcess::~LogStorageProcess() {}
@@ -325,47 +380,79 @@ Future<Nothing> LogStorageProcess::apply(const list<Log::Entry>& entries)
         return Failure("Failed to deserialize Operation");
       }
 
-      switch (operation.type()) {
-        case Operation::SNAPSHOT: {
-          CHECK(operation.has_snapshot());
+      Try<Nothing> applied = _apply(entry.position, operation);
 
-          // Add or update (override) the snapshot.
-          Snapshot snapshot(entry.position, operation.snapshot().entry());
-          snapshots.put(snapshot.entry.name(), snapshot);
-          break;
-        }
+      if (applied.isError()) {
+        return Failure(applied.error());
+      }
+
+      index = entry.position;
+    }
+  }
 
-        case Operation::DIFF: {
-          CHECK(operation.has_diff());
+  return Nothing();
+}
 
-          Option<Snapshot> snapshot =
-            snapshots.get(operation.diff().entry().name());
 
-          CHECK_SOME(snapshot);
+Try<Nothing> LogStorageProcess::_apply(
+    const Log::Position& position,
+    const Operation& operation)
+{
+  switch (operation.type()) {
+    case Operation::SNAPSHOT: {
+      CHECK(operation.has_snapshot());
+
+      // Add or update (override) the snapshot.
+      Snapshot snapshot(position, operation.snapshot().entry());
+      snapshots.put(snapshot.entry.name(), snapshot);
+      break;
+    }
 
-          Try<Snapshot> patched = snapshot.get().patch(operation.diff());
+    case Operation::DIFF: {
+      CHECK(operation.has_diff());
 
-          if (patched.isError()) {
-            return Failure("Failed to apply the diff: " + patched.error());
-          }
+      Option<Snapshot> snapshot =
+        snapshots.get(operation.diff().entry().name());
 
-          // Replace the snapshot with the patched snapshot.
-          snapshots.put(patched.get().entry.name(), patched.get());
-          break;
-        }
+      CHECK_SOME(snapshot);
 
-        case Operation::EXPUNGE: {
-          CHECK(operation.has_expunge());
-          snapshots.erase(operation.expunge().name());
-          break;
-        }
+      Try<Snapshot> patched = snapshot.get().patch(operation.diff());
 
-        default:
-          return Failure("Unknown operation: " + stringify(operation.type()));
+      if (patched.isError()) {
+        return Error("Failed to apply the diff: " + patched.error());
       }
 
-      index = entry.position;
+      // Replace the snapshot with the patched snapshot.
+      snapshots.put(patched.get().entry.name(), patched.get());
+      break;
+    }
+
+    case Operation::EXPUNGE: {
+      CHECK(operation.has_expunge());
+      snapshots.erase(operation.expunge().name());
+      break;
     }
+
+    case Operation::BATCH: {
+      CHECK(operation.has_batch());
+
+      // All the operations of a batch share the position of the batch.
+      foreach (const Operation& batched, operation.batch().operations()) {
+        if (batched.type() == Operation::BATCH) {
+          return Error("Unexpected nested batch");
+        }
+
+        Try<Nothing> applied = _apply(position, batched);
+
+        if (applied.isError()) {
+          return applied;
+        }
+      }
+      break;
+    }
+
+    default:
+      return Error("Unknown operation: " + stringify(operation.type()));
   }
 
   return Nothing();
@@ -442,6 +529,12 @@ Future<Nothing> LogStorageProcess::__truncate(
 
 Future<Option<Entry>> LogStorageProcess::get(const string& name)
 {
+  // Serve the read directly from memory if we have already read the
+  // log (saving a dispatch).
+  if (starting.isSome() && starting.get().isReady()) {
+    return _get(name);
+  }
+
   return start()
     .then(defer(self(), &Self::_get, name));
 }
@@ -463,189 +556,382 @@ Future<bool> LogStorageProcess::set(
     const Entry& entry,
     const UUID& uuid)
 {
-  return mutex.lock()
-    .then(defer(self(), &Self::_set, entry, uuid))
+  return modify(shared_ptr<Modification>(
+      new Modification(Modification::SET, entry, uuid)));
+}
+
+
+Future<bool> LogStorageProcess::expunge(const Entry& entry)
+{
+  return modify(shared_ptr<Modification>(
+      new Modification(
+          Modification::EXPUNGE,
+          entry,
+          UUID::fromBytes(entry.uuid()).get())));
+}
+
+
+Future<bool> LogStorageProcess::modify(
+    const shared_ptr<Modification>& modification)
+{
+  Future<bool> future = modification->promise.future();
+
+  // Give up on the modification if the caller discards it. A weak
+  // pointer is used so that the callback does not keep the
+  // modification (and thus its promise) alive.
+  weak_ptr<Modification> weak = modification;
+
+  future.onDiscard([weak]() {
+    shared_ptr<Modification> modification = weak.lock();
+    if (modification) {
+      modification->promise.discard();
+    }
+  });
+
+  pending.push_back(modification);
+
+  // We lock since writing includes a call to Log::Writer::append
+  // which must be serialized with the other appends and truncations.
+  // The modifications pending by the time we get the lock are all
+  // written at once.
+  mutex.lock()
+    .then(defer(self(), &Self::flush))
     .onAny(lambda::bind(&Mutex::unlock, mutex));
+
+  return future;
 }
 
 
-Future<bool> LogStorageProcess::_set(
-    const Entry& entry,
-    const UUID& uuid)
+Future<Nothing> LogStorageProcess::flush()
 {
+  if (pending.empty()) {
+    // Already written as part of an earlier batch.
+    return Nothing();
+  }
+
+  list<shared_ptr<Modification>> modifications;
+  std::swap(modifications, pending);
+
   return start()
-    .then(defer(self(), &Self::__set, entry, uuid));
+    .then(defer(self(), &Self::_flush, modifications))
+    .onAny(lambda::bind(&Self::abandon, modifications, lambda::_1));
 }
 
 
-Future<bool> LogStorageProcess::__set(
-    const Entry& entry,
-    const UUID& uuid)
+Future<Nothing> LogStorageProcess::_flush(
+    const list<shared_ptr<Modification>>& modifications)
 {
-  Option<Snapshot> snapshot = snapshots.get(entry.name());
+  // The entries resulting from the modifications (none if expunged).
+  // Each modification is checked against the entry as left by the
+  // preceding modifications of the batch, which means that only the
+  // last modification of each entry needs to be written.
+  hashmap<string, Option<Entry>> entries;
+
+  // The modifications that we are about to write.
+  list<shared_ptr<Modification>> writing;
+
+  foreach (const shared_ptr<Modification>& modification, modifications) {
+    if (modification->promise.future().isDiscarded()) {
+      continue; // The caller gave up.
+    }
+
+    const string& name = modification->entry.name();
+
+    Option<Entry> entry = None();
+
+    if (entries.contains(name)) {
+      entry = entries.at(name);
+    } else if (snapshots.contains(name)) {
+      entry = snapshots.get(name).get().entry;
+    }
+
+    // Check the version first (if we've already got an entry).
+    bool valid = entry.isSome()
+      ? UUID::fromBytes(entry.get().uuid()).get() == modification->uuid
+      : modification->type == Modification::SET;
 
-  // Check the version first (if we've already got a snapshot).
-  if (snapshot.isSome() &&
-      UUID::fromBytes(snapshot.get().entry.uuid()).get() != uuid) {
-    return false;
+    if (!valid) {
+      modification->promise.set(false);
+      continue;
+    }
+
+    if (modification->type == Modification::SET) {
+      entries.put(name, modification->entry);
+    } else {
+      entries.put(name, None());
+    }
+
+    writing.push_back(modification);
   }
 
-  // Check if we should try to compute a diff.
-  if (snapshot.isSome() && snapshot.get().diffs < diffsBetweenSnapshots) {
-    // Keep metrics for the time to calculate diffs.
-    metrics.diff.start();
+  // The entries in the order of their last modification, which is
+  // the order their operations are appended in. This way a failed
+  // append only fails the modifications at or after it, see '__flush'.
+  vector<string> order;
+  hashset<string> ordered;
+
+  for (auto modification = writing.rbegin();
+       modification != writing.rend();
+       ++modification) {
+    const string& name = (*modification)->entry.name();
+    if (!ordered.contains(name)) {
+      ordered.insert(name);
+      order.push_back(name);
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+
+  vector<Operation> operations;
 
-    // Construct the diff of the last snapshot.
-    Try<svn::Diff> diff = svn::diff(
-        snapshot.get().entry.value(),
-        entry.value());
+  // The names of the entries the operations are for.
+  vector<string> names;
 
-    Duration elapsed = metrics.diff.stop();
+  // The number of leading appends that must succeed for the
+  // modifications of each entry to be written (i.e., up to and
+  // including the append of its operation, if any).
+  hashmap<string, size_t> appends;
 
-    if (diff.isError()) {
-      // TODO(benh): Fallback and try and write a whole snapshot?
-      return Failure("Failed to construct diff: " + diff.error());
+  // The number of diffs on top of the snapshot, for the entries that
+  // are written as diffs.
+  hashmap<string, size_t> diffs;
+
+  foreach (const string& name, order) {
+    const Option<Entry>& entry = entries.at(name);
+    Option<Snapshot> snapshot = snapshots.get(name);
+
+    if (entry.isNone()) {
+      // Nothing to expunge if the entry was created in this batch.
+      if (snapshot.isSome()) {
+        Operation operation;
+        operation.set_type(Operation::EXPUNGE);
+        operation.mutable_expunge()->set_name(name);
+        operations.push_back(operation);
+        names.push_back(name);
+      }
+      appends.put(name, operations.size());
+      continue;
     }
 
-    VLOG(1) << "Created an SVN diff in " << elapsed
-            << " of size " << Bytes(diff.get().data.size()) << " which is "
-            << (diff.get().data.size() / (double) entry.value().size()) * 100.0
-            << "% the original size (" << Bytes(entry.value().size()) << ")";
+    // Check if we should try to compute a diff.
+    if (snapshot.isSome() && snapshot.get().diffs < diffsBetweenSnapshots) {
+      // Keep metrics for the time to calculate diffs.
+      metrics.diff.start();
 
-    // Only write the diff if it provides a reduction in size.
-    if (diff.get().data.size() < entry.value().size()) {
-      // Append a diff operation.
-      Operation operation;
-      operation.set_type(Operation::DIFF);
-      operation.mutable_diff()->mutable_entry()->CopyFrom(entry);
-      operation.mutable_diff()->mutable_entry()->set_value(diff.get().data);
+      // Construct the diff of the last snapshot.
+      Try<svn::Diff> diff = svn::diff(
+          snapshot.get().entry.value(),
+          entry.get().value());
 
-      string value;
-      if (!operation.SerializeToString(&value)) {
-        return Failure("Failed to serialize DIFF Operation");
+      Duration elapsed = metrics.diff.stop();
+
+      if (diff.isError()) {
+        // TODO(benh): Fallback and try and write a whole snapshot?
+        return Failure("Failed to construct diff: " + diff.error());
       }
 
-      return writer.append(value)
-        .then(defer(self(),
-                    &Self::___set,
-                    entry,
-                    snapshot.get().diffs + 1,
-                    lambda::_1));
+      const size_t size = entry.get().value().size();
+
+      VLOG(1) << "Created an SVN diff in " << elapsed
+              << " of size " << Bytes(diff.get().data.size()) << " which is "
+              << (diff.get().data.size() / (double) size) * 100.0
+              << "% the original size (" << Bytes(size) << ")";
+
+      // Only write the diff if it provides a reduction in size.
+      if (diff.get().data.size() < size) {
+        Operation operation;
+        operation.set_type(Operation::DIFF);
+        operation.mutable_diff()->mutable_entry()->CopyFrom(entry.get());
+        operation.mutable_diff()->mutable_entry()->set_value(diff.get().data);
+        operations.push_back(operation);
+        names.push_back(name);
+        appends.put(name, operations.size());
+
+        diffs.put(name, snapshot.get().diffs + 1);
+        continue;
+      }
     }
+
+    // Write the full snapshot.
+    Operation operation;
+    operation.set_type(Operation::SNAPSHOT);
+    operation.mutable_snapshot()->mutable_entry()->CopyFrom(entry.get());
+    operations.push_back(operation);
+    names.push_back(name);
+    appends.put(name, operations.size());
   }
 
-  // Write the full snapshot.
-  Operation operation;
-  operation.set_type(Operation::SNAPSHOT);
-  operation.mutable_snapshot()->mutable_entry()->CopyFrom(entry);
+  if (operations.empty()) {
+    // The modifications cancel each other out (e.g., an entry created
+    // and expunged in the same batch), there is nothing to write.
+    foreach (const shared_ptr<Modification>& modification, writing) {
+      modification->promise.set(true);
+    }
 
-  string value;
-  if (!operation.SerializeToString(&value)) {
-    return Failure("Failed to serialize SNAPSHOT Operation");
+    return Nothing();
   }
 
-  return writer.append(value)
-    .then(defer(self(), &Self::___set, entry, 0, lambda::_1));
-}
+  if (batchOperations && operations.size() > 1) {
+    Operation operation;
+    operation.set_type(Operation::BATCH);
+    foreach (const Operation& batched, operations) {
+      operation.mutable_batch()->add_operations()->CopyFrom(batched);
+    }
 
+    operations = {operation};
 
-Future<bool> LogStorageProcess::___set(
-    const Entry& entry,
-    size_t diffs,
-    Option<Log::Position> position)
-{
-  if (position.isNone()) {
-    starting = None(); // Reset 'starting' so we try again.
-    return false;
+    // All the operations are now written by the same append.
+    foreachvalue (size_t& count, appends) {
+      count = std::min(count, operations.size());
+    }
   }
 
-  // Update index so we don't bother reading anything before this
-  // position again (if we don't have to).
-  index = max(index, position);
-
-  // Determine the position that represents the snapshot: if we just
-  // wrote a diff then we want to use the existing position of the
-  // snapshot, otherwise we just overwrote the snapshot so we should
-  // use the returned position (i.e., do nothing).
-  if (diffs > 0) {
-    CHECK(snapshots.contains(entry.name()));
-    position = snapshots.get(entry.name()).get().position;
-  }
+  // Serialize all of the operations before appending any of them so
+  // that a failure doesn't leave the batch partially written.
+  vector<string> values;
 
-  Snapshot snapshot(position.get(), entry, diffs);
-  snapshots.put(snapshot.entry.name(), snapshot);
+  foreach (const Operation& operation, operations) {
+    string value;
+    if (!operation.SerializeToString(&value)) {
+      return Failure("Failed to serialize Operation");
+    }
+    values.push_back(value);
+  }
 
-  // And truncate the log if necessary.
-  truncate();
+  VLOG(1) << "Writing " << writing.size() << " modifications ("
+          << names.size() << " operations) to the log";
 
-  return true;
-}
+  // Each operation is a separate append. Since the writer uses group
+  // commits the appends are written together in a single round (if
+  // the replicas support it, otherwise one after the other).
+  list<Future<Option<Log::Position>>> appending;
 
+  foreach (const string& value, values) {
+    appending.push_back(writer.append(value));
+  }
 
-Future<bool> LogStorageProcess::expunge(const Entry& entry)
-{
-  return mutex.lock()
-    .then(defer(self(), &Self::_expunge, entry))
-    .onAny(lambda::bind(&Mutex::unlock, mutex));
+  return collect(appending)
+    .then(defer(self(),
+                &Self::__flush,
+                writing,
+                entries,
+                diffs,
+                names,
+                appends,
+                lambda::_1));
 }
 
 
-Future<bool> LogStorageProcess::_expunge(const Entry& entry)
+Future<Nothing> LogStorageProcess::__flush(
+    const list<shared_ptr<Modification>>& modifications,
+    const hashmap<string, Option<Entry>>& entries,
+    const hashmap<string, size_t>& diffs,
+    const vector<string>& names,
+    const hashmap<string, size_t>& appends,
+    const list<Option<Log::Position>>& positions)
 {
-  return start()
-    .then(defer(self(), &Self::__expunge, entry));
-}
+  // All the operations of a batch entry share its position.
+  CHECK(positions.size() == names.size() || positions.size() == 1);
+
+  // The position each entry was written at.
+  hashmap<string, Log::Position> written;
+
+  // The number of appends that succeeded before the first failed one
+  // (if any). If an append failed we were demoted, hence only the
+  // entries written by the preceding appends are considered written.
+  // Note that 'index' is not advanced past the failed append so that
+  // any later append which did succeed is read back once we've
+  // restarted.
+  size_t succeeded = 0;
+
+  vector<string>::const_iterator name = names.begin();
+
+  foreach (const Option<Log::Position>& position, positions) {
+    if (position.isNone()) {
+      starting = None(); // Reset 'starting' so we try again.
+      break;
+    }
 
+    // Update index so we don't bother reading anything before this
+    // position again (if we don't have to).
+    index = max(index, position);
 
-Future<bool> LogStorageProcess::__expunge(const Entry& entry)
-{
-  Option<Snapshot> snapshot = snapshots.get(entry.name());
+    do {
+      written.put(*name++, position.get());
+    } while (positions.size() == 1 && name != names.end());
 
-  if (snapshot.isNone()) {
-    return false;
+    ++succeeded;
   }
 
-  // Check the version first.
-  if (UUID::fromBytes(snapshot.get().entry.uuid()).get() !=
-      UUID::fromBytes(entry.uuid()).get()) {
-    return false;
+  foreachpair (const string& name, const Option<Entry>& entry, entries) {
+    if (appends.at(name) > succeeded) {
+      continue; // Not written, see above.
+    }
+
+    if (entry.isNone()) {
+      snapshots.erase(name);
+      continue;
+    }
+
+    // Determine the position that represents the snapshot: if we
+    // just wrote a diff then we want to use the existing position of
+    // the snapshot, otherwise we just overwrote the snapshot so we
+    // should use the returned position.
+    if (diffs.contains(name)) {
+      CHECK(snapshots.contains(name));
+
+      Snapshot snapshot(
+          snapshots.get(name).get().position,
+          entry.get(),
+          diffs.at(name));
+
+      snapshots.put(name, snapshot);
+    } else {
+      snapshots.put(name, Snapshot(written.at(name), entry.get()));
+    }
   }
 
-  // Now serialize and append an expunge operation.
-  Operation operation;
-  operation.set_type(Operation::EXPUNGE);
-  operation.mutable_expunge()->set_name(entry.name());
+  // The modifications of an entry that was not written (because its
+  // append or one before it failed) are reported as failed, the
+  // others were written.
+  foreach (const shared_ptr<Modification>& modification, modifications) {
+    modification->promise.set(
+        appends.at(modification->entry.name()) <= succeeded);
+  }
 
-  string value;
-  if (!operation.SerializeToString(&value)) {
-    return Failure("Failed to serialize Operation");
+  // And truncate the log if necessary.
+  if (succeeded == positions.size()) {
+    truncate();
   }
 
-  return writer.append(value)
-    .then(defer(self(), &Self::___expunge, entry, lambda::_1));
+  return Nothing();
 }
 
 
-Future<bool> LogStorageProcess::___expunge(
-    const Entry& entry,
-    const Option<Log::Position>& position)
+void LogStorageProcess::abandon(
+    const list<shared_ptr<Modification>>& modifications,
+    const Future<Nothing>& future)
 {
-  if (position.isNone()) {
-    starting = None(); // Reset 'starting' so we try again.
-    return false;
+  // Notify the callers whose modifications have not been completed
+  // (this is a no-op for the others).
+  foreach (const shared_ptr<Modification>& modification, modifications) {
+    if (future.isFailed()) {
+      modification->promise.fail(future.failure());
+    } else if (future.isDiscarded()) {
+      modification->promise.discard();
+    }
   }
-
-  // Remove from snapshots and truncate the log if possible.
-  CHECK(snapshots.contains(entry.name()));
-  snapshots.erase(entry.name());
-  truncate();
-
-  return true;
 }
 
 
 Future<std::set<string>> LogStorageProcess::names()
 {
+  // Serve the names directly from memory if we have already read the
+  // log, see 'get'.
+  if (starting.isSome() && starting.get().isReady()) {
+    return _names();
+  }
+
   return start()
     .then(defer(self(), &Self::_names));
 }
@@ -658,9 +944,15 @@ Future<std::set<string>> LogStorageProcess::_names()
 }
 
 
-LogStorage::LogStorage(Log* log, size_t diffsBetweenSnapshots)
+LogStorage::LogStorage(
+    Log* log,
+    size_t diffsBetweenSnapshots,
+    bool batchOperations)
 {
-  process = new LogStorageProcess(log, diffsBetweenSnapshots);
+  process = new LogStorageProcess(
+      log,
+      diffsBetweenSnapshots,
+      batchOperations);
   spawn(process);
 }
 
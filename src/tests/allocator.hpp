@@ -17,6 +17,8 @@
 #ifndef __TESTS_ALLOCATOR_HPP__
 #define __TESTS_ALLOCATOR_HPP__
 
+#include <utility>
+
 #include <gmock/gmock.h>
 
 #include <mesos/allocator/allocator.hpp>
@@ -202,12 +204,15 @@ ACTION_P(InvokeUpdateWeights, allocator)
 }
 
 
-template <typename T = master::allocator::HierarchicalDRFAllocator>
-mesos::allocator::Allocator* createAllocator()
+template <
+    typename T = master::allocator::HierarchicalDRFAllocator,
+    typename... Args>
+mesos::allocator::Allocator* createAllocator(Args&&... args)
 {
   // T represents the allocator type. It can be a default built-in
   // allocator, or one provided by an allocator module.
-  Try<mesos::allocator::Allocator*> instance = T::create();
+  Try<mesos::allocator::Allocator*> instance =
+    T::create(std::forward<Args>(args)...);
   CHECK_SOME(instance);
   return CHECK_NOTNULL(instance.get());
 }
@@ -202,6 +202,59 @@ TEST_P(MasterAPITest, GetAgents)
 }
 
 
+// This test verifies that concurrent read-only calls, which are served
+// from snapshots of the master's state, observe the same state.
+TEST_P(MasterAPITest, GetStateConcurrently)
+{
+  Try<Owned<cluster::Master>> master = this->StartMaster();
+  ASSERT_SOME(master);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Future<SlaveRegisteredMessage> agentRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get()->pid, _);
+
+  Try<Owned<cluster::Slave>> agent = StartSlave(detector.get());
+  ASSERT_SOME(agent);
+
+  AWAIT_READY(agentRegisteredMessage);
+
+  ContentType contentType = GetParam();
+
+  v1::master::Call getState;
+  getState.set_type(v1::master::Call::GET_STATE);
+
+  v1::master::Call getAgents;
+  getAgents.set_type(v1::master::Call::GET_AGENTS);
+
+  vector<Future<v1::master::Response>> states;
+  vector<Future<v1::master::Response>> agents;
+
+  for (int i = 0; i < 10; i++) {
+    states.push_back(post(master.get()->pid, getState, contentType));
+    agents.push_back(post(master.get()->pid, getAgents, contentType));
+  }
+
+  for (size_t i = 0; i < states.size(); i++) {
+    AWAIT_READY(states[i]);
+    ASSERT_EQ(v1::master::Response::GET_STATE, states[i]->type());
+    ASSERT_EQ(1, states[i]->get_state().get_agents().agents_size());
+
+    AWAIT_READY(agents[i]);
+    ASSERT_EQ(v1::master::Response::GET_AGENTS, agents[i]->type());
+    ASSERT_EQ(1, agents[i]->get_agents().agents_size());
+
+    EXPECT_EQ(
+        states[0]->get_state().get_agents().SerializeAsString(),
+        states[i]->get_state().get_agents().SerializeAsString());
+
+    EXPECT_EQ(
+        states[i]->get_state().get_agents().SerializeAsString(),
+        agents[i]->get_agents().SerializeAsString());
+  }
+}
+
+
 TEST_P(MasterAPITest, GetFlags)
 {
   Try<Owned<cluster::Master>> master = this->StartMaster();
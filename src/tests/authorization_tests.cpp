@@ -14,6 +14,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <list>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -24,6 +26,13 @@
 
 #include <mesos/module/authorizer.hpp>
 
+#include <process/collect.hpp>
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
 #include "authorizer/local/authorizer.hpp"
@@ -37,6 +46,9 @@ namespace mesos {
 namespace internal {
 namespace tests {
 
+using std::cout;
+using std::endl;
+using std::list;
 using std::string;
 
 
@@ -2451,6 +2463,107 @@ TYPED_TEST(AuthorizationTest, ViewRole)
   }
 }
 
+
+class Authorization_BENCHMARK_Test
+  : public MesosTest,
+    public ::testing::WithParamInterface<size_t> {};
+
+
+// The authorization benchmark tests are parameterized by the number
+// of ACLs.
+INSTANTIATE_TEST_CASE_P(
+    ACLs,
+    Authorization_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U));
+
+
+// Measures the throughput of the local authorizer, both for plain
+// authorization requests and for an object approver (as used when
+// filtering the master endpoints), with many ACLs.
+TEST_P(Authorization_BENCHMARK_Test, LocalAuthorizer)
+{
+  const size_t aclCount = GetParam();
+
+  ACLs acls;
+
+  // Each principal can only view its own role.
+  for (size_t i = 0; i < aclCount; i++) {
+    mesos::ACL::ViewRole* acl = acls.add_view_roles();
+    acl->mutable_principals()->add_values("principal" + stringify(i));
+    acl->mutable_roles()->add_values("role" + stringify(i));
+  }
+
+  {
+    // No other principal can view any role.
+    mesos::ACL::ViewRole* acl = acls.add_view_roles();
+    acl->mutable_principals()->set_type(mesos::ACL::Entity::ANY);
+    acl->mutable_roles()->set_type(mesos::ACL::Entity::NONE);
+  }
+
+  Try<Authorizer*> create = LocalAuthorizer::create(acls);
+  ASSERT_SOME(create);
+  Owned<Authorizer> authorizer(create.get());
+
+  const size_t requestCount = 100000;
+
+  // Half of the requests are for a role that the principal cannot
+  // view. Note that requests are repeated once all the principals
+  // have been used, which exercises the decisions cache.
+  list<Future<bool>> futures;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < requestCount; i++) {
+    authorization::Request request;
+    request.set_action(authorization::VIEW_ROLE);
+    request.mutable_subject()->set_value(
+        "principal" + stringify(i % aclCount));
+    request.mutable_object()->set_value(
+        "role" + stringify((i % 2 == 0 ? i : i + 1) % aclCount));
+
+    futures.push_back(authorizer->authorized(request));
+  }
+
+  Future<list<bool>> authorized = collect(futures);
+  AWAIT_READY_FOR(authorized, Minutes(5));
+
+  Duration elapsed = watch.elapsed();
+
+  cout << "Authorized " << requestCount << " requests with " << aclCount
+       << " ACLs in " << elapsed << " ("
+       << static_cast<uint64_t>(requestCount / elapsed.secs())
+       << " requests/sec)" << endl;
+
+  // Now approve objects for a single subject.
+  authorization::Subject subject;
+  subject.set_value("principal" + stringify(aclCount / 2));
+
+  Future<Owned<ObjectApprover>> approver =
+    authorizer->getObjectApprover(subject, authorization::VIEW_ROLE);
+
+  AWAIT_READY(approver);
+
+  watch.start();
+
+  for (size_t i = 0; i < requestCount; i++) {
+    const string role = "role" + stringify(i % aclCount);
+
+    ObjectApprover::Object object;
+    object.value = &role;
+
+    Try<bool> approved = approver.get()->approved(object);
+    ASSERT_SOME(approved);
+  }
+
+  elapsed = watch.elapsed();
+
+  cout << "Approved " << requestCount << " objects with " << aclCount
+       << " ACLs in " << elapsed << " ("
+       << static_cast<uint64_t>(requestCount / elapsed.secs())
+       << " objects/sec)" << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -234,7 +234,8 @@ Try<process::Owned<Master>> Master::start(
   if (flags.registry == "in_memory") {
     master->storage.reset(new mesos::state::InMemoryStorage());
   } else if (flags.registry == "replicated_log") {
-    master->storage.reset(new mesos::state::LogStorage(master->log.get()));
+    master->storage.reset(new mesos::state::LogStorage(
+        master->log.get(), 0, flags.registry_batch_writes));
   } else {
     return Error(
         "Unsupported option for registry persistence: " + flags.registry);
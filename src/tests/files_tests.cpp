@@ -47,6 +47,7 @@ using process::Owned;
 
 using process::http::BadRequest;
 using process::http::Forbidden;
+using process::http::Headers;
 using process::http::NotFound;
 using process::http::OK;
 using process::http::Response;
@@ -484,6 +485,63 @@ TEST_F(FilesTest, DownloadTest)
 }
 
 
+// Tests that '/files/download' serves a single range of a file when
+// requested with a 'Range' header.
+TEST_F(FilesTest, DownloadRangeTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "0123456789"));
+  AWAIT_EXPECT_READY(files.attach("file", "file"));
+
+  Headers headers;
+  headers["Range"] = "bytes=2-5";
+
+  Future<Response> response =
+    process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      Response(process::http::Status::PARTIAL_CONTENT).status,
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 2-5/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("2345", response);
+
+  // The last bytes of the file, as when tailing it.
+  headers["Range"] = "bytes=-3";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 7-9/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("789", response);
+
+  // An open ended range past the end of the file.
+  headers["Range"] = "bytes=8-100";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 8-9/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("89", response);
+
+  headers["Range"] = "bytes=10-";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      Response(process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE).status,
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes */10", "Content-Range", response);
+
+  // Multiple ranges are not supported, hence the whole file is sent.
+  headers["Range"] = "bytes=0-1,4-5";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("0123456789", response);
+}
+
+
 // Tests that the '/files/debug' endpoint works as expected.
 TEST_F(FilesTest, DebugTest)
 {
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -512,6 +513,103 @@ TEST_F(HierarchicalAllocatorTest, ReservedDRF)
 }
 
 
+// Tests that computing the resources available on the agents in
+// parallel results in the same allocation as computing them serially.
+// The minimum number of agents per shard is lowered so that a batch
+// allocation on a small cluster is split across several shards.
+TEST_F(HierarchicalAllocatorTest, ParallelAllocation)
+{
+  Clock::pause();
+
+  const size_t agentCount = 16;
+
+  const Resources agentResources = Resources::parse(
+      "cpus:2;mem:1024;disk:0;cpus(role1):1;mem(role1):512;disk(role1):0")
+    .get();
+
+  // Returns the resources offered to each role in a batch allocation
+  // of all the agents, using the given number of shards.
+  auto allocate = [&](size_t allocationParallelism) {
+    vector<Allocation> offers;
+
+    delete allocator;
+    allocator = createAllocator<HierarchicalDRFAllocator>(
+        allocationParallelism, 1u);
+
+    initialize(
+        master::Flags(),
+        [&offers](const FrameworkID& frameworkId,
+                  const hashmap<SlaveID, Resources>& resources) {
+          Allocation allocation;
+          allocation.frameworkId = frameworkId;
+          allocation.resources = resources;
+
+          offers.push_back(allocation);
+        });
+
+    hashmap<FrameworkID, string> roles;
+
+    foreach (const string& role, vector<string>({"role1", "role2"})) {
+      FrameworkInfo framework = createFrameworkInfo(role);
+      allocator->addFramework(framework.id(), framework, {});
+      roles[framework.id()] = role;
+    }
+
+    for (size_t i = 0; i < agentCount; i++) {
+      SlaveInfo agent = createSlaveInfo(agentResources);
+      allocator->addSlave(agent.id(), agent, None(), agent.resources(), {});
+    }
+
+    // The agents are offered one at a time as they are added. Decline
+    // all of these offers so that the next batch allocation considers
+    // all the agents at once.
+    Clock::settle();
+
+    foreach (const Allocation& allocation, offers) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   allocation.resources) {
+        allocator->recoverResources(
+            allocation.frameworkId, slaveId, resources, None());
+      }
+    }
+
+    Clock::settle();
+    offers.clear();
+
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    hashmap<string, Resources> allocated;
+    foreach (const Allocation& allocation, offers) {
+      allocated[roles.at(allocation.frameworkId)] +=
+        Resources::sum(allocation.resources);
+    }
+
+    return allocated;
+  };
+
+  const hashmap<string, Resources> serial = allocate(1u);
+  const hashmap<string, Resources> parallel = allocate(4u);
+
+  ASSERT_FALSE(serial.empty());
+  EXPECT_EQ(serial, parallel);
+
+  // All the agents are offered in full.
+  Resources expected;
+  for (size_t i = 0; i < agentCount; i++) {
+    expected += agentResources;
+  }
+
+  Resources total;
+  foreachvalue (const Resources& resources, parallel) {
+    total += resources;
+  }
+
+  EXPECT_EQ(expected, total);
+}
+
+
 // Tests that the fairness exclusion list works as expected. The test
 // accomplishes this by adding frameworks and slaves one at a time to
 // the allocator with exclude resources, making sure that each time a
@@ -1379,6 +1477,56 @@ TEST_F(HierarchicalAllocatorTest, UpdateAllocationSharedPersistentVolume)
 }
 
 
+// This test verifies that a shared persistent volume created through
+// `updateAllocation()` is offered to other frameworks in the next batch
+// allocation, even though no other resources became available.
+TEST_F(HierarchicalAllocatorTest, UpdateAllocationSharedVolumeCandidate)
+{
+  Clock::pause();
+
+  initialize();
+
+  SlaveInfo slave = createSlaveInfo("cpus:100;mem:100;disk(role1):100");
+  allocator->addSlave(slave.id(), slave, None(), slave.resources(), {});
+
+  FrameworkInfo framework1 = createFrameworkInfo(
+      "role1",
+      {FrameworkInfo::Capability::SHARED_RESOURCES});
+  allocator->addFramework(framework1.id(), framework1, {});
+
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework1.id(), allocation->frameworkId);
+  EXPECT_EQ(slave.resources(), Resources::sum(allocation->resources));
+
+  FrameworkInfo framework2 = createFrameworkInfo(
+      "role1",
+      {FrameworkInfo::Capability::SHARED_RESOURCES});
+  allocator->addFramework(framework2.id(), framework2, {});
+
+  // Let the allocation triggered by adding `framework2` complete. It
+  // finds nothing to offer since `framework1` holds all the resources.
+  Clock::settle();
+
+  Resource volume = createDiskResource(
+      "5", "role1", "id1", None(), None(), true);
+
+  allocator->updateAllocation(
+      framework1.id(),
+      slave.id(),
+      Resources::sum(allocation->resources),
+      {CREATE(volume)});
+
+  // Only the shared volume can be offered to `framework2`.
+  Clock::advance(flags.allocation_interval);
+
+  allocation = allocations.get();
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework2.id(), allocation->frameworkId);
+  EXPECT_EQ(Resources(volume), Resources::sum(allocation->resources));
+}
+
+
 // Tests that shared resources are only offered to frameworks who have
 // opted in for SHARED_RESOURCES.
 TEST_F(HierarchicalAllocatorTest, SharedResourcesCapability)
@@ -3099,6 +3247,80 @@ TEST_F(HierarchicalAllocatorTest, AllocationRunTimerMetrics)
 }
 
 
+// This test checks that batch allocations only consider the agents
+// that changed since they were last allocated, and that the number
+// of agents considered is correctly reflected in the metrics.
+TEST_F(HierarchicalAllocatorTest, AllocationCandidatesMetrics)
+{
+  Clock::pause();
+
+  initialize();
+
+  SlaveInfo agent1 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(agent1.id(), agent1, None(), agent1.resources(), {});
+
+  SlaveInfo agent2 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(agent2.id(), agent2, None(), agent2.resources(), {});
+
+  // Adding a framework triggers an allocation for all agents.
+  FrameworkInfo framework = createFrameworkInfo("role1");
+  allocator->addFramework(framework.id(), framework, {});
+
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework.id(), allocation->frameworkId);
+  EXPECT_EQ(2u, allocation->resources.size());
+
+  // Each added agent was considered once on its own, then both
+  // agents were considered when the framework was added.
+  JSON::Object expected;
+  expected.values = {
+      {"allocator/mesos/allocation_runs", 3},
+      {"allocator/mesos/allocation_candidates", 4},
+      {"allocator/mesos/allocation_run_candidates", 2},
+  };
+
+  JSON::Value metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+
+  // Nothing changed since the last allocation, hence the batch
+  // allocation does not need to consider any agents.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+
+  // Recovering the resources of an agent makes it a candidate
+  // for the next batch allocation.
+  allocator->recoverResources(
+      framework.id(),
+      agent1.id(),
+      allocation->resources.get(agent1.id()).get(),
+      None());
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  allocation = allocations.get();
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework.id(), allocation->frameworkId);
+  EXPECT_EQ(agent1.resources(), Resources::sum(allocation->resources));
+
+  expected.values = {
+      {"allocator/mesos/allocation_runs", 4},
+      {"allocator/mesos/allocation_candidates", 5},
+      {"allocator/mesos/allocation_run_candidates", 1},
+  };
+
+  metrics = Metrics();
+
+  EXPECT_TRUE(metrics.contains(expected));
+}
+
+
 // This test checks that per-role active offer filter metrics
 // are correctly reported in the metrics endpoint.
 TEST_F(HierarchicalAllocatorTest, ActiveOfferFiltersMetrics)
@@ -4197,6 +4419,126 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, SuppressOffers)
 }
 
 
+// Measures the time of batch allocations when the allocator computes
+// the resources available on the agents serially and in parallel, see
+// `--allocation_parallelism`.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, ParallelAllocation)
+{
+  size_t agentCount = std::tr1::get<0>(GetParam());
+  size_t frameworkCount = std::tr1::get<1>(GetParam());
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  struct Allocation
+  {
+    FrameworkID   frameworkId;
+    SlaveID       slaveId;
+    Resources     resources;
+  };
+
+  vector<Allocation> allocations;
+
+  auto offerCallback = [&allocations](
+      const FrameworkID& frameworkId,
+      const hashmap<SlaveID, Resources>& resources)
+  {
+    foreachpair (const SlaveID& slaveId, const Resources& r, resources) {
+      Allocation allocation;
+      allocation.frameworkId = frameworkId;
+      allocation.slaveId = slaveId;
+      allocation.resources = r;
+
+      allocations.push_back(std::move(allocation));
+    }
+  };
+
+  cout << "Using " << agentCount << " agents and "
+       << frameworkCount << " frameworks" << endl;
+
+  const Resources agentResources = Resources::parse(
+      "cpus:24;mem:4096;disk:4096;ports:[31000-32000]").get();
+
+  // Each agent has a portion of it's resources allocated to a single
+  // framework. We round-robin through the frameworks when allocating.
+  Resources allocation = Resources::parse("cpus:16;mem:1024;disk:1024").get();
+
+  Try<::mesos::Value::Ranges> ranges = fragment(createRange(31000, 32000), 16);
+  ASSERT_SOME(ranges);
+  ASSERT_EQ(16, ranges->range_size());
+
+  allocation += createPorts(ranges.get());
+
+  const size_t parallelism =
+    std::max(std::thread::hardware_concurrency(), 2u);
+
+  foreach (size_t allocationParallelism, vector<size_t>({1u, parallelism})) {
+    // Start over with a fresh allocator for each level of parallelism.
+    delete allocator;
+    allocator =
+      createAllocator<HierarchicalDRFAllocator>(allocationParallelism);
+    allocations.clear();
+
+    initialize(master::Flags(), offerCallback);
+
+    vector<FrameworkInfo> frameworks;
+    frameworks.reserve(frameworkCount);
+
+    for (size_t i = 0; i < frameworkCount; i++) {
+      frameworks.push_back(createFrameworkInfo("*"));
+      allocator->addFramework(frameworks[i].id(), frameworks[i], {});
+    }
+
+    for (size_t i = 0; i < agentCount; i++) {
+      SlaveInfo agent = createSlaveInfo(agentResources);
+
+      hashmap<FrameworkID, Resources> used;
+      used[frameworks[i % frameworkCount].id()] = allocation;
+
+      allocator->addSlave(
+          agent.id(), agent, None(), agent.resources(), used);
+    }
+
+    // Wait for all the `addFramework` and `addSlave` operations
+    // to be processed.
+    Clock::settle();
+
+    const size_t allocationsCount = 5;
+
+    for (size_t i = 0; i < allocationsCount; i++) {
+      // Decline all the outstanding offers without a filter so that
+      // each batch allocation offers the same resources again.
+      foreach (const Allocation& allocation, allocations) {
+        allocator->recoverResources(
+            allocation.frameworkId,
+            allocation.slaveId,
+            allocation.resources,
+            None());
+      }
+
+      // Wait for all declined offers to be processed.
+      Clock::settle();
+      allocations.clear();
+
+      Stopwatch watch;
+      watch.start();
+
+      // Advance the clock and trigger a batch allocation.
+      Clock::advance(flags.allocation_interval);
+      Clock::settle();
+
+      watch.stop();
+
+      cout << "allocate() with an allocation parallelism of "
+           << allocationParallelism << " took " << watch.elapsed()
+           << " to make " << allocations.size() << " offers" << endl;
+    }
+  }
+
+  Clock::resume();
+}
+
+
 // Measures the processing time required for the allocator metrics.
 //
 // TODO(bmahler): Add allocations to this benchmark.
@@ -16,9 +16,11 @@
 
 #include <stdint.h>
 
+#include <iostream>
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -65,9 +67,12 @@ using namespace mesos::internal::log;
 
 using namespace process;
 
+using std::cout;
+using std::endl;
 using std::list;
 using std::set;
 using std::string;
+using std::vector;
 
 using testing::_;
 using testing::Eq;
@@ -139,6 +144,78 @@ typedef ::testing::Types<LevelDBStorage> LogStorageTypes;
 TYPED_TEST_CASE(LogStorageTest, LogStorageTypes);
 
 
+TYPED_TEST(LogStorageTest, PersistMultiple)
+{
+  TypeParam storage;
+
+  Try<Storage::State> state = storage.restore(os::getcwd() + "/.log");
+  ASSERT_SOME(state);
+
+  // Append from position 0 to position 9 at once.
+  vector<Action> actions;
+  for (uint64_t i = 0; i < 10; i++) {
+    Action action;
+    action.set_position(i);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(stringify(i));
+
+    actions.push_back(action);
+  }
+
+  ASSERT_SOME(storage.persist(actions));
+
+  for (uint64_t i = 0; i < 10; i++) {
+    Try<Action> action = storage.read(i);
+    ASSERT_SOME(action);
+
+    EXPECT_EQ(i, action.get().position());
+    EXPECT_TRUE(action.get().learned());
+    EXPECT_EQ(Action::APPEND, action.get().type());
+    ASSERT_TRUE(action.get().has_append());
+    EXPECT_EQ(stringify(i), action.get().append().bytes());
+  }
+
+  // Append at position 10 and truncate to position 3 (at position
+  // 11) at once.
+  actions.clear();
+
+  Action append;
+  append.set_position(10);
+  append.set_promised(1);
+  append.set_performed(1);
+  append.set_learned(true);
+  append.set_type(Action::APPEND);
+  append.mutable_append()->set_bytes(stringify(10));
+  actions.push_back(append);
+
+  Action truncate;
+  truncate.set_position(11);
+  truncate.set_promised(1);
+  truncate.set_performed(1);
+  truncate.set_learned(true);
+  truncate.set_type(Action::TRUNCATE);
+  truncate.mutable_truncate()->set_to(3);
+  actions.push_back(truncate);
+
+  ASSERT_SOME(storage.persist(actions));
+
+  for (uint64_t i = 0; i < 12; i++) {
+    Try<Action> action = storage.read(i);
+
+    if (i < 3) {
+      // Position 0, 1 and 2 have been truncated.
+      EXPECT_ERROR(action);
+    } else {
+      ASSERT_SOME(action);
+      EXPECT_EQ(i, action.get().position());
+    }
+  }
+}
+
+
 TYPED_TEST(LogStorageTest, Truncate)
 {
   TypeParam storage;
@@ -321,6 +398,67 @@ TYPED_TEST(LogStorageTest, TruncateWithManyHoles)
 }
 
 
+TYPED_TEST(LogStorageTest, Compact)
+{
+  Clock::pause();
+
+  TypeParam storage;
+
+  Try<Storage::State> state = storage.restore(os::getcwd() + "/.log");
+  ASSERT_SOME(state);
+
+  // Append from position 0 to position 9 and truncate to position 5
+  // (at position 10).
+  vector<Action> actions;
+  for (uint64_t i = 0; i < 10; i++) {
+    Action action;
+    action.set_position(i);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(stringify(i));
+
+    actions.push_back(action);
+  }
+
+  Action truncate;
+  truncate.set_position(10);
+  truncate.set_promised(1);
+  truncate.set_performed(1);
+  truncate.set_learned(true);
+  truncate.set_type(Action::TRUNCATE);
+  truncate.mutable_truncate()->set_to(5);
+  actions.push_back(truncate);
+
+  ASSERT_SOME(storage.persist(actions));
+
+  Future<Storage::Statistics> statistics = storage.statistics();
+  AWAIT_READY(statistics);
+  EXPECT_EQ(0u, statistics.get().compactions);
+  EXPECT_NONE(statistics.get().compaction);
+
+  // The compaction happens in the background after a delay.
+  Clock::advance(Minutes(1));
+  Clock::settle();
+
+  statistics = storage.statistics();
+  AWAIT_READY(statistics);
+  EXPECT_EQ(1u, statistics.get().compactions);
+  EXPECT_SOME(statistics.get().compaction);
+
+  Clock::resume();
+
+  EXPECT_ERROR(storage.read(4));
+
+  for (uint64_t i = 5; i < 10; i++) {
+    Try<Action> action = storage.read(i);
+    ASSERT_SOME(action);
+    EXPECT_EQ(stringify(i), action.get().append().bytes());
+  }
+}
+
+
 class ReplicaTest : public TemporaryDirectoryTest
 {
 protected:
@@ -581,6 +719,90 @@ TEST_F(ReplicaTest, NonVoting)
 }
 
 
+class Replica_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public ::testing::WithParamInterface<size_t>
+{
+protected:
+  tool::Initialize initializer;
+};
+
+
+// The replica benchmark tests are parameterized by the number of
+// positions in the log.
+INSTANTIATE_TEST_CASE_P(
+    Positions,
+    Replica_BENCHMARK_Test,
+    ::testing::Values(10000U, 100000U, 1000000U));
+
+
+// Measures the time it takes to restore a replica from a populated
+// database in which the first half of the log has been truncated.
+// The first restore has to reclaim the truncated positions (as the
+// storage was closed before the background compaction kicked in)
+// while the second one starts from a compacted database.
+TEST_P(Replica_BENCHMARK_Test, Restore)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  ASSERT_SOME(initializer.execute());
+
+  const size_t positions = GetParam();
+
+  {
+    LevelDBStorage storage;
+    ASSERT_SOME(storage.restore(path));
+
+    const string bytes(1024, 'a');
+
+    vector<Action> actions;
+    for (uint64_t position = 1; position <= positions; position++) {
+      Action action;
+      action.set_position(position);
+      action.set_promised(1);
+      action.set_performed(1);
+      action.set_learned(true);
+      action.set_type(Action::APPEND);
+      action.mutable_append()->set_bytes(bytes);
+
+      actions.push_back(action);
+
+      if (actions.size() == 1000 || position == positions) {
+        ASSERT_SOME(storage.persist(actions));
+        actions.clear();
+      }
+    }
+
+    Action truncate;
+    truncate.set_position(positions + 1);
+    truncate.set_promised(1);
+    truncate.set_performed(1);
+    truncate.set_learned(true);
+    truncate.set_type(Action::TRUNCATE);
+    truncate.mutable_truncate()->set_to(positions / 2);
+
+    ASSERT_SOME(storage.persist(truncate));
+  }
+
+  for (int i = 0; i < 2; i++) {
+    Stopwatch watch;
+    watch.start();
+
+    Replica replica(path);
+    AWAIT_READY_FOR(replica.status(), Minutes(5));
+
+    Duration elapsed = watch.elapsed();
+
+    Future<Storage::Statistics> statistics = replica.statistics();
+    AWAIT_READY(statistics);
+
+    cout << "Restored a replica with " << positions << " positions ("
+         << positions / 2 << " truncated, " << statistics.get().size
+         << " on disk) in " << elapsed << endl;
+  }
+}
+
+
 class CoordinatorTest : public TemporaryDirectoryTest
 {
 protected:
@@ -1214,6 +1436,339 @@ TEST_F(CoordinatorTest, MultipleAppends)
 }
 
 
+// Tests that appends issued while a write is in progress are written
+// together (in a single round) when group commits are enabled.
+TEST_F(CoordinatorTest, GroupCommit)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, true);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  // Remove a replica from the network so that the first append waits
+  // for a quorum and the other appends arrive while it is in progress.
+  // Without group commits those appends would fail.
+  network->remove(replica2->pid());
+
+  Future<Option<uint64_t>> first = coord.append("1");
+
+  list<Future<Option<uint64_t>>> appending;
+  for (uint64_t position = 2; position <= 10; position++) {
+    appending.push_back(coord.append(stringify(position)));
+  }
+
+  network->add(replica2->pid());
+
+  AWAIT_READY(first);
+  EXPECT_SOME_EQ(1u, first.get());
+
+  uint64_t position = 2;
+  foreach (const Future<Option<uint64_t>>& append, appending) {
+    AWAIT_READY(append);
+    EXPECT_SOME_EQ(position++, append.get());
+  }
+
+  {
+    Future<list<Action>> actions = replica1->read(1, 10);
+    AWAIT_READY(actions);
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_TRUE(action.learned());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+}
+
+
+// Tests that a coordinator with a window of writes starts appends
+// without waiting for the previous ones and returns them in order.
+TEST_F(CoordinatorTest, PipelinedAppends)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, false, 5);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  // Remove a replica from the network so that the appends wait for a
+  // quorum, which ensures that they are all in progress at once.
+  network->remove(replica2->pid());
+
+  list<Future<Option<uint64_t>>> appending;
+  for (uint64_t position = 1; position <= 5; position++) {
+    appending.push_back(coord.append(stringify(position)));
+  }
+
+  // The window is full.
+  AWAIT_FAILED(coord.append("6"));
+
+  network->add(replica2->pid());
+
+  uint64_t position = 1;
+  foreach (const Future<Option<uint64_t>>& append, appending) {
+    AWAIT_READY(append);
+    EXPECT_SOME_EQ(position++, append.get());
+  }
+
+  {
+    Future<list<Action>> actions = replica1->read(1, 5);
+    AWAIT_READY(actions);
+    EXPECT_EQ(5u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+}
+
+
+// Tests that all of the writes in progress return none once a
+// coordinator gets demoted.
+TEST_F(CoordinatorTest, PipelinedAppendsDemoted)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord1(2, replica1, network1, false, 3);
+
+  {
+    Future<Option<uint64_t>> electing = coord1.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  Shared<Network> network2(new Network(pids));
+
+  Coordinator coord2(2, replica2, network2);
+
+  {
+    Future<Option<uint64_t>> electing = coord2.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  list<Future<Option<uint64_t>>> appending;
+  for (int i = 0; i < 3; i++) {
+    appending.push_back(coord1.append("hello moto"));
+  }
+
+  foreach (const Future<Option<uint64_t>>& append, appending) {
+    AWAIT_READY(append);
+    EXPECT_NONE(append.get());
+  }
+
+  // The demoted coordinator does not write anymore.
+  {
+    Future<Option<uint64_t>> appending = coord1.append("hello moto");
+    AWAIT_READY(appending);
+    EXPECT_NONE(appending.get());
+  }
+
+  {
+    Future<Option<uint64_t>> appending = coord2.append("hello hello");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(1u, appending.get());
+  }
+}
+
+
+// Tests that the holes left behind by a coordinator that got demoted
+// with a window of appends in progress are filled by the next elected
+// coordinator, with either the original data or NOPs.
+TEST_F(CoordinatorTest, PipelinedAppendsDemotedFill)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  const string path3 = os::getcwd() + "/.log3";
+  initializer.flags.path = path3;
+  ASSERT_SOME(initializer.execute());
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+  Shared<Replica> replica3(new Replica(path3));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+  pids.insert(replica3->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord1(2, replica1, network1, false, 3);
+
+  {
+    Future<Option<uint64_t>> electing = coord1.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  pids.clear();
+  pids.insert(replica2->pid());
+  pids.insert(replica3->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  Coordinator coord2(2, replica3, network2);
+
+  {
+    // Note that the first election might fail because 'coord2' gets
+    // its proposal number from 'replica3', in which case a second
+    // attempt will need to be made.
+    Future<Option<uint64_t>> electing = coord2.elect();
+    AWAIT_READY(electing);
+
+    if (electing.get().isNone()) {
+      electing = coord2.elect();
+      AWAIT_READY(electing);
+    }
+
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  // Drop the first write to 'replica1' so that position 1 is not
+  // accepted by any replica while positions 2 and 3 are only accepted
+  // by 'replica1' (the other replicas have been promised to 'coord2').
+  DROP_PROTOBUF(WriteRequest(), _, Eq(replica1->pid()));
+
+  list<Future<Option<uint64_t>>> appending;
+  for (uint64_t position = 1; position <= 3; position++) {
+    appending.push_back(coord1.append(stringify(position)));
+  }
+
+  // The demoted coordinator returns none for all of the appends in
+  // progress.
+  foreach (const Future<Option<uint64_t>>& append, appending) {
+    AWAIT_READY(append);
+    EXPECT_NONE(append.get());
+  }
+
+  {
+    Future<list<Action>> actions = replica1->read(2, 3);
+    AWAIT_READY(actions);
+    ASSERT_EQ(2u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_FALSE(action.learned());
+    }
+  }
+
+  pids.clear();
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network3(new Network(pids));
+
+  Coordinator coord3(2, replica1, network3);
+
+  {
+    // Note that the first election might fail because 'coord3' gets
+    // its proposal number from 'replica1' which has only been promised
+    // to 'coord1', in which case a second attempt will need to be made.
+    Future<Option<uint64_t>> electing = coord3.elect();
+    AWAIT_READY(electing);
+
+    if (electing.get().isNone()) {
+      electing = coord3.elect();
+      AWAIT_READY(electing);
+    }
+
+    EXPECT_SOME_EQ(3u, electing.get());
+  }
+
+  {
+    Future<Option<uint64_t>> appending = coord3.append("4");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(4u, appending.get());
+  }
+
+  // The log has no gaps: the hole at position 1 got filled with a NOP
+  // and the appends that had been accepted kept their original data.
+  {
+    Future<list<Action>> actions = replica1->read(1, 4);
+    AWAIT_READY(actions);
+    ASSERT_EQ(4u, actions.get().size());
+
+    uint64_t position = 1;
+    foreach (const Action& action, actions.get()) {
+      EXPECT_EQ(position, action.position());
+      ASSERT_TRUE(action.has_type());
+
+      if (position == 1) {
+        EXPECT_EQ(Action::NOP, action.type());
+      } else {
+        ASSERT_EQ(Action::APPEND, action.type());
+        EXPECT_EQ(stringify(position), action.append().bytes());
+      }
+
+      position++;
+    }
+  }
+}
+
+
 TEST_F(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -1824,8 +2379,11 @@ TEST_F(RecoverTest, CatchupRetry)
   // learned messages are blocked from being sent replica2, the
   // catch-up process has to wait for a quorum of explicit promises.
   // If we don't allow retry, the catch-up process will get stuck at
-  // promise phase even if replica1 reemerges later.
+  // promise phase even if replica1 reemerges later. We also drop the
+  // catch-up request to replica1 so that the learned actions cannot
+  // be fetched in bulk from it.
   DROP_PROTOBUF(PromiseRequest(), _, Eq(replica1->pid()));
+  DROP_PROTOBUF(CatchUpRequest(), _, Eq(replica1->pid()));
 
   Future<Nothing> catching =
     catchup(2, replica3, network2, None(), positions, Seconds(10));
@@ -1853,6 +2411,79 @@ TEST_F(RecoverTest, CatchupRetry)
 }
 
 
+// This test verifies that the learned positions are copied in bulk
+// from another replica, without running Paxos on each of them.
+TEST_F(RecoverTest, CatchupLearned)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  const string path3 = os::getcwd() + "/.log3";
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord(2, replica1, network1);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  IntervalSet<uint64_t> positions;
+
+  for (uint64_t position = 1; position <= 10; position++) {
+    Future<Option<uint64_t>> appending = coord.append(stringify(position));
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position, appending.get());
+    positions += position;
+  }
+
+  Shared<Replica> replica3(new Replica(path3));
+
+  pids.insert(replica3->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  // Paxos cannot make progress without promises.
+  DROP_PROTOBUFS(PromiseRequest(), _, _);
+
+  Future<CatchUpRequest> catchUpRequest =
+    FUTURE_PROTOBUF(CatchUpRequest(), _, Eq(replica1->pid()));
+
+  Future<Nothing> catching =
+    catchup(2, replica3, network2, None(), positions, Seconds(10));
+
+  AWAIT_READY(catchUpRequest);
+  EXPECT_EQ(1u, catchUpRequest.get().from());
+  EXPECT_EQ(10u, catchUpRequest.get().to());
+
+  AWAIT_READY(catching);
+
+  Future<list<Action>> actions = replica3->read(1, 10);
+  AWAIT_READY(actions);
+  ASSERT_EQ(10u, actions.get().size());
+  foreach (const Action& action, actions.get()) {
+    EXPECT_TRUE(action.learned());
+    ASSERT_TRUE(action.has_type());
+    ASSERT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+}
+
+
 TEST_F(RecoverTest, AutoInitialization)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -2051,6 +2682,66 @@ TEST_F(LogTest, WriteRead)
 }
 
 
+// Tests that a writer with group commits enabled allows appends to be
+// issued without waiting for the previous ones.
+TEST_F(LogTest, GroupCommit)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  Replica replica1(path1);
+
+  set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, true);
+
+  Future<Option<Log::Position>> start = writer.start();
+
+  AWAIT_READY(start);
+  ASSERT_SOME(start.get());
+
+  list<Future<Option<Log::Position>>> positions;
+  for (int i = 0; i < 10; i++) {
+    positions.push_back(writer.append(stringify(i)));
+  }
+
+  // The appends end up at consecutive positions in order.
+  Option<Log::Position> last;
+  foreach (const Future<Option<Log::Position>>& position, positions) {
+    AWAIT_READY(position);
+    ASSERT_SOME(position.get());
+
+    if (last.isSome()) {
+      EXPECT_LT(last.get(), position.get().get());
+    }
+
+    last = position.get().get();
+  }
+
+  Log::Reader reader(&log);
+
+  Future<list<Log::Entry>> entries =
+    reader.read(positions.front().get().get(), last.get());
+
+  AWAIT_READY(entries);
+
+  ASSERT_EQ(10u, entries.get().size());
+
+  int i = 0;
+  foreach (const Log::Entry& entry, entries.get()) {
+    EXPECT_EQ(stringify(i++), entry.data);
+  }
+}
+
+
 TEST_F(LogTest, Position)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -2111,6 +2802,13 @@ TEST_F(LogTest, Metrics)
 
   ASSERT_EQ(1u, snapshot.values.count("prefix/log/recovered"));
   EXPECT_EQ(1, snapshot.values["prefix/log/recovered"]);
+
+  ASSERT_EQ(1u, snapshot.values.count("prefix/log/storage/size_bytes"));
+  ASSERT_EQ(1u, snapshot.values.count("prefix/log/storage/compactions"));
+  EXPECT_EQ(0, snapshot.values["prefix/log/storage/compactions"]);
+
+  // No compaction has been done yet.
+  EXPECT_EQ(0u, snapshot.values.count("prefix/log/storage/compaction_ms"));
 }
 
 
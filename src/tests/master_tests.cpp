@@ -16,6 +16,10 @@
 
 #include <unistd.h>
 
+#include <sys/resource.h>
+
+#include <iostream>
+#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,19 +34,24 @@
 #include <mesos/scheduler/scheduler.hpp>
 
 #include <process/clock.hpp>
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/http.hpp>
+#include <process/id.hpp>
 #include <process/owned.hpp>
 #include <process/pid.hpp>
+#include <process/protobuf.hpp>
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/metrics.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/json.hpp>
 #include <stout/net.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 
@@ -94,11 +103,17 @@ using process::Future;
 using process::Owned;
 using process::PID;
 using process::Promise;
+using process::UPID;
 
+using process::http::NotModified;
 using process::http::OK;
+using process::http::Pipe;
 using process::http::Response;
 using process::http::Unauthorized;
 
+using std::cout;
+using std::endl;
+using std::list;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -110,6 +125,7 @@ using testing::Eq;
 using testing::Not;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -3129,6 +3145,53 @@ TEST_F(MasterTest, StateEndpoint)
 }
 
 
+// This test ensures that the streamed state endpoint is the same as
+// the non-streamed one.
+TEST_F(MasterTest, StateEndpointStreamed)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+
+  Future<Response> response = process::http::get(
+      master.get()->pid,
+      "state",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+  Try<JSON::Object> expected = JSON::parse<JSON::Object>(response->body);
+  ASSERT_SOME(expected);
+
+  response = process::http::get(
+      master.get()->pid,
+      "state",
+      "stream=true",
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ(APPLICATION_JSON, "Content-Type", response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("chunked", "Transfer-Encoding", response);
+
+  Try<JSON::Object> state = JSON::parse<JSON::Object>(response->body);
+  ASSERT_SOME(state);
+
+  EXPECT_EQ(JSON::Value(expected.get()), JSON::Value(state.get()));
+
+  ASSERT_TRUE(state->values["slaves"].is<JSON::Array>());
+  EXPECT_EQ(1u, state->values["slaves"].as<JSON::Array>().values.size());
+}
+
+
 // This test ensures that the framework's information is included in
 // the master's state endpoint.
 //
@@ -3320,6 +3383,107 @@ TEST_F(MasterTest, StateSummaryEndpoint)
 }
 
 
+// This test verifies that the state summary is served from a cache
+// until the state of the master changes, and that requests carrying
+// the entity tag of the current summary get a 304 response.
+TEST_F(MasterTest, StateSummaryEndpointCached)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get());
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+
+  // Pause the clock so that the state of the master stays the same.
+  Clock::pause();
+  Clock::settle();
+
+  process::http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+
+  Future<Response> response1 = process::http::get(
+      master.get()->pid,
+      "state-summary",
+      None(),
+      headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response1);
+  ASSERT_TRUE(response1->headers.contains("ETag"));
+
+  const string etag = response1->headers.at("ETag");
+
+  // A repeated request is served from the cache.
+  Future<Response> response2 = process::http::get(
+      master.get()->pid,
+      "state-summary",
+      None(),
+      headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response2);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ(etag, "ETag", response2);
+  EXPECT_EQ(response1->body, response2->body);
+
+  // A request that already has the summary does not get it again.
+  headers["If-None-Match"] = etag;
+
+  Future<Response> response3 = process::http::get(
+      master.get()->pid,
+      "state-summary",
+      None(),
+      headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(NotModified().status, response3);
+  EXPECT_TRUE(response3->body.empty());
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(2, metrics.values["master/state_summary_cache_hits"]);
+  EXPECT_EQ(1, metrics.values["master/state_summary_cache_misses"]);
+
+  Clock::resume();
+
+  // Registering a framework changes the summary.
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  Future<Nothing> registered;
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .WillOnce(FutureSatisfy(&registered));
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillRepeatedly(Return()); // Ignore offers.
+
+  driver.start();
+
+  AWAIT_READY(registered);
+
+  Future<Response> response4 = process::http::get(
+      master.get()->pid,
+      "state-summary",
+      None(),
+      headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response4);
+  ASSERT_TRUE(response4->headers.contains("ETag"));
+  EXPECT_NE(etag, response4->headers.at("ETag"));
+
+  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response4->body);
+  ASSERT_SOME(parse);
+
+  Result<JSON::Array> frameworks = parse->find<JSON::Array>("frameworks");
+  ASSERT_SOME(frameworks);
+  EXPECT_EQ(1u, frameworks->values.size());
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test verifies that executor labels are
 // exposed in the master's state endpoint.
 TEST_F(MasterTest, ExecutorLabels)
@@ -4920,6 +5084,202 @@ TEST_F(MasterTest, RecoverResourcesOrphanedTask)
     .Times(AtMost(1));
 }
 
+
+// A fake agent that only re-registers with the master, with the given
+// running tasks, so that large clusters can be simulated cheaply.
+class TestSlaveProcess : public ProtobufProcess<TestSlaveProcess>
+{
+public:
+  TestSlaveProcess(
+      const UPID& _master,
+      const SlaveInfo& _slaveInfo,
+      const FrameworkInfo& _frameworkInfo,
+      const vector<Task>& _tasks)
+    : ProcessBase(process::ID::generate("test-slave")),
+      master(_master),
+      slaveInfo(_slaveInfo),
+      frameworkInfo(_frameworkInfo),
+      tasks(_tasks) {}
+
+  Future<Nothing> reregistered()
+  {
+    return promise.future();
+  }
+
+protected:
+  virtual void initialize()
+  {
+    install<SlaveReregisteredMessage>(&TestSlaveProcess::_reregistered);
+    install<PingSlaveMessage>(&TestSlaveProcess::ping);
+
+    ReregisterSlaveMessage message;
+    message.mutable_slave()->CopyFrom(slaveInfo);
+    message.add_frameworks()->CopyFrom(frameworkInfo);
+    message.set_version(MESOS_VERSION);
+
+    foreach (const Task& task, tasks) {
+      message.add_tasks()->CopyFrom(task);
+    }
+
+    send(master, message);
+  }
+
+private:
+  void _reregistered(const UPID& from)
+  {
+    promise.set(Nothing());
+  }
+
+  // Keeps the master from marking the agent unreachable.
+  void ping(const UPID& from)
+  {
+    send(from, PongSlaveMessage());
+  }
+
+  const UPID master;
+  const SlaveInfo slaveInfo;
+  const FrameworkInfo frameworkInfo;
+  const vector<Task> tasks;
+
+  Promise<Nothing> promise;
+};
+
+
+class MasterStateQuery_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<size_t> {};
+
+
+// The state query benchmark tests are parameterized by the number of
+// agents, each of them running 10 tasks.
+INSTANTIATE_TEST_CASE_P(
+    AgentCount,
+    MasterStateQuery_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U, 40000U));
+
+
+// Measures the time to first byte, the total time and the increase of
+// the peak memory usage for querying the master's state endpoint, with
+// and without streaming.
+TEST_P(MasterStateQuery_BENCHMARK_Test, State)
+{
+  const size_t agentCount = GetParam();
+  const size_t tasksPerAgent = 10;
+
+  master::Flags flags = CreateMasterFlags();
+  flags.authenticate_agents = false;
+  flags.authenticate_http_readonly = false;
+  flags.registry = "in_memory";
+
+  Try<Owned<cluster::Master>> master = StartMaster(flags);
+  ASSERT_SOME(master);
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->set_value("framework");
+
+  const Resources agentResources =
+    Resources::parse("cpus:16;mem:65536;disk:1048576").get();
+
+  const Resources taskResources = Resources::parse("cpus:0.1;mem:32").get();
+
+  vector<Owned<TestSlaveProcess>> agents;
+  list<Future<Nothing>> reregistered;
+
+  for (size_t i = 0; i < agentCount; i++) {
+    SlaveInfo slaveInfo;
+    slaveInfo.mutable_id()->set_value("agent" + stringify(i));
+    slaveInfo.set_hostname("agent" + stringify(i));
+    slaveInfo.mutable_resources()->CopyFrom(agentResources);
+
+    vector<Task> tasks;
+    for (size_t j = 0; j < tasksPerAgent; j++) {
+      Task task;
+      task.set_name("");
+      task.mutable_task_id()->set_value(
+          "task" + stringify(i) + "-" + stringify(j));
+      task.mutable_slave_id()->CopyFrom(slaveInfo.id());
+      task.mutable_framework_id()->CopyFrom(frameworkInfo.id());
+      task.set_state(TASK_RUNNING);
+      task.mutable_resources()->CopyFrom(taskResources);
+
+      tasks.push_back(task);
+    }
+
+    Owned<TestSlaveProcess> agent(new TestSlaveProcess(
+        master.get()->pid, slaveInfo, frameworkInfo, tasks));
+
+    process::spawn(agent.get());
+
+    reregistered.push_back(agent->reregistered());
+    agents.push_back(agent);
+  }
+
+  AWAIT_READY_FOR(process::collect(reregistered), Minutes(10));
+
+  cout << "Re-registered " << agentCount << " agents with "
+       << tasksPerAgent << " tasks each" << endl;
+
+  // The peak memory usage only ever grows, so the streamed state is
+  // queried first, as it is expected to need less memory.
+  for (bool streaming : {true, false}) {
+    Option<string> query;
+    if (streaming) {
+      query = "stream=true";
+    }
+
+    struct rusage usage;
+    ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &usage));
+    const Bytes peak = Kilobytes(usage.ru_maxrss);
+
+    Stopwatch watch;
+    watch.start();
+
+    Future<Response> response =
+      process::http::streaming::get(master.get()->pid, "state", query);
+
+    AWAIT_READY_FOR(response, Minutes(5));
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    ASSERT_EQ(Response::PIPE, response->type);
+    ASSERT_SOME(response->reader);
+
+    Pipe::Reader reader = response->reader.get();
+
+    Option<Duration> firstByte;
+    size_t bytes = 0;
+
+    while (true) {
+      Future<string> read = reader.read();
+      AWAIT_READY_FOR(read, Minutes(5));
+
+      if (read->empty()) {
+        break;
+      }
+
+      if (firstByte.isNone()) {
+        firstByte = watch.elapsed();
+      }
+
+      bytes += read->size();
+    }
+
+    ASSERT_SOME(firstByte);
+
+    ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &usage));
+
+    cout << (streaming ? "Streamed " : "Serialized ") << Bytes(bytes)
+         << " of state, first byte after " << firstByte.get()
+         << ", last byte after " << watch.elapsed()
+         << ", peak memory usage increased by "
+         << Kilobytes(usage.ru_maxrss) - peak << endl;
+  }
+
+  foreach (const Owned<TestSlaveProcess>& agent, agents) {
+    process::terminate(agent.get());
+    process::wait(agent.get());
+  }
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -34,6 +34,7 @@
 
 #include "common/resources_utils.hpp"
 
+#include "master/constants.hpp"
 #include "master/master.hpp"
 
 #include "master/detector/standalone.hpp"
@@ -324,7 +325,11 @@ TEST_F(OversubscriptionTest, ForwardUpdateSlaveMessage)
 
   EXPECT_EQ(update.get().oversubscribed_resources(), resources);
 
-  // Ensure the metric is updated.
+  // Ensure the metric is updated. The master pushes its gauges
+  // periodically.
+  Clock::advance(master::METRICS_REFRESH_INTERVAL);
+  Clock::settle();
+
   JSON::Object metrics = Metrics();
   ASSERT_EQ(
       1u,
@@ -1056,6 +1056,8 @@ TEST_F(RegistrarTest, Bootstrap)
   }
 
   // Run 2 should see the slave.
+  flags.registry_store_deltas = false;
+
   {
     Registrar registrar(flags, state);
 
@@ -1069,6 +1071,59 @@ TEST_F(RegistrarTest, Bootstrap)
 }
 
 
+// Tests that the operations stored as deltas rather than as part of
+// the entire registry are replayed upon recovery, also by a registrar
+// that does not store deltas itself.
+TEST_F(RegistrarTest, ReplayDeltas)
+{
+  flags.registry_store_deltas = true;
+
+  vector<SlaveInfo> infos;
+  for (int i = 0; i < 10; i++) {
+    SlaveInfo info = slave;
+    info.mutable_id()->set_value(stringify(i));
+    infos.push_back(info);
+  }
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    // Apply the operations one at a time so that each is stored
+    // in a separate delta.
+    foreach (const SlaveInfo& info, infos) {
+      AWAIT_TRUE(registrar.apply(Owned<Operation>(new AdmitSlave(info))));
+    }
+
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new RemoveSlave(infos[0]))));
+
+    TimeInfo unreachableTime = protobuf::getCurrentTime();
+
+    AWAIT_TRUE(registrar.apply(
+        Owned<Operation>(new MarkSlaveUnreachable(infos[1], unreachableTime))));
+  }
+
+  {
+    Registrar registrar(flags, state);
+
+    Future<Registry> registry = registrar.recover(master);
+    AWAIT_READY(registry);
+
+    ASSERT_EQ(8, registry.get().slaves().slaves().size());
+    for (int i = 0; i < 8; i++) {
+      EXPECT_EQ(infos[i + 2], registry.get().slaves().slaves(i).info());
+    }
+
+    ASSERT_EQ(1, registry.get().unreachable().slaves().size());
+    EXPECT_EQ(infos[1].id(), registry.get().unreachable().slaves(0).id());
+
+    // Operations must still apply to the replayed registry.
+    AWAIT_FALSE(registrar.apply(Owned<Operation>(new AdmitSlave(infos[2]))));
+    AWAIT_TRUE(registrar.apply(Owned<Operation>(new AdmitSlave(infos[0]))));
+  }
+}
+
+
 class MockStorage : public Storage
 {
 public:
@@ -1230,9 +1285,6 @@ INSTANTIATE_TEST_CASE_P(
 
 TEST_P(Registrar_BENCHMARK_Test, Performance)
 {
-  Registrar registrar(flags, state);
-  AWAIT_READY(registrar.recover(master));
-
   Attributes attributes = Attributes::parse("foo:bar;baz:quux");
   Resources resources =
     Resources::parse("cpus(*):1.0;mem(*):512;disk(*):2048").get();
@@ -1252,54 +1304,74 @@ TEST_P(Registrar_BENCHMARK_Test, Performance)
     infos.push_back(info);
   }
 
-  // Admit slaves.
-  Stopwatch watch;
-  watch.start();
-  Future<bool> result;
-  foreach (const SlaveInfo& info, infos) {
-    result = registrar.apply(Owned<Operation>(new AdmitSlave(info)));
-  }
-  AWAIT_READY_FOR(result, Minutes(5));
-  LOG(INFO) << "Admitted " << slaveCount << " agents in " << watch.elapsed();
-
-  // Shuffle the slaves so we are readmitting them in random order (
-  // same as in production).
-  std::random_shuffle(infos.begin(), infos.end());
-
-  // Mark slaves reachable again. This simulates the master failing
-  // over, and then the previously registered agents reregistering
-  // with the new master.
-  watch.start();
-  foreach (const SlaveInfo& info, infos) {
-    result = registrar.apply(Owned<Operation>(new MarkSlaveReachable(info)));
-  }
-  AWAIT_READY_FOR(result, Minutes(5));
-  LOG(INFO) << "Marked " << slaveCount
-            << " agents reachable in " << watch.elapsed();
-
-  // Recover slaves.
-  Registrar registrar2(flags, state);
-  watch.start();
-  MasterInfo info;
-  info.set_id("master");
-  info.set_ip(10000000);
-  info.set_port(5050);
-  Future<Registry> registry = registrar2.recover(info);
-  AWAIT_READY(registry);
-  LOG(INFO) << "Recovered " << slaveCount << " agents ("
-            << Bytes(registry.get().ByteSize()) << ") in " << watch.elapsed();
-
-  // Shuffle the slaves so we are removing them in random order (same
-  // as in production).
-  std::random_shuffle(infos.begin(), infos.end());
-
-  // Remove slaves.
-  watch.start();
-  foreach (const SlaveInfo& info, infos) {
-    result = registrar2.apply(Owned<Operation>(new RemoveSlave(info)));
+  // Measure storing the entire registry for each update as well as
+  // storing deltas. All the slaves are removed at the end of each
+  // round, hence both rounds start with an empty registry.
+  foreach (bool storeDeltas, vector<bool>({false, true})) {
+    flags.registry_store_deltas = storeDeltas;
+
+    cout << (storeDeltas ? "Storing deltas" : "Storing the entire registry")
+         << endl;
+
+    Future<bool> result;
+    Stopwatch watch;
+
+    {
+      Registrar registrar(flags, state);
+      AWAIT_READY(registrar.recover(master));
+
+      // Admit slaves.
+      watch.start();
+      foreach (const SlaveInfo& info, infos) {
+        result = registrar.apply(Owned<Operation>(new AdmitSlave(info)));
+      }
+      AWAIT_READY_FOR(result, Minutes(5));
+      cout << "Admitted " << slaveCount << " agents in "
+           << watch.elapsed() << endl;
+
+      // Shuffle the slaves so we are readmitting them in random order
+      // (same as in production).
+      std::random_shuffle(infos.begin(), infos.end());
+
+      // Mark slaves reachable again. This simulates the master failing
+      // over, and then the previously registered agents reregistering
+      // with the new master.
+      watch.start();
+      foreach (const SlaveInfo& info, infos) {
+        result =
+          registrar.apply(Owned<Operation>(new MarkSlaveReachable(info)));
+      }
+      AWAIT_READY_FOR(result, Minutes(5));
+      cout << "Marked " << slaveCount
+           << " agents reachable in " << watch.elapsed() << endl;
+    }
+
+    // Recover slaves.
+    Registrar registrar2(flags, state);
+    watch.start();
+    MasterInfo info;
+    info.set_id("master");
+    info.set_ip(10000000);
+    info.set_port(5050);
+    Future<Registry> registry = registrar2.recover(info);
+    AWAIT_READY(registry);
+    cout << "Recovered " << slaveCount << " agents ("
+         << Bytes(registry.get().ByteSize()) << ") in "
+         << watch.elapsed() << endl;
+
+    // Shuffle the slaves so we are removing them in random order (same
+    // as in production).
+    std::random_shuffle(infos.begin(), infos.end());
+
+    // Remove slaves.
+    watch.start();
+    foreach (const SlaveInfo& info, infos) {
+      result = registrar2.apply(Owned<Operation>(new RemoveSlave(info)));
+    }
+    AWAIT_READY_FOR(result, Minutes(5));
+    cout << "Removed " << slaveCount << " agents in "
+         << watch.elapsed() << endl;
   }
-  AWAIT_READY_FOR(result, Minutes(5));
-  cout << "Removed " << slaveCount << " agents in " << watch.elapsed() << endl;
 }
 
 
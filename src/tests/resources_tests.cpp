@@ -27,6 +27,8 @@
 #include <stout/json.hpp>
 #include <stout/protobuf.hpp>
 
+#include "common/resource_quantities.hpp"
+
 #include "master/master.hpp"
 
 #include "tests/mesos.hpp"
@@ -2301,6 +2303,104 @@ TEST(ResourcesOperationTest, StrippedResourcesNonScalar)
 }
 
 
+TEST(ResourceQuantitiesTest, FromScalarResources)
+{
+  Resources resources = Resources::parse(
+      "cpus:1;mem:512;ports:[31000-32000];cpus(role):2;mem(role):64").get();
+
+  resources += Resources::parse("mem:128").get().flatten(
+      "role", createReservationInfo("principal")).get();
+  resources += createDiskResource("200", "role", "1", "path");
+
+  Resource revocable = Resources::parse("cpus", "4", "*").get();
+  revocable.mutable_revocable();
+
+  resources += revocable;
+
+  ResourceQuantities quantities =
+    ResourceQuantities::fromScalarResources(resources);
+
+  EXPECT_EQ(resources.createStrippedScalarQuantity(),
+            quantities.toResources());
+
+  EXPECT_FLOAT_EQ(7, quantities.get("cpus").value());
+  EXPECT_FLOAT_EQ(704, quantities.get("mem").value());
+  EXPECT_FLOAT_EQ(200, quantities.get("disk").value());
+  EXPECT_FLOAT_EQ(0, quantities.get("ports").value());
+  EXPECT_FLOAT_EQ(0, quantities.get("gpus").value());
+
+  EXPECT_EQ(Resources::parse("cpus:3;mem:704;disk:200").get() + revocable,
+            quantities.flatten().toResources());
+}
+
+
+TEST(ResourceQuantitiesTest, Arithmetic)
+{
+  Resources left = Resources::parse("cpus:1.5;mem:512;cpus(role):2").get();
+  Resources right = Resources::parse("cpus:0.001;mem:1024;disk:10").get();
+
+  ResourceQuantities leftQuantities =
+    ResourceQuantities::fromScalarResources(left);
+  ResourceQuantities rightQuantities =
+    ResourceQuantities::fromScalarResources(right);
+
+  EXPECT_EQ((left + right).createStrippedScalarQuantity(),
+            (leftQuantities + rightQuantities).toResources());
+
+  // Like for `Resources`, quantities that drop to zero or below are
+  // removed and the other quantities are ignored.
+  EXPECT_EQ((left - right).createStrippedScalarQuantity(),
+            (leftQuantities - rightQuantities).toResources());
+  EXPECT_EQ((right - left).createStrippedScalarQuantity(),
+            (rightQuantities - leftQuantities).toResources());
+
+  ResourceQuantities total;
+  total += leftQuantities;
+  total += rightQuantities;
+  total -= leftQuantities;
+
+  EXPECT_EQ(rightQuantities, total);
+
+  total -= rightQuantities;
+
+  EXPECT_TRUE(total.empty());
+
+  // Fixed point arithmetic is used, as for `Value::Scalar`.
+  ResourceQuantities tenth =
+    ResourceQuantities::fromScalarResources(Resources::parse("cpus:0.1").get());
+
+  for (int i = 0; i < 10; i++) {
+    total += tenth;
+  }
+
+  EXPECT_EQ(ResourceQuantities::fromScalarResources(
+                Resources::parse("cpus:1").get()),
+            total);
+}
+
+
+TEST(ResourceQuantitiesTest, Contains)
+{
+  ResourceQuantities quantities = ResourceQuantities::fromScalarResources(
+      Resources::parse("cpus:2;mem:512;cpus(role):1").get());
+
+  EXPECT_TRUE(quantities.contains(ResourceQuantities()));
+  EXPECT_TRUE(quantities.contains(quantities));
+
+  EXPECT_TRUE(quantities.contains(ResourceQuantities::fromScalarResources(
+      Resources::parse("cpus:2;cpus(role):0.5").get())));
+
+  EXPECT_FALSE(quantities.contains(ResourceQuantities::fromScalarResources(
+      Resources::parse("cpus:2.001").get())));
+
+  EXPECT_FALSE(quantities.contains(ResourceQuantities::fromScalarResources(
+      Resources::parse("mem(role):1").get())));
+
+  EXPECT_FALSE(quantities.contains(ResourceQuantities::fromScalarResources(
+      Resources::parse("disk:1").get())));
+}
+
+
 TEST(ResourcesOperationTest, CreatePersistentVolumeFromMount)
 {
   Resource::DiskInfo::Source source = createDiskSourceMount("mnt");
@@ -2800,6 +2900,21 @@ public:
     ranges.resources = Resources::parse("ports:[" + ports + "]").get();
     ranges.totalOperations = 1000;
 
+    // Test the performance of ranges on an agent that advertises a
+    // large port range which has been fragmented by tasks taking
+    // ports: [1-2,4-5,7-8,...,30000].
+    ports.clear();
+    for (int portBegin = 1; portBegin < 30000-1; portBegin = portBegin + 3) {
+      if (!ports.empty()) {
+        ports += ",";
+      }
+      ports += stringify(portBegin) + "-" + stringify(portBegin+1);
+    }
+
+    Parameter fragmented;
+    fragmented.resources = Resources::parse("ports:[" + ports + "]").get();
+    fragmented.totalOperations = 100;
+
     // Test a typical vector of scalars which include shared resources
     // (viz, shared persistent volumes).
     Resource disk = createDiskResource(
@@ -2812,6 +2927,7 @@ public:
     parameters_.push_back(std::move(scalars));
     parameters_.push_back(std::move(reservations));
     parameters_.push_back(std::move(ranges));
+    parameters_.push_back(std::move(fragmented));
     parameters_.push_back(std::move(shared));
 
     return parameters_;
@@ -2891,6 +3007,37 @@ TEST_P(Resources_BENCHMARK_Test, Arithmetic)
        << " on " << abbreviate(stringify(resources), 50) << endl;
 
   ASSERT_TRUE(total.empty()) << total;
+
+  // The allocator and the sorters perform the arithmetic on the
+  // compact quantities of the resources instead.
+  const ResourceQuantities quantities =
+    ResourceQuantities::fromScalarResources(resources);
+
+  ResourceQuantities totalQuantities;
+
+  watch.start();
+  for (size_t i = 0; i < totalOperations; i++) {
+    totalQuantities += quantities;
+  }
+  watch.stop();
+
+  cout << "Took " << watch.elapsed()
+       << " to perform " << totalOperations << " 'total += r' operations"
+       << " on the quantities of "
+       << abbreviate(stringify(resources), 50) << endl;
+
+  watch.start();
+  for (size_t i = 0; i < totalOperations; i++) {
+    totalQuantities -= quantities;
+  }
+  watch.stop();
+
+  cout << "Took " << watch.elapsed()
+       << " to perform " << totalOperations << " 'total -= r' operations"
+       << " on the quantities of "
+       << abbreviate(stringify(resources), 50) << endl;
+
+  ASSERT_TRUE(totalQuantities.empty()) << totalQuantities;
 }
 
 
@@ -2954,6 +3101,55 @@ TEST_F(Resources_Filter_BENCHMARK_Test, Filters)
        << " on " << stringify(reserved) << endl;
 }
 
+
+class Resources_Ranges_BENCHMARK_Test : public ::testing::Test {};
+
+
+// This benchmark mimics the ports of an agent with a large port range
+// that get fragmented as tasks take (and later return) single ports.
+TEST_F(Resources_Ranges_BENCHMARK_Test, Fragmentation)
+{
+  const size_t totalPorts = 30000u;
+
+  const Resources total =
+    Resources::parse("ports:[1-" + stringify(totalPorts) + "]").get();
+
+  // Every other port is taken, which leaves the most ranges behind.
+  vector<Resources> taken;
+  for (size_t port = 1; port <= totalPorts; port += 2) {
+    taken.push_back(Resources::parse(
+        "ports:[" + stringify(port) + "-" + stringify(port) + "]").get());
+  }
+
+  Resources available = total;
+
+  Stopwatch watch;
+
+  watch.start();
+  foreach (const Resources& resources, taken) {
+    ASSERT_TRUE(available.contains(resources));
+
+    available -= resources;
+  }
+  watch.stop();
+
+  cout << "Took " << watch.elapsed()
+       << " to take " << taken.size() << " single ports out of "
+       << abbreviate(stringify(total), 50) << endl;
+
+  watch.start();
+  foreach (const Resources& resources, taken) {
+    available += resources;
+  }
+  watch.stop();
+
+  cout << "Took " << watch.elapsed()
+       << " to return " << taken.size() << " single ports to "
+       << abbreviate(stringify(available), 50) << endl;
+
+  ASSERT_EQ(total, available);
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
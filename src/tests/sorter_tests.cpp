@@ -17,15 +17,22 @@
 #include <stdarg.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <gmock/gmock.h>
 
 #include <mesos/resources.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/stringify.hpp>
 
 #include "master/allocator/sorter/drf/sorter.hpp"
 
@@ -38,6 +45,7 @@ using ::testing::WithParamInterface;
 using std::cout;
 using std::endl;
 using std::string;
+using std::tuple;
 using std::vector;
 
 namespace mesos {
@@ -685,6 +693,53 @@ TEST_P(Sorter_BENCHMARK_Test, FullSort)
   cout << "No-op sort of " << clientCount << " clients took "
        << watch.elapsed() << endl;
 
+  // Number of rounds for each of the churn scenarios below.
+  const size_t churnRounds = 100;
+
+  Resources churned = Resources::parse("cpus:1;mem:128").get();
+
+  watch.start();
+  {
+    // Churn the allocations: each round allocates some resources to
+    // a client and sorts (as done by an allocation cycle) and then
+    // recovers them (e.g., because the offer got declined).
+    for (size_t i = 0; i < churnRounds; i++) {
+      const SlaveID& slaveId = agents[i % agents.size()];
+      const string& client = clients[i % clients.size()];
+
+      sorter.allocated(client, slaveId, churned);
+      sorter.sort();
+      sorter.unallocated(client, slaveId, churned);
+    }
+  }
+  watch.stop();
+
+  cout << "Sort of " << clientCount << " clients after allocation churn took "
+       << watch.elapsed() / churnRounds << " on average" << endl;
+
+  SlaveID churnedAgent;
+  churnedAgent.set_value("churned");
+
+  Resources churnedAgentResources = Resources::parse("cpus:24;mem:4096").get();
+
+  watch.start();
+  {
+    // Churn the agents: each round adds an agent and removes it again
+    // (e.g., because it got partitioned), sorting after each change
+    // of the total resources.
+    for (size_t i = 0; i < churnRounds; i++) {
+      sorter.add(churnedAgent, churnedAgentResources);
+      sorter.sort();
+
+      sorter.remove(churnedAgent, churnedAgentResources);
+      sorter.sort();
+    }
+  }
+  watch.stop();
+
+  cout << "Sort of " << clientCount << " clients after agent churn took "
+       << watch.elapsed() / (churnRounds * 2) << " on average" << endl;
+
   watch.start();
   {
     // Unallocate resources on all agents, round-robin through the clients.
@@ -811,6 +866,220 @@ TEST(SorterTest, SharedResources)
   EXPECT_EQ(3, sorter.count());
 }
 
+
+// Tests that the order that the sorter maintains incrementally matches
+// the order obtained by recalculating all the shares from scratch,
+// through a random sequence of changes to the clients, their
+// allocations and the total resources.
+TEST(SorterTest, IncrementalSortMatchesFullRecalculation)
+{
+  // A fixed seed keeps failures reproducible.
+  std::mt19937 random(42);
+
+  auto uniform = [&random](size_t min, size_t max) {
+    return std::uniform_int_distribution<size_t>(min, max)(random);
+  };
+
+  // Integral quantities are used so that the shares calculated below
+  // are exactly the ones calculated by the sorter.
+  auto resources = [&uniform](size_t scale) {
+    return Resources::parse(
+        "cpus:" + stringify(uniform(1, 4) * scale) +
+        ";mem:" + stringify(uniform(1, 64) * scale) +
+        ";disk:" + stringify(uniform(1, 32) * scale)).get();
+  };
+
+  // The state of the sorter, from which the order is recalculated.
+  struct Client
+  {
+    double weight;
+    bool active;
+    size_t allocations;
+    hashmap<SlaveID, Resources> allocated;
+  };
+
+  hashmap<string, Client> clients;
+  hashmap<SlaveID, Resources> totals;
+
+  auto sorted = [&clients, &totals]() {
+    hashmap<string, double> total;
+    foreachvalue (const Resources& resources, totals) {
+      foreach (const Resource& resource, resources) {
+        total[resource.name()] += resource.scalar().value();
+      }
+    }
+
+    vector<tuple<double, size_t, string>> order;
+    foreachpair (const string& name, const Client& client, clients) {
+      if (!client.active) {
+        continue;
+      }
+
+      hashmap<string, double> allocated;
+      foreachvalue (const Resources& resources, client.allocated) {
+        foreach (const Resource& resource, resources) {
+          allocated[resource.name()] += resource.scalar().value();
+        }
+      }
+
+      double share = 0.0;
+      foreachpair (const string& resourceName, double quantity, total) {
+        if (quantity > 0.0 && allocated.contains(resourceName)) {
+          share = std::max(share, allocated.at(resourceName) / quantity);
+        }
+      }
+
+      order.push_back(
+          std::make_tuple(share / client.weight, client.allocations, name));
+    }
+
+    std::sort(order.begin(), order.end());
+
+    vector<string> names;
+    foreach (const auto& client, order) {
+      names.push_back(std::get<2>(client));
+    }
+
+    return names;
+  };
+
+  auto pick = [&uniform](const vector<string>& names) {
+    return names[uniform(0, names.size() - 1)];
+  };
+
+  const double weights[] = {0.5, 1.0, 2.0, 3.0};
+
+  DRFSorter sorter;
+
+  size_t nextClient = 0;
+  size_t nextAgent = 0;
+
+  for (size_t i = 0; i < 2000; i++) {
+    const hashset<string> clientNames = clients.keys();
+    const vector<string> names(clientNames.begin(), clientNames.end());
+
+    const hashset<SlaveID> agentIds = totals.keys();
+    const vector<SlaveID> agents(agentIds.begin(), agentIds.end());
+
+    switch (uniform(0, 9)) {
+      case 0: {
+        if (clients.size() < 10) {
+          const string name = "client" + stringify(nextClient++);
+          const double weight = weights[uniform(0, 3)];
+
+          sorter.add(name, weight);
+          clients[name] = Client{weight, true, 0, {}};
+        }
+        break;
+      }
+      case 1: {
+        if (!names.empty()) {
+          const string name = pick(names);
+
+          sorter.remove(name);
+          clients.erase(name);
+        }
+        break;
+      }
+      case 2:
+      case 3: {
+        if (!names.empty() && !agents.empty()) {
+          const string name = pick(names);
+          const SlaveID agent = agents[uniform(0, agents.size() - 1)];
+          const Resources allocation = resources(1);
+
+          sorter.allocated(name, agent, allocation);
+
+          clients[name].allocated[agent] += allocation;
+          if (clients[name].active) {
+            clients[name].allocations++;
+          }
+        }
+        break;
+      }
+      case 4: {
+        if (!names.empty()) {
+          const string name = pick(names);
+
+          if (!clients[name].allocated.empty()) {
+            const SlaveID agent = clients[name].allocated.begin()->first;
+
+            sorter.unallocated(
+                name, agent, clients[name].allocated.at(agent));
+
+            clients[name].allocated.erase(agent);
+          }
+        }
+        break;
+      }
+      case 5: {
+        if (totals.size() < 10) {
+          SlaveID agent;
+          agent.set_value("agent" + stringify(nextAgent++));
+
+          const Resources total = resources(10);
+
+          sorter.add(agent, total);
+          totals[agent] = total;
+        }
+        break;
+      }
+      case 6: {
+        if (!agents.empty()) {
+          const SlaveID agent = agents[uniform(0, agents.size() - 1)];
+
+          sorter.remove(agent, totals.at(agent));
+          totals.erase(agent);
+        }
+        break;
+      }
+      case 7: {
+        // Update the total resources of an agent.
+        if (!agents.empty()) {
+          const SlaveID agent = agents[uniform(0, agents.size() - 1)];
+          const Resources total = resources(10);
+
+          sorter.remove(agent, totals.at(agent));
+          sorter.add(agent, total);
+          totals[agent] = total;
+        }
+        break;
+      }
+      case 8: {
+        if (!names.empty()) {
+          const string name = pick(names);
+          const double weight = weights[uniform(0, 3)];
+
+          sorter.update(name, weight);
+          clients[name].weight = weight;
+        }
+        break;
+      }
+      case 9: {
+        if (!names.empty()) {
+          const string name = pick(names);
+
+          if (clients[name].active) {
+            sorter.deactivate(name);
+            clients[name].active = false;
+          } else {
+            sorter.activate(name);
+            clients[name].active = true;
+            clients[name].allocations = 0;
+          }
+        }
+        break;
+      }
+    }
+
+    // Like the allocator, sort only every few changes so that the
+    // sorter accumulates several changes between sorts.
+    if (uniform(0, 2) == 0) {
+      ASSERT_EQ(sorted(), sorter.sort()) << "after change " << i;
+    }
+  }
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
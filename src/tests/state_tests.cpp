@@ -77,6 +77,7 @@ using mesos::state::ZooKeeperStorage;
 using mesos::state::protobuf::State;
 using mesos::state::protobuf::Variable;
 
+using mesos::internal::state::Entry;
 using mesos::internal::state::Operation;
 
 namespace mesos {
@@ -691,6 +692,186 @@ TEST_F(LogStateTest, Diff)
 }
 
 
+// This test verifies that concurrent stores are all applied, even
+// though they might be written to the log in batches.
+TEST_F(LogStateTest, ConcurrentStores)
+{
+  const size_t count = 10;
+
+  vector<Variable<Slaves>> variables;
+
+  for (size_t i = 0; i < count; i++) {
+    Future<Variable<Slaves>> future = state->fetch<Slaves>(
+        "slaves" + stringify(i));
+
+    AWAIT_READY(future);
+
+    Slaves slaves = future.get().get();
+    slaves.add_slaves()->mutable_info()->set_hostname(
+        "localhost" + stringify(i));
+
+    variables.push_back(future.get().mutate(slaves));
+  }
+
+  list<Future<Option<Variable<Slaves>>>> stores;
+
+  foreach (const Variable<Slaves>& variable, variables) {
+    stores.push_back(state->store(variable));
+  }
+
+  foreach (const Future<Option<Variable<Slaves>>>& store, stores) {
+    AWAIT_READY(store);
+    EXPECT_SOME(store.get());
+  }
+
+  // A store with a stale version must fail.
+  Future<Option<Variable<Slaves>>> stale = state->store(variables.front());
+  AWAIT_READY(stale);
+  EXPECT_NONE(stale.get());
+
+  // Now read the log with another storage.
+  mesos::state::LogStorage storage2(log);
+  State state2(&storage2);
+
+  for (size_t i = 0; i < count; i++) {
+    Future<Variable<Slaves>> future = state2.fetch<Slaves>(
+        "slaves" + stringify(i));
+
+    AWAIT_READY(future);
+
+    Slaves slaves = future.get().get();
+    ASSERT_EQ(1, slaves.slaves().size());
+    EXPECT_EQ("localhost" + stringify(i), slaves.slaves(0).info().hostname());
+  }
+}
+
+
+// This test verifies that concurrent stores are written as a single
+// batch entry when batching operations is enabled, and that they are
+// read back from the log.
+TEST_F(LogStateTest, ConcurrentStoresBatchOperations)
+{
+  const size_t count = 10;
+
+  mesos::state::LogStorage storage2(log, 0, true);
+  State state2(&storage2);
+
+  vector<Variable<Slaves>> variables;
+
+  for (size_t i = 0; i < count; i++) {
+    Future<Variable<Slaves>> future = state2.fetch<Slaves>(
+        "slaves" + stringify(i));
+
+    AWAIT_READY(future);
+
+    Slaves slaves = future.get().get();
+    slaves.add_slaves()->mutable_info()->set_hostname(
+        "localhost" + stringify(i));
+
+    variables.push_back(future.get().mutate(slaves));
+  }
+
+  list<Future<Option<Variable<Slaves>>>> stores;
+
+  foreach (const Variable<Slaves>& variable, variables) {
+    stores.push_back(state2.store(variable));
+  }
+
+  foreach (const Future<Option<Variable<Slaves>>>& store, stores) {
+    AWAIT_READY(store);
+    EXPECT_SOME(store.get());
+  }
+
+  // See the comment in 'Diff' as to why we settle the clock.
+  Clock::pause();
+  Clock::settle();
+  Clock::resume();
+
+  Log::Reader reader(log);
+
+  Future<Log::Position> beginning = reader.beginning();
+  Future<Log::Position> ending = reader.ending();
+
+  AWAIT_READY(beginning);
+  AWAIT_READY(ending);
+
+  Future<list<Log::Entry>> entries = reader.read(beginning.get(), ending.get());
+
+  AWAIT_READY(entries);
+
+  bool batched = false;
+
+  foreach (const Log::Entry& entry, entries.get()) {
+    Operation operation;
+    ASSERT_TRUE(operation.ParseFromString(entry.data));
+
+    if (operation.type() == Operation::BATCH) {
+      batched = true;
+    }
+  }
+
+  EXPECT_TRUE(batched);
+
+  // Now read the log with the storage of the fixture.
+  for (size_t i = 0; i < count; i++) {
+    Future<Variable<Slaves>> future = state->fetch<Slaves>(
+        "slaves" + stringify(i));
+
+    AWAIT_READY(future);
+
+    Slaves slaves = future.get().get();
+    ASSERT_EQ(1, slaves.slaves().size());
+    EXPECT_EQ("localhost" + stringify(i), slaves.slaves(0).info().hostname());
+  }
+}
+
+
+// This test verifies that the entries written in a batch are read
+// back from the log.
+TEST_F(LogStateTest, Batch)
+{
+  Operation operation;
+  operation.set_type(Operation::BATCH);
+
+  for (size_t i = 0; i < 2; i++) {
+    Entry entry;
+    entry.set_name("name" + stringify(i));
+    entry.set_uuid(UUID::random().toBytes());
+    entry.set_value("value" + stringify(i));
+
+    Operation* snapshot = operation.mutable_batch()->add_operations();
+    snapshot->set_type(Operation::SNAPSHOT);
+    snapshot->mutable_snapshot()->mutable_entry()->CopyFrom(entry);
+  }
+
+  string value;
+  ASSERT_TRUE(operation.SerializeToString(&value));
+
+  {
+    Log::Writer writer(log);
+
+    Future<Option<Log::Position>> start = writer.start();
+    AWAIT_READY(start);
+    ASSERT_SOME(start.get());
+
+    Future<Option<Log::Position>> append = writer.append(value);
+    AWAIT_READY(append);
+    ASSERT_SOME(append.get());
+  }
+
+  Future<set<string>> names = storage->names();
+  AWAIT_READY(names);
+  EXPECT_EQ(set<string>({"name0", "name1"}), names.get());
+
+  for (size_t i = 0; i < 2; i++) {
+    Future<Option<Entry>> entry = storage->get("name" + stringify(i));
+    AWAIT_READY(entry);
+    ASSERT_SOME(entry.get());
+    EXPECT_EQ("value" + stringify(i), entry.get().get().value());
+  }
+}
+
+
 #ifdef MESOS_HAS_JAVA
 class ZooKeeperStateTest : public tests::ZooKeeperTest
 {
@@ -472,6 +472,75 @@ TEST(ValuesTest, RangesSubtraction)
   ranges2 = parse("[1-2]").get().ranges();
 
   EXPECT_EQ(parse("[3-8]").get().ranges(), ranges1 - ranges2);
+
+  // Spans multiple ranges.
+  ranges1 = parse("[1-4, 6-8, 10-12, 14-20]").get().ranges();
+  ranges2 = parse("[3-11, 15-15]").get().ranges();
+
+  EXPECT_EQ(parse("[1-2, 12-12, 14-14, 16-20]").get().ranges(),
+            ranges1 - ranges2);
+}
+
+
+// Test arithmetic on ranges that are not sorted.
+TEST(ValuesTest, RangesUnsorted)
+{
+  Value::Ranges ranges1;
+  Value::Range* range = ranges1.add_range();
+  range->set_begin(7);
+  range->set_end(8);
+  range = ranges1.add_range();
+  range->set_begin(3);
+  range->set_end(5);
+
+  Value::Ranges ranges2 = parse("[6-6]").get().ranges();
+
+  EXPECT_EQ(parse("[3-5, 7-8]").get().ranges(), ranges1);
+  EXPECT_EQ(parse("[3-8]").get().ranges(), ranges1 + ranges2);
+  EXPECT_EQ(parse("[3-5, 8-8]").get().ranges(),
+            ranges1 - parse("[7-7]").get().ranges());
+
+  EXPECT_TRUE(parse("[4-5, 7-7]").get().ranges() <= ranges1);
+  EXPECT_FALSE(parse("[5-7]").get().ranges() <= ranges1);
+}
+
+
+// Test taking single ports out of a range one at a time and returning
+// them again, which fragments the range.
+TEST(ValuesTest, RangesFragmentation)
+{
+  Value::Ranges total = parse("[1-1000]").get().ranges();
+  Value::Ranges ranges = total;
+
+  for (uint64_t port = 1; port <= 1000; port += 2) {
+    Value::Ranges taken;
+    Value::Range* range = taken.add_range();
+    range->set_begin(port);
+    range->set_end(port);
+
+    EXPECT_TRUE(taken <= ranges);
+
+    ranges -= taken;
+
+    EXPECT_FALSE(taken <= ranges);
+    EXPECT_TRUE(ranges <= total);
+  }
+
+  EXPECT_EQ(500, ranges.range_size());
+  EXPECT_EQ(2u, ranges.range(0).begin());
+  EXPECT_EQ(1000u, ranges.range(499).end());
+
+  for (int port = 999; port >= 1; port -= 2) {
+    Value::Ranges returned;
+    Value::Range* range = returned.add_range();
+    range->set_begin(port);
+    range->set_end(port);
+
+    ranges += returned;
+  }
+
+  EXPECT_EQ(total, ranges);
+  EXPECT_EQ(1, ranges.range_size());
 }
 
 } // namespace tests {
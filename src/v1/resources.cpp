@@ -665,6 +665,12 @@ Option<Error> Resources::validate(const Resource& resource)
       return Error("Invalid ranges resource");
     }
 
+    // Ranges are typically kept sorted (see the `Value::Ranges`
+    // arithmetic), in which case they don't overlap if each range
+    // ends before the next one begins. This lets us avoid checking
+    // each pair of ranges for ports resources with many ranges.
+    bool sorted = true;
+
     for (int i = 0; i < resource.ranges().range_size(); i++) {
       const Value::Range& range = resource.ranges().range(i);
 
@@ -673,6 +679,14 @@ Option<Error> Resources::validate(const Resource& resource)
         return Error("Invalid ranges resource: begin > end");
       }
 
+      if (i > 0 && resource.ranges().range(i - 1).end() >= range.begin()) {
+        sorted = false;
+      }
+    }
+
+    for (int i = 0; !sorted && i < resource.ranges().range_size(); i++) {
+      const Value::Range& range = resource.ranges().range(i);
+
       // Ensure ranges don't overlap (but not necessarily coalesced).
       for (int j = i + 1; j < resource.ranges().range_size(); j++) {
         if (range.begin() <= resource.ranges().range(j).begin() &&
@@ -960,18 +974,25 @@ Resources::Resources(const RepeatedPtrField<Resource>& _resources)
 
 bool Resources::contains(const Resources& that) const
 {
-  Resources remaining = *this;
+  // NOTE: Only persistent volumes need to be subtracted as we go, so
+  // we only copy the resources (which can be large, e.g., fragmented
+  // port ranges) if there are any.
+  Option<Resources> remaining;
 
   foreach (const Resource_& resource_, that.resources) {
     // NOTE: We use _contains because Resources only contain valid
     // Resource objects, and we don't want the performance hit of the
     // validity check.
-    if (!remaining._contains(resource_)) {
+    if (!(remaining.isSome() ? remaining.get() : *this)._contains(resource_)) {
       return false;
     }
 
     if (isPersistentVolume(resource_.resource)) {
-      remaining.subtract(resource_);
+      if (remaining.isNone()) {
+        remaining = *this;
+      }
+
+      remaining->subtract(resource_);
     }
   }
 